@@ -55,6 +55,10 @@ int g_api_version = 0;
 static_assert( sizeof(FDBKeyValue) == sizeof(KeyValueRef),
 			   "FDBKeyValue / KeyValueRef size mismatch" );
 
+/* Likewise for returning Standalone<VectorRef<KeyRef>> as an array of FDBKey. */
+static_assert( sizeof(FDBKey) == sizeof(KeyRef),
+			   "FDBKey / KeyRef size mismatch" );
+
 
 #define TSAV_ERROR(type, error) ((FDBFuture*)(ThreadFuture<type>(error())).extractPtr())
 
@@ -238,6 +242,14 @@ fdb_error_t fdb_future_get_database_v609( FDBFuture* f, FDBDatabase** out_databa
 		( (TSAV( Reference<IDatabase>, f )->get() ).extractPtr() ); );
 }
 
+extern "C" DLLEXPORT
+fdb_error_t fdb_future_get_key_array( FDBFuture* f, FDBKey const** out_key_array, int* out_count ) {
+	CATCH_AND_RETURN(
+		Standalone<VectorRef<KeyRef>> na = TSAV(Standalone<VectorRef<KeyRef>>, f)->get();
+		*out_key_array = (FDBKey*) na.begin();
+		*out_count = na.size(); );
+}
+
 extern "C" DLLEXPORT
 fdb_error_t fdb_future_get_value( FDBFuture* f, fdb_bool_t* out_present,
 								  uint8_t const** out_value, int* out_value_length ) {
@@ -270,6 +282,20 @@ fdb_error_t fdb_future_get_keyvalue_array_v13(
 		*out_count = rrr.size(); );
 }
 
+static_assert(sizeof(FDBMappedKeyValue) == sizeof(MappedKeyValueRef), "FDBMappedKeyValue must match the layout of MappedKeyValueRef");
+
+extern "C" DLLEXPORT
+fdb_error_t fdb_future_get_mappedkeyvalue_array(
+	FDBFuture* f, FDBMappedKeyValue const** out_kv,
+	int* out_count, fdb_bool_t* out_more )
+{
+	CATCH_AND_RETURN(
+		Standalone<MappedRangeResultRef> rrr = TSAV(Standalone<MappedRangeResultRef>, f)->get();
+		*out_kv = (FDBMappedKeyValue*)rrr.begin();
+		*out_count = rrr.size();
+		*out_more = rrr.more; );
+}
+
 extern "C" DLLEXPORT
 fdb_error_t fdb_future_get_string_array(
 	FDBFuture* f, const char*** out_strings, int* out_count)
@@ -422,21 +448,11 @@ FDBFuture* fdb_transaction_get_addresses_for_key( FDBTransaction* tr, uint8_t co
 
 }
 
-FDBFuture* fdb_transaction_get_range_impl(
-		FDBTransaction* tr, uint8_t const* begin_key_name,
-		int begin_key_name_length, fdb_bool_t begin_or_equal, int begin_offset,
-		uint8_t const* end_key_name, int end_key_name_length,
-		fdb_bool_t end_or_equal, int end_offset, int limit, int target_bytes,
-		FDBStreamingMode mode, int iteration, fdb_bool_t snapshot,
-		fdb_bool_t reverse )
+/* Translates the limits and streaming mode accepted by the range read functions into GetRangeLimits, or returns the
+   error to report */
+Optional<Error> fdb_range_limits( int limit, int target_bytes, FDBStreamingMode mode, int iteration,
+                                  GetRangeLimits* out_limits )
 {
-	/* This method may be called with a runtime API version of 13, in
-	   which negative row limits are a reverse range read */
-	if (g_api_version <= 13 && limit < 0) {
-		limit = -limit;
-		reverse = true;
-	}
-
 	/* Zero at the C API maps to "infinity" at lower levels */
 	if (!limit)
 		limit = CLIENT_KNOBS->ROW_LIMIT_UNLIMITED;
@@ -445,7 +461,7 @@ FDBFuture* fdb_transaction_get_range_impl(
 
 	/* Unlimited/unlimited with mode _EXACT isn't permitted */
 	if (limit == CLIENT_KNOBS->ROW_LIMIT_UNLIMITED && target_bytes == CLIENT_KNOBS->BYTE_LIMIT_UNLIMITED && mode == FDB_STREAMING_MODE_EXACT)
-		return TSAV_ERROR(Standalone<RangeResultRef>, exact_mode_without_limits);
+		return exact_mode_without_limits();
 
 	/* _ITERATOR mode maps to one of the known streaming modes
 	   depending on iteration */
@@ -464,7 +480,7 @@ FDBFuture* fdb_transaction_get_range_impl(
 	int mode_bytes;
 	if (mode == FDB_STREAMING_MODE_ITERATOR) {
 		if (iteration <= 0)
-			return TSAV_ERROR(Standalone<RangeResultRef>, client_invalid_operation);
+			return client_invalid_operation();
 
 		iteration = std::min(iteration, max_iteration);
 		mode_bytes = iteration_progression[iteration - 1];
@@ -472,13 +488,37 @@ FDBFuture* fdb_transaction_get_range_impl(
 	else if(mode >= 0 && mode <= FDB_STREAMING_MODE_SERIAL)
 		mode_bytes = mode_bytes_array[mode];
 	else
-		return TSAV_ERROR(Standalone<RangeResultRef>, client_invalid_operation);
+		return client_invalid_operation();
 
 	if(target_bytes == CLIENT_KNOBS->BYTE_LIMIT_UNLIMITED)
 		target_bytes = mode_bytes;
 	else if(mode_bytes != CLIENT_KNOBS->BYTE_LIMIT_UNLIMITED)
 		target_bytes = std::min(target_bytes, mode_bytes);
 
+	*out_limits = GetRangeLimits(limit, target_bytes);
+	return Optional<Error>();
+}
+
+FDBFuture* fdb_transaction_get_range_impl(
+		FDBTransaction* tr, uint8_t const* begin_key_name,
+		int begin_key_name_length, fdb_bool_t begin_or_equal, int begin_offset,
+		uint8_t const* end_key_name, int end_key_name_length,
+		fdb_bool_t end_or_equal, int end_offset, int limit, int target_bytes,
+		FDBStreamingMode mode, int iteration, fdb_bool_t snapshot,
+		fdb_bool_t reverse )
+{
+	/* This method may be called with a runtime API version of 13, in
+	   which negative row limits are a reverse range read */
+	if (g_api_version <= 13 && limit < 0) {
+		limit = -limit;
+		reverse = true;
+	}
+
+	GetRangeLimits limits;
+	Optional<Error> error = fdb_range_limits(limit, target_bytes, mode, iteration, &limits);
+	if (error.present())
+		return (FDBFuture*)ThreadFuture<Standalone<RangeResultRef>>(error.get()).extractPtr();
+
 	return (FDBFuture*)( TXN(tr)->getRange(
 							 KeySelectorRef(
 								 KeyRef( begin_key_name,
@@ -488,7 +528,30 @@ FDBFuture* fdb_transaction_get_range_impl(
 								 KeyRef( end_key_name,
 										 end_key_name_length ),
 								 end_or_equal, end_offset ),
-							 GetRangeLimits(limit, target_bytes),
+							 limits,
+							 snapshot, reverse ).extractPtr() );
+}
+
+extern "C" DLLEXPORT
+FDBFuture* fdb_transaction_get_mapped_range(
+		FDBTransaction* tr, uint8_t const* begin_key_name,
+		int begin_key_name_length, fdb_bool_t begin_or_equal, int begin_offset,
+		uint8_t const* end_key_name, int end_key_name_length,
+		fdb_bool_t end_or_equal, int end_offset, uint8_t const* mapper_name,
+		int mapper_name_length, int limit, int target_bytes,
+		FDBStreamingMode mode, int iteration, fdb_bool_t snapshot,
+		fdb_bool_t reverse )
+{
+	GetRangeLimits limits;
+	Optional<Error> error = fdb_range_limits(limit, target_bytes, mode, iteration, &limits);
+	if (error.present())
+		return (FDBFuture*)ThreadFuture<Standalone<MappedRangeResultRef>>(error.get()).extractPtr();
+
+	return (FDBFuture*)( TXN(tr)->getMappedRange(
+							 KeySelectorRef( KeyRef( begin_key_name, begin_key_name_length ), begin_or_equal, begin_offset ),
+							 KeySelectorRef( KeyRef( end_key_name, end_key_name_length ), end_or_equal, end_offset ),
+							 StringRef( mapper_name, mapper_name_length ),
+							 limits,
 							 snapshot, reverse ).extractPtr() );
 }
 
@@ -634,6 +697,13 @@ FDBFuture* fdb_transaction_get_estimated_range_size_bytes( FDBTransaction* tr, u
 	return (FDBFuture*)(TXN(tr)->getEstimatedRangeSizeBytes(range).extractPtr());
 }
 
+extern "C" DLLEXPORT
+FDBFuture* fdb_transaction_get_range_split_points( FDBTransaction* tr, uint8_t const* begin_key_name,
+        int begin_key_name_length, uint8_t const* end_key_name, int end_key_name_length, int64_t chunk_size ) {
+	KeyRangeRef range(KeyRef(begin_key_name, begin_key_name_length), KeyRef(end_key_name, end_key_name_length));
+	return (FDBFuture*)(TXN(tr)->getRangeSplitPoints(range, chunk_size).extractPtr());
+}
+
 #include "fdb_c_function_pointers.g.h"
 
 #define FDB_API_CHANGED(func, ver) if (header_version < ver) fdb_api_ptr_##func = (void*)&(func##_v##ver##_PREV); else if (fdb_api_ptr_##func == (void*)&fdb_api_ptr_unimpl) fdb_api_ptr_##func = (void*)&(func##_impl);
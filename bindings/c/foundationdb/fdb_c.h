@@ -91,6 +91,11 @@ extern "C" {
     DLLEXPORT WARN_UNUSED_RESULT fdb_error_t fdb_add_network_thread_completion_hook(void (*hook)(void*), void *hook_parameter);
 
 #pragma pack(push, 4)
+    typedef struct key {
+        const uint8_t* key;
+        int key_length;
+    } FDBKey;
+
 #if FDB_API_VERSION >= 630
     typedef struct keyvalue {
         const uint8_t* key;
@@ -106,6 +111,17 @@ extern "C" {
         int value_length;
     } FDBKeyValue;
 #endif
+
+    /* An index entry returned by fdb_transaction_get_mapped_range, followed by the records it maps to */
+    typedef struct mappedkeyvalue {
+        const uint8_t* key;
+        int key_length;
+        const uint8_t* value;
+        int value_length;
+        const FDBKeyValue* records;
+        int records_count;
+        int reserved;
+    } FDBMappedKeyValue;
 #pragma pack(pop)
 
     DLLEXPORT void fdb_future_cancel( FDBFuture* f );
@@ -136,6 +152,10 @@ extern "C" {
     fdb_future_get_key( FDBFuture* f, uint8_t const** out_key,
                         int* out_key_length );
 
+    DLLEXPORT WARN_UNUSED_RESULT fdb_error_t
+    fdb_future_get_key_array( FDBFuture* f, FDBKey const** out_key_array,
+                              int* out_count );
+
     DLLEXPORT WARN_UNUSED_RESULT fdb_error_t
     fdb_future_get_value( FDBFuture* f, fdb_bool_t *out_present,
                           uint8_t const** out_value,
@@ -147,6 +167,10 @@ extern "C" {
                                    int* out_count, fdb_bool_t* out_more );
 #endif
 
+    DLLEXPORT WARN_UNUSED_RESULT fdb_error_t
+    fdb_future_get_mappedkeyvalue_array( FDBFuture* f, FDBMappedKeyValue const** out_kv,
+                                         int* out_count, fdb_bool_t* out_more );
+
     DLLEXPORT WARN_UNUSED_RESULT fdb_error_t fdb_future_get_string_array(FDBFuture* f,
                             const char*** out_strings, int* out_count);
 
@@ -205,6 +229,17 @@ extern "C" {
         fdb_bool_t reverse );
 #endif
 
+    /* Reads the index entries in the range and, on the storage servers, the records that the mapper builds from each
+       entry.  Fails with mapped_range_reads_your_writes if the read depends on writes made by the transaction. */
+    DLLEXPORT WARN_UNUSED_RESULT FDBFuture* fdb_transaction_get_mapped_range(
+        FDBTransaction* tr, uint8_t const* begin_key_name,
+        int begin_key_name_length, fdb_bool_t begin_or_equal, int begin_offset,
+        uint8_t const* end_key_name, int end_key_name_length,
+        fdb_bool_t end_or_equal, int end_offset, uint8_t const* mapper_name,
+        int mapper_name_length, int limit, int target_bytes,
+        FDBStreamingMode mode, int iteration, fdb_bool_t snapshot,
+        fdb_bool_t reverse );
+
     DLLEXPORT void
     fdb_transaction_set( FDBTransaction* tr, uint8_t const* key_name,
                          int key_name_length, uint8_t const* value,
@@ -260,6 +295,10 @@ extern "C" {
     fdb_transaction_get_estimated_range_size_bytes( FDBTransaction* tr, uint8_t const* begin_key_name,
         int begin_key_name_length, uint8_t const* end_key_name, int end_key_name_length);
 
+    DLLEXPORT WARN_UNUSED_RESULT FDBFuture*
+    fdb_transaction_get_range_split_points( FDBTransaction* tr, uint8_t const* begin_key_name,
+        int begin_key_name_length, uint8_t const* end_key_name, int end_key_name_length, int64_t chunk_size);
+
     #define FDB_KEYSEL_LAST_LESS_THAN(k, l) k, l, 0, 0
     #define FDB_KEYSEL_LAST_LESS_OR_EQUAL(k, l) k, l, 1, 0
     #define FDB_KEYSEL_FIRST_GREATER_THAN(k, l) k, l, 1, 1
@@ -661,6 +661,33 @@ struct GetEstimatedRangeSize : InstructionFunc {
 const char* GetEstimatedRangeSize::name = "GET_ESTIMATED_RANGE_SIZE";
 REGISTER_INSTRUCTION_FUNC(GetEstimatedRangeSize);
 
+struct GetRangeSplitPoints : InstructionFunc {
+	static const char* name;
+
+	ACTOR static Future<Void> call(Reference<FlowTesterData> data, Reference<InstructionData> instruction) {
+		state std::vector<StackItem> items = data->stack.pop(3);
+		if (items.size() != 3)
+			return Void();
+
+		Standalone<StringRef> s1 = wait(items[0].value);
+		state Standalone<StringRef> beginKey = Tuple::unpack(s1).getString(0);
+
+		Standalone<StringRef> s2 = wait(items[1].value);
+		state Standalone<StringRef> endKey = Tuple::unpack(s2).getString(0);
+
+		Standalone<StringRef> s3 = wait(items[2].value);
+		state int64_t chunkSize = Tuple::unpack(s3).getInt(0);
+
+		Future<FDBStandalone<VectorRef<KeyRef>>> fsplitPoints = instruction->tr->getRangeSplitPoints(KeyRangeRef(beginKey, endKey), chunkSize);
+		FDBStandalone<VectorRef<KeyRef>> splitPoints = wait(fsplitPoints);
+		data->stack.pushTuple(LiteralStringRef("GOT_RANGE_SPLIT_POINTS"));
+
+		return Void();
+	}
+};
+const char* GetRangeSplitPoints::name = "GET_RANGE_SPLIT_POINTS";
+REGISTER_INSTRUCTION_FUNC(GetRangeSplitPoints);
+
 struct GetKeyFunc : InstructionFunc {
 	static const char* name;
 
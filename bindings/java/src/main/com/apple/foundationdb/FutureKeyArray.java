@@ -0,0 +1,39 @@
+/*
+ * FutureKeyArray.java
+ *
+ * This source file is part of the FoundationDB open source project
+ *
+ * Copyright 2013-2020 Apple Inc. and the FoundationDB project authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.apple.foundationdb;
+
+import java.util.Arrays;
+import java.util.List;
+import java.util.concurrent.Executor;
+
+class FutureKeyArray extends NativeFuture<List<byte[]>> {
+	FutureKeyArray(long cPtr, Executor executor) {
+		super(cPtr);
+		registerMarshalCallback(executor);
+	}
+
+	@Override
+	protected List<byte[]> getIfDone_internal(long cPtr) throws FDBException {
+		return Arrays.asList(FutureKeyArray_get(cPtr));
+	}
+
+	private native byte[][] FutureKeyArray_get(long cPtr) throws FDBException;
+}
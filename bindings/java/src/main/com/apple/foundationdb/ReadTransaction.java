@@ -20,6 +20,7 @@
 
 package com.apple.foundationdb;
 
+import java.util.List;
 import java.util.concurrent.CompletableFuture;
 
 import com.apple.foundationdb.async.AsyncIterable;
@@ -444,6 +445,29 @@ public interface ReadTransaction extends ReadTransactionContext {
 	 */
 	CompletableFuture<Long> getEstimatedRangeSizeBytes(Range range);
 
+	/**
+	 * Gets a list of keys that can split the given range into (roughly) equally sized chunks based on
+	 * {@code chunkSize}. The first key is {@code begin} and the last key is {@code end}.
+	 *
+	 * @param begin the beginning of the range (inclusive)
+	 * @param end the end of the range (exclusive)
+	 * @param chunkSize the size of chunks in bytes that the range is split into
+	 *
+	 * @return a handle to access the results of the asynchronous call
+	 */
+	CompletableFuture<List<byte[]>> getRangeSplitPoints(byte[] begin, byte[] end, long chunkSize);
+
+	/**
+	 * Gets a list of keys that can split the given range into (roughly) equally sized chunks based on
+	 * {@code chunkSize}. The first key is the beginning of {@code range} and the last key is its end.
+	 *
+	 * @param range the range of the keys
+	 * @param chunkSize the size of chunks in bytes that the range is split into
+	 *
+	 * @return a handle to access the results of the asynchronous call
+	 */
+	CompletableFuture<List<byte[]>> getRangeSplitPoints(Range range, long chunkSize);
+
 	/**
 	 * Returns a set of options that can be set on a {@code Transaction}
 	 *
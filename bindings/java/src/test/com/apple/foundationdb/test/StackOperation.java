@@ -57,6 +57,7 @@ enum StackOperation {
 	GET_APPROXIMATE_SIZE,
 	GET_VERSIONSTAMP,
 	GET_ESTIMATED_RANGE_SIZE,
+	GET_RANGE_SPLIT_POINTS,
 	SET_READ_VERSION,
 	ON_ERROR,
 	SUB,
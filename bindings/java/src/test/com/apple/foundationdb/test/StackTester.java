@@ -211,6 +211,11 @@ public class StackTester {
 				Long size = inst.readTr.getEstimatedRangeSizeBytes((byte[])params.get(0), (byte[])params.get(1)).join();
 				inst.push("GOT_ESTIMATED_RANGE_SIZE".getBytes());
 			}
+			else if (op == StackOperation.GET_RANGE_SPLIT_POINTS) {
+				List<Object> params = inst.popParams(3).join();
+				List<byte[]> splitPoints = inst.readTr.getRangeSplitPoints((byte[])params.get(0), (byte[])params.get(1), ((Number)params.get(2)).longValue()).join();
+				inst.push("GOT_RANGE_SPLIT_POINTS".getBytes());
+			}
 			else if(op == StackOperation.GET_RANGE) {
 				List<Object> params = inst.popParams(5).join();
 
@@ -461,6 +461,18 @@ class TransactionRead(_FDBBase):
             end_key, len(end_key)
             ))
 
+    def get_range_split_points(self, begin_key, end_key, chunk_size):
+        if begin_key is None:
+            begin_key = b''
+        if end_key is None:
+            end_key = b'\xff'
+        return FutureKeyArray(self.capi.fdb_transaction_get_range_split_points(
+            self.tpointer,
+            begin_key, len(begin_key),
+            end_key, len(end_key),
+            chunk_size
+            ))
+
 
 class Transaction(TransactionRead):
     """A modifiable snapshot of a Database.
@@ -726,6 +738,15 @@ class FutureKeyValueArray(Future):
         # destroy the future anyway
 
 
+class FutureKeyArray(Future):
+    def wait(self):
+        self.block_until_ready()
+        ks = ctypes.pointer(KeyStruct())
+        count = ctypes.c_int()
+        self.capi.fdb_future_get_key_array(self.fpointer, ctypes.byref(ks), ctypes.byref(count))
+        return [ctypes.string_at(x.key, x.key_length) for x in ks[0:count.value]]
+
+
 class FutureStringArray(Future):
     def wait(self):
         self.block_until_ready()
@@ -1199,6 +1220,12 @@ class KVIter(object):
         return self.next()
 
 
+class KeyStruct(ctypes.Structure):
+    _fields_ = [('key', ctypes.POINTER(ctypes.c_byte)),
+                ('key_length', ctypes.c_int)]
+    _pack_ = 4
+
+
 class KeyValueStruct(ctypes.Structure):
     _fields_ = [('key', ctypes.POINTER(ctypes.c_byte)),
                 ('key_length', ctypes.c_int),
@@ -1393,6 +1420,10 @@ def init_c_api():
     _capi.fdb_future_get_keyvalue_array.restype = int
     _capi.fdb_future_get_keyvalue_array.errcheck = check_error_code
 
+    _capi.fdb_future_get_key_array.argtypes = [ctypes.c_void_p, ctypes.POINTER(ctypes.POINTER(KeyStruct)), ctypes.POINTER(ctypes.c_int)]
+    _capi.fdb_future_get_key_array.restype = int
+    _capi.fdb_future_get_key_array.errcheck = check_error_code
+
     _capi.fdb_future_get_string_array.argtypes = [ctypes.c_void_p, ctypes.POINTER(ctypes.POINTER(ctypes.c_char_p)), ctypes.POINTER(ctypes.c_int)]
     _capi.fdb_future_get_string_array.restype = int
     _capi.fdb_future_get_string_array.errcheck = check_error_code
@@ -1438,6 +1469,9 @@ def init_c_api():
     _capi.fdb_transaction_get_estimated_range_size_bytes.argtypes = [ctypes.c_void_p, ctypes.c_void_p, ctypes.c_int, ctypes.c_void_p, ctypes.c_int]
     _capi.fdb_transaction_get_estimated_range_size_bytes.restype = ctypes.c_void_p
 
+    _capi.fdb_transaction_get_range_split_points.argtypes = [ctypes.c_void_p, ctypes.c_void_p, ctypes.c_int, ctypes.c_void_p, ctypes.c_int, ctypes.c_int64]
+    _capi.fdb_transaction_get_range_split_points.restype = ctypes.c_void_p
+
     _capi.fdb_transaction_add_conflict_range.argtypes = [ctypes.c_void_p, ctypes.c_void_p, ctypes.c_int, ctypes.c_void_p, ctypes.c_int, ctypes.c_int]
     _capi.fdb_transaction_add_conflict_range.restype = ctypes.c_int
     _capi.fdb_transaction_add_conflict_range.errcheck = check_error_code
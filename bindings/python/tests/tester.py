@@ -370,6 +370,10 @@ class Tester:
                     begin, end = inst.pop(2)
                     estimatedSize = obj.get_estimated_range_size_bytes(begin, end).wait()
                     inst.push(b"GOT_ESTIMATED_RANGE_SIZE")
+                elif inst.op == six.u("GET_RANGE_SPLIT_POINTS"):
+                    begin, end, chunkSize = inst.pop(3)
+                    estimatedSize = obj.get_range_split_points(begin, end, chunkSize).wait()
+                    inst.push(b"GOT_RANGE_SPLIT_POINTS")
                 elif inst.op == six.u("GET_KEY"):
                     key, or_equal, offset, prefix = inst.pop(4)
                     result = obj.get_key(fdb.KeySelector(key, or_equal, offset))
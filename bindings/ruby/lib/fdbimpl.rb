@@ -90,6 +90,7 @@ module FDB
       attach_function :fdb_future_get_value, [ :pointer, :pointer, :pointer, :pointer ], :fdb_error
       attach_function :fdb_future_get_keyvalue_array, [ :pointer, :pointer, :pointer, :pointer ], :fdb_error
       attach_function :fdb_future_get_string_array, [ :pointer, :pointer, :pointer ], :fdb_error
+      attach_function :fdb_future_get_key_array, [ :pointer, :pointer, :pointer ], :fdb_error
 
       attach_function :fdb_create_database, [ :string, :pointer ], :fdb_error
 
@@ -109,6 +110,7 @@ module FDB
       attach_function :fdb_transaction_get_key, [ :pointer, :pointer, :int, :int, :int, :int ], :pointer
       attach_function :fdb_transaction_get_range, [ :pointer, :pointer, :int, :int, :int, :pointer, :int, :int, :int, :int, :int, :int, :int, :int, :int ], :pointer
       attach_function :fdb_transaction_get_estimated_range_size_bytes, [ :pointer, :pointer, :int, :pointer, :int ], :pointer
+      attach_function :fdb_transaction_get_range_split_points, [ :pointer, :pointer, :int, :pointer, :int, :int64 ], :pointer
       attach_function :fdb_transaction_set, [ :pointer, :pointer, :int, :pointer, :int ], :void
       attach_function :fdb_transaction_clear, [ :pointer, :pointer, :int ], :void
       attach_function :fdb_transaction_clear_range, [ :pointer, :pointer, :int, :pointer, :int ], :void
@@ -121,6 +123,12 @@ module FDB
       attach_function :fdb_transaction_reset, [ :pointer ], :void
     end
 
+    class KeyStruct < FFI::Struct
+      pack 4
+      layout :key, :pointer,
+             :key_length, :int
+    end
+
     class KeyValueStruct < FFI::Struct
       pack 4
       layout :key, :pointer,
@@ -472,6 +480,22 @@ module FDB
     end
   end
 
+  class FutureKeyArray < Future
+    def wait
+      block_until_ready
+
+      ks = FFI::MemoryPointer.new :pointer
+      count = FFI::MemoryPointer.new :int
+      FDBC.check_error FDBC.fdb_future_get_key_array(@fpointer, ks, count)
+      ks = ks.read_pointer
+
+      (0..count.read_int-1).map{|i|
+        x = FDBC::KeyStruct.new(ks + (i * FDBC::KeyStruct.size))
+        x[:key].read_bytes(x[:key_length])
+      }
+    end
+  end
+
   class FutureStringArray < LazyFuture
     def getter
       strings = FFI::MemoryPointer.new :pointer
@@ -825,6 +849,15 @@ module FDB
       Int64Future.new(FDBC.fdb_transaction_get_estimated_range_size_bytes(@tpointer, bkey, bkey.bytesize, ekey, ekey.bytesize))
     end
 
+    def get_range_split_points(begin_key, end_key, chunk_size)
+      if chunk_size <= 0
+        raise ArgumentError, "Invalid chunk size: #{chunk_size}, expected positive size"
+      end
+      bkey = FDB.key_to_bytes(begin_key)
+      ekey = FDB.key_to_bytes(end_key)
+      FutureKeyArray.new(FDBC.fdb_transaction_get_range_split_points(@tpointer, bkey, bkey.bytesize, ekey, ekey.bytesize, chunk_size))
+    end
+
   end
 
   TransactionRead.class_variable_set("@@StreamingMode", @@StreamingMode)
@@ -195,6 +195,24 @@ struct CommitTransactionRef {
 	}
 };
 
+// The mutations a change feed recorded at one version.  An entry with no mutations only reports that nothing
+// was recorded up to its version.
+struct MutationsAndVersionRef {
+	VectorRef<MutationRef> mutations;
+	Version version;
+
+	MutationsAndVersionRef() : version(invalidVersion) {}
+	MutationsAndVersionRef( VectorRef<MutationRef> mutations, Version version ) : mutations(mutations), version(version) {}
+	MutationsAndVersionRef( Arena& to, const MutationsAndVersionRef& from ) : mutations(to, from.mutations), version(from.version) {}
+
+	int expectedSize() const { return mutations.expectedSize(); }
+
+	template <class Ar>
+	void serialize( Ar& ar ) {
+		serializer(ar, mutations, version);
+	}
+};
+
 bool debugMutation( const char* context, Version version, MutationRef const& m );
 bool debugKeyRange( const char* context, Version version, KeyRangeRef const& keyRange );
 
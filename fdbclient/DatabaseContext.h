@@ -132,6 +132,27 @@ public:
 	};
 	std::map<uint32_t, VersionBatcher> versionBatcher;
 
+	// Point read batching: reads of the same shard at the same version share one GetValuesRequest
+	struct PendingGetValue {
+		Reference<LocationInfo> locations;
+		Version version;
+		Key key;
+		Promise<Optional<Value>> reply;
+	};
+	PromiseStream<PendingGetValue> getValueBatchStream;
+	Future<Void> getValueBatcher;
+
+	// Watch batching: watches of keys in the same shard share one WatchValuesRequest
+	struct PendingWatch {
+		Reference<LocationInfo> locations;
+		Version version;
+		Key key;
+		Optional<Value> value;
+		Promise<WatchValueReply> reply;
+	};
+	PromiseStream<PendingWatch> watchBatchStream;
+	Future<Void> watchBatcher;
+
 	AsyncTrigger connectionFileChangedTrigger;
 
 	// Disallow any reads at a read version lower than minAcceptableReadVersion.  This way the client does not have to
@@ -582,6 +582,8 @@ KeyRangeWith<Val> keyRangeWith( const KeyRangeRef& range, const Val& value ) {
 	return KeyRangeWith<Val>(range, value);
 }
 
+struct MappedKeyValueRef;
+
 struct GetRangeLimits {
 	enum { ROW_LIMIT_UNLIMITED = -1, BYTE_LIMIT_UNLIMITED = -1 };
 
@@ -595,6 +597,7 @@ struct GetRangeLimits {
 
 	void decrement( VectorRef<KeyValueRef> const& data );
 	void decrement( KeyValueRef const& data );
+	void decrement( MappedKeyValueRef const& data );
 
 	// True if either the row or byte limit has been reached
 	bool isReached();
@@ -643,6 +646,35 @@ struct Traceable<RangeResultRef> : std::true_type {
 	}
 };
 
+// An index entry returned by a mapped range read, together with the records its mapper selected.  The layout is
+// shared with FDBMappedKeyValue in the C API.
+struct MappedKeyValueRef : KeyValueRef {
+	VectorRef<KeyValueRef> records;
+
+	MappedKeyValueRef() {}
+	MappedKeyValueRef( Arena& a, const MappedKeyValueRef& copyFrom ) : KeyValueRef(a, copyFrom), records(a, copyFrom.records) {}
+
+	int expectedSize() const { return KeyValueRef::expectedSize() + records.expectedSize(); }
+
+	template <class Ar>
+	void serialize( Ar& ar ) {
+		serializer(ar, key, value, records);
+	}
+};
+
+struct MappedRangeResultRef : VectorRef<MappedKeyValueRef> {
+	bool more;  // True if index entries may remain in the requested range beyond the limits; continue after the last key
+
+	MappedRangeResultRef() : more(false) {}
+	MappedRangeResultRef( Arena& p, const MappedRangeResultRef& toCopy ) : VectorRef<MappedKeyValueRef>( p, toCopy ), more( toCopy.more ) {}
+	MappedRangeResultRef( const VectorRef<MappedKeyValueRef>& value, bool more ) : VectorRef<MappedKeyValueRef>( value ), more( more ) {}
+
+	template <class Ar>
+	void serialize( Ar& ar ) {
+		serializer(ar, ((VectorRef<MappedKeyValueRef>&)*this), more);
+	}
+};
+
 struct KeyValueStoreType {
 	constexpr static FileIdentifier file_identifier = 6560359;
 	// These enumerated values are stored in the database configuration, so should NEVER be changed.
@@ -48,7 +48,9 @@ public:
 	virtual ThreadFuture<Standalone<StringRef>> getVersionstamp() = 0;
 
 	virtual void addReadConflictRange(const KeyRangeRef& keys) = 0;
+	virtual ThreadFuture<Standalone<MappedRangeResultRef>> getMappedRange(const KeySelectorRef& begin, const KeySelectorRef& end, const StringRef& mapper, GetRangeLimits limits, bool snapshot=false, bool reverse=false) = 0;
 	virtual ThreadFuture<int64_t> getEstimatedRangeSizeBytes(const KeyRangeRef& keys) = 0;
+	virtual ThreadFuture<Standalone<VectorRef<KeyRef>>> getRangeSplitPoints(const KeyRangeRef& range, int64_t chunkSize) = 0;
 
 	virtual void atomicOp(const KeyRef& key, const ValueRef& value, uint32_t operationType) = 0;
 	virtual void set(const KeyRef& key, const ValueRef& value) = 0;
@@ -58,6 +58,13 @@ ClientKnobs::ClientKnobs(bool randomize) {
 	init( WRONG_SHARD_SERVER_DELAY,                .01 ); if( randomize && BUGGIFY ) WRONG_SHARD_SERVER_DELAY = deterministicRandom()->random01(); // FLOW_KNOBS->PREVENT_FAST_SPIN_DELAY; // SOMEDAY: This delay can limit performance of retrieving data when the cache is mostly wrong (e.g. dumping the database after a test)
 	init( FUTURE_VERSION_RETRY_DELAY,              .01 ); if( randomize && BUGGIFY ) FUTURE_VERSION_RETRY_DELAY = deterministicRandom()->random01();// FLOW_KNOBS->PREVENT_FAST_SPIN_DELAY;
 	init( REPLY_BYTE_LIMIT,                      80000 );
+	init( ENABLE_RANGE_STREAMING,                 true ); if( randomize && BUGGIFY ) ENABLE_RANGE_STREAMING = false;
+	init( ENABLE_GET_VALUE_BATCHING,              true ); if( randomize && BUGGIFY ) ENABLE_GET_VALUE_BATCHING = false;
+	init( GET_VALUE_BATCH_INTERVAL,                0.0 ); if( randomize && BUGGIFY ) GET_VALUE_BATCH_INTERVAL = 0.001;
+	init( GET_VALUE_BATCH_MAX_KEYS,                100 ); if( randomize && BUGGIFY ) GET_VALUE_BATCH_MAX_KEYS = 2;
+	init( ENABLE_WATCH_BATCHING,                  true ); if( randomize && BUGGIFY ) ENABLE_WATCH_BATCHING = false;
+	init( WATCH_BATCH_INTERVAL,                  0.001 ); if( randomize && BUGGIFY ) WATCH_BATCH_INTERVAL = 0.0;
+	init( WATCH_BATCH_MAX_KEYS,                  10000 ); if( randomize && BUGGIFY ) WATCH_BATCH_MAX_KEYS = 2;
 	init( DEFAULT_BACKOFF,                         .01 ); if( randomize && BUGGIFY ) DEFAULT_BACKOFF = deterministicRandom()->random01();
 	init( DEFAULT_MAX_BACKOFF,                     1.0 );
 	init( BACKOFF_GROWTH_RATE,                     2.0 );
@@ -80,6 +87,7 @@ ClientKnobs::ClientKnobs(bool randomize) {
 	init( LOCATION_CACHE_EVICTION_SIZE_SIM,         10 ); if( randomize && BUGGIFY ) LOCATION_CACHE_EVICTION_SIZE_SIM = 3;
 
 	init( GET_RANGE_SHARD_LIMIT,                     2 );
+	init( PARALLEL_RANGE_READ_MAX_SHARDS,          100 );
 	init( WARM_RANGE_SHARD_LIMIT,                  100 );
 	init( STORAGE_METRICS_SHARD_LIMIT,             100 ); if( randomize && BUGGIFY ) STORAGE_METRICS_SHARD_LIMIT = 3;
 	init( SHARD_COUNT_LIMIT,                        80 ); if( randomize && BUGGIFY ) SHARD_COUNT_LIMIT = 3;
@@ -55,6 +55,13 @@ public:
 	double WRONG_SHARD_SERVER_DELAY; // SOMEDAY: This delay can limit performance of retrieving data when the cache is mostly wrong (e.g. dumping the database after a test)
 	double FUTURE_VERSION_RETRY_DELAY;
 	int REPLY_BYTE_LIMIT;
+	bool ENABLE_RANGE_STREAMING; // Reads without a byte limit stream each shard instead of issuing one request per batch
+	bool ENABLE_GET_VALUE_BATCHING; // Concurrent point reads of the same shard are sent as one GetValuesRequest
+	double GET_VALUE_BATCH_INTERVAL; // Seconds a point read waits for others to batch with; 0 sends every read on its own
+	int GET_VALUE_BATCH_MAX_KEYS; // Reads after which a batch is sent without waiting out the interval
+	bool ENABLE_WATCH_BATCHING; // Concurrent watches of keys in the same shard are sent as one WatchValuesRequest
+	double WATCH_BATCH_INTERVAL;
+	int WATCH_BATCH_MAX_KEYS;
 	double DEFAULT_BACKOFF;
 	double DEFAULT_MAX_BACKOFF;
 	double BACKOFF_GROWTH_RATE;
@@ -78,6 +85,7 @@ public:
 	int LOCATION_CACHE_EVICTION_SIZE_SIM;
 
 	int GET_RANGE_SHARD_LIMIT;
+	int PARALLEL_RANGE_READ_MAX_SHARDS; // Upper bound for the PARALLEL_RANGE_READS transaction option
 	int WARM_RANGE_SHARD_LIMIT;
 	int STORAGE_METRICS_SHARD_LIMIT;
 	int SHARD_COUNT_LIMIT;
@@ -20,6 +20,7 @@
 
 #include "fdbclient/NativeAPI.actor.h"
 
+#include <deque>
 #include <iterator>
 #include <regex>
 #include <unordered_set>
@@ -37,6 +38,7 @@
 #include "fdbclient/ReadYourWrites.h"
 #include "fdbclient/StorageServerInterface.h"
 #include "fdbclient/SystemData.h"
+#include "fdbclient/Tuple.h"
 #include "fdbrpc/LoadBalance.h"
 #include "fdbrpc/Net2FileSystem.h"
 #include "fdbrpc/simulator.h"
@@ -565,6 +567,8 @@ Database DatabaseContext::create(Reference<AsyncVar<ClientDBInfo>> clientInfo, F
 
 DatabaseContext::~DatabaseContext() {
 	monitorMasterProxiesInfoChange.cancel();
+	getValueBatcher.cancel();
+	watchBatcher.cancel();
 	for(auto it = server_interf.begin(); it != server_interf.end(); it = server_interf.erase(it))
 		it->second->notifyContextDestroyed();
 	ASSERT_ABORT( server_interf.empty() );
@@ -1094,6 +1098,14 @@ void GetRangeLimits::decrement( KeyValueRef const& data ) {
 		bytes = std::max( 0, bytes - (int)8 - (int)data.expectedSize() );
 }
 
+void GetRangeLimits::decrement( MappedKeyValueRef const& data ) {
+	minRows = std::max(0, minRows - 1);
+	if( rows != CLIENT_KNOBS->ROW_LIMIT_UNLIMITED )
+		rows--;
+	if( bytes != CLIENT_KNOBS->BYTE_LIMIT_UNLIMITED )
+		bytes = std::max( 0, bytes - (int)8 - (int)data.expectedSize() );
+}
+
 // True if either the row or byte limit has been reached
 bool GetRangeLimits::isReached() {
 	return rows == 0 || (bytes == 0 && minRows == 0);
@@ -1322,6 +1334,90 @@ Future<Void> Transaction::warmRange(Database cx, KeyRange keys) {
 	return warmRange_impl(this, cx, keys);
 }
 
+static bool canBatchGetValue(Reference<LocationInfo> const& locations) {
+	for (int i = 0; i < locations->size(); i++) {
+		if (!locations->getInterface(i).hasGetValues()) return false;
+	}
+	return true;
+}
+
+ACTOR Future<Void> sendGetValueBatch(DatabaseContext* cx, Reference<LocationInfo> locations, Version version,
+                                     std::vector<DatabaseContext::PendingGetValue> requests) {
+	state std::vector<DatabaseContext::PendingGetValue> pending = std::move(requests);
+	try {
+		if (pending.size() == 1) {
+			GetValueReply reply = wait(loadBalance(locations, &StorageServerInterface::getValue,
+			                                       GetValueRequest(pending[0].key, version, Optional<UID>()),
+			                                       TaskPriority::DefaultPromiseEndpoint, false,
+			                                       cx->enableLocalityLoadBalance ? &cx->queueModel : nullptr));
+			pending[0].reply.send(reply.value);
+			return Void();
+		}
+
+		state GetValuesRequest req;
+		req.version = version;
+		std::vector<KeyRef> keys;
+		for (auto& p : pending) {
+			keys.push_back(p.key);
+		}
+		std::sort(keys.begin(), keys.end());
+		keys.resize(std::unique(keys.begin(), keys.end()) - keys.begin());
+		for (auto& k : keys) {
+			req.keys.push_back_deep(req.arena, k);
+		}
+
+		state GetValuesReply reply = wait(loadBalance(locations, &StorageServerInterface::getValues, req,
+		                                              TaskPriority::DefaultPromiseEndpoint, false,
+		                                              cx->enableLocalityLoadBalance ? &cx->queueModel : nullptr));
+		for (auto& p : pending) {
+			auto it = std::lower_bound(reply.data.begin(), reply.data.end(), p.key, KeyValueRef::OrderByKey());
+			if (it != reply.data.end() && it->key == p.key) {
+				p.reply.send(Value(it->value, reply.arena));
+			} else {
+				p.reply.send(Optional<Value>());
+			}
+		}
+	} catch (Error& e) {
+		if (e.code() == error_code_actor_cancelled) throw;
+		for (auto& p : pending) {
+			p.reply.sendError(e);
+		}
+	}
+	return Void();
+}
+
+// Collects point reads from all transactions on cx and sends the reads of each shard at each version as one
+// GetValuesRequest, either when GET_VALUE_BATCH_MAX_KEYS reads have piled up or after GET_VALUE_BATCH_INTERVAL.
+ACTOR Future<Void> getValueBatcher(DatabaseContext* cx, FutureStream<DatabaseContext::PendingGetValue> requestStream) {
+	state std::map<std::pair<LocationInfo*, Version>, std::vector<DatabaseContext::PendingGetValue>> batches;
+	state PromiseStream<Future<Void>> addActor;
+	state Future<Void> collection = actorCollection(addActor.getFuture());
+	state Future<Void> timeout;
+
+	loop {
+		choose {
+			when(DatabaseContext::PendingGetValue req = waitNext(requestStream)) {
+				auto& batch = batches[std::make_pair(req.locations.getPtr(), req.version)];
+				batch.push_back(req);
+				if (batch.size() >= CLIENT_KNOBS->GET_VALUE_BATCH_MAX_KEYS) {
+					addActor.send(sendGetValueBatch(cx, req.locations, req.version, std::move(batch)));
+					batches.erase(std::make_pair(req.locations.getPtr(), req.version));
+				} else if (!timeout.isValid()) {
+					timeout = delay(CLIENT_KNOBS->GET_VALUE_BATCH_INTERVAL, TaskPriority::DefaultPromiseEndpoint);
+				}
+			}
+			when(wait(timeout.isValid() ? timeout : Never())) {
+				for (auto& b : batches) {
+					addActor.send(sendGetValueBatch(cx, b.second[0].locations, b.first.second, std::move(b.second)));
+				}
+				batches.clear();
+				timeout = Future<Void>();
+			}
+			when(wait(collection)) {} // for errors
+		}
+	}
+}
+
 ACTOR Future<Optional<Value>> getValue( Future<Version> version, Key key, Database cx, TransactionInfo info, Reference<TransactionLogInfo> trLogInfo )
 {
 	state Version ver = wait( version );
@@ -1355,12 +1451,28 @@ ACTOR Future<Optional<Value>> getValue( Future<Version> version, Key key, Databa
 					throw deterministicRandom()->randomChoice(
 						std::vector<Error>{ transaction_too_old(), future_version() });
 				}
+				state Future<GetValueReply> replyFuture;
+				// Without an interval to wait for other reads in, the batcher would only add a hop to every read
+				if (CLIENT_KNOBS->ENABLE_GET_VALUE_BATCHING && CLIENT_KNOBS->GET_VALUE_BATCH_INTERVAL > 0 &&
+				    CLIENT_KNOBS->GET_VALUE_BATCH_MAX_KEYS > 1 && !getValueID.present() &&
+				    info.readPriority == READ_PRIORITY_DEFAULT && canBatchGetValue(ssi.second)) {
+					if (!cx->getValueBatcher.isValid()) {
+						cx->getValueBatcher = getValueBatcher(cx.getPtr(), cx->getValueBatchStream.getFuture());
+					}
+					DatabaseContext::PendingGetValue pending;
+					pending.locations = ssi.second;
+					pending.version = ver;
+					pending.key = key;
+					cx->getValueBatchStream.send(pending);
+					replyFuture = map(pending.reply.getFuture(), [](Optional<Value> v) { return GetValueReply(v); });
+				} else {
+					replyFuture = loadBalance(ssi.second, &StorageServerInterface::getValue,
+					                          GetValueRequest(key, ver, getValueID, info.readPriority), TaskPriority::DefaultPromiseEndpoint,
+					                          false, cx->enableLocalityLoadBalance ? &cx->queueModel : nullptr);
+				}
 				choose {
 					when(wait(cx->connectionFileChanged())) { throw transaction_too_old(); }
-					when(GetValueReply _reply =
-							wait(loadBalance(ssi.second, &StorageServerInterface::getValue,
-											GetValueRequest(key, ver, getValueID), TaskPriority::DefaultPromiseEndpoint, false,
-											cx->enableLocalityLoadBalance ? &cx->queueModel : nullptr))) {
+					when(GetValueReply _reply = wait(replyFuture)) {
 						reply = _reply;
 					}
 				}
@@ -1441,7 +1553,7 @@ ACTOR Future<Key> getKey( Database cx, KeySelector k, Future<Version> version, T
 				choose {
 					when(wait(cx->connectionFileChanged())) { throw transaction_too_old(); }
 					when(GetKeyReply _reply =
-							wait(loadBalance(ssi.second, &StorageServerInterface::getKey, GetKeyRequest(k, version.get()),
+							wait(loadBalance(ssi.second, &StorageServerInterface::getKey, GetKeyRequest(k, version.get(), info.readPriority),
 											TaskPriority::DefaultPromiseEndpoint, false,
 											cx->enableLocalityLoadBalance ? &cx->queueModel : nullptr))) {
 						reply = _reply;
@@ -1510,6 +1622,102 @@ ACTOR Future<Void> readVersionBatcher(
 	DatabaseContext* cx, FutureStream<std::pair<Promise<GetReadVersionReply>, Optional<UID>>> versionStream,
 	uint32_t flags);
 
+static bool canBatchWatch(Reference<LocationInfo> const& locations) {
+	for (int i = 0; i < locations->size(); i++) {
+		if (!locations->getInterface(i).hasWatchValues()) return false;
+	}
+	return true;
+}
+
+// Sends the watches of one shard as a WatchValuesRequest, and sends the ones that have not fired again each time
+// some of them do, until all of them have fired or been abandoned by their callers.
+ACTOR Future<Void> sendWatchBatch(DatabaseContext* cx, Reference<LocationInfo> locations,
+                                  std::vector<DatabaseContext::PendingWatch> watches) {
+	state std::vector<DatabaseContext::PendingWatch> pending = std::move(watches);
+	try {
+		loop {
+			pending.erase(std::remove_if(pending.begin(), pending.end(),
+			                             [](DatabaseContext::PendingWatch const& p) {
+				                             return !p.reply.getFutureReferenceCount();
+			                             }),
+			              pending.end());
+			if (pending.empty()) {
+				return Void();
+			}
+
+			if (pending.size() == 1) {
+				WatchValueReply reply = wait(loadBalance(
+				    locations, &StorageServerInterface::watchValue,
+				    WatchValueRequest(pending[0].key, pending[0].value, pending[0].version, Optional<UID>()),
+				    TaskPriority::DefaultPromiseEndpoint));
+				pending[0].reply.send(reply);
+				return Void();
+			}
+
+			WatchValuesRequest req;
+			req.version = 0;
+			for (auto& p : pending) {
+				req.watches.push_back_deep(req.arena, WatchedKeyRef(p.key, p.value.castTo<ValueRef>()));
+				req.version = std::max(req.version, p.version);
+			}
+
+			WatchValuesReply reply = wait(loadBalance(locations, &StorageServerInterface::watchValues, req,
+			                                          TaskPriority::DefaultPromiseEndpoint));
+			std::vector<bool> fired(pending.size());
+			for (int i : reply.fired) {
+				fired[i] = true;
+			}
+			std::vector<DatabaseContext::PendingWatch> remaining;
+			for (int i = 0; i < pending.size(); i++) {
+				if (fired[i]) {
+					pending[i].reply.send(WatchValueReply(reply.version));
+				} else {
+					remaining.push_back(std::move(pending[i]));
+				}
+			}
+			pending = std::move(remaining);
+		}
+	} catch (Error& e) {
+		if (e.code() == error_code_actor_cancelled) throw;
+		for (auto& p : pending) {
+			p.reply.sendError(e);
+		}
+	}
+	return Void();
+}
+
+// Collects watches from all transactions on cx and sends the watches of each shard as one WatchValuesRequest, either
+// when WATCH_BATCH_MAX_KEYS watches have piled up or after WATCH_BATCH_INTERVAL.
+ACTOR Future<Void> watchBatcher(DatabaseContext* cx, FutureStream<DatabaseContext::PendingWatch> requestStream) {
+	state std::map<LocationInfo*, std::vector<DatabaseContext::PendingWatch>> batches;
+	state PromiseStream<Future<Void>> addActor;
+	state Future<Void> collection = actorCollection(addActor.getFuture());
+	state Future<Void> timeout;
+
+	loop {
+		choose {
+			when(DatabaseContext::PendingWatch req = waitNext(requestStream)) {
+				auto& batch = batches[req.locations.getPtr()];
+				batch.push_back(req);
+				if (batch.size() >= CLIENT_KNOBS->WATCH_BATCH_MAX_KEYS) {
+					addActor.send(sendWatchBatch(cx, req.locations, std::move(batch)));
+					batches.erase(req.locations.getPtr());
+				} else if (!timeout.isValid()) {
+					timeout = delay(CLIENT_KNOBS->WATCH_BATCH_INTERVAL, TaskPriority::DefaultPromiseEndpoint);
+				}
+			}
+			when(wait(timeout.isValid() ? timeout : Never())) {
+				for (auto& b : batches) {
+					addActor.send(sendWatchBatch(cx, b.second[0].locations, std::move(b.second)));
+				}
+				batches.clear();
+				timeout = Future<Void>();
+			}
+			when(wait(collection)) {} // for errors
+		}
+	}
+}
+
 ACTOR Future<Void> watchValue(Future<Version> version, Key key, Optional<Value> value, Database cx,
                               TransactionInfo info) {
 	state Version ver = wait( version );
@@ -1528,10 +1736,25 @@ ACTOR Future<Void> watchValue(Future<Version> version, Key key, Optional<Value>
 				g_traceBatch.addEvent("WatchValueDebug", watchValueID.get().first(), "NativeAPI.watchValue.Before"); //.detail("TaskID", g_network->getCurrentTask());
 			}
 			state WatchValueReply resp;
+			state Future<WatchValueReply> replyFuture;
+			if (CLIENT_KNOBS->ENABLE_WATCH_BATCHING && !watchValueID.present() && canBatchWatch(ssi.second)) {
+				if (!cx->watchBatcher.isValid()) {
+					cx->watchBatcher = watchBatcher(cx.getPtr(), cx->watchBatchStream.getFuture());
+				}
+				DatabaseContext::PendingWatch pending;
+				pending.locations = ssi.second;
+				pending.version = ver;
+				pending.key = key;
+				pending.value = value;
+				cx->watchBatchStream.send(pending);
+				replyFuture = pending.reply.getFuture();
+			} else {
+				replyFuture = loadBalance(ssi.second, &StorageServerInterface::watchValue,
+				                          WatchValueRequest(key, value, ver, watchValueID),
+				                          TaskPriority::DefaultPromiseEndpoint);
+			}
 			choose {
-				when(WatchValueReply r = wait(loadBalance(ssi.second, &StorageServerInterface::watchValue,
-				                                          WatchValueRequest(key, value, ver, watchValueID),
-				                                          TaskPriority::DefaultPromiseEndpoint))) {
+				when(WatchValueReply r = wait(replyFuture)) {
 					resp = r;
 				}
 				when(wait(cx->connectionFile ? cx->connectionFile->onChange() : Never())) { wait(Never()); }
@@ -1570,7 +1793,8 @@ ACTOR Future<Void> watchValue(Future<Version> version, Key key, Optional<Value>
 	}
 }
 
-void transformRangeLimits(GetRangeLimits limits, bool reverse, GetKeyValuesRequest &req) {
+template <class Request>
+void transformRangeLimits(GetRangeLimits limits, bool reverse, Request& req) {
 	if(limits.bytes != 0) {
 		if(!limits.hasRowLimit())
 			req.limit = CLIENT_KNOBS->REPLY_BYTE_LIMIT; // Can't get more than this many rows anyway
@@ -1614,6 +1838,7 @@ ACTOR Future<Standalone<RangeResultRef>> getExactRange( Database cx, Version ver
 
 			//FIXME: buggify byte limits on internal functions that use them, instead of globally
 			req.debugID = info.debugID;
+			req.priority = info.readPriority;
 
 			try {
 				if( info.debugID.present() ) {
@@ -1842,6 +2067,70 @@ void getRangeFinished(Database cx, Reference<TransactionLogInfo> trLogInfo, doub
 	}
 }
 
+// Reads as much of req's range as one storage server holds with a single streaming request, and returns it as one
+// reply.  Replicas that cannot stream are skipped, and if none can the range is read with an ordinary request.
+ACTOR Future<GetKeyValuesReply> getKeyValuesStreamed( Database cx, Reference<LocationInfo> locations,
+	GetKeyValuesRequest req, GetRangeLimits limits, bool reverse )
+{
+	state int count = locations->size();
+	state int start = deterministicRandom()->randomInt(0, std::max(1, locations->countBest()));
+	state int i = 0;
+	for (; i < count; i++) {
+		state int index = (start + i) % count;
+		state RequestStream<GetKeyValuesStreamRequest> const* stream = &locations->get(index, &StorageServerInterface::getKeyValuesStream);
+		if (!locations->getInterface(index).hasStreamingRangeReads() ||
+			IFailureMonitor::failureMonitor().getState(stream->getEndpoint()).failed) {
+			continue;
+		}
+
+		state GetKeyValuesStreamRequest streamReq;
+		streamReq.begin = req.begin;
+		streamReq.end = req.end;
+		streamReq.arena.dependsOn(req.arena);
+		streamReq.version = req.version;
+		streamReq.limit = limits.hasRowLimit() ? limits.rows : std::numeric_limits<int>::max();
+		if (reverse) streamReq.limit *= -1;
+		streamReq.limitBytes = std::numeric_limits<int>::max();
+		streamReq.isFetchKeys = req.isFetchKeys;
+		streamReq.debugID = req.debugID;
+		streamReq.priority = req.priority;
+
+		state FutureStream<GetKeyValuesStreamReply> replies = stream->getReplyStream(streamReq);
+		state GetKeyValuesReply output;
+		output.version = req.version;
+		try {
+			loop {
+				GetKeyValuesStreamReply rep = waitNext(replies);
+				output.arena.dependsOn(rep.arena);
+				output.data.append(output.arena, rep.data.begin(), rep.data.size());
+				output.version = rep.version;
+				output.more = rep.more;
+				output.cached = output.cached || rep.cached;
+			}
+		} catch (Error& e) {
+			if (e.code() == error_code_actor_cancelled) throw;
+			if (e.code() == error_code_end_of_stream) return output;
+
+			// Every batch that arrived was read at the same version, so the caller can pick up after the last key
+			if (output.data.size()) {
+				TEST(true); // Range stream ended early with partial results
+				output.more = true;
+				return output;
+			}
+
+			if (e.code() == error_code_wrong_shard_server || e.code() == error_code_transaction_too_old ||
+				e.code() == error_code_future_version || e.code() == error_code_process_behind) {
+				throw;
+			}
+			TEST(true); // Range stream failed, trying another replica
+		}
+	}
+
+	TEST(true); // No replica could stream the range
+	GetKeyValuesReply rep = wait( loadBalance(locations, &StorageServerInterface::getKeyValues, req, TaskPriority::DefaultPromiseEndpoint, false, cx->enableLocalityLoadBalance ? &cx->queueModel : NULL ) );
+	return rep;
+}
+
 ACTOR Future<Standalone<RangeResultRef>> getRange( Database cx, Reference<TransactionLogInfo> trLogInfo, Future<Version> fVersion,
 	KeySelector begin, KeySelector end, GetRangeLimits limits, Promise<std::pair<Key, Key>> conflictRange, bool snapshot, bool reverse,
 	TransactionInfo info )
@@ -1881,6 +2170,7 @@ ACTOR Future<Standalone<RangeResultRef>> getRange( Database cx, Reference<Transa
 			state GetKeyValuesRequest req;
 
 			req.isFetchKeys = (info.taskID == TaskPriority::FetchKeys);
+			req.priority = info.readPriority;
 			req.version = readVersion;
 
 			if( reverse && (begin-1).isDefinitelyLess(shard.begin) &&
@@ -1929,8 +2219,14 @@ ACTOR Future<Standalone<RangeResultRef>> getRange( Database cx, Reference<Transa
 								transaction_too_old(), future_version()
 									});
 					}
-					GetKeyValuesReply _rep = wait( loadBalance(beginServer.second, &StorageServerInterface::getKeyValues, req, TaskPriority::DefaultPromiseEndpoint, false, cx->enableLocalityLoadBalance ? &cx->queueModel : NULL ) );
-					rep = _rep;
+					// Reads without a byte limit (WANT_ALL and EXACT) stream the whole shard rather than paying a round trip per batch
+					if (CLIENT_KNOBS->ENABLE_RANGE_STREAMING && !limits.hasByteLimit()) {
+						GetKeyValuesReply _rep = wait( getKeyValuesStreamed(cx, beginServer.second, req, limits, reverse) );
+						rep = _rep;
+					} else {
+						GetKeyValuesReply _rep = wait( loadBalance(beginServer.second, &StorageServerInterface::getKeyValues, req, TaskPriority::DefaultPromiseEndpoint, false, cx->enableLocalityLoadBalance ? &cx->queueModel : NULL ) );
+						rep = _rep;
+					}
 					++cx->transactionPhysicalReadsCompleted;
 				} catch(Error&) {
 					++cx->transactionPhysicalReadsCompleted;
@@ -2064,6 +2360,116 @@ Future<Standalone<RangeResultRef>> getRange( Database const& cx, Future<Version>
 	return getRange(cx, Reference<TransactionLogInfo>(), fVersion, begin, end, limits, Promise<std::pair<Key, Key>>(), true, reverse, info);
 }
 
+// Reads keys, which lies within one shard as of when it was located, up to limits.  Unlike getExactRange this does not
+// stop after the first batch when there is a byte limit, since the caller wants the whole part.
+ACTOR Future<Standalone<RangeResultRef>> getRangePart( Database cx, Version version, KeyRange keys, GetRangeLimits limits,
+	bool reverse, TransactionInfo info )
+{
+	state Standalone<RangeResultRef> output;
+	loop {
+		Standalone<RangeResultRef> rep = wait( getExactRange(cx, version, keys, limits, reverse, info) );
+		output.arena().dependsOn( rep.arena() );
+		output.append( output.arena(), rep.begin(), rep.size() );
+		limits.decrement( rep );
+
+		if( !rep.more || !rep.size() || limits.isReached() ) {
+			output.more = rep.more;
+			return output;
+		}
+
+		if( reverse )
+			keys = KeyRangeRef( keys.begin, rep.end()[-1].key );
+		else
+			keys = KeyRangeRef( keyAfter( rep.end()[-1].key ), keys.end );
+	}
+}
+
+// Like getRange, but for a range with exact endpoints: the shards of the range are located up front and up to
+// maxShards of them are read concurrently, then stitched together in key order.  A shard is only started while the
+// data already received is short of the limits, and only asks for what is left of them, so a limited read does not
+// prefetch data it cannot return.
+ACTOR Future<Standalone<RangeResultRef>> getRangeParallel( Database cx, Reference<TransactionLogInfo> trLogInfo, Future<Version> fVersion,
+	KeyRange keys, GetRangeLimits limits, Promise<std::pair<Key, Key>> conflictRange, bool snapshot, bool reverse,
+	TransactionInfo info, int maxShards )
+{
+	state KeySelector originalBegin = KeySelector( firstGreaterOrEqual(keys.begin), keys.arena() );
+	state KeySelector originalEnd = KeySelector( firstGreaterOrEqual(keys.end), keys.arena() );
+	state Standalone<RangeResultRef> output;
+
+	try {
+		state Version version = wait( fVersion );
+		cx->validateVersion(version);
+
+		// Shards read separately must agree on a version, so leave reads at the latest version to the serial path
+		if( version == latestVersion ) {
+			Standalone<RangeResultRef> result = wait( getRange(cx, trLogInfo, version, originalBegin, originalEnd, limits, conflictRange, snapshot, reverse, info) );
+			return result;
+		}
+
+		state double startTime = now();
+		state vector< pair<KeyRange, Reference<LocationInfo>> > locations = wait( getKeyRangeLocations( cx, keys, CLIENT_KNOBS->TOO_MANY, reverse, &StorageServerInterface::getKeyValues, info ) );
+		state std::deque<Future<Standalone<RangeResultRef>>> parts;
+		state int nextShard = 0;
+
+		++cx->transactionPhysicalReads;
+		try {
+			loop {
+				GetRangeLimits remaining = limits;
+				for( int i = 0; i < parts.size() && !remaining.isReached(); i++ ) {
+					if( !parts[i].isReady() || parts[i].isError() )
+						continue;
+					if( remaining.hasRowLimit() && parts[i].get().size() >= remaining.rows )
+						remaining.rows = 0;
+					else
+						remaining.decrement( parts[i].get() );
+				}
+				while( nextShard < locations.size() && parts.size() < (size_t)maxShards && ( parts.empty() || !remaining.isReached() ) ) {
+					parts.push_back( getRangePart(cx, version, locations[nextShard].first & keys, remaining, reverse, info) );
+					++nextShard;
+				}
+				if( parts.empty() ) {
+					break;
+				}
+
+				Standalone<RangeResultRef> part = wait( parts.front() );
+				parts.pop_front();
+
+				// A part started before the ones ahead of it finished may hold more rows than are left
+				bool truncated = limits.hasRowLimit() && part.size() > limits.rows;
+				int rows = truncated ? limits.rows : part.size();
+				output.arena().dependsOn( part.arena() );
+				output.append( output.arena(), part.begin(), rows );
+				limits.decrement( VectorRef<KeyValueRef>( part.begin(), rows ) );
+
+				// Later parts were read past the end of this one, so they cannot be used
+				if( part.more || limits.isReached() ) {
+					output.more = truncated || part.more || !parts.empty() || nextShard < locations.size();
+					break;
+				}
+			}
+			++cx->transactionPhysicalReadsCompleted;
+		} catch(Error&) {
+			++cx->transactionPhysicalReadsCompleted;
+			throw;
+		}
+
+		if( keys.begin == allKeys.begin && ( reverse ? !output.more : true ) )
+			output.readToBegin = true;
+		if( keys.end == allKeys.end && ( reverse ? true : !output.more ) )
+			output.readThroughEnd = true;
+
+		getRangeFinished(cx, trLogInfo, startTime, originalBegin, originalEnd, snapshot, conflictRange, reverse, output);
+		return output;
+	}
+	catch(Error &e) {
+		if(conflictRange.canBeSet()) {
+			conflictRange.send(std::make_pair(Key(), Key()));
+		}
+
+		throw;
+	}
+}
+
 Transaction::Transaction( Database const& cx )
 	: cx(cx), info(cx->taskID), backoff(CLIENT_KNOBS->DEFAULT_BACKOFF), committedVersion(invalidVersion), versionstampPromise(Promise<Standalone<StringRef>>()), options(cx), numErrors(0), trLogInfo(createTrLogInfoProbabilistically(cx))
 {
@@ -2082,6 +2488,7 @@ void Transaction::operator=(Transaction&& r) BOOST_NOEXCEPT {
 	readVersion = std::move(r.readVersion);
 	metadataVersion = std::move(r.metadataVersion);
 	extraConflictRanges = std::move(r.extraConflictRanges);
+	mappedConflictRanges = std::move(r.mappedConflictRanges);
 	commitResult = std::move(r.commitResult);
 	committing = std::move(r.committing);
 	options = std::move(r.options);
@@ -2282,6 +2689,115 @@ Future< Key > Transaction::getKey( const KeySelector& key, bool snapshot ) {
 	return getKeyAndConflictRange( cx, key, getReadVersion(), conflictRange, info );
 }
 
+// The index entries a mapped range read covered and the records they named, which it read
+Standalone<VectorRef<KeyRangeRef>> mappedRangeConflicts( KeyRange keys, Key mapper, Standalone<MappedRangeResultRef> const& result, bool reverse ) {
+	Standalone<VectorRef<KeyRangeRef>> ranges;
+	if (!result.more)
+		ranges.push_back_deep(ranges.arena(), keys);
+	else if (reverse)
+		ranges.push_back_deep(ranges.arena(), KeyRangeRef(result.back().key, keys.end));
+	else
+		ranges.push_back_deep(ranges.arena(), KeyRangeRef(keys.begin, keyAfter(result.back().key)));
+
+	// The storage servers have already validated the mapper
+	Tuple mapperTuple = Tuple::unpack(mapper);
+	for (auto& entry : result) {
+		bool isRangeQuery;
+		Tuple mappedKey = constructMappedKey(entry, mapperTuple, isRangeQuery);
+		ranges.push_back_deep(ranges.arena(), isRangeQuery ? mappedKey.range() : singleKeyRange(mappedKey.pack()));
+	}
+	return ranges;
+}
+
+ACTOR Future<Standalone<MappedRangeResultRef>> getMappedRange( Database cx, Future<Version> fVersion, KeyRange keys, Key mapper,
+                                                               GetRangeLimits limits, Promise<Standalone<VectorRef<KeyRangeRef>>> conflictRanges,
+                                                               bool snapshot, bool reverse, TransactionInfo info ) {
+	state Standalone<MappedRangeResultRef> output;
+	state KeyRange remaining = keys;
+	state Version version = wait( fVersion );
+	cx->validateVersion(version);
+
+	loop {
+		state std::pair<KeyRange, Reference<LocationInfo>> ssi = wait( getKeyLocation(cx, reverse ? remaining.end : remaining.begin, &StorageServerInterface::getMappedKeyValues, info, reverse) );
+		state KeyRange range = ssi.first & remaining;
+
+		for (int i = 0; i < ssi.second->size(); i++) {
+			if (!ssi.second->getInterface(i).hasMappedRangeReads()) {
+				TEST(true); // Mapped range read of a shard with a storage server that predates it
+				throw unsupported_operation();
+			}
+		}
+
+		state GetMappedKeyValuesRequest req;
+		req.keys = KeyRangeRef(req.arena, range);
+		req.mapper = StringRef(req.arena, mapper);
+		req.version = version;
+		req.priority = info.readPriority;
+		transformRangeLimits(limits, reverse, req);
+		if( info.debugID.present() ) {
+			req.debugID = info.debugID;
+			g_traceBatch.addEvent("TransactionDebug", info.debugID.get().first(), "NativeAPI.getMappedRange.Before");
+		}
+
+		try {
+			++cx->transactionPhysicalReads;
+			state GetMappedKeyValuesReply rep;
+			try {
+				choose {
+					when(wait(cx->connectionFileChanged())) { throw transaction_too_old(); }
+					when(GetMappedKeyValuesReply _rep = wait(loadBalance(ssi.second, &StorageServerInterface::getMappedKeyValues, req, TaskPriority::DefaultPromiseEndpoint, false, cx->enableLocalityLoadBalance ? &cx->queueModel : nullptr))) {
+						rep = _rep;
+					}
+				}
+				++cx->transactionPhysicalReadsCompleted;
+			} catch(Error&) {
+				++cx->transactionPhysicalReadsCompleted;
+				throw;
+			}
+
+			if( info.debugID.present() )
+				g_traceBatch.addEvent("TransactionDebug", info.debugID.get().first(), "NativeAPI.getMappedRange.After");
+
+			output.arena().dependsOn(rep.arena);
+			for (auto& entry : rep.data) {
+				output.push_back(output.arena(), entry);
+				limits.decrement(entry);
+				cx->transactionBytesRead += entry.expectedSize();
+			}
+			cx->transactionKeysRead += rep.data.size();
+
+			// A reply stops short of the end of the shard only when it has entries; continue after the last one
+			if (rep.more) {
+				ASSERT(rep.data.size());
+				if (reverse)
+					remaining = KeyRangeRef(remaining.begin, rep.data.back().key);
+				else
+					remaining = KeyRangeRef(keyAfter(rep.data.back().key), remaining.end);
+			} else {
+				if (reverse)
+					remaining = KeyRangeRef(remaining.begin, range.begin);
+				else
+					remaining = KeyRangeRef(range.end, remaining.end);
+			}
+
+			if (remaining.empty() || limits.isReached()) {
+				output.more = !remaining.empty();
+				if (!snapshot) conflictRanges.send(mappedRangeConflicts(keys, mapper, output, reverse));
+				return output;
+			}
+		} catch (Error& e) {
+			if( info.debugID.present() )
+				g_traceBatch.addEvent("TransactionDebug", info.debugID.get().first(), "NativeAPI.getMappedRange.Error");
+			if (e.code() == error_code_wrong_shard_server || e.code() == error_code_all_alternatives_failed) {
+				cx->invalidateCache(reverse ? remaining.end : remaining.begin, reverse);
+				wait(delay(CLIENT_KNOBS->WRONG_SHARD_SERVER_DELAY, info.taskID));
+			} else {
+				throw;
+			}
+		}
+	}
+}
+
 Future< Standalone<RangeResultRef> > Transaction::getRange(
 	const KeySelector& begin,
 	const KeySelector& end,
@@ -2322,6 +2838,11 @@ Future< Standalone<RangeResultRef> > Transaction::getRange(
 		extraConflictRanges.push_back( conflictRange.getFuture() );
 	}
 
+	if( options.parallelRangeReadShards > 0 && b.isFirstGreaterOrEqual() && e.isFirstGreaterOrEqual() ) {
+		TEST(true); // Native parallel range read
+		return ::getRangeParallel(cx, trLogInfo, getReadVersion(), KeyRangeRef(b.getKey(), e.getKey()), limits, conflictRange, snapshot, reverse, info, options.parallelRangeReadShards);
+	}
+
 	return ::getRange(cx, trLogInfo, getReadVersion(), b, e, limits, conflictRange, snapshot, reverse, info);
 }
 
@@ -2335,6 +2856,24 @@ Future< Standalone<RangeResultRef> > Transaction::getRange(
 	return getRange( begin, end, GetRangeLimits( limit ), snapshot, reverse );
 }
 
+Future<Standalone<MappedRangeResultRef>> Transaction::getMappedRange( const KeyRange& keys, const Key& mapper, GetRangeLimits limits, bool snapshot, bool reverse ) {
+	++cx->transactionLogicalReads;
+	++cx->transactionGetRangeRequests;
+
+	if( limits.isReached() || keys.empty() )
+		return Standalone<MappedRangeResultRef>();
+
+	if( !limits.isValid() )
+		return range_limits_invalid();
+
+	Promise<Standalone<VectorRef<KeyRangeRef>>> conflictRanges;
+	if(!snapshot) {
+		mappedConflictRanges.push_back( conflictRanges.getFuture() );
+	}
+
+	return ::getMappedRange(cx, getReadVersion(), keys, mapper, limits, conflictRanges, snapshot, reverse, info);
+}
+
 void Transaction::addReadConflictRange( KeyRangeRef const& keys ) {
 	ASSERT( !keys.empty() );
 
@@ -2513,6 +3052,7 @@ void Transaction::reset() {
 	readVersion = Future<Version>();
 	metadataVersion = Promise<Optional<Key>>();
 	extraConflictRanges.clear();
+	mappedConflictRanges.clear();
 	versionstampPromise = Promise<Standalone<StringRef>>();
 	commitResult = Promise<Void>();
 	committing = Future<Void>();
@@ -2894,6 +3434,9 @@ Future<Void> Transaction::commitMutations() {
 		for(int i=0; i<extraConflictRanges.size(); i++)
 			if (extraConflictRanges[i].isReady() && extraConflictRanges[i].get().first < extraConflictRanges[i].get().second )
 				tr.transaction.read_conflict_ranges.push_back( tr.arena, KeyRangeRef(extraConflictRanges[i].get().first, extraConflictRanges[i].get().second) );
+		for(auto& ranges : mappedConflictRanges)
+			if (ranges.isReady() && !ranges.isError())
+				tr.transaction.read_conflict_ranges.append_deep( tr.arena, ranges.get().begin(), ranges.get().size() );
 
 		if( !options.causalWriteRisky && !intersects( tr.transaction.write_conflict_ranges, tr.transaction.read_conflict_ranges ).present() )
 			makeSelfConflicting();
@@ -2971,6 +3514,12 @@ Future<Void> Transaction::commit() {
 
 void Transaction::setPriority( uint32_t priorityFlag ) {
 	options.getReadVersionFlags = (options.getReadVersionFlags & ~GetReadVersionRequest::FLAG_PRIORITY_MASK) | priorityFlag;
+	if(priorityFlag == GetReadVersionRequest::PRIORITY_SYSTEM_IMMEDIATE)
+		info.readPriority = READ_PRIORITY_IMMEDIATE;
+	else if(priorityFlag == GetReadVersionRequest::PRIORITY_BATCH)
+		info.readPriority = READ_PRIORITY_BATCH;
+	else
+		info.readPriority = READ_PRIORITY_DEFAULT;
 }
 
 void Transaction::setOption( FDBTransactionOptions::Option option, Optional<StringRef> value ) {
@@ -3096,6 +3645,11 @@ void Transaction::setOption( FDBTransactionOptions::Option option, Optional<Stri
 			options.sizeLimit = extractIntOption(value, 32, CLIENT_KNOBS->TRANSACTION_SIZE_LIMIT);
 			break;
 
+		case FDBTransactionOptions::PARALLEL_RANGE_READS:
+			validateOptionValue(value, true);
+			options.parallelRangeReadShards = extractIntOption(value, 0, CLIENT_KNOBS->PARALLEL_RANGE_READ_MAX_SHARDS);
+			break;
+
 		case FDBTransactionOptions::LOCK_AWARE:
 			validateOptionValue(value, false);
 			options.lockAware = true;
@@ -3574,6 +4128,63 @@ Future< Standalone<VectorRef<KeyRef>> > Transaction::splitStorageMetrics( KeyRan
 	return ::splitStorageMetrics( cx, keys, limit, estimated );
 }
 
+ACTOR Future< Standalone<VectorRef<KeyRef>> > getRangeSplitPoints( Database cx, KeyRange keys, int64_t chunkSize )
+{
+	loop {
+		state vector< pair<KeyRange, Reference<LocationInfo>> > locations = wait( getKeyRangeLocations( cx, keys, CLIENT_KNOBS->TOO_MANY, false, &StorageServerInterface::getRangeSplitPoints, TransactionInfo(TaskPriority::DefaultPromiseEndpoint) ) );
+		for (auto& location : locations) {
+			for (int i = 0; i < location.second->size(); i++) {
+				if (!location.second->getInterface(i).hasRangeSplitPoints()) {
+					TEST(true); // Range split points of a shard with a storage server that predates them
+					throw unsupported_operation();
+				}
+			}
+		}
+		try {
+			// Each shard is split independently, so ask all of them at once
+			state int nLocs = locations.size();
+			state vector<Future<SplitRangeReply>> fReplies(nLocs);
+			for (int i = 0; i < nLocs; i++) {
+				SplitRangeRequest req( locations[i].first & keys, chunkSize );
+				fReplies[i] = loadBalance( locations[i].second, &StorageServerInterface::getRangeSplitPoints, req, TaskPriority::DefaultPromiseEndpoint );
+			}
+			wait( waitForAll(fReplies) );
+
+			// Shard boundaries are always split points, since a chunk never spans two servers' byte samples
+			Standalone<VectorRef<KeyRef>> results;
+			results.push_back_deep( results.arena(), keys.begin );
+			for (int i = 0; i < nLocs; i++) {
+				if (i > 0) {
+					results.push_back_deep( results.arena(), locations[i].first.begin );
+				}
+				const SplitRangeReply& res = fReplies[i].get();
+				if (res.splitPoints.size()) {
+					results.append( results.arena(), res.splitPoints.begin(), res.splitPoints.size() );
+					results.arena().dependsOn( res.splitPoints.arena() );
+				}
+			}
+			if (results.back() != keys.end) {
+				results.push_back_deep( results.arena(), keys.end );
+			}
+			return results;
+		} catch (Error& e) {
+			if (e.code() != error_code_wrong_shard_server && e.code() != error_code_all_alternatives_failed) {
+				TraceEvent(SevError, "GetRangeSplitPointsError").error(e);
+				throw;
+			}
+			cx->invalidateCache( keys );
+			wait(delay(CLIENT_KNOBS->WRONG_SHARD_SERVER_DELAY));
+		}
+	}
+}
+
+Future< Standalone<VectorRef<KeyRef>> > Transaction::getRangeSplitPoints( KeyRange const& keys, int64_t chunkSize ) {
+	if (chunkSize <= 0) {
+		return client_invalid_operation();
+	}
+	return ::getRangeSplitPoints( cx, keys, chunkSize );
+}
+
 void Transaction::checkDeferredError() { cx->checkDeferredError(); }
 
 Reference<TransactionLogInfo> Transaction::createTrLogInfoProbabilistically(const Database &cx) {
@@ -3593,6 +4204,267 @@ void enableClientInfoLogging() {
 	TraceEvent(SevInfo, "ClientInfoLoggingEnabled");
 }
 
+ACTOR Future<Version> registerChangeFeed(Database cx, Key rangeID, KeyRange range) {
+	state Transaction tr(cx);
+	loop {
+		try {
+			tr.setOption(FDBTransactionOptions::ACCESS_SYSTEM_KEYS);
+			tr.set(changeFeedKey(rangeID), changeFeedValue(range));
+			wait(tr.commit());
+			return tr.getCommittedVersion();
+		} catch (Error& e) {
+			wait(tr.onError(e));
+		}
+	}
+}
+
+ACTOR Future<Void> removeChangeFeed(Database cx, Key rangeID) {
+	state Transaction tr(cx);
+	loop {
+		try {
+			tr.setOption(FDBTransactionOptions::ACCESS_SYSTEM_KEYS);
+			tr.clear(changeFeedKey(rangeID));
+			wait(tr.commit());
+			return Void();
+		} catch (Error& e) {
+			wait(tr.onError(e));
+		}
+	}
+}
+
+ACTOR Future<Void> getChangeFeedStream(Database cx, PromiseStream<Standalone<VectorRef<MutationsAndVersionRef>>> results,
+                                       Key rangeID, Version begin, Version end, KeyRange range) {
+	loop {
+		try {
+			if (begin >= end) {
+				results.sendError(end_of_stream());
+				return Void();
+			}
+
+			state vector<pair<KeyRange, Reference<LocationInfo>>> locations =
+			    wait(getKeyRangeLocations(cx, range, std::numeric_limits<int>::max(), false,
+			                              &StorageServerInterface::changeFeedStream, TransactionInfo(TaskPriority::DefaultEndpoint)));
+
+			// One stream per shard, each from a replica that supports change feeds
+			state std::vector<FutureStream<ChangeFeedStreamReply>> streams;
+			for (auto& location : locations) {
+				int count = location.second->size();
+				int start = deterministicRandom()->randomInt(0, count);
+				int useIdx = -1;
+				bool supported = false;
+				for (int i = 0; i < count; i++) {
+					int index = (start + i) % count;
+					if (!location.second->getInterface(index).hasChangeFeeds()) continue;
+					supported = true;
+					if (!IFailureMonitor::failureMonitor().getState(location.second->get(index, &StorageServerInterface::changeFeedStream).getEndpoint()).failed) {
+						useIdx = index;
+						break;
+					}
+				}
+				if (!supported) throw unsupported_operation();
+				if (useIdx == -1) throw all_alternatives_failed();
+
+				ChangeFeedStreamRequest req;
+				req.rangeID = rangeID;
+				req.begin = begin;
+				req.end = end;
+				req.range = KeyRangeRef(req.arena, location.first & range);
+				streams.push_back(location.second->get(useIdx, &StorageServerInterface::changeFeedStream).getReplyStream(req));
+			}
+
+			// Every shard's mutations are buffered until all of the streams have caught up with their versions
+			state std::vector<std::deque<Standalone<MutationsAndVersionRef>>> buffered(streams.size());
+			state std::vector<Version> through(streams.size(), begin - 1);
+			loop {
+				state int next = std::min_element(through.begin(), through.end()) - through.begin();
+				try {
+					ChangeFeedStreamReply rep = waitNext(streams[next]);
+					for (auto& mv : rep.mutations) {
+						if (mv.mutations.size()) buffered[next].push_back(Standalone<MutationsAndVersionRef>(mv, rep.arena));
+					}
+					through[next] = rep.mutations.back().version;
+				} catch (Error& e) {
+					if (e.code() != error_code_end_of_stream) throw;
+					through[next] = end - 1;
+				}
+
+				Version minThrough = *std::min_element(through.begin(), through.end());
+				if (minThrough < begin) continue;
+
+				Standalone<VectorRef<MutationsAndVersionRef>> output;
+				loop {
+					Version version = minThrough + 1;
+					for (auto& b : buffered) {
+						if (b.size()) version = std::min(version, b.front().version);
+					}
+					if (version > minThrough) break;
+
+					MutationsAndVersionRef entry(VectorRef<MutationRef>(), version);
+					for (auto& b : buffered) {
+						if (b.size() && b.front().version == version) {
+							output.arena().dependsOn(b.front().arena());
+							entry.mutations.append(output.arena(), b.front().mutations.begin(), b.front().mutations.size());
+							b.pop_front();
+						}
+					}
+					output.push_back(output.arena(), entry);
+				}
+				if (output.empty() || output.back().version != minThrough) {
+					output.push_back(output.arena(), MutationsAndVersionRef(VectorRef<MutationRef>(), minThrough));
+				}
+				results.send(output);
+				begin = minThrough + 1;
+
+				if (begin >= end) {
+					results.sendError(end_of_stream());
+					return Void();
+				}
+			}
+		} catch (Error& e) {
+			if (e.code() == error_code_actor_cancelled) throw;
+			if (e.code() == error_code_wrong_shard_server || e.code() == error_code_all_alternatives_failed ||
+			    e.code() == error_code_connection_failed || e.code() == error_code_broken_promise) {
+				// Pick up where the stream left off, from the shards' current locations
+				TEST(true); // Change feed stream restarted
+				cx->invalidateCache(range);
+				wait(delay(CLIENT_KNOBS->WRONG_SHARD_SERVER_DELAY));
+			} else {
+				results.sendError(e);
+				return Void();
+			}
+		}
+	}
+}
+
+ACTOR Future<Void> popChangeFeedOnServer(StorageServerInterface ssi, Key rangeID, Version version) {
+	ErrorOr<Void> reply = wait(ssi.changeFeedPop.tryGetReply(ChangeFeedPopRequest(rangeID, version)));
+	if (reply.isError() && reply.getError().code() != error_code_change_feed_not_registered) {
+		throw reply.getError();
+	}
+	return Void();
+}
+
+ACTOR Future<Void> popChangeFeedMutations(Database cx, Key rangeID, KeyRange range, Version version) {
+	loop {
+		try {
+			vector<pair<KeyRange, Reference<LocationInfo>>> locations =
+			    wait(getKeyRangeLocations(cx, range, std::numeric_limits<int>::max(), false,
+			                              &StorageServerInterface::changeFeedPop, TransactionInfo(TaskPriority::DefaultEndpoint)));
+
+			// Every replica records the feed, so every replica is popped
+			std::vector<Future<Void>> pops;
+			for (auto& location : locations) {
+				for (int i = 0; i < location.second->size(); i++) {
+					if (location.second->getInterface(i).hasChangeFeeds()) {
+						pops.push_back(popChangeFeedOnServer(location.second->getInterface(i), rangeID, version));
+					}
+				}
+			}
+			wait(waitForAll(pops));
+			return Void();
+		} catch (Error& e) {
+			if (e.code() != error_code_request_maybe_delivered && e.code() != error_code_broken_promise) {
+				throw;
+			}
+			cx->invalidateCache(range);
+			wait(delay(CLIENT_KNOBS->WRONG_SHARD_SERVER_DELAY));
+		}
+	}
+}
+
+ACTOR Future<Void> getRangeStream(Database cx, PromiseStream<Standalone<RangeResultRef>> results, KeyRange keys,
+                                  Version version, Reference<FlowLock> readAhead) {
+	state Key begin = keys.begin;
+	loop {
+		try {
+			if (begin >= keys.end) {
+				results.sendError(end_of_stream());
+				return Void();
+			}
+
+			state vector<pair<KeyRange, Reference<LocationInfo>>> locations =
+			    wait(getKeyRangeLocations(cx, KeyRangeRef(begin, keys.end), CLIENT_KNOBS->GET_RANGE_SHARD_LIMIT, false,
+			                              &StorageServerInterface::getKeyValuesStream, TransactionInfo(TaskPriority::DefaultEndpoint)));
+
+			state int shard = 0;
+			for (; shard < locations.size(); shard++) {
+				state KeyRange range = locations[shard].first & KeyRangeRef(begin, keys.end);
+				state Reference<LocationInfo> location = locations[shard].second;
+				int count = location->size();
+				int start = deterministicRandom()->randomInt(0, count);
+				state int useIdx = -1;
+				bool supported = false;
+				for (int i = 0; i < count; i++) {
+					int index = (start + i) % count;
+					if (!location->getInterface(index).hasStreamingRangeReads()) continue;
+					supported = true;
+					if (!IFailureMonitor::failureMonitor().getState(location->get(index, &StorageServerInterface::getKeyValuesStream).getEndpoint()).failed) {
+						useIdx = index;
+						break;
+					}
+				}
+				if (!supported) throw unsupported_operation();
+				if (useIdx == -1) throw all_alternatives_failed();
+
+				GetKeyValuesStreamRequest req;
+				req.begin = firstGreaterOrEqual(KeyRef(req.arena, range.begin));
+				req.end = firstGreaterOrEqual(KeyRef(req.arena, range.end));
+				req.version = version;
+				req.limit = std::numeric_limits<int>::max();
+				req.limitBytes = std::numeric_limits<int>::max();
+				req.isFetchKeys = true;
+				state FutureStream<GetKeyValuesStreamReply> replies = location->get(useIdx, &StorageServerInterface::getKeyValuesStream).getReplyStream(req);
+
+				loop {
+					state GetKeyValuesStreamReply rep;
+					try {
+						GetKeyValuesStreamReply _rep = waitNext(replies);
+						rep = _rep;
+					} catch (Error& e) {
+						if (e.code() != error_code_end_of_stream) throw;
+						break;
+					}
+
+					if (rep.checksum.present() && rep.checksum.get() != rep.dataChecksum()) {
+						TraceEvent(SevWarnAlways, "GetRangeStreamChecksumMismatch")
+						    .detail("Server", location->getInterface(useIdx).id())
+						    .detail("Begin", range.begin)
+						    .detail("End", range.end);
+						throw checksum_failed();
+					}
+
+					// The server only stops short of the shard's end when it has more to send, so a batch without more
+					// completes the shard
+					Key readThrough = rep.more ? (rep.data.size() ? keyAfter(rep.data.back().key) : begin) : range.end;
+					state Standalone<RangeResultRef> block(RangeResultRef(VectorRef<KeyValueRef>(rep.data.begin(), rep.data.size()), true, readThrough), rep.arena);
+					block.arena().dependsOn(readThrough.arena());
+					wait(readAhead->take(TaskPriority::DefaultYield, block.expectedSize()));
+					begin = block.readThrough.get();
+					results.send(block);
+				}
+				begin = range.end;
+			}
+		} catch (Error& e) {
+			if (e.code() == error_code_actor_cancelled) throw;
+			if (e.code() == error_code_wrong_shard_server || e.code() == error_code_all_alternatives_failed ||
+			    e.code() == error_code_connection_failed || e.code() == error_code_broken_promise ||
+			    e.code() == error_code_checksum_failed) {
+				// Pick up after the last batch that was sent, from the shards' current locations
+				TEST(true); // Range stream restarted
+				cx->invalidateCache(KeyRangeRef(begin, keys.end));
+				wait(delay(CLIENT_KNOBS->WRONG_SHARD_SERVER_DELAY));
+			} else if (e.code() == error_code_server_overloaded) {
+				// The server shed a batch from its read queue, so pick up after the last batch once it has had time
+				TEST(true); // Range stream overloaded
+				wait(delay(CLIENT_KNOBS->WRONG_SHARD_SERVER_DELAY));
+			} else {
+				results.sendError(e);
+				return Void();
+			}
+		}
+	}
+}
+
 ACTOR Future<Void> snapCreate(Database cx, Standalone<StringRef> snapCmd, UID snapUID) {
 	TraceEvent("SnapCreateEnter")
 	    .detail("SnapCmd", snapCmd.toString())
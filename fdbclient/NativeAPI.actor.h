@@ -121,6 +121,7 @@ struct TransactionOptions {
 	uint32_t getReadVersionFlags;
 	uint32_t sizeLimit;
 	int maxTransactionLoggingFieldLength;
+	int parallelRangeReadShards;
 	bool checkWritesEnabled : 1;
 	bool causalWriteRisky : 1;
 	bool commitOnFirstProxy : 1;
@@ -141,12 +142,13 @@ class ReadYourWritesTransaction; // workaround cyclic dependency
 struct TransactionInfo {
 	Optional<UID> debugID;
 	TaskPriority taskID;
+	int32_t readPriority; // a ReadPriority, from the transaction's priority option
 	bool useProvisionalProxies;
 	// Used to save conflicting keys if FDBTransactionOptions::REPORT_CONFLICTING_KEYS is enabled
 	// shared_ptr used here since TransactionInfo is sometimes copied as function parameters.
 	std::shared_ptr<ReadYourWritesTransaction> conflictingKeysRYW;
 
-	explicit TransactionInfo( TaskPriority taskID ) : taskID(taskID), useProvisionalProxies(false) {}
+	explicit TransactionInfo( TaskPriority taskID ) : taskID(taskID), readPriority(READ_PRIORITY_DEFAULT), useProvisionalProxies(false) {}
 };
 
 struct TransactionLogInfo : public ReferenceCounted<TransactionLogInfo>, NonCopyable {
@@ -236,6 +238,12 @@ public:
 		                KeySelector(firstGreaterOrEqual(keys.end), keys.arena()), limits, snapshot, reverse);
 	}
 
+	// Reads the index entries in keys and, on the storage servers, the records that mapper derives from each of them.
+	// The conflict ranges of the records are only known from the result, so they are added once the read completes.
+	[[nodiscard]] Future<Standalone<MappedRangeResultRef>> getMappedRange(const KeyRange& keys, const Key& mapper,
+	                                                                      GetRangeLimits limits, bool snapshot = false,
+	                                                                      bool reverse = false);
+
 	[[nodiscard]] Future<Standalone<VectorRef<const char*>>> getAddressesForKey(const Key& key);
 
 	void enableCheckWrites();
@@ -249,6 +257,8 @@ public:
 	// Pass a negative value for `shardLimit` to indicate no limit on the shard number.
 	Future< StorageMetrics > getStorageMetrics( KeyRange const& keys, int shardLimit );
 	Future< Standalone<VectorRef<KeyRef>> > splitStorageMetrics( KeyRange const& keys, StorageMetrics const& limit, StorageMetrics const& estimated );
+	// Returns keys, starting with keys.begin and ending with keys.end, that divide the range into chunks of roughly chunkSize bytes
+	Future< Standalone<VectorRef<KeyRef>> > getRangeSplitPoints( KeyRange const& keys, int64_t chunkSize );
 
 	// If checkWriteConflictRanges is true, existing write conflict ranges will be searched for this key
 	void set( const KeyRef& key, const ValueRef& value, bool addConflictRange = true );
@@ -310,6 +320,7 @@ private:
 	Future<Version> readVersion;
 	Promise<Optional<Value>> metadataVersion;
 	vector<Future<std::pair<Key, Key>>> extraConflictRanges;
+	vector<Future<Standalone<VectorRef<KeyRangeRef>>>> mappedConflictRanges;
 	Promise<Void> commitResult;
 	Future<Void> committing;
 };
@@ -320,6 +331,28 @@ std::string unprintable( const std::string& );
 
 int64_t extractIntOption( Optional<StringRef> value, int64_t minValue = std::numeric_limits<int64_t>::min(), int64_t maxValue = std::numeric_limits<int64_t>::max() );
 
+// Registers a change feed named rangeID on the storage servers holding range, and returns the version it was registered
+// at.  The feed records the mutations to range at later versions until it is removed.
+ACTOR Future<Version> registerChangeFeed(Database cx, Key rangeID, KeyRange range);
+ACTOR Future<Void> removeChangeFeed(Database cx, Key rangeID);
+
+// Sends the mutations the feed recorded in range at versions [begin, end) to results, in version order, and ends it with
+// end_of_stream.  The last entry of each batch is at the version the stream is complete through, and may carry no
+// mutations.  Fails with change_feed_popped if mutations at begin are no longer available.
+ACTOR Future<Void> getChangeFeedStream(Database cx, PromiseStream<Standalone<VectorRef<MutationsAndVersionRef>>> results,
+                                       Key rangeID, Version begin, Version end, KeyRange range);
+
+// Discards the mutations the feed recorded in range before version; range should be the whole range of the feed
+ACTOR Future<Void> popChangeFeedMutations(Database cx, Key rangeID, KeyRange range, Version version);
+
+// Sends the contents of keys at version to results in key order, in batches as large as the storage servers send them,
+// and ends it with end_of_stream.  Every batch's readThrough is the key the stream is complete through.  Each batch
+// takes its expectedSize() from readAhead before it is sent, and the consumer releases it once the batch is used, which
+// bounds how far the stream runs ahead.  Batches are checksummed by the storage server and verified here.  Fails with
+// unsupported_operation if a shard has no replica that can stream.
+ACTOR Future<Void> getRangeStream(Database cx, PromiseStream<Standalone<RangeResultRef>> results, KeyRange keys,
+                                  Version version, Reference<FlowLock> readAhead);
+
 // Takes a snapshot of the cluster, specifically the following persistent
 // states: coordinator, TLog and storage state
 ACTOR Future<Void> snapCreate(Database cx, Standalone<StringRef> snapCmd, UID snapUID);
@@ -22,6 +22,7 @@
 #include "fdbclient/Atomic.h"
 #include "fdbclient/DatabaseContext.h"
 #include "fdbclient/StatusClient.h"
+#include "fdbclient/Tuple.h"
 #include "fdbclient/MonitorLeader.h"
 #include "flow/Util.h"
 #include "flow/actorcompiler.h"  // This must be the last #include.
@@ -979,6 +980,78 @@ public:
 		triggerWatches(ryw, singleKeyRange(key), val, valueKnown);
 	}
 
+	static bool containsWrites( ReadYourWritesTransaction* ryw, KeyRangeRef const& keys ) {
+		WriteMap::iterator it( &ryw->writes );
+		for( it.skip( keys.begin ); it.beginKey() < keys.end; ++it ) {
+			if( !it.is_unmodified_range() )
+				return true;
+		}
+		return false;
+	}
+
+	// Mapped range reads are served entirely by the storage servers, so they cannot see this transaction's writes.
+	// Rather than return stale records, they fail if the index range or any record they read has been written.
+	ACTOR static Future<Standalone<MappedRangeResultRef>> getMappedRangeThrough( ReadYourWritesTransaction* ryw, KeySelector begin, KeySelector end, Key mapper, GetRangeLimits limits, bool snapshot, bool reverse ) {
+		state Key beginKey = begin.getKey();
+		state Key endKey = end.getKey();
+		if( !begin.isFirstGreaterOrEqual() ) {
+			Key k = wait( ryw->getKey( begin, snapshot ) );
+			beginKey = k;
+		}
+		if( !end.isFirstGreaterOrEqual() ) {
+			Key k = wait( ryw->getKey( end, snapshot ) );
+			endKey = k;
+		}
+		if( beginKey >= endKey ) {
+			return Standalone<MappedRangeResultRef>();
+		}
+
+		state KeyRange keys = KeyRangeRef( beginKey, endKey );
+		if( !ryw->options.readYourWritesDisabled && containsWrites( ryw, keys ) ) {
+			throw mapped_range_reads_your_writes();
+		}
+
+		Standalone<MappedRangeResultRef> result = wait( ryw->tr.getMappedRange( keys, mapper, limits, true, reverse ) );
+
+		// The server has already validated the mapper
+		Tuple mapperTuple = Tuple::unpack( mapper );
+		KeyRef maxKey = ryw->getMaxReadKey();
+		for( auto& entry : result ) {
+			bool isRangeQuery;
+			Tuple mappedKey = constructMappedKey( entry, mapperTuple, isRangeQuery );
+			KeyRange records = isRangeQuery ? mappedKey.range() : singleKeyRange( mappedKey.pack() );
+			if( records.end > maxKey ) {
+				throw key_outside_legal_range();
+			}
+			if( !ryw->options.readYourWritesDisabled && containsWrites( ryw, records ) ) {
+				throw mapped_range_reads_your_writes();
+			}
+			if( !snapshot ) {
+				ryw->addReadConflictRange( records );
+			}
+		}
+
+		if( !snapshot ) {
+			if( !result.more )
+				ryw->addReadConflictRange( keys );
+			else if( reverse )
+				ryw->addReadConflictRange( KeyRangeRef( result.back().key, keys.end ) );
+			else
+				ryw->addReadConflictRange( KeyRangeRef( keys.begin, keyAfter( result.back().key ) ) );
+		}
+
+		return result;
+	}
+
+	ACTOR static Future<Standalone<MappedRangeResultRef>> getMappedRange( ReadYourWritesTransaction* ryw, KeySelector begin, KeySelector end, Key mapper, GetRangeLimits limits, bool snapshot, bool reverse ) {
+		choose {
+			when (Standalone<MappedRangeResultRef> result = wait( getMappedRangeThrough( ryw, begin, end, mapper, limits, snapshot, reverse ) )) {
+				return result;
+			}
+			when (wait(ryw->resetPromise.getFuture())) { throw internal_error(); }
+		}
+	}
+
 	ACTOR static Future<Void> watch( ReadYourWritesTransaction *ryw, Key key ) {
 		state Future<Optional<Value>> val;
 		state Future<Void> watchFuture;
@@ -1364,6 +1437,43 @@ Future< Standalone<RangeResultRef> > ReadYourWritesTransaction::getRange(
 	return getRange( begin, end, GetRangeLimits( limit ), snapshot, reverse );
 }
 
+Future<Standalone<MappedRangeResultRef>> ReadYourWritesTransaction::getMappedRange(
+	KeySelector begin,
+	KeySelector end,
+	Key mapper,
+	GetRangeLimits limits,
+	bool snapshot,
+	bool reverse )
+{
+	if(checkUsedDuringCommit()) {
+		return used_during_commit();
+	}
+
+	if( resetPromise.isSet() )
+		return resetPromise.getFuture().getError();
+
+	KeyRef maxKey = getMaxReadKey();
+	if(begin.getKey() > maxKey || end.getKey() > maxKey)
+		return key_outside_legal_range();
+
+	if( limits.isReached() )
+		return Standalone<MappedRangeResultRef>();
+
+	if( !limits.isValid() )
+		return range_limits_invalid();
+
+	if( begin.orEqual )
+		begin.removeOrEqual(begin.arena());
+
+	if( end.orEqual )
+		end.removeOrEqual(end.arena());
+
+	Future<Standalone<MappedRangeResultRef>> result = RYWImpl::getMappedRange( this, begin, end, mapper, limits, snapshot, reverse );
+
+	reading.add( success( result ) );
+	return result;
+}
+
 Future< Standalone<VectorRef<const char*> >> ReadYourWritesTransaction::getAddressesForKey( const Key& key ) {
 	if(checkUsedDuringCommit()) {
 		return used_during_commit();
@@ -1389,6 +1499,20 @@ Future<int64_t> ReadYourWritesTransaction::getEstimatedRangeSizeBytes(const KeyR
 	return map(waitOrError(tr.getStorageMetrics(keys, -1), resetPromise.getFuture()), [](const StorageMetrics& m) { return m.bytes; });
 }
 
+Future<Standalone<VectorRef<KeyRef>>> ReadYourWritesTransaction::getRangeSplitPoints(const KeyRangeRef& range, int64_t chunkSize) {
+	if(checkUsedDuringCommit()) {
+		throw used_during_commit();
+	}
+	if( resetPromise.isSet() )
+		return resetPromise.getFuture().getError();
+
+	KeyRef maxKey = getMaxReadKey();
+	if(range.begin > maxKey || range.end > maxKey)
+		return key_outside_legal_range();
+
+	return waitOrError(tr.getRangeSplitPoints(range, chunkSize), resetPromise.getFuture());
+}
+
 void ReadYourWritesTransaction::addReadConflictRange( KeyRangeRef const& keys ) {
 	if(checkUsedDuringCommit()) {
 		throw used_during_commit();
@@ -84,7 +84,10 @@ public:
 	}
 
 	[[nodiscard]] Future<Standalone<VectorRef<const char*>>> getAddressesForKey(const Key& key);
+	// Fails with mapped_range_reads_your_writes if the read depends on keys written by this transaction
+	Future< Standalone<MappedRangeResultRef> > getMappedRange( KeySelector begin, KeySelector end, Key mapper, GetRangeLimits limits, bool snapshot = false, bool reverse = false );
 	Future<int64_t> getEstimatedRangeSizeBytes( const KeyRangeRef& keys );
+	Future<Standalone<VectorRef<KeyRef>>> getRangeSplitPoints( const KeyRangeRef& range, int64_t chunkSize );
 
 	void addReadConflictRange( KeyRangeRef const& keys );
 	void makeSelfConflicting() { tr.makeSelfConflicting(); }
@@ -23,11 +23,13 @@
 #pragma once
 
 #include "fdbclient/FDBTypes.h"
+#include "fdbclient/CommitTransaction.h"
 #include "fdbrpc/Locality.h"
 #include "fdbrpc/QueueModel.h"
 #include "fdbrpc/fdbrpc.h"
 #include "fdbrpc/LoadBalance.actor.h"
 #include "flow/Stats.h"
+#include "flow/crc32c.h"
 #include "fdbrpc/TimedRequest.h"
 
 // Dead code, removed in the next protocol version
@@ -44,6 +46,10 @@ struct VersionReply {
 	}
 };
 
+// The order in which a storage server admits reads that are waiting for it.  Batch reads are also the first to be shed
+// when the server is overloaded, and immediate reads are never shed.
+enum ReadPriority { READ_PRIORITY_BATCH = 0, READ_PRIORITY_DEFAULT = 1, READ_PRIORITY_IMMEDIATE = 2, READ_PRIORITY_COUNT = 3 };
+
 struct StorageServerInterface {
 	constexpr static FileIdentifier file_identifier = 15302073;
 	enum { BUSY_ALLOWED = 0, BUSY_FORCE = 1, BUSY_LOCAL = 2 };
@@ -71,8 +77,48 @@ struct StorageServerInterface {
 	RequestStream<ReplyPromise<KeyValueStoreType>> getKeyValueStoreType;
 	RequestStream<struct WatchValueRequest> watchValue;
 
-	explicit StorageServerInterface(UID uid) : uniqueID( uid ) {}
-	StorageServerInterface() : uniqueID( deterministicRandom()->randomUniqueID() ) {}
+	// Streams the range in batches until it is exhausted or the limits are reached, subject to the same shard
+	// restrictions as getKeyValues.  The stream ends with end_of_stream.
+	RequestStream<struct GetKeyValuesStreamRequest> getKeyValuesStream;
+
+	// Reads many keys at one version; throws wrong_shard_server if any of them is not readable on this server
+	RequestStream<struct GetValuesRequest> getValues;
+
+	// Reads a range of index entries within one shard and, for each entry, the records named by applying the
+	// request's mapper to it.  Records on other servers are read through the database.
+	RequestStream<struct GetMappedKeyValuesRequest> getMappedKeyValues;
+
+	// Streams the mutations a change feed recorded within one shard, starting at a version and waiting for new ones
+	// until the end version.  The stream ends with end_of_stream, or with wrong_shard_server if the shard moves.
+	RequestStream<struct ChangeFeedStreamRequest> changeFeedStream;
+
+	// Discards the mutations a change feed recorded before a version
+	RequestStream<struct ChangeFeedPopRequest> changeFeedPop;
+
+	// Returns keys that cut a range within one shard into chunks of about the requested size, from the byte sample
+	RequestStream<struct SplitRangeRequest> getRangeSplitPoints;
+
+	// Watches many keys of one shard at once, replying with all of the watches that fired at about the same time
+	RequestStream<struct WatchValuesRequest> watchValues;
+
+	// The optional requests above that this server serves.  Servers that predate them advertise none, and storage
+	// caches serve only some of them.
+	enum {
+		STREAMING_RANGE_READS = 1 << 0,
+		GET_VALUES = 1 << 1,
+		MAPPED_RANGE_READS = 1 << 2,
+		CHANGE_FEEDS = 1 << 3,
+		RANGE_SPLIT_POINTS = 1 << 4,
+		WATCH_VALUES = 1 << 5,
+
+		STORAGE_SERVER_FEATURES = STREAMING_RANGE_READS | GET_VALUES | MAPPED_RANGE_READS | CHANGE_FEEDS |
+		                          RANGE_SPLIT_POINTS | WATCH_VALUES,
+		STORAGE_CACHE_FEATURES = GET_VALUES
+	};
+	uint32_t features;
+
+	explicit StorageServerInterface(UID uid) : uniqueID( uid ), features( 0 ) {}
+	StorageServerInterface() : uniqueID( deterministicRandom()->randomUniqueID() ), features( 0 ) {}
 	NetworkAddress address() const { return getValue.getEndpoint().getPrimaryAddress(); }
 	Optional<NetworkAddress> secondaryAddress() const { return getValue.getEndpoint().addresses.secondaryAddress; }
 	UID id() const { return uniqueID; }
@@ -86,19 +132,37 @@ struct StorageServerInterface {
 			serializer(ar, uniqueID, locality, getValue, getKey, getKeyValues, getShardState, waitMetrics,
 			           splitMetrics, getStorageMetrics, waitFailure, getQueuingMetrics, getKeyValueStoreType);
 			if (ar.protocolVersion().hasWatches()) serializer(ar, watchValue);
+			if (ar.protocolVersion().hasStreamingRangeReads()) serializer(ar, getKeyValuesStream);
+			if (ar.protocolVersion().hasGetValues()) serializer(ar, getValues);
+			if (ar.protocolVersion().hasMappedRangeReads()) serializer(ar, getMappedKeyValues);
+			if (ar.protocolVersion().hasChangeFeeds()) serializer(ar, changeFeedStream, changeFeedPop);
+			if (ar.protocolVersion().hasRangeSplitPoints()) serializer(ar, getRangeSplitPoints);
+			if (ar.protocolVersion().hasWatchValues()) serializer(ar, watchValues);
+			if (ar.protocolVersion().hasStorageServerFeatures()) serializer(ar, features);
 		} else {
 			serializer(ar, uniqueID, locality, getValue, getKey, getKeyValues, getShardState, waitMetrics,
 			           splitMetrics, getStorageMetrics, waitFailure, getQueuingMetrics, getKeyValueStoreType,
-			           watchValue);
+			           watchValue, getKeyValuesStream, getValues, getMappedKeyValues, changeFeedStream, changeFeedPop,
+			           getRangeSplitPoints, watchValues, features);
 		}
 	}
+	bool hasStreamingRangeReads() const { return features & STREAMING_RANGE_READS; }
+	bool hasGetValues() const { return features & GET_VALUES; }
+	bool hasMappedRangeReads() const { return features & MAPPED_RANGE_READS; }
+	bool hasChangeFeeds() const { return features & CHANGE_FEEDS; }
+	bool hasRangeSplitPoints() const { return features & RANGE_SPLIT_POINTS; }
+	bool hasWatchValues() const { return features & WATCH_VALUES; }
 	bool operator == (StorageServerInterface const& s) const { return uniqueID == s.uniqueID; }
 	bool operator < (StorageServerInterface const& s) const { return uniqueID < s.uniqueID; }
 	void initEndpoints() {
 		getValue.getEndpoint( TaskPriority::LoadBalancedEndpoint );
 		getKey.getEndpoint( TaskPriority::LoadBalancedEndpoint );
 		getKeyValues.getEndpoint( TaskPriority::LoadBalancedEndpoint );
+		getKeyValuesStream.getEndpoint( TaskPriority::LoadBalancedEndpoint );
+		getValues.getEndpoint( TaskPriority::LoadBalancedEndpoint );
+		getMappedKeyValues.getEndpoint( TaskPriority::LoadBalancedEndpoint );
 	}
+
 };
 
 struct StorageInfo : NonCopyable, public ReferenceCounted<StorageInfo> {
@@ -143,14 +207,44 @@ struct GetValueRequest : TimedRequest {
 	Key key;
 	Version version;
 	Optional<UID> debugID;
+	int32_t priority; // a ReadPriority
 	ReplyPromise<GetValueReply> reply;
 
-	GetValueRequest(){}
-	GetValueRequest(const Key& key, Version ver, Optional<UID> debugID) : key(key), version(ver), debugID(debugID) {}
+	GetValueRequest() : priority(READ_PRIORITY_DEFAULT) {}
+	GetValueRequest(const Key& key, Version ver, Optional<UID> debugID, int32_t priority = READ_PRIORITY_DEFAULT) : key(key), version(ver), debugID(debugID), priority(priority) {}
 	
 	template <class Ar> 
 	void serialize( Ar& ar ) {
-		serializer(ar, key, version, debugID, reply);
+		serializer(ar, key, version, debugID, reply, priority);
+	}
+};
+
+struct GetValuesReply : public LoadBalancedReply {
+	constexpr static FileIdentifier file_identifier = 1378930;
+	Arena arena;
+	VectorRef<KeyValueRef, VecSerStrategy::String> data; // the requested keys that are present, in key order
+
+	GetValuesReply() {}
+
+	template <class Ar>
+	void serialize( Ar& ar ) {
+		serializer(ar, LoadBalancedReply::penalty, LoadBalancedReply::error, data, arena);
+	}
+};
+
+struct GetValuesRequest : TimedRequest {
+	constexpr static FileIdentifier file_identifier = 8454531;
+	Arena arena;
+	VectorRef<KeyRef> keys; // sorted and unique
+	Version version;
+	Optional<UID> debugID;
+	ReplyPromise<GetValuesReply> reply;
+
+	GetValuesRequest() {}
+
+	template <class Ar>
+	void serialize( Ar& ar ) {
+		serializer(ar, keys, version, debugID, reply, arena);
 	}
 };
 
@@ -184,6 +278,50 @@ struct WatchValueRequest {
 	}
 };
 
+struct WatchedKeyRef {
+	KeyRef key;
+	Optional<ValueRef> value; // the value the client read, which the watch waits to change
+
+	WatchedKeyRef() {}
+	WatchedKeyRef(KeyRef key, Optional<ValueRef> value) : key(key), value(value) {}
+	WatchedKeyRef(Arena& a, const WatchedKeyRef& copyFrom) : key(a, copyFrom.key), value(a, copyFrom.value) {}
+
+	int expectedSize() const { return key.expectedSize() + value.expectedSize(); }
+
+	template <class Ar>
+	void serialize(Ar& ar) {
+		serializer(ar, key, value);
+	}
+};
+
+struct WatchValuesReply {
+	constexpr static FileIdentifier file_identifier = 3942156;
+	Version version; // a version at which all of the fired watches' keys had changed
+	std::vector<int> fired; // indexes into the request's watches
+
+	WatchValuesReply() : version(invalidVersion) {}
+
+	template <class Ar>
+	void serialize(Ar& ar) {
+		serializer(ar, version, fired);
+	}
+};
+
+struct WatchValuesRequest {
+	constexpr static FileIdentifier file_identifier = 14747734;
+	Arena arena;
+	VectorRef<WatchedKeyRef> watches;
+	Version version; // the latest version at which any of the values were read
+	ReplyPromise<WatchValuesReply> reply;
+
+	WatchValuesRequest() {}
+
+	template <class Ar>
+	void serialize(Ar& ar) {
+		serializer(ar, watches, version, reply, arena);
+	}
+};
+
 struct GetKeyValuesReply : public LoadBalancedReply {
 	constexpr static FileIdentifier file_identifier = 1783066;
 	Arena arena;
@@ -208,13 +346,144 @@ struct GetKeyValuesRequest : TimedRequest {
 	int limit, limitBytes;
 	bool isFetchKeys;
 	Optional<UID> debugID;
+	int32_t priority; // a ReadPriority
 	ReplyPromise<GetKeyValuesReply> reply;
 
-	GetKeyValuesRequest() : isFetchKeys(false) {}
+	GetKeyValuesRequest() : isFetchKeys(false), priority(READ_PRIORITY_DEFAULT) {}
 //	GetKeyValuesRequest(const KeySelectorRef& begin, const KeySelectorRef& end, Version version, int limit, int limitBytes, Optional<UID> debugID) : begin(begin), end(end), version(version), limit(limit), limitBytes(limitBytes) {}
 	template <class Ar>
 	void serialize( Ar& ar ) {
-		serializer(ar, begin, end, version, limit, limitBytes, isFetchKeys, debugID, reply, arena);
+		serializer(ar, begin, end, version, limit, limitBytes, isFetchKeys, debugID, reply, arena, priority);
+	}
+};
+
+struct GetKeyValuesStreamReply : public ReplyPromiseStreamReply {
+	constexpr static FileIdentifier file_identifier = 1783067;
+	Arena arena;
+	VectorRef<KeyValueRef, VecSerStrategy::String> data;
+	Version version; // useful when latestVersion was requested
+	bool more; // true unless this is the last batch and the range was exhausted
+	bool cached;
+	Optional<uint32_t> checksum; // of data, sent to fetchKeys so that a shard move never ingests a corrupted batch
+
+	GetKeyValuesStreamReply() : version(invalidVersion), more(false), cached(false) {}
+
+	int expectedSize() const { return sizeof(GetKeyValuesStreamReply) + data.expectedSize(); }
+
+	uint32_t dataChecksum() const {
+		uint32_t crc = 0;
+		for (auto& kv : data) {
+			int32_t sizes[2] = { kv.key.size(), kv.value.size() };
+			crc = crc32c_append(crc, reinterpret_cast<const uint8_t*>(sizes), sizeof(sizes));
+			crc = crc32c_append(crc, kv.key.begin(), kv.key.size());
+			crc = crc32c_append(crc, kv.value.begin(), kv.value.size());
+		}
+		return crc;
+	}
+
+	template <class Ar>
+	void serialize( Ar& ar ) {
+		serializer(ar, ReplyPromiseStreamReply::acknowledgeToken, ReplyPromiseStreamReply::sequence, data, version,
+		           more, cached, checksum, arena);
+	}
+};
+
+struct GetKeyValuesStreamRequest : TimedRequest {
+	constexpr static FileIdentifier file_identifier = 6795747;
+	Arena arena;
+	KeySelectorRef begin, end;
+	Version version;		// or latestVersion
+	int limit, limitBytes;	// totals for the whole stream
+	bool isFetchKeys;
+	Optional<UID> debugID;
+	int32_t priority; // a ReadPriority
+	ReplyPromiseStream<GetKeyValuesStreamReply> reply;
+
+	GetKeyValuesStreamRequest() : isFetchKeys(false), priority(READ_PRIORITY_DEFAULT) {}
+	template <class Ar>
+	void serialize( Ar& ar ) {
+		serializer(ar, begin, end, version, limit, limitBytes, isFetchKeys, debugID, reply, arena, priority);
+	}
+};
+
+struct GetMappedKeyValuesReply : public LoadBalancedReply {
+	constexpr static FileIdentifier file_identifier = 1783068;
+	Arena arena;
+	VectorRef<MappedKeyValueRef> data;
+	Version version;
+	bool more; // true if the limits stopped the read before the end of the requested range
+	bool cached;
+
+	GetMappedKeyValuesReply() : version(invalidVersion), more(false), cached(false) {}
+
+	template <class Ar>
+	void serialize( Ar& ar ) {
+		serializer(ar, LoadBalancedReply::penalty, LoadBalancedReply::error, data, version, more, cached, arena);
+	}
+};
+
+struct GetMappedKeyValuesRequest : TimedRequest {
+	constexpr static FileIdentifier file_identifier = 6795748;
+	Arena arena;
+	KeyRangeRef keys;
+	KeyRef mapper; // a packed tuple describing how to build record keys from each index entry
+	Version version;
+	int limit, limitBytes; // limit counts index entries; limitBytes counts index entries and records
+	Optional<UID> debugID;
+	int32_t priority; // a ReadPriority
+	ReplyPromise<GetMappedKeyValuesReply> reply;
+
+	GetMappedKeyValuesRequest() : priority(READ_PRIORITY_DEFAULT) {}
+
+	template <class Ar>
+	void serialize( Ar& ar ) {
+		serializer(ar, keys, mapper, version, limit, limitBytes, debugID, reply, arena, priority);
+	}
+};
+
+struct ChangeFeedStreamReply : public ReplyPromiseStreamReply {
+	constexpr static FileIdentifier file_identifier = 1783069;
+	Arena arena;
+	VectorRef<MutationsAndVersionRef> mutations; // the last entry's version is the version through which the reply is complete
+
+	ChangeFeedStreamReply() {}
+
+	int expectedSize() const { return sizeof(ChangeFeedStreamReply) + mutations.expectedSize(); }
+
+	template <class Ar>
+	void serialize( Ar& ar ) {
+		serializer(ar, ReplyPromiseStreamReply::acknowledgeToken, ReplyPromiseStreamReply::sequence, mutations, arena);
+	}
+};
+
+struct ChangeFeedStreamRequest {
+	constexpr static FileIdentifier file_identifier = 6795749;
+	Arena arena;
+	Key rangeID;
+	Version begin, end; // mutations at versions in [begin, end) are returned
+	KeyRangeRef range;	// only mutations to this part of the feed are returned; it must be readable on the server
+	ReplyPromiseStream<ChangeFeedStreamReply> reply;
+
+	ChangeFeedStreamRequest() : begin(0), end(0) {}
+
+	template <class Ar>
+	void serialize( Ar& ar ) {
+		serializer(ar, rangeID, begin, end, range, reply, arena);
+	}
+};
+
+struct ChangeFeedPopRequest {
+	constexpr static FileIdentifier file_identifier = 6795750;
+	Key rangeID;
+	Version version;
+	ReplyPromise<Void> reply;
+
+	ChangeFeedPopRequest() : version(invalidVersion) {}
+	ChangeFeedPopRequest( Key const& rangeID, Version version ) : rangeID(rangeID), version(version) {}
+
+	template <class Ar>
+	void serialize( Ar& ar ) {
+		serializer(ar, rangeID, version, reply);
 	}
 };
 
@@ -236,14 +505,15 @@ struct GetKeyRequest : TimedRequest {
 	Arena arena;
 	KeySelectorRef sel;
 	Version version;		// or latestVersion
+	int32_t priority; // a ReadPriority
 	ReplyPromise<GetKeyReply> reply;
 
-	GetKeyRequest() {}
-	GetKeyRequest(KeySelectorRef const& sel, Version version) : sel(sel), version(version) {}
+	GetKeyRequest() : priority(READ_PRIORITY_DEFAULT) {}
+	GetKeyRequest(KeySelectorRef const& sel, Version version, int32_t priority = READ_PRIORITY_DEFAULT) : sel(sel), version(version), priority(priority) {}
 
 	template <class Ar>
 	void serialize( Ar& ar ) {
-		serializer(ar, sel, version, reply, arena);
+		serializer(ar, sel, version, reply, arena, priority);
 	}
 };
 
@@ -388,6 +658,33 @@ struct SplitMetricsRequest {
 	}
 };
 
+struct SplitRangeReply {
+	constexpr static FileIdentifier file_identifier = 11813134;
+	// If the given range is [A, B), then split points are in (A, B)
+	Standalone<VectorRef<KeyRef>> splitPoints;
+
+	template <class Ar>
+	void serialize( Ar& ar ) {
+		serializer(ar, splitPoints);
+	}
+};
+
+struct SplitRangeRequest {
+	constexpr static FileIdentifier file_identifier = 10725174;
+	Arena arena;
+	KeyRangeRef keys;
+	int64_t chunkSize;
+	ReplyPromise<SplitRangeReply> reply;
+
+	SplitRangeRequest() : chunkSize(0) {}
+	SplitRangeRequest( KeyRangeRef const& keys, int64_t chunkSize ) : keys( arena, keys ), chunkSize( chunkSize ) {}
+
+	template <class Ar>
+	void serialize( Ar& ar ) {
+		serializer(ar, keys, chunkSize, reply, arena);
+	}
+};
+
 struct GetStorageMetricsReply {
 	constexpr static FileIdentifier file_identifier = 15491478;
 	StorageMetrics load;
@@ -173,6 +173,25 @@ uint16_t cacheChangeKeyDecodeIndex( const KeyRef& key ) {
 	return idx;
 }
 
+const KeyRangeRef changeFeedKeys( LiteralStringRef("\xff/changeFeed/"), LiteralStringRef("\xff/changeFeed0") );
+const KeyRef changeFeedPrefix = changeFeedKeys.begin;
+const KeyRef changeFeedPrivatePrefix = LiteralStringRef("\xff\xff/changeFeed/");
+
+const Key changeFeedKey( KeyRef const& rangeID ) {
+	return rangeID.withPrefix( changeFeedPrefix );
+}
+const Value changeFeedValue( KeyRangeRef const& range ) {
+	BinaryWriter wr((IncludeVersion()));
+	wr << range;
+	return wr.toValue();
+}
+KeyRange decodeChangeFeedValue( ValueRef const& value ) {
+	KeyRange range;
+	BinaryReader reader( value, IncludeVersion() );
+	reader >> range;
+	return range;
+}
+
 const KeyRangeRef serverTagKeys(
 	LiteralStringRef("\xff/serverTag/"),
 	LiteralStringRef("\xff/serverTag0") );
@@ -82,6 +82,15 @@ extern const KeyRef cacheChangePrefix;
 const Key cacheChangeKeyFor( uint16_t idx );
 uint16_t cacheChangeKeyDecodeIndex( const KeyRef& key );
 
+//    "\xff/changeFeed/[[rangeID]]" := "[[KeyRange]]"
+// Storage servers holding any part of the range record the mutations to it from the version this key is set
+extern const KeyRangeRef changeFeedKeys;
+extern const KeyRef changeFeedPrefix;
+extern const KeyRef changeFeedPrivatePrefix;
+const Key changeFeedKey( KeyRef const& rangeID );
+const Value changeFeedValue( KeyRangeRef const& range );
+KeyRange decodeChangeFeedValue( ValueRef const& value );
+
 extern const KeyRangeRef serverTagKeys;
 extern const KeyRef serverTagPrefix;
 extern const KeyRangeRef serverTagMaxKeys;
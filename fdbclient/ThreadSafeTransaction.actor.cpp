@@ -157,6 +157,18 @@ ThreadFuture< Key > ThreadSafeTransaction::getKey( const KeySelectorRef& key, bo
 		} );
 }
 
+ThreadFuture< Standalone<MappedRangeResultRef> > ThreadSafeTransaction::getMappedRange( const KeySelectorRef& begin, const KeySelectorRef& end, const StringRef& mapper, GetRangeLimits limits, bool snapshot, bool reverse ) {
+	KeySelector b = begin;
+	KeySelector e = end;
+	Key m = mapper;
+
+	ReadYourWritesTransaction *tr = this->tr;
+	return onMainThread( [tr, b, e, m, limits, snapshot, reverse]() -> Future< Standalone<MappedRangeResultRef> > {
+			tr->checkDeferredError();
+			return tr->getMappedRange(b, e, m, limits, snapshot, reverse);
+		} );
+}
+
 ThreadFuture<int64_t> ThreadSafeTransaction::getEstimatedRangeSizeBytes( const KeyRangeRef& keys ) {
 	KeyRange r = keys;
 
@@ -167,6 +179,16 @@ ThreadFuture<int64_t> ThreadSafeTransaction::getEstimatedRangeSizeBytes( const K
 		} );
 }
 
+ThreadFuture<Standalone<VectorRef<KeyRef>>> ThreadSafeTransaction::getRangeSplitPoints( const KeyRangeRef& range, int64_t chunkSize ) {
+	KeyRange r = range;
+
+	ReadYourWritesTransaction *tr = this->tr;
+	return onMainThread( [tr, r, chunkSize]() -> Future<Standalone<VectorRef<KeyRef>>> {
+			tr->checkDeferredError();
+			return tr->getRangeSplitPoints(r, chunkSize);
+		} );
+}
+
 
 ThreadFuture< Standalone<RangeResultRef> > ThreadSafeTransaction::getRange( const KeySelectorRef& begin, const KeySelectorRef& end, int limit, bool snapshot, bool reverse ) {
 	KeySelector b = begin;
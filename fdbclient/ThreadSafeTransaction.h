@@ -71,7 +71,9 @@ public:
 	}
 	ThreadFuture<Standalone<VectorRef<const char*>>> getAddressesForKey(const KeyRef& key) override;
 	ThreadFuture<Standalone<StringRef>> getVersionstamp() override;
+	ThreadFuture< Standalone<MappedRangeResultRef> > getMappedRange( const KeySelectorRef& begin, const KeySelectorRef& end, const StringRef& mapper, GetRangeLimits limits, bool snapshot = false, bool reverse = false ) override;
 	ThreadFuture<int64_t> getEstimatedRangeSizeBytes(const KeyRangeRef& keys) override;
+	ThreadFuture<Standalone<VectorRef<KeyRef>>> getRangeSplitPoints(const KeyRangeRef& range, int64_t chunkSize) override;
 
 	void addReadConflictRange( const KeyRangeRef& keys ) override;
 	void makeSelfConflicting();
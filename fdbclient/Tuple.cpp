@@ -19,6 +19,7 @@
  */
 
 #include "fdbclient/Tuple.h"
+#include "flow/UnitTest.h"
 
 static size_t find_string_terminator(const StringRef data, size_t offset) {
 	size_t i = offset;
@@ -262,3 +263,99 @@ Tuple Tuple::subTuple(size_t start, size_t end) const {
 	size_t endPos = end < offsets.size() ? offsets[end] : data.size();
 	return Tuple(StringRef(data.begin() + offsets[start], endPos - offsets[start]));
 }
+
+Tuple constructMappedKey( KeyValueRef const& kv, Tuple const& mapper, bool& isRangeQuery ) {
+	Tuple mappedKey;
+	Optional<Tuple> keyTuple, valueTuple;
+	isRangeQuery = false;
+
+	for (int i = 0; i < mapper.size(); i++) {
+		Tuple::ElementType type = mapper.getType(i);
+		if (type != Tuple::BYTES && type != Tuple::UTF8) {
+			mappedKey.append(mapper.subTuple(i, i + 1));
+			continue;
+		}
+
+		Standalone<StringRef> s = mapper.getString(i);
+		bool fromKey = s.startsWith(LiteralStringRef("{K["));
+		if (s == LiteralStringRef("{...}")) {
+			if (i != mapper.size() - 1) {
+				throw mapper_bad_range_descriptor();
+			}
+			isRangeQuery = true;
+		} else if ((fromKey || s.startsWith(LiteralStringRef("{V["))) && s.endsWith(LiteralStringRef("]}"))) {
+			StringRef digits = s.substr(3, s.size() - 5);
+			if (digits.size() == 0 || digits.size() > 9) {
+				throw mapper_bad_index();
+			}
+			int index = 0;
+			for (uint8_t c : digits) {
+				if (c < '0' || c > '9') {
+					throw mapper_bad_index();
+				}
+				index = index * 10 + (c - '0');
+			}
+
+			Optional<Tuple>& source = fromKey ? keyTuple : valueTuple;
+			if (!source.present()) {
+				try {
+					source = Tuple::unpack(fromKey ? kv.key : kv.value);
+				} catch (Error& e) {
+					throw mapper_not_tuple();
+				}
+			}
+			if (index >= source.get().size()) {
+				throw mapper_bad_index();
+			}
+			mappedKey.append(source.get().subTuple(index, index + 1));
+		} else {
+			Standalone<StringRef> unescaped;
+			uint8_t* out = new (unescaped.arena()) uint8_t[s.size()];
+			int length = 0;
+			for (int j = 0; j < s.size(); j++) {
+				if ((s[j] == '{' || s[j] == '}') && j + 1 < s.size() && s[j + 1] == s[j]) {
+					j++;
+				}
+				out[length++] = s[j];
+			}
+			((StringRef&)unescaped) = StringRef(out, length);
+			mappedKey.append(unescaped, type == Tuple::UTF8);
+		}
+	}
+
+	return mappedKey;
+}
+
+TEST_CASE("/fdbclient/Tuple/constructMappedKey") {
+	Tuple indexKey = Tuple().append(LiteralStringRef("index")).append(LiteralStringRef("blue")).append(LiteralStringRef("p1"));
+	Tuple indexValue = Tuple().append(LiteralStringRef("v")).append(42);
+	KeyValueRef kv(indexKey.pack(), indexValue.pack());
+	bool isRangeQuery;
+
+	Tuple mapped = constructMappedKey(kv, Tuple().append(LiteralStringRef("rec")).append(LiteralStringRef("{K[2]}")).append(LiteralStringRef("{V[1]}")), isRangeQuery);
+	ASSERT(!isRangeQuery);
+	ASSERT(mapped.pack() == Tuple().append(LiteralStringRef("rec")).append(LiteralStringRef("p1")).append(42).pack());
+
+	mapped = constructMappedKey(kv, Tuple().append(LiteralStringRef("rec")).append(LiteralStringRef("{K[2]}")).append(LiteralStringRef("{...}")), isRangeQuery);
+	ASSERT(isRangeQuery);
+	ASSERT(mapped.pack() == Tuple().append(LiteralStringRef("rec")).append(LiteralStringRef("p1")).pack());
+
+	mapped = constructMappedKey(kv, Tuple().append(LiteralStringRef("{{K[1]}}")).append(7), isRangeQuery);
+	ASSERT(mapped.pack() == Tuple().append(LiteralStringRef("{K[1]}")).append(7).pack());
+
+	std::vector<std::pair<Tuple, int>> invalid = {
+		{ Tuple().append(LiteralStringRef("{K[3]}")), error_code_mapper_bad_index },
+		{ Tuple().append(LiteralStringRef("{V[x]}")), error_code_mapper_bad_index },
+		{ Tuple().append(LiteralStringRef("{...}")).append(LiteralStringRef("{K[0]}")), error_code_mapper_bad_range_descriptor },
+	};
+	for (auto& m : invalid) {
+		try {
+			constructMappedKey(kv, m.first, isRangeQuery);
+			ASSERT(false);
+		} catch (Error& e) {
+			ASSERT(e.code() == m.second);
+		}
+	}
+
+	return Void();
+}
@@ -70,4 +70,11 @@ private:
 	std::vector<size_t> offsets;
 };
 
+// Builds the key of the record that an index entry maps to in a mapped range read.  The mapper is a tuple whose
+// elements are copied into the result, except for these strings:
+//   "{K[i]}" and "{V[i]}"  element i of the index entry's key or value, both of which must be tuples
+//   "{...}"                only allowed last; the result is then the prefix of a range of records
+// Any other string is copied with "{{" and "}}" replaced by "{" and "}".
+Tuple constructMappedKey(KeyValueRef const& kv, Tuple const& mapper, bool& isRangeQuery);
+
 #endif /* FDBCLIENT_TUPLE_H */
@@ -0,0 +1,104 @@
+/*
+ * VersionedMap.actor.cpp
+ *
+ * This source file is part of the FoundationDB open source project
+ *
+ * Copyright 2013-2018 Apple Inc. and the FoundationDB project authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "fdbclient/VersionedMap.h"
+#include "flow/UnitTest.h"
+#include "flow/actorcompiler.h"  // This must be the last #include.
+
+void forceLinkVersionedMapTests() {}
+
+TEST_CASE("/fdbclient/VersionedMap/PBTree") {
+	// Applies the same random sets and clears to a PTree and a PBTree, and checks that both match a model of every
+	// version still in the window
+	state VersionedMap<int,int> ptree(false);
+	state VersionedMap<int,int> btree(true);
+	state std::map<Version, std::map<int,int>> model;
+	state std::map<int,int> latest;
+	state int keySpace = deterministicRandom()->randomInt(10, 2000);
+	state Version v;
+	state Version oldest;
+
+	for(v=1; v<=300; ++v) {
+		ptree.createNewVersion(v);
+		btree.createNewVersion(v);
+		int ops = deterministicRandom()->randomInt(0, 100);
+		for(int i=0; i<ops; i++) {
+			int k = deterministicRandom()->randomInt(0, keySpace);
+			if (deterministicRandom()->random01() < 0.7) {
+				ptree.insert(k, (int)v);
+				btree.insert(k, (int)v);
+				latest[k] = v;
+			} else if (deterministicRandom()->coinflip()) {
+				int e = k + deterministicRandom()->randomInt(0, keySpace / 4 + 1);
+				ptree.erase(k, e);
+				btree.erase(k, e);
+				latest.erase(latest.lower_bound(k), latest.lower_bound(e));
+			} else if (latest.count(k)) {
+				ptree.erase(k);
+				btree.erase(k);
+				latest.erase(k);
+			}
+		}
+		model[v] = latest;
+
+		if (deterministicRandom()->random01() < 0.1) {
+			oldest = deterministicRandom()->randomInt(ptree.getOldestVersion(), v+1);
+			ptree.forgetVersionsBefore(oldest);
+			wait( btree.forgetVersionsBeforeAsync(oldest) );
+			model.erase(model.begin(), model.lower_bound(oldest));
+		}
+
+		for(auto& m : model) {
+			auto pview = ptree.at(m.first);
+			auto bview = btree.at(m.first);
+			bview.validate();
+
+			auto p = pview.begin();
+			auto b = bview.begin();
+			for(auto& kv : m.second) {
+				ASSERT(p && b && p.key() == kv.first && b.key() == kv.first && *p == kv.second && *b == kv.second);
+				ASSERT(b.insertVersion() == p.insertVersion());
+				++p;
+				++b;
+			}
+			ASSERT(!p && !b && b == bview.end());
+
+			for(int i=0; i<10; i++) {
+				int k = deterministicRandom()->randomInt(-1, keySpace+1);
+				auto expected = m.second.lower_bound(k);
+				auto lb = bview.lower_bound(k);
+				ASSERT(expected == m.second.end() ? !lb : (lb && lb.key() == expected->first));
+				auto lle = bview.lastLessOrEqual(k);
+				auto plle = pview.lastLessOrEqual(k);
+				ASSERT(bool(lle) == bool(plle) && (!lle || lle.key() == plle.key()));
+				auto ll = bview.lastLess(k);
+				auto pll = pview.lastLess(k);
+				ASSERT(bool(ll) == bool(pll) && (!ll || ll.key() == pll.key()));
+				ASSERT((bview.find(k) != bview.end()) == (m.second.count(k) != 0));
+				if (lb) {
+					--lb;
+					ASSERT(lb == ll);
+				}
+			}
+		}
+	}
+
+	return Void();
+}
@@ -465,6 +465,14 @@ namespace PTreeImpl {
 		}
 	}
 
+	// Moves the children of p that no other node refers to into toFree, so that they can be destroyed incrementally
+	template <class T>
+	void releaseSoleOwnedChildren(Reference<PTree<T>>& p, std::vector<Reference<PTree<T>>>& toFree) {
+		for (int c = 0; c < 3; c++) {
+			if (p->pointer[c] && p->pointer[c]->isSoleOwner()) toFree.push_back(std::move(p->pointer[c]));
+		}
+	}
+
 	//Remove pointers to any child nodes that have been updated at or before the given version
 	//This essentially gets rid of node versions that will never be read (beyond 5s worth of versions)
 	//TODO look into making this per-version compaction. (We could keep track of updated nodes at each version for example)
@@ -489,6 +497,455 @@ namespace PTreeImpl {
 
 }
 
+// PBTree is a persistent B+tree, an alternative to PTree for VersionedMap.  Items are stored in order in wide leaves,
+// so a lookup touches a handful of contiguous nodes instead of a long chain of small treap nodes, and neighboring items
+// share a cache line when iterating.
+//
+// Persistence is by path copying.  Each node records the version at which it was created, and only nodes created at the
+// version being modified, which no older root can reach, are changed in place.  Any other node on the path is copied
+// first, so writes to a version copy each node on their path at most once.  Every key stored in an internal node is the
+// first key of the corresponding child at that node's version, so internal nodes never refer to the memory of an item
+// that is no longer in the tree.
+namespace PBTreeImpl {
+
+	template <class K, class V>
+	struct PBTree : NonCopyable {
+		typedef MapPair<K, V> Item;
+		enum { Capacity = 16, MinFill = Capacity / 4 };
+
+		Version version; // The version at which this node was created; it is only modified in place at that version
+		int32_t refCount;
+		int16_t count;
+		bool isLeaf;
+
+		void addref() { ++refCount; }
+		void delref();
+		bool isSoleOwner() const { return refCount == 1; }
+
+	protected:
+		PBTree(Version version, bool isLeaf) : version(version), refCount(1), count(0), isLeaf(isLeaf) {}
+	};
+
+	template <class K, class V>
+	struct PBTreeLeaf : PBTree<K, V>, FastAllocated<PBTreeLeaf<K, V>> {
+		typedef typename PBTree<K, V>::Item Item;
+		typename std::aligned_storage<sizeof(Item), alignof(Item)>::type storage[PBTree<K, V>::Capacity];
+
+		explicit PBTreeLeaf(Version version) : PBTree<K, V>(version, true) {}
+		~PBTreeLeaf() {
+			for (int i = 0; i < this->count; i++) items()[i].~Item();
+		}
+
+		Item* items() { return reinterpret_cast<Item*>(storage); }
+		Item const* items() const { return reinterpret_cast<Item const*>(storage); }
+
+		void insertAt(int i, Item const& x) {
+			ASSERT(this->count < (PBTree<K, V>::Capacity));
+			if (i < this->count) {
+				new (&items()[this->count]) Item(std::move(items()[this->count - 1]));
+				for (int j = this->count - 1; j > i; j--) items()[j] = std::move(items()[j - 1]);
+				items()[i] = x;
+			} else {
+				new (&items()[i]) Item(x);
+			}
+			++this->count;
+		}
+		void append(Item const& x) { insertAt(this->count, x); }
+		// Removes items [begin, end)
+		void removeRange(int begin, int end) {
+			int n = end - begin;
+			if (n <= 0) return;
+			for (int j = begin; j + n < this->count; j++) items()[j] = std::move(items()[j + n]);
+			for (int j = this->count - n; j < this->count; j++) items()[j].~Item();
+			this->count -= n;
+		}
+	};
+
+	template <class K, class V>
+	struct PBTreeInternal : PBTree<K, V>, FastAllocated<PBTreeInternal<K, V>> {
+		K keys[PBTree<K, V>::Capacity]; // keys[i] is the first key in children[i]
+		Reference<PBTree<K, V>> children[PBTree<K, V>::Capacity];
+
+		explicit PBTreeInternal(Version version) : PBTree<K, V>(version, false) {}
+
+		void insertAt(int i, K const& key, Reference<PBTree<K, V>> const& child) {
+			ASSERT(this->count < (PBTree<K, V>::Capacity));
+			for (int j = this->count; j > i; j--) {
+				keys[j] = keys[j - 1];
+				children[j] = std::move(children[j - 1]);
+			}
+			keys[i] = key;
+			children[i] = child;
+			++this->count;
+		}
+		void append(K const& key, Reference<PBTree<K, V>> const& child) { insertAt(this->count, key, child); }
+		// Removes children [begin, end)
+		void removeRange(int begin, int end) {
+			int n = end - begin;
+			if (n <= 0) return;
+			for (int j = begin; j + n < this->count; j++) {
+				keys[j] = keys[j + n];
+				children[j] = std::move(children[j + n]);
+			}
+			for (int j = this->count - n; j < this->count; j++) children[j].clear();
+			this->count -= n;
+		}
+	};
+
+	template <class K, class V>
+	void PBTree<K, V>::delref() {
+		if (--refCount == 0) {
+			if (isLeaf)
+				delete static_cast<PBTreeLeaf<K, V>*>(this);
+			else
+				delete static_cast<PBTreeInternal<K, V>*>(this);
+		}
+	}
+
+	template <class K, class V>
+	PBTreeLeaf<K, V>* asLeaf(PBTree<K, V>* p) { return static_cast<PBTreeLeaf<K, V>*>(p); }
+	template <class K, class V>
+	PBTreeLeaf<K, V> const* asLeaf(PBTree<K, V> const* p) { return static_cast<PBTreeLeaf<K, V> const*>(p); }
+	template <class K, class V>
+	PBTreeInternal<K, V>* asInternal(PBTree<K, V>* p) { return static_cast<PBTreeInternal<K, V>*>(p); }
+	template <class K, class V>
+	PBTreeInternal<K, V> const* asInternal(PBTree<K, V> const* p) { return static_cast<PBTreeInternal<K, V> const*>(p); }
+
+	template <class K, class V>
+	K const& firstKey(PBTree<K, V> const* p) {
+		return p->isLeaf ? asLeaf(p)->items()[0].key : asInternal(p)->keys[0];
+	}
+
+	// A finger is the path from the root to an item: the child index taken at each internal node, then the item's index
+	// in its leaf.  An empty finger is the end of the tree.
+	template <class K, class V>
+	using Finger = std::vector<std::pair<PBTree<K, V> const*, int>>;
+
+	// Index of the child of p whose subtree would contain x
+	template <class K, class V, class X>
+	int childIndex(PBTreeInternal<K, V> const* p, const X& x) {
+		int lo = 1, hi = p->count;
+		while (lo < hi) {
+			int mid = (lo + hi) / 2;
+			if (x < p->keys[mid])
+				hi = mid;
+			else
+				lo = mid + 1;
+		}
+		return lo - 1;
+	}
+
+	// Index of the first item in p that is >= x (or > x, if upper)
+	template <class K, class V, class X>
+	int itemIndex(PBTreeLeaf<K, V> const* p, const X& x, bool upper) {
+		int lo = 0, hi = p->count;
+		while (lo < hi) {
+			int mid = (lo + hi) / 2;
+			if (upper ? !(x < p->items()[mid].key) : p->items()[mid].key < x)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		return lo;
+	}
+
+	// Appends the path to the first (or last) item of the subtree at p to f
+	template <class K, class V>
+	void pushEdge(PBTree<K, V> const* p, bool last, Finger<K, V>& f) {
+		while (true) {
+			int i = last ? p->count - 1 : 0;
+			f.emplace_back(p, i);
+			if (p->isLeaf) return;
+			p = asInternal(p)->children[i].getPtr();
+		}
+	}
+
+	template <class K, class V>
+	void first(const Reference<PBTree<K, V>>& p, Finger<K, V>& f) {
+		if (p) pushEdge(p.getPtr(), false, f);
+	}
+
+	template <class K, class V>
+	void last(const Reference<PBTree<K, V>>& p, Finger<K, V>& f) {
+		if (p) pushEdge(p.getPtr(), true, f);
+	}
+
+	template <class K, class V>
+	void next(Finger<K, V>& f) {
+		ASSERT(f.size());
+		if (++f.back().second < f.back().first->count) return;
+		do {
+			f.pop_back();
+		} while (f.size() && ++f.back().second == f.back().first->count);
+		if (f.size()) pushEdge(asInternal(f.back().first)->children[f.back().second].getPtr(), false, f);
+	}
+
+	template <class K, class V>
+	void previous(Finger<K, V>& f) {
+		ASSERT(f.size());
+		if (--f.back().second >= 0) return;
+		do {
+			f.pop_back();
+		} while (f.size() && --f.back().second < 0);
+		if (f.size()) pushEdge(asInternal(f.back().first)->children[f.back().second].getPtr(), true, f);
+	}
+
+	// Sets f to the first item >= x (or > x, if upper)
+	template <class K, class V, class X>
+	void bound(const Reference<PBTree<K, V>>& root, const X& x, bool upper, Finger<K, V>& f) {
+		if (!root) return;
+		PBTree<K, V> const* p = root.getPtr();
+		while (!p->isLeaf) {
+			int i = childIndex(asInternal(p), x);
+			f.emplace_back(p, i);
+			p = asInternal(p)->children[i].getPtr();
+		}
+		int i = itemIndex(asLeaf(p), x, upper);
+		if (i < p->count) {
+			f.emplace_back(p, i);
+		} else {
+			f.emplace_back(p, i - 1);
+			next(f);
+		}
+	}
+
+	template <class K, class V, class X>
+	void lower_bound(const Reference<PBTree<K, V>>& root, const X& x, Finger<K, V>& f) {
+		bound(root, x, false, f);
+	}
+
+	template <class K, class V, class X>
+	void upper_bound(const Reference<PBTree<K, V>>& root, const X& x, Finger<K, V>& f) {
+		bound(root, x, true, f);
+	}
+
+	template <class K, class V>
+	Reference<PBTree<K, V>> copy(PBTree<K, V> const* p, Version at) {
+		if (p->isLeaf) {
+			auto* c = new PBTreeLeaf<K, V>(at);
+			for (int i = 0; i < p->count; i++) c->append(asLeaf(p)->items()[i]);
+			return Reference<PBTree<K, V>>(c);
+		} else {
+			auto* c = new PBTreeInternal<K, V>(at);
+			for (int i = 0; i < p->count; i++) c->append(asInternal(p)->keys[i], asInternal(p)->children[i]);
+			return Reference<PBTree<K, V>>(c);
+		}
+	}
+
+	// Returns p, after replacing it with a copy if it might be shared with a version before at
+	template <class K, class V>
+	PBTree<K, V>* mutate(Reference<PBTree<K, V>>& p, Version at) {
+		if (p->version != at) p = copy(p.getPtr(), at);
+		return p.getPtr();
+	}
+
+	// Called after children[i] of p has been modified at version at; removes it if it is empty, and otherwise fixes
+	// p's key for it and merges it with a neighbor if both fit in one node
+	template <class K, class V>
+	void childChanged(PBTreeInternal<K, V>* p, int i, Version at) {
+		PBTree<K, V> const* c = p->children[i].getPtr();
+		if (!c->count) {
+			p->removeRange(i, i + 1);
+			return;
+		}
+		p->keys[i] = firstKey(c);
+		if (c->count >= PBTree<K, V>::MinFill || p->count < 2) return;
+
+		int j = i + 1 < p->count ? i : i - 1; // Merge children j and j+1
+		PBTree<K, V> const* right = p->children[j + 1].getPtr();
+		if (p->children[j]->count + right->count > PBTree<K, V>::Capacity) return;
+		PBTree<K, V>* left = mutate(p->children[j], at);
+		if (left->isLeaf) {
+			for (int k = 0; k < right->count; k++) asLeaf(left)->append(asLeaf(right)->items()[k]);
+		} else {
+			for (int k = 0; k < right->count; k++)
+				asInternal(left)->append(asInternal(right)->keys[k], asInternal(right)->children[k]);
+		}
+		p->removeRange(j + 1, j + 2);
+	}
+
+	// Inserts or replaces x in the subtree at p, which must be mutable at version at.  If p is full, its upper half is
+	// moved to a new node, which is returned so that the caller can add it to p's parent.
+	template <class K, class V>
+	Reference<PBTree<K, V>> insert(PBTree<K, V>* p, Version at, const MapPair<K, V>& x) {
+		const int half = PBTree<K, V>::Capacity / 2;
+		if (p->isLeaf) {
+			auto* l = asLeaf(p);
+			int i = itemIndex(l, x.key, false);
+			if (i < l->count && !(x.key < l->items()[i].key)) {
+				l->items()[i] = x;
+				return Reference<PBTree<K, V>>();
+			}
+			if (l->count < PBTree<K, V>::Capacity) {
+				l->insertAt(i, x);
+				return Reference<PBTree<K, V>>();
+			}
+			auto* r = new PBTreeLeaf<K, V>(at);
+			for (int k = half; k < l->count; k++) r->append(l->items()[k]);
+			l->removeRange(half, l->count);
+			if (i <= half)
+				l->insertAt(i, x);
+			else
+				r->insertAt(i - half, x);
+			return Reference<PBTree<K, V>>(r);
+		}
+
+		auto* n = asInternal(p);
+		int i = childIndex(n, x.key);
+		Reference<PBTree<K, V>> split = insert(mutate(n->children[i], at), at, x);
+		n->keys[i] = firstKey(n->children[i].getPtr());
+		if (!split) return split;
+		if (n->count < PBTree<K, V>::Capacity) {
+			n->insertAt(i + 1, firstKey(split.getPtr()), split);
+			return Reference<PBTree<K, V>>();
+		}
+		auto* r = new PBTreeInternal<K, V>(at);
+		for (int k = half; k < n->count; k++) r->append(n->keys[k], n->children[k]);
+		n->removeRange(half, n->count);
+		if (i + 1 <= half)
+			n->insertAt(i + 1, firstKey(split.getPtr()), split);
+		else
+			r->insertAt(i + 1 - half, firstKey(split.getPtr()), split);
+		return Reference<PBTree<K, V>>(r);
+	}
+
+	// Removes the root while it is empty or an internal node with a single child
+	template <class K, class V>
+	void shrinkRoot(Reference<PBTree<K, V>>& root) {
+		while (root && !root->isLeaf && root->count == 1) {
+			Reference<PBTree<K, V>> child = asInternal(root.getPtr())->children[0];
+			root = std::move(child);
+		}
+		if (root && !root->count) root.clear();
+	}
+
+	// Modifies root to point to a PBTree with x inserted, replacing any item with the same key
+	template <class K, class V>
+	void insert(Reference<PBTree<K, V>>& root, Version at, const MapPair<K, V>& x) {
+		if (!root) root = Reference<PBTree<K, V>>(new PBTreeLeaf<K, V>(at));
+		Reference<PBTree<K, V>> split = insert(mutate(root, at), at, x);
+		if (split) {
+			auto* r = new PBTreeInternal<K, V>(at);
+			r->append(firstKey(root.getPtr()), root);
+			r->append(firstKey(split.getPtr()), split);
+			root = Reference<PBTree<K, V>>(r);
+		}
+	}
+
+	// Removes the items in [begin, end) from the subtree at p, which must be mutable at version at
+	template <class K, class V, class X>
+	void remove(PBTree<K, V>* p, Version at, const X& begin, const X& end) {
+		if (p->isLeaf) {
+			auto* l = asLeaf(p);
+			l->removeRange(itemIndex(l, begin, false), itemIndex(l, end, false));
+			return;
+		}
+
+		auto* n = asInternal(p);
+		int first = childIndex(n, begin);
+		int last = childIndex(n, end);
+		if (first == last) {
+			remove(mutate(n->children[first], at), at, begin, end);
+			childChanged(n, first, at);
+			return;
+		}
+
+		// Every child strictly between first and last is inside the range and is dropped without being visited
+		remove(mutate(n->children[last], at), at, begin, end);
+		bool firstCovered = !(n->keys[first] < begin);
+		if (!firstCovered) remove(mutate(n->children[first], at), at, begin, end);
+		int dropBegin = firstCovered ? first : first + 1;
+		n->removeRange(dropBegin, last);
+		childChanged(n, dropBegin, at);
+		if (!firstCovered) childChanged(n, first, at);
+	}
+
+	// Modifies root to point to a PBTree with the items in [begin, end) removed
+	template <class K, class V, class X>
+	void remove(Reference<PBTree<K, V>>& root, Version at, const X& begin, const X& end) {
+		if (!root || !(begin < end)) return;
+		// Clearing a range that has no items must not copy the path to it
+		Finger<K, V> f;
+		lower_bound(root, begin, f);
+		if (f.empty() || !(asLeaf(f.back().first)->items()[f.back().second].key < end)) return;
+		remove(mutate(root, at), at, begin, end);
+		shrinkRoot(root);
+	}
+
+	// Removes the item with key x from the subtree at p, which must be mutable at version at
+	template <class K, class V, class X>
+	void remove(PBTree<K, V>* p, Version at, const X& x) {
+		if (p->isLeaf) {
+			auto* l = asLeaf(p);
+			int i = itemIndex(l, x, false);
+			ASSERT(i < l->count && !(x < l->items()[i].key)); // attempt to remove item not present in PBTree
+			l->removeRange(i, i + 1);
+			return;
+		}
+		auto* n = asInternal(p);
+		int i = childIndex(n, x);
+		remove(mutate(n->children[i], at), at, x);
+		childChanged(n, i, at);
+	}
+
+	// Modifies root to point to a PBTree with x removed
+	template <class K, class V, class X>
+	void remove(Reference<PBTree<K, V>>& root, Version at, const X& x) {
+		ASSERT(root); // attempt to remove item not present in PBTree
+		remove(mutate(root, at), at, x);
+		shrinkRoot(root);
+	}
+
+	// Moves the children of p that no other node refers to into toFree, so that they can be destroyed incrementally
+	template <class K, class V>
+	void releaseSoleOwnedChildren(Reference<PBTree<K, V>>& p, std::vector<Reference<PBTree<K, V>>>& toFree) {
+		if (p->isLeaf) return;
+		auto* n = asInternal(p.getPtr());
+		for (int i = 0; i < n->count; i++) {
+			if (n->children[i]->isSoleOwner()) toFree.push_back(std::move(n->children[i]));
+		}
+	}
+
+	template <class K, class V>
+	void printTree(const Reference<PBTree<K, V>>& p, int depth = 0) {
+		if (!p) return;
+		for (int i = 0; i < p->count; i++) {
+			for (int d = 0; d < depth; d++) printf("  ");
+			if (p->isLeaf) {
+				printf(":%s\n", describe(asLeaf(p.getPtr())->items()[i].key).c_str());
+			} else {
+				printf("[%s]\n", describe(asInternal(p.getPtr())->keys[i]).c_str());
+				printTree(asInternal(p.getPtr())->children[i], depth + 1);
+			}
+		}
+	}
+
+	// Checks the ordering and separator invariants of the subtree at p; last is the greatest key seen so far
+	template <class K, class V>
+	void validate(const Reference<PBTree<K, V>>& p, K const*& last, int& count, int& height, int depth = 1) {
+		if (!p) return;
+		ASSERT(p->count > 0 && p->count <= (PBTree<K, V>::Capacity));
+		if (p->isLeaf) {
+			ASSERT(!height || height == depth);
+			height = depth;
+			for (int i = 0; i < p->count; i++) {
+				K const& k = asLeaf(p.getPtr())->items()[i].key;
+				ASSERT(!last || *last < k);
+				last = &k;
+				++count;
+			}
+			return;
+		}
+		auto* n = asInternal(p.getPtr());
+		for (int i = 0; i < n->count; i++) {
+			K const& first = firstKey(n->children[i].getPtr());
+			ASSERT(!(n->keys[i] < first) && !(first < n->keys[i]));
+			ASSERT(n->children[i]->version <= p->version);
+			validate(n->children[i], last, count, height, depth + 1);
+		}
+	}
+}
+
 class ValueOrClearToRef {
 public:
 	static ValueOrClearToRef value(ValueRef const& v) { return ValueOrClearToRef(v, false); }
@@ -508,49 +965,72 @@ private:
 
 // VersionedMap provides an interface to a partially persistent tree, allowing you to read the values at a particular version,
 // create new versions, modify the current version of the tree, and forget versions prior to a specific version.
+//
+// The tree is either a PTree or, if the map is constructed with useBTree, a PBTree.  Both give the same results; the
+// PBTree makes fewer, larger allocations and is cheaper to search and iterate.
 template <class K, class T>
 class VersionedMap : NonCopyable {
 //private:
 public:
 	typedef PTreeImpl::PTree<MapPair<K,std::pair<T,Version>>> PTreeT;
 	typedef Reference< PTreeT > Tree;
+	typedef PBTreeImpl::PBTree<K,std::pair<T,Version>> PBTreeT;
+	typedef Reference< PBTreeT > BTree;
+
+	// The root of the tree at some version.  Only the member for the map's kind of tree is ever set.
+	struct Root {
+		Tree ptree;
+		BTree btree;
+	};
 
 	Version oldestVersion, latestVersion;
+	bool useBTree;
 
-	// This deque keeps track of PTree root nodes at various versions. Since the
+	// This deque keeps track of tree root nodes at various versions. Since the
 	// versions increase monotonically, the deque is implicitly sorted and hence
 	// binary-searchable.
-	std::deque<std::pair<Version, Tree>> roots;
+	std::deque<std::pair<Version, Root>> roots;
 
 	struct rootsComparator {
-		bool operator()(const std::pair<Version, Tree>& value, const Version& key)
+		bool operator()(const std::pair<Version, Root>& value, const Version& key)
 		{
 			return (value.first < key);
 		}
-		bool operator()(const Version& key, const std::pair<Version, Tree>& value)
+		bool operator()(const Version& key, const std::pair<Version, Root>& value)
 		{
 			return (key < value.first);
 		}
 	};
 
-	Tree const& getRoot( Version v ) const {
+	Root const& getRoot( Version v ) const {
 		auto r = upper_bound(roots.begin(), roots.end(), v, rootsComparator());
 		--r;
 		return r->second;
 	}
 
 	// For each item in the versioned map, 4 PTree nodes are potentially allocated:
-	static const int overheadPerItem = nextFastAllocatedSize(sizeof(PTreeT)) * 4;
+	static const int ptreeOverheadPerItem = nextFastAllocatedSize(sizeof(PTreeT)) * 4;
+
+	// A PBTree write copies each node on its path that no earlier write at its version has copied.  With few writes per
+	// version, which is when that costs the most, it is the leaf and every internal node above it.  PBTreeChargedDepth
+	// levels hold a few hundred thousand items at the usual fill, as many as a storage server keeps in memory.
+	enum { PBTreeChargedDepth = 5 };
+	static const int pbtreeOverheadPerItem = nextFastAllocatedSize(sizeof(PBTreeImpl::PBTreeLeaf<K,std::pair<T,Version>>)) +
+	                                         nextFastAllocatedSize(sizeof(PBTreeImpl::PBTreeInternal<K,std::pair<T,Version>>)) * (PBTreeChargedDepth - 1);
+
+	// The memory an item may hold while its version is in the map, for the map's kind of tree
+	int overheadPerItem() const { return useBTree ? pbtreeOverheadPerItem : ptreeOverheadPerItem; }
 	struct iterator;
 
-	VersionedMap() : oldestVersion(0), latestVersion(0) {
-		roots.emplace_back(0, Tree());
+	explicit VersionedMap( bool useBTree = false ) : oldestVersion(0), latestVersion(0), useBTree(useBTree) {
+		roots.emplace_back(0, Root());
 	}
-	VersionedMap( VersionedMap&& v ) BOOST_NOEXCEPT : oldestVersion(v.oldestVersion), latestVersion(v.latestVersion), roots(std::move(v.roots)) {
+	VersionedMap( VersionedMap&& v ) BOOST_NOEXCEPT : oldestVersion(v.oldestVersion), latestVersion(v.latestVersion), useBTree(v.useBTree), roots(std::move(v.roots)) {
 	}
 	void operator = (VersionedMap && v) BOOST_NOEXCEPT {
 		oldestVersion = v.oldestVersion;
 		latestVersion = v.latestVersion;
+		useBTree = v.useBTree;
 		roots = std::move(v.roots);
 	}
 
@@ -589,24 +1069,33 @@ public:
 
 		UNSTOPPABLE_ASSERT(r->first == newOldestVersion);
 
-		vector<Tree> toFree;
-		toFree.reserve(10000);
 		auto newBegin = r;
-		Tree *lastRoot = nullptr;
+		Future<Void> cleanup = useBTree ? releaseRoots(&Root::btree, newBegin, taskID) : releaseRoots(&Root::ptree, newBegin, taskID);
+
+		roots.erase(roots.begin(), newBegin);
+		oldestVersion = newOldestVersion;
+		return cleanup;
+	}
+
+private:
+	// Takes the trees of the roots before newBegin that nothing else refers to, and frees them in the background
+	template <class R>
+	Future<Void> releaseRoots( R Root::*member, typename std::deque<std::pair<Version, Root>>::iterator newBegin, TaskPriority taskID ) {
+		vector<R> toFree;
+		toFree.reserve(10000);
+		R *lastRoot = nullptr;
 		for(auto root = roots.begin(); root != newBegin; ++root) {
-			if(root->second) {
-				if(lastRoot != nullptr && root->second == *lastRoot) {
+			R& tree = root->second.*member;
+			if(tree) {
+				if(lastRoot != nullptr && tree == *lastRoot) {
 					(*lastRoot).clear();
 				}
-				if(root->second->isSoleOwner()) {
-					toFree.push_back(root->second);
+				if(tree->isSoleOwner()) {
+					toFree.push_back(tree);
 				}
-				lastRoot = &root->second;
+				lastRoot = &tree;
 			}
 		}
-
-		roots.erase(roots.begin(), newBegin);
-		oldestVersion = newOldestVersion;
 		return deferredCleanupActor(toFree, taskID);
 	}
 
@@ -614,7 +1103,7 @@ public:
 	void createNewVersion(Version version) {     // following sets and erases are into the given version, which may now be passed to at().  Must be called in monotonically increasing order.
 		if (version > latestVersion) {
 			latestVersion = version;
-			Tree r = getRoot(version);
+			Root r = getRoot(version);
 			roots.emplace_back(version, r);
 		} else ASSERT( version == latestVersion );
 	}
@@ -624,14 +1113,24 @@ public:
 		insert( k, t, latestVersion );
 	}
 	void insert(const K& k, const T& t, Version insertAt) {
-		if (PTreeImpl::contains(roots.back().second, latestVersion, k )) PTreeImpl::remove( roots.back().second, latestVersion, k ); // FIXME: Make PTreeImpl::insert do this automatically  (see also WriteMap.h FIXME)
-		PTreeImpl::insert( roots.back().second, latestVersion, MapPair<K,std::pair<T,Version>>(k,std::make_pair(t,insertAt)) );
+		if (useBTree) {
+			PBTreeImpl::insert( roots.back().second.btree, latestVersion, MapPair<K,std::pair<T,Version>>(k,std::make_pair(t,insertAt)) );
+			return;
+		}
+		if (PTreeImpl::contains(roots.back().second.ptree, latestVersion, k )) PTreeImpl::remove( roots.back().second.ptree, latestVersion, k ); // FIXME: Make PTreeImpl::insert do this automatically  (see also WriteMap.h FIXME)
+		PTreeImpl::insert( roots.back().second.ptree, latestVersion, MapPair<K,std::pair<T,Version>>(k,std::make_pair(t,insertAt)) );
 	}
 	void erase(const K& begin, const K& end) {
-		PTreeImpl::remove( roots.back().second, latestVersion, begin, end );
+		if (useBTree)
+			PBTreeImpl::remove( roots.back().second.btree, latestVersion, begin, end );
+		else
+			PTreeImpl::remove( roots.back().second.ptree, latestVersion, begin, end );
 	}
 	void erase(const K& key ) {  // key must be present
-		PTreeImpl::remove( roots.back().second, latestVersion, key );
+		if (useBTree)
+			PBTreeImpl::remove( roots.back().second.btree, latestVersion, key );
+		else
+			PTreeImpl::remove( roots.back().second.ptree, latestVersion, key );
 	}
 	void erase(iterator const& item) {  // iterator must be in latest version!
 		// SOMEDAY: Optimize to use item.finger and avoid repeated search
@@ -640,20 +1139,27 @@ public:
 	}
 
 	void printDetail() {
-		PTreeImpl::printTreeDetails(roots.back().second, 0);
+		if (useBTree)
+			PBTreeImpl::printTree(roots.back().second.btree, 0);
+		else
+			PTreeImpl::printTreeDetails(roots.back().second.ptree, 0);
 	}
 
 	void printTree(Version at) {
-		PTreeImpl::printTree(roots.back().second, at, 0);
+		if (useBTree)
+			PBTreeImpl::printTree(getRoot(at).btree, 0);
+		else
+			PTreeImpl::printTree(roots.back().second.ptree, at, 0);
 	}
 
 	void compact(Version newOldestVersion) {
 		ASSERT( newOldestVersion <= latestVersion );
+		if (useBTree) return; // A PBTree never keeps pointers for old versions in its nodes
 		//auto newBegin = roots.lower_bound(newOldestVersion);
 		auto newBegin = lower_bound(roots.begin(), roots.end(), newOldestVersion, rootsComparator());
 		for(auto root = roots.begin(); root != newBegin; ++root) {
-			if(root->second)
-				PTreeImpl::compact(root->second, newOldestVersion);
+			if(root->second.ptree)
+				PTreeImpl::compact(root->second.ptree, newOldestVersion);
 		}
 		//printf("\nPrinting the tree at latest version after compaction.\n");
 		//PTreeImpl::printTreeDetails(roots.back().second(), 0);
@@ -661,39 +1167,51 @@ public:
 
 	// for(auto i = vm.at(version).lower_bound(range.begin); i < range.end; ++i)
 	struct iterator{
-		explicit iterator(Tree const& root, Version at) : root(root), at(at) {}
+		explicit iterator(Root const& root, Version at, bool useBTree) : root(root), at(at), useBTree(useBTree) {}
 
-		K const& key() const { return finger.back()->data.key; }
-		Version insertVersion() const { return finger.back()->data.value.second; }  // Returns the version at which the current item was inserted
-		operator bool() const { return finger.size()!=0; }
+		K const& key() const { return useBTree ? item().key : finger.back()->data.key; }
+		Version insertVersion() const { return useBTree ? item().value.second : finger.back()->data.value.second; }  // Returns the version at which the current item was inserted
+		operator bool() const { return useBTree ? bfinger.size()!=0 : finger.size()!=0; }
 		bool operator < (const K& key) const { return this->key() < key; }
 
-		T const& operator*() { return finger.back()->data.value.first; }
-		T const* operator->() { return &finger.back()->data.value.first; }
-		void operator++() { if (finger.size()) PTreeImpl::next( at, finger ); else PTreeImpl::first(root, at, finger); }
-		void operator--() { if (finger.size()) PTreeImpl::previous( at, finger ); else PTreeImpl::last(root, at, finger); }
-		bool operator == ( const iterator& r ) const { if (finger.size() && r.finger.size()) return finger.back() == r.finger.back(); else return finger.size()==r.finger.size(); }
-		bool operator != ( const iterator& r ) const { if (finger.size() && r.finger.size()) return finger.back() != r.finger.back(); else return finger.size()!=r.finger.size(); }
+		T const& operator*() { return useBTree ? item().value.first : finger.back()->data.value.first; }
+		T const* operator->() { return &**this; }
+		void operator++() {
+			if (useBTree) { if (bfinger.size()) PBTreeImpl::next( bfinger ); else PBTreeImpl::first(root.btree, bfinger); }
+			else { if (finger.size()) PTreeImpl::next( at, finger ); else PTreeImpl::first(root.ptree, at, finger); }
+		}
+		void operator--() {
+			if (useBTree) { if (bfinger.size()) PBTreeImpl::previous( bfinger ); else PBTreeImpl::last(root.btree, bfinger); }
+			else { if (finger.size()) PTreeImpl::previous( at, finger ); else PTreeImpl::last(root.ptree, at, finger); }
+		}
+		bool operator == ( const iterator& r ) const {
+			if (useBTree) { if (bfinger.size() && r.bfinger.size()) return bfinger.back() == r.bfinger.back(); else return bfinger.size()==r.bfinger.size(); }
+			if (finger.size() && r.finger.size()) return finger.back() == r.finger.back(); else return finger.size()==r.finger.size();
+		}
+		bool operator != ( const iterator& r ) const { return !(*this == r); }
 
 	private:
 		friend class VersionedMap<K,T>;
-		Tree root;
+		Root root;
 		Version at;
+		bool useBTree;
 		vector< PTreeT const* > finger;
+		PBTreeImpl::Finger<K,std::pair<T,Version>> bfinger;
+
+		MapPair<K,std::pair<T,Version>> const& item() const { return PBTreeImpl::asLeaf(bfinger.back().first)->items()[bfinger.back().second]; }
 	};
 
 	class ViewAtVersion {
 	public:
-		ViewAtVersion(Tree const& root, Version at) : root(root), at(at) {}
+		ViewAtVersion(Root const& root, Version at, bool useBTree) : root(root), at(at), useBTree(useBTree) {}
 
-		iterator begin() const { iterator i(root,at); PTreeImpl::first( root, at, i.finger ); return i; }
-		iterator end() const { return iterator(root,at); }
+		iterator begin() const { iterator i(root,at,useBTree); ++i; return i; }
+		iterator end() const { return iterator(root,at,useBTree); }
 
 		// Returns x such that key==*x, or end()
 		template <class X>
 		iterator find(const X &key) const { 
-			iterator i(root,at); 
-			PTreeImpl::lower_bound( root, at, key, i.finger ); 
+			iterator i = lower_bound(key);
 			if (i && i.key() == key)
 				return i;
 			else
@@ -703,24 +1221,29 @@ public:
 		// Returns the smallest x such that *x>=key, or end()
 		template <class X>
 		iterator lower_bound(const X &key) const {
-			iterator i(root,at); 
-			PTreeImpl::lower_bound( root, at, key, i.finger );
+			iterator i(root,at,useBTree); 
+			if (useBTree)
+				PBTreeImpl::lower_bound( root.btree, key, i.bfinger );
+			else
+				PTreeImpl::lower_bound( root.ptree, at, key, i.finger );
 			return i;
 		}
 
 		// Returns the smallest x such that *x>key, or end()
 		template <class X>
 		iterator upper_bound(const X &key) const {
-			iterator i(root,at); 
-			PTreeImpl::upper_bound( root, at, key, i.finger );
+			iterator i(root,at,useBTree); 
+			if (useBTree)
+				PBTreeImpl::upper_bound( root.btree, key, i.bfinger );
+			else
+				PTreeImpl::upper_bound( root.ptree, at, key, i.finger );
 			return i;
 		}
 
 		// Returns the largest x such that *x<=key, or end()
 		template <class X>
 		iterator lastLessOrEqual( const X &key ) const {
-			iterator i(root,at); 
-			PTreeImpl::upper_bound( root, at, key, i.finger );
+			iterator i = upper_bound(key);
 			--i;
 			return i;
 		}
@@ -728,25 +1251,30 @@ public:
 		// Returns the largest x such that *x<key, or end()
 		template <class X>
 		iterator lastLess( const X &key ) const {
-			iterator i(root,at); 
-			PTreeImpl::lower_bound( root, at, key, i.finger );
+			iterator i = lower_bound(key);
 			--i;
 			return i;
 		}
 
 		void validate() {
 			int count=0, height=0;
-			PTreeImpl::validate<MapPair<K,std::pair<T,Version>>>( root, at, NULL, NULL, count, height );
+			if (useBTree) {
+				K const* last = nullptr;
+				PBTreeImpl::validate( root.btree, last, count, height );
+			} else {
+				PTreeImpl::validate<MapPair<K,std::pair<T,Version>>>( root.ptree, at, NULL, NULL, count, height );
+			}
 			if ( height > 100 )
 				TraceEvent(SevWarnAlways, "DiabolicalPTreeSize").detail("Size", count).detail("Height", height);
 		}
 	private:
-		Tree root;
+		Root root;
 		Version at;
+		bool useBTree;
 	};
 
-	ViewAtVersion at( Version v ) const { return ViewAtVersion(getRoot(v), v); }
-	ViewAtVersion atLatest() const { return ViewAtVersion(roots.back().second, latestVersion); }
+	ViewAtVersion at( Version v ) const { return ViewAtVersion(getRoot(v), v, useBTree); }
+	ViewAtVersion atLatest() const { return ViewAtVersion(roots.back().second, latestVersion, useBTree); }
 
 	bool isClearContaining( ViewAtVersion const& view, KeyRef key ) {
 		auto i = view.lastLessOrEqual(key);
@@ -0,0 +1,678 @@
+/*
+ * AsyncFileIOUring.actor.h
+ *
+ * This source file is part of the FoundationDB open source project
+ *
+ * Copyright 2013-2018 Apple Inc. and the FoundationDB project authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#ifdef __linux__
+
+// When actually compiled (NO_INTELLISENSE), include the generated version of this file.  In intellisense use the source version.
+#if defined(NO_INTELLISENSE) && !defined(FLOW_ASYNCFILEIOURING_ACTOR_G_H)
+	#define FLOW_ASYNCFILEIOURING_ACTOR_G_H
+	#include "fdbrpc/AsyncFileIOUring.actor.g.h"
+#elif !defined(FLOW_ASYNCFILEIOURING_ACTOR_H)
+	#define FLOW_ASYNCFILEIOURING_ACTOR_H
+
+#include "fdbrpc/IAsyncFile.h"
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include "fdbrpc/linux_io_uring.h"
+#include "flow/Knobs.h"
+#include "flow/UnitTest.h"
+#include <stdio.h>
+#include "flow/genericactors.actor.h"
+#include "flow/actorcompiler.h"  // This must be the last #include.
+
+// Disk I/O through an io_uring shared with the kernel.  Like AsyncFileKAIO, requests are queued by priority and
+// submitted in one batch per run loop iteration, and the kernel signals completions on the reactor's eventfd.  Unlike
+// KAIO, completions are collected from the shared completion ring without a system call, data syncs are issued on the
+// ring rather than on a thread, and files need not be opened with O_DIRECT.
+class AsyncFileIOUring : public IAsyncFile, public ReferenceCounted<AsyncFileIOUring> {
+public:
+	static Future<Reference<IAsyncFile>> open( std::string filename, int flags, int mode, void* ignore ) {
+		ASSERT( isEnabled() );
+
+		if (flags & OPEN_LOCK)
+			mode |= 02000;  // Enable mandatory locking for this file if it is supported by the filesystem
+
+		std::string open_filename = filename;
+		if (flags & OPEN_ATOMIC_WRITE_AND_CREATE) {
+			ASSERT( (flags & OPEN_CREATE) && (flags & OPEN_READWRITE) && !(flags & OPEN_EXCLUSIVE) );
+			open_filename = filename + ".part";
+		}
+
+		int fd = ::open( open_filename.c_str(), openFlags(flags), mode );
+		if (fd<0) {
+			Error e = errno==ENOENT ? file_not_found() : io_error();
+			TraceEvent("AsyncFileIOUringOpenFailed").error(e).detail("Filename", filename).detailf("Flags", "%x", flags)
+				.detailf("OSFlags", "%x", openFlags(flags)).detailf("Mode", "0%o", mode).GetLastError();
+			return e;
+		} else {
+			TraceEvent("AsyncFileIOUringOpen")
+				.detail("Filename", filename)
+				.detail("Flags", flags)
+				.detail("Mode", mode)
+				.detail("Fd", fd);
+		}
+
+		Reference<AsyncFileIOUring> r(new AsyncFileIOUring( fd, flags, filename ));
+
+		if (flags & OPEN_LOCK) {
+			// Acquire a "write" lock for the entire file
+			flock lockDesc;
+			lockDesc.l_type = F_WRLCK;
+			lockDesc.l_whence = SEEK_SET;
+			lockDesc.l_start = 0;
+			lockDesc.l_len = 0;
+			lockDesc.l_pid = 0;
+			if (fcntl(fd, F_SETLK, &lockDesc) == -1) {
+				TraceEvent(SevError, "UnableToLockFile").detail("Filename", filename).GetLastError();
+				return io_error();
+			}
+		}
+
+		struct stat buf;
+		if (fstat( fd, &buf )) {
+			TraceEvent("AsyncFileIOUringFStatError").detail("Fd",fd).detail("Filename", filename).GetLastError();
+			return io_error();
+		}
+
+		r->lastFileSize = r->nextFileSize = buf.st_size;
+		return Reference<IAsyncFile>(std::move(r));
+	}
+
+	// Sets up the ring and makes the kernel signal completions on ev.  Returns false, leaving the caller to fall back
+	// to another implementation, if the kernel does not support io_uring or refuses it (for example under seccomp).
+	static bool init( Reference<IEventFD> ev, double ioTimeout ) {
+		int rc = ctx.ring.setup( FLOW_KNOBS->IO_URING_QUEUE_DEPTH );
+		if (rc<0) {
+			TraceEvent(SevWarnAlways, "IOUringSetupError").detail("Entries", FLOW_KNOBS->IO_URING_QUEUE_DEPTH).detail("Errno", -rc);
+			return false;
+		}
+
+		int evfd = ev->getFD();
+		if (io_uring_register( ctx.ring.fd, IO_URING_REGISTER_EVENTFD, &evfd, 1 ) < 0) {
+			TraceEvent(SevWarnAlways, "IOUringRegisterEventFDError").GetLastError();
+			ctx.ring.teardown();
+			return false;
+		}
+
+		if( !g_network->isSimulated() ) {
+			ctx.countSubmit.init(LiteralStringRef("AsyncFile.CountIOUringSubmit"));
+			ctx.countCollect.init(LiteralStringRef("AsyncFile.CountIOUringCollect"));
+			ctx.submitMetric.init(LiteralStringRef("AsyncFile.Submit"));
+			ctx.countPreSubmitTruncate.init(LiteralStringRef("AsyncFile.CountPreIOUringSubmitTruncate"));
+			ctx.preSubmitTruncateBytes.init(LiteralStringRef("AsyncFile.PreIOUringSubmitTruncateBytes"));
+		}
+
+		TraceEvent("IOUringInit").detail("Entries", ctx.ring.sqEntries);
+		setTimeout(ioTimeout);
+		poll(ev);
+
+		g_network->setGlobal(INetwork::enRunCycleFunc, (flowGlobalType) &AsyncFileIOUring::launch);
+		return true;
+	}
+
+	static bool isEnabled() { return ctx.ring.fd >= 0; }
+	static void setTimeout(double ioTimeout) { ctx.setIOTimeout(ioTimeout); }
+
+	virtual void addref() { ReferenceCounted<AsyncFileIOUring>::addref(); }
+	virtual void delref() { ReferenceCounted<AsyncFileIOUring>::delref(); }
+
+	virtual Future<int> read( void* data, int length, int64_t offset ) {
+		++countFileLogicalReads;
+		++countLogicalReads;
+
+		if(failed) {
+			return io_timeout();
+		}
+
+		IOBlock *io = new IOBlock(IO_URING_OP_READV, fd);
+		io->iov.iov_base = data;
+		io->iov.iov_len = length;
+		io->offset = offset;
+
+		enqueue(io);
+		return io->result.getFuture();
+	}
+	virtual Future<Void> write( void const* data, int length, int64_t offset ) {
+		++countFileLogicalWrites;
+		++countLogicalWrites;
+
+		if(failed) {
+			return io_timeout();
+		}
+
+		IOBlock *io = new IOBlock(IO_URING_OP_WRITEV, fd);
+		io->iov.iov_base = (void*)data;
+		io->iov.iov_len = length;
+		io->offset = offset;
+
+		nextFileSize = std::max( nextFileSize, offset+length );
+
+		enqueue(io);
+		return success(io->result.getFuture());
+	}
+#ifndef FALLOC_FL_ZERO_RANGE
+#define FALLOC_FL_ZERO_RANGE 0x10
+#endif
+	virtual Future<Void> zeroRange( int64_t offset, int64_t length ) override {
+		bool success = false;
+		if (ctx.fallocateZeroSupported) {
+			int rc = fallocate( fd, FALLOC_FL_ZERO_RANGE, offset, length );
+			if (rc == EOPNOTSUPP) {
+				ctx.fallocateZeroSupported = false;
+			}
+			if (rc == 0) {
+				success = true;
+			}
+		}
+		return success ? Void() : IAsyncFile::zeroRange(offset, length);
+	}
+	virtual Future<Void> truncate( int64_t size ) {
+		++countFileLogicalWrites;
+		++countLogicalWrites;
+
+		if(failed) {
+			return io_timeout();
+		}
+
+		int result = -1;
+		bool completed = false;
+		double begin = timer_monotonic();
+
+		if( ctx.fallocateSupported && size >= lastFileSize ) {
+			result = fallocate( fd, 0, 0, size);
+			if (result != 0) {
+				int fallocateErrCode = errno;
+				TraceEvent("AsyncFileIOUringAllocateError").detail("Fd",fd).detail("Filename", filename).detail("Size", size).GetLastError();
+				if ( fallocateErrCode == EOPNOTSUPP ) {
+					// Mark fallocate as unsupported. Try again with truncate.
+					ctx.fallocateSupported = false;
+				} else {
+					return io_error();
+				}
+			} else {
+				completed = true;
+			}
+		}
+		if ( !completed )
+			result = ftruncate(fd, size);
+
+		double end = timer_monotonic();
+		if(nondeterministicRandom()->random01() < end-begin) {
+			TraceEvent("SlowIOUringTruncate")
+				.detail("TruncateTime", end - begin)
+				.detail("TruncateBytes", size - lastFileSize);
+		}
+
+		if(result != 0) {
+			TraceEvent("AsyncFileIOUringTruncateError").detail("Fd",fd).detail("Filename", filename).GetLastError();
+			return io_error();
+		}
+
+		lastFileSize = nextFileSize = size;
+
+		return Void();
+	}
+
+	ACTOR static Future<Void> throwErrorIfFailed( Reference<AsyncFileIOUring> self, Future<int> sync ) {
+		wait( success(sync) );
+		if(self->failed) {
+			throw io_timeout();
+		}
+		return Void();
+	}
+
+	// As with AsyncFileKAIO, the sync covers writes which have completed, so it is issued like any other request
+	// instead of draining the ring first.
+	virtual Future<Void> sync() {
+		++countFileLogicalWrites;
+		++countLogicalWrites;
+
+		if(failed) {
+			return io_timeout();
+		}
+
+		IOBlock *io = new IOBlock(IO_URING_OP_FSYNC, fd);
+		io->opFlags = IO_URING_FSYNC_DATASYNC;
+
+		enqueue(io);
+		Future<Void> fsync = throwErrorIfFailed(Reference<AsyncFileIOUring>::addRef(this), io->result.getFuture());
+
+		if (flags & OPEN_ATOMIC_WRITE_AND_CREATE) {
+			flags &= ~OPEN_ATOMIC_WRITE_AND_CREATE;
+
+			return AsyncFileEIO::waitAndAtomicRename( fsync, filename+".part", filename );
+		}
+
+		return fsync;
+	}
+	virtual Future<int64_t> size() { return nextFileSize; }
+	virtual int64_t debugFD() {
+		return fd;
+	}
+	virtual std::string getFilename() {
+		return filename;
+	}
+	~AsyncFileIOUring() {
+		close(fd);
+	}
+
+	static void launch() {
+		if (ctx.queue.size() && ctx.outstanding < (int)ctx.ring.sqEntries) {
+			ctx.submitMetric = true;
+
+			double begin = timer_monotonic();
+			if (!ctx.outstanding) ctx.ioStallBegin = begin;
+
+			int n = std::min<size_t>((int)ctx.ring.sqEntries - ctx.outstanding, ctx.queue.size());
+			for(int i=0; i<n; i++) {
+				auto io = ctx.queue.top();
+				linux_io_uring_sqe* sqe = ctx.ring.getSqe();
+				if (!sqe) break;
+
+				ctx.queue.pop();
+				io->startTime = now();
+
+				if(ctx.ioTimeout > 0) {
+					ctx.appendToRequestList(io);
+				}
+
+				// Extending writes would be handed to kernel worker threads, so extend the file first as KAIO does
+				if (io->opcode == IO_URING_OP_WRITEV && io->owner->lastFileSize != io->owner->nextFileSize) {
+					++ctx.countPreSubmitTruncate;
+					int64_t truncateSize = io->owner->nextFileSize - io->owner->lastFileSize;
+					ASSERT(truncateSize > 0);
+					ctx.preSubmitTruncateBytes += truncateSize;
+					io->owner->truncate(io->owner->nextFileSize);
+				}
+
+				io->prepare(sqe);
+				++ctx.outstanding;
+			}
+
+			// Requests left in the ring by an earlier busy submit are resubmitted along with this batch
+			int rc = submit();
+
+			double end = timer_monotonic();
+			if(end-begin > FLOW_KNOBS->SLOW_LOOP_CUTOFF && nondeterministicRandom()->random01() < end-begin) {
+				TraceEvent("SlowIOUringLaunch").detail("SubmitTime", end-begin).detail("Submitted", rc);
+			}
+
+			ctx.submitMetric = false;
+			++ctx.countSubmit;
+
+			double elapsed = timer_monotonic() - begin;
+			g_network->networkInfo.metrics.secSquaredSubmit += elapsed*elapsed/2;
+		} else if (ctx.ring.unsubmitted()) {
+			submit();
+		}
+	}
+
+	bool failed;
+private:
+	int fd, flags;
+	int64_t lastFileSize, nextFileSize;
+	std::string filename;
+	Int64MetricHandle countFileLogicalWrites;
+	Int64MetricHandle countFileLogicalReads;
+
+	Int64MetricHandle countLogicalWrites;
+	Int64MetricHandle countLogicalReads;
+
+	struct IOBlock : FastAllocated<IOBlock> {
+		Promise<int> result;
+		Reference<AsyncFileIOUring> owner;
+		int opcode;
+		int fd;
+		iovec iov;
+		int64_t offset;
+		uint32_t opFlags;
+		int64_t prio;
+		IOBlock *prev;
+		IOBlock *next;
+		double startTime;
+
+		struct indirect_order_by_priority { bool operator () ( IOBlock* a, IOBlock* b ) { return a->prio < b->prio; } };
+
+		IOBlock(int opcode, int fd) : opcode(opcode), fd(fd), offset(0), opFlags(0), prev(nullptr), next(nullptr), startTime(0) {
+			iov.iov_base = nullptr;
+			iov.iov_len = 0;
+		}
+
+		TaskPriority getTask() const { return static_cast<TaskPriority>((prio>>32)+1); }
+
+		void prepare( linux_io_uring_sqe* sqe ) {
+			sqe->opcode = opcode;
+			sqe->fd = fd;
+			sqe->off = offset;
+			sqe->op_flags = opFlags;
+			if (opcode != IO_URING_OP_FSYNC) {
+				sqe->addr = (uint64_t)&iov;
+				sqe->len = 1;
+			}
+			sqe->user_data = (uint64_t)this;
+		}
+
+		ACTOR static void deliver( Promise<int> result, bool failed, int r, TaskPriority task ) {
+			wait( delay(0, task) );
+			if (failed) result.sendError(io_timeout());
+			else if (r < 0) result.sendError(io_error());
+			else result.send(r);
+		}
+
+		void setResult( int r ) {
+			if (r<0) {
+				struct stat fst;
+				fstat( fd, &fst );
+
+				errno = -r;
+				TraceEvent("AsyncFileIOUringIOError").GetLastError().detail("Fd", fd).detail("Op", opcode).detail("Nbytes", iov.iov_len).detail("Offset", offset).detail("Ptr", int64_t(iov.iov_base))
+					.detail("Size", fst.st_size).detail("Filename", owner->filename);
+			}
+			deliver( result, owner->failed, r, getTask() );
+			delete this;
+		}
+
+		void timeout(bool warnOnly) {
+			TraceEvent(SevWarnAlways, "AsyncFileIOUringTimeout").detail("Fd", fd).detail("Op", opcode).detail("Nbytes", iov.iov_len).detail("Offset", offset).detail("Ptr", int64_t(iov.iov_base))
+				.detail("Filename", owner->filename);
+			g_network->setGlobal(INetwork::enASIOTimedOut, (flowGlobalType)true);
+
+			if(!warnOnly)
+				owner->failed = true;
+		}
+	};
+
+	struct Context {
+		linux_io_uring ring;
+		int outstanding;
+		double ioStallBegin;
+		bool fallocateSupported;
+		bool fallocateZeroSupported;
+		std::priority_queue<IOBlock*, std::vector<IOBlock*>, IOBlock::indirect_order_by_priority> queue;
+		Int64MetricHandle countSubmit;
+		Int64MetricHandle countCollect;
+		Int64MetricHandle submitMetric;
+
+		double ioTimeout;
+		bool timeoutWarnOnly;
+		IOBlock *submittedRequestList;
+
+		Int64MetricHandle countPreSubmitTruncate;
+		Int64MetricHandle preSubmitTruncateBytes;
+
+		uint32_t opsIssued;
+		Context() : outstanding(0), ioStallBegin(0), fallocateSupported(true), fallocateZeroSupported(true), submittedRequestList(nullptr), opsIssued(0) {
+			setIOTimeout(0);
+		}
+
+		void setIOTimeout(double timeout) {
+			ioTimeout = fabs(timeout);
+			timeoutWarnOnly = timeout < 0;
+		}
+
+		void appendToRequestList(IOBlock *io) {
+			ASSERT(!io->next && !io->prev);
+
+			if(submittedRequestList) {
+				io->prev = submittedRequestList->prev;
+				io->prev->next = io;
+
+				submittedRequestList->prev = io;
+				io->next = submittedRequestList;
+			}
+			else {
+				submittedRequestList = io;
+				io->next = io->prev = io;
+			}
+		}
+
+		void removeFromRequestList(IOBlock *io) {
+			if(io->next == nullptr) {
+				ASSERT(io->prev == nullptr);
+				return;
+			}
+
+			ASSERT(io->prev != nullptr);
+
+			if(io == io->next) {
+				ASSERT(io == submittedRequestList && io == io->prev);
+				submittedRequestList = nullptr;
+			}
+			else {
+				io->next->prev = io->prev;
+				io->prev->next = io->next;
+
+				if(submittedRequestList == io) {
+					submittedRequestList = io->next;
+				}
+			}
+
+			io->next = io->prev = nullptr;
+		}
+	};
+	static Context ctx;
+
+	explicit AsyncFileIOUring(int fd, int flags, std::string const& filename) : failed(false), fd(fd), flags(flags), filename(filename) {
+		if( !g_network->isSimulated() ) {
+			countFileLogicalWrites.init(LiteralStringRef("AsyncFile.CountFileLogicalWrites"), filename);
+			countFileLogicalReads.init( LiteralStringRef("AsyncFile.CountFileLogicalReads"), filename);
+			countLogicalWrites.init(LiteralStringRef("AsyncFile.CountLogicalWrites"));
+			countLogicalReads.init( LiteralStringRef("AsyncFile.CountLogicalReads"));
+		}
+	}
+
+	void enqueue( IOBlock* io ) {
+		if (flags & OPEN_UNBUFFERED) {
+			ASSERT( int64_t(io->iov.iov_base) % 4096 == 0 && io->offset % 4096 == 0 && io->iov.iov_len % 4096 == 0 );
+		}
+
+		io->prio = (int64_t(g_network->getCurrentTask())<<32) - (++ctx.opsIssued);
+		io->owner = Reference<AsyncFileIOUring>::addRef(this);
+
+		ctx.queue.push(io);
+	}
+
+	// Unlike KAIO, io_uring is asynchronous for buffered files too, so O_DIRECT is only used when asked for
+	static int openFlags(int flags) {
+		int oflags = O_CLOEXEC;
+		ASSERT( bool(flags & OPEN_READONLY) != bool(flags & OPEN_READWRITE) );  // readonly xor readwrite
+		if( flags & OPEN_UNBUFFERED ) oflags |= O_DIRECT;
+		if( flags & OPEN_EXCLUSIVE ) oflags |= O_EXCL;
+		if( flags & OPEN_CREATE )    oflags |= O_CREAT;
+		if( flags & OPEN_READONLY )  oflags |= O_RDONLY;
+		if( flags & OPEN_READWRITE ) oflags |= O_RDWR;
+		if( flags & OPEN_ATOMIC_WRITE_AND_CREATE ) oflags |= O_TRUNC;
+		return oflags;
+	}
+
+	// Submits everything in the ring.  EAGAIN and EBUSY leave the requests in the ring to be retried on the next run
+	// loop iteration.  As with KAIO, other errors are assumed to represent failure to issue the first request, so it
+	// fails and the rest are taken back out of the ring and queued again.
+	static int submit() {
+		int rc = ctx.ring.submit();
+		if (rc<0 && rc != -EAGAIN && rc != -EBUSY) {
+			bool first = true;
+			ctx.ring.discard([&](linux_io_uring_sqe const& sqe) {
+				IOBlock* io = (IOBlock*)sqe.user_data;
+				--ctx.outstanding;
+				if(ctx.ioTimeout > 0) {
+					ctx.removeFromRequestList(io);
+				}
+				if (first) {
+					first = false;
+					io->setResult(rc);
+				} else {
+					ctx.queue.push(io);
+				}
+			});
+		}
+		return rc;
+	}
+
+	ACTOR static void poll( Reference<IEventFD> ev ) {
+		loop {
+			wait(success(ev->read()));
+
+			wait(delay(0, TaskPriority::DiskIOComplete));
+
+			// The completions are already in the shared ring, so collecting them needs no system call
+			std::vector<std::pair<IOBlock*, int>> completed;
+			ctx.ring.reap([&](linux_io_uring_cqe const& cqe) { completed.emplace_back((IOBlock*)cqe.user_data, cqe.res); });
+
+			++ctx.countCollect;
+			int n = completed.size();
+			if (n) {
+				double t = timer_monotonic();
+				double elapsed = t - ctx.ioStallBegin;
+				ctx.ioStallBegin = t;
+				g_network->networkInfo.metrics.secSquaredDiskStall += elapsed*elapsed/2;
+			}
+
+			ctx.outstanding -= n;
+
+			if(ctx.ioTimeout > 0) {
+				double currentTime = now();
+				while(ctx.submittedRequestList && currentTime - ctx.submittedRequestList->startTime > ctx.ioTimeout) {
+					ctx.submittedRequestList->timeout(ctx.timeoutWarnOnly);
+					ctx.removeFromRequestList(ctx.submittedRequestList);
+				}
+			}
+
+			for(auto& c : completed) {
+				if(ctx.ioTimeout > 0) {
+					ctx.removeFromRequestList(c.first);
+				}
+
+				c.first->setResult( c.second );
+			}
+		}
+	}
+};
+
+TEST_CASE("/fdbrpc/AsyncFileIOUring/ReadWriteSync") {
+	// This test does nothing in simulation, or where the network did not set up a ring
+	if (!g_network->isSimulated() && AsyncFileIOUring::isEnabled()) {
+		state Reference<IAsyncFile> f;
+		state void *buf = FastAllocator<4096>::allocate();
+		state void *readBuf = FastAllocator<4096>::allocate();
+		try {
+			Reference<IAsyncFile> f_ = wait(AsyncFileIOUring::open(
+			    "/tmp/__IOURING_TEST_FILE__",
+			    IAsyncFile::OPEN_UNBUFFERED | IAsyncFile::OPEN_READWRITE | IAsyncFile::OPEN_CREATE, 0666, nullptr));
+			f = f_;
+
+			state int i = 0;
+			for(; i < 8; ++i) {
+				memset(buf, 'a' + i, 4096);
+				wait(f->write(buf, 4096, i * 4096));
+			}
+			wait(f->sync());
+			int64_t size = wait(f->size());
+			ASSERT(size == 8 * 4096);
+
+			for(i = 0; i < 8; ++i) {
+				int n = wait(f->read(readBuf, 4096, i * 4096));
+				ASSERT(n == 4096);
+				ASSERT(((uint8_t*)readBuf)[0] == 'a' + i && ((uint8_t*)readBuf)[4095] == 'a' + i);
+			}
+		} catch (Error& e) {
+			state Error err = e;
+			FastAllocator<4096>::release(buf);
+			FastAllocator<4096>::release(readBuf);
+			if(f) {
+				wait(AsyncFileEIO::deleteFile(f->getFilename(), true));
+			}
+			throw err;
+		}
+
+		FastAllocator<4096>::release(buf);
+		FastAllocator<4096>::release(readBuf);
+		wait(AsyncFileEIO::deleteFile(f->getFilename(), true));
+	}
+
+	return Void();
+}
+
+TEST_CASE("/fdbrpc/AsyncFileIOUring/Ring") {
+	// Exercises the ring directly, so that it is tested wherever the kernel supports io_uring whether or not the
+	// network uses it.  This test does nothing in simulation.
+	if (g_network->isSimulated()) return Void();
+
+	linux_io_uring ring;
+	int rc = ring.setup(4);
+	if (rc<0) {
+		ASSERT(rc == -ENOSYS || rc == -EPERM || rc == -ENOMEM);
+		return Void();
+	}
+
+	std::string filename = "/tmp/__IOURING_RING_TEST_FILE__";
+	int fd = ::open(filename.c_str(), O_CREAT | O_TRUNC | O_RDWR | O_CLOEXEC, 0666);
+	ASSERT(fd >= 0);
+	char data[4096], readData[4096];
+	memset(data, 'x', sizeof(data));
+	ASSERT(pwrite(fd, data, sizeof(data), 0) == sizeof(data));
+
+	// The ring holds at most as many entries as it was set up with
+	for(uint32_t i = 0; i < ring.sqEntries; ++i) ASSERT(ring.getSqe());
+	ASSERT(!ring.getSqe() && ring.unsubmitted() == ring.sqEntries);
+
+	// Entries that were never submitted can be taken back
+	ASSERT(ring.discard([](linux_io_uring_sqe const&) {}) == (int)ring.sqEntries);
+	ASSERT(ring.unsubmitted() == 0);
+
+	linux_io_uring_sqe* nop = ring.getSqe();
+	nop->opcode = IO_URING_OP_NOP;
+	nop->user_data = 1;
+	iovec iov;
+	iov.iov_base = readData;
+	iov.iov_len = sizeof(readData);
+	linux_io_uring_sqe* readSqe = ring.getSqe();
+	readSqe->opcode = IO_URING_OP_READV;
+	readSqe->fd = fd;
+	readSqe->addr = (uint64_t)&iov;
+	readSqe->len = 1;
+	readSqe->user_data = 2;
+	ASSERT(ring.submit() == 2 && ring.unsubmitted() == 0);
+
+	int results[3] = { -1, -1, -1 };
+	int reaped = 0;
+	while(reaped < 2) {
+		ASSERT(io_uring_enter(ring.fd, 0, 2 - reaped, IO_URING_ENTER_GETEVENTS) >= 0 || errno == EINTR);
+		reaped += ring.reap([&](linux_io_uring_cqe const& cqe) {
+			ASSERT(cqe.user_data == 1 || cqe.user_data == 2);
+			results[cqe.user_data] = cqe.res;
+		});
+	}
+	ASSERT(results[1] == 0 && results[2] == sizeof(readData));
+	ASSERT(memcmp(data, readData, sizeof(data)) == 0);
+
+	::close(fd);
+	::unlink(filename.c_str());
+	ring.teardown();
+	return Void();
+}
+
+AsyncFileIOUring::Context AsyncFileIOUring::ctx;
+
+#include "flow/unactorcompiler.h"
+#endif
+#endif
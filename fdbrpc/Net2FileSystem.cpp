@@ -35,6 +35,7 @@
 #include "fdbrpc/AsyncFileEIO.actor.h"
 #include "fdbrpc/AsyncFileWinASIO.actor.h"
 #include "fdbrpc/AsyncFileKAIO.actor.h"
+#include "fdbrpc/AsyncFileIOUring.actor.h"
 #include "flow/AsioReactor.h"
 #include "flow/Platform.h"
 #include "fdbrpc/AsyncFileWriteChecker.h"
@@ -62,8 +63,11 @@ Future< Reference<class IAsyncFile> > Net2FileSystem::open( std::string filename
 	// don’t properly support kernel async I/O without O_DIRECT or AIO at all. In such
 	// cases, DISABLE_POSIX_KERNEL_AIO knob can be enabled to fallback to EIO instead
 	// of Kernel AIO. And EIO_USE_ODIRECT can be used to turn on or off O_DIRECT within
-	// EIO.
-	if ((flags & IAsyncFile::OPEN_UNBUFFERED) && !(flags & IAsyncFile::OPEN_NO_AIO) &&
+	// EIO. When USE_IO_URING is set and the kernel supports it, io_uring takes the place of Kernel AIO, and since it
+	// does not need O_DIRECT it is also used for buffered files. DISABLE_POSIX_KERNEL_AIO turns off both.
+	if (AsyncFileIOUring::isEnabled() && !(flags & IAsyncFile::OPEN_NO_AIO) && !FLOW_KNOBS->DISABLE_POSIX_KERNEL_AIO)
+		f = AsyncFileIOUring::open(filename, flags, mode, NULL);
+	else if ((flags & IAsyncFile::OPEN_UNBUFFERED) && !(flags & IAsyncFile::OPEN_NO_AIO) &&
 	    !FLOW_KNOBS->DISABLE_POSIX_KERNEL_AIO)
 		f = AsyncFileKAIO::open(filename, flags, mode, NULL);
 	else
@@ -93,7 +97,9 @@ Net2FileSystem::Net2FileSystem(double ioTimeout, std::string fileSystemPath)
 {
 	Net2AsyncFile::init();
 #ifdef __linux__
-	AsyncFileKAIO::init( Reference<IEventFD>(N2::ASIOReactor::getEventFD()), ioTimeout );
+	// Both share the reactor's eventfd and the run cycle function, so only one of them is set up
+	if (!FLOW_KNOBS->USE_IO_URING || FLOW_KNOBS->DISABLE_POSIX_KERNEL_AIO || !AsyncFileIOUring::init( Reference<IEventFD>(N2::ASIOReactor::getEventFD()), ioTimeout ))
+		AsyncFileKAIO::init( Reference<IEventFD>(N2::ASIOReactor::getEventFD()), ioTimeout );
 
 	if (fileSystemPath.empty()) {
 		checkFileSystem = false;
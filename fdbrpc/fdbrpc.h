@@ -120,6 +120,8 @@ public:
 
 	ReplyPromise(const Endpoint& endpoint) : sav(new NetSAV<T>(0, 1, endpoint)) {}
 	const Endpoint& getEndpoint(TaskPriority taskID = TaskPriority::DefaultPromiseEndpoint) const { return sav->getEndpoint(taskID); }
+	// True if the reply goes to another process, at getEndpoint()
+	bool isRemote() const { return sav->isRemoteEndpoint(); }
 
 	void operator=(const ReplyPromise& rhs) {
 		if (rhs.sav) rhs.sav->addPromiseRef();
@@ -233,6 +235,313 @@ struct NetNotifiedQueue : NotifiedQueue<T>, FlowReceiver, FastAllocated<NetNotif
 	virtual bool isStream() const { return true; }
 };
 
+struct AcknowledgementReply {
+	constexpr static FileIdentifier file_identifier = 1389929;
+	int64_t bytes;
+
+	AcknowledgementReply() : bytes(0) {}
+	explicit AcknowledgementReply(int64_t bytes) : bytes(bytes) {}
+
+	template <class Ar>
+	void serialize(Ar& ar) {
+		serializer(ar, bytes);
+	}
+};
+
+// Base class for the messages carried by a ReplyPromiseStream.  The first message sent to a remote receiver
+// carries the token of the sender's acknowledgement endpoint, and every message is numbered so that the
+// receiver can detect a message lost to a connection failure.
+struct ReplyPromiseStreamReply {
+	Optional<UID> acknowledgeToken;
+	uint16_t sequence;
+
+	ReplyPromiseStreamReply() : sequence(0) {}
+};
+
+// Lives on the sending side of a ReplyPromiseStream and tracks how many bytes the receiver has consumed.
+// The sender waits on ready whenever it gets more than bytesLimit ahead of the receiver.
+struct AcknowledgementReceiver : FlowReceiver, FastAllocated<AcknowledgementReceiver> {
+	using FastAllocated<AcknowledgementReceiver>::operator new;
+	using FastAllocated<AcknowledgementReceiver>::operator delete;
+
+	int64_t bytesSent;
+	int64_t bytesAcknowledged;
+	int64_t bytesLimit;
+	Promise<Void> ready;
+	Error failure;
+
+	AcknowledgementReceiver() : bytesSent(0), bytesAcknowledged(0), bytesLimit(0) {}
+
+	bool canSend() const { return bytesLimit <= 0 || bytesSent - bytesAcknowledged < bytesLimit; }
+
+	void acknowledge(int64_t bytes) {
+		if (bytes <= bytesAcknowledged) return;
+		bytesAcknowledged = bytes;
+		if (canSend()) fireReady();
+	}
+
+	void fail(Error const& e) {
+		if (failure.isValid()) return;
+		failure = e;
+		fireReady();
+	}
+
+	virtual void receive(ArenaObjectReader& reader) {
+		ErrorOr<AcknowledgementReply> message;
+		reader.deserialize(message);
+		if (message.isError()) {
+			fail(message.getError());
+		} else {
+			acknowledge(message.get().bytes);
+		}
+	}
+
+private:
+	void fireReady() {
+		// Waking the sender may destroy this receiver, so nothing may be touched after the send
+		if (ready.canBeSet()) {
+			Promise<Void> hold = ready;
+			if (failure.isValid()) {
+				hold.sendError(failure);
+			} else {
+				hold.send(Void());
+			}
+		}
+	}
+};
+
+// The queue behind a ReplyPromiseStream.  On the receiving side it is a local endpoint that checks message
+// sequence numbers and acknowledges each message as it is consumed; on the sending side it is a proxy for the
+// remote endpoint and owns the AcknowledgementReceiver used for flow control.
+template <class T>
+struct NetNotifiedQueueWithAcknowledgements : NotifiedQueue<T>,
+                                              FlowReceiver,
+                                              FastAllocated<NetNotifiedQueueWithAcknowledgements<T>> {
+	using FastAllocated<NetNotifiedQueueWithAcknowledgements<T>>::operator new;
+	using FastAllocated<NetNotifiedQueueWithAcknowledgements<T>>::operator delete;
+
+	AcknowledgementReceiver acknowledgements;
+	Optional<Endpoint> acknowledgeEndpoint;
+	int64_t bytesConsumed;
+	uint16_t sequence;
+	bool sentError;
+	Promise<Void> closed;
+
+	NetNotifiedQueueWithAcknowledgements(int futures, int promises)
+	  : NotifiedQueue<T>(futures, promises), bytesConsumed(0), sequence(0), sentError(false) {}
+	NetNotifiedQueueWithAcknowledgements(int futures, int promises, const Endpoint& remoteEndpoint)
+	  : NotifiedQueue<T>(futures, promises), FlowReceiver(remoteEndpoint, false), bytesConsumed(0), sequence(0),
+	    sentError(false) {}
+
+	virtual void destroy() {
+		if (isRemoteEndpoint() && !sentError) {
+			// The sender went away without finishing the stream
+			FlowTransport::transport().sendUnreliable(SerializeSource<ErrorOr<EnsureTable<T>>>(broken_promise()),
+			                                          getEndpoint(TaskPriority::ReadSocket), false);
+		}
+		delete this;
+	}
+
+	virtual void receive(ArenaObjectReader& reader) {
+		this->addPromiseRef();
+		ErrorOr<EnsureTable<T>> message;
+		reader.deserialize(message);
+		if (message.isError()) {
+			this->sendError(message.getError());
+			close();
+		} else {
+			T& reply = message.get().asUnderlyingType();
+			if (reply.acknowledgeToken.present()) {
+				acknowledgeEndpoint = FlowTransport::transport().loadedEndpoint(reply.acknowledgeToken.get());
+			}
+			if (reply.sequence != sequence) {
+				// A message was lost, so the rest of the stream cannot be trusted
+				this->sendError(connection_failed());
+				close();
+			} else {
+				sequence++;
+				if (this->shouldFireImmediately()) {
+					consumed(reply.expectedSize());
+				}
+				this->send(std::move(reply));
+			}
+		}
+		this->delPromiseRef();
+	}
+
+	virtual T pop() {
+		T res = this->popImpl();
+		consumed(res.expectedSize());
+		return res;
+	}
+
+	virtual void cancel() {
+		// The receiver dropped the stream, so tell the sender to stop.  Failing the local acknowledgements can
+		// destroy this queue, so nothing may be touched afterwards.
+		Promise<Void> hold = closed;
+		if (!this->error.isValid()) {
+			if (acknowledgeEndpoint.present()) {
+				FlowTransport::transport().sendUnreliable(
+				    SerializeSource<ErrorOr<AcknowledgementReply>>(operation_obsolete()), acknowledgeEndpoint.get(),
+				    false);
+			} else {
+				acknowledgements.fail(operation_obsolete());
+			}
+		}
+		if (hold.canBeSet()) hold.send(Void());
+	}
+
+	void consumed(int64_t bytes) {
+		bytesConsumed += bytes;
+		if (acknowledgeEndpoint.present()) {
+			FlowTransport::transport().sendUnreliable(
+			    SerializeSource<ErrorOr<AcknowledgementReply>>(AcknowledgementReply(bytesConsumed)),
+			    acknowledgeEndpoint.get(), false);
+		} else {
+			acknowledgements.acknowledge(bytesConsumed);
+		}
+	}
+
+	void close() {
+		if (closed.canBeSet()) closed.send(Void());
+	}
+};
+
+// ReplyPromiseStream is the streaming analogue of ReplyPromise: a request carries one, and the server sends any
+// number of replies through it before ending the stream with an error (end_of_stream on success).  Like
+// ReplyPromise only a token is serialized, so it works for clients without a public address.  The receiver
+// acknowledges the bytes it consumes and the sender waits on onReady() to stay within its byte limit.
+template <class T>
+class ReplyPromiseStream : public ComposedIdentifier<T, 0x20> {
+public:
+	void send(T value) const {
+		queue->acknowledgements.bytesSent += value.expectedSize();
+		if (queue->isRemoteEndpoint()) {
+			if (!queue->acknowledgements.isLocalEndpoint()) {
+				value.acknowledgeToken = queue->acknowledgements.getEndpoint(TaskPriority::ReadSocket).token;
+			}
+			value.sequence = queue->sequence++;
+			FlowTransport::transport().sendUnreliable(SerializeSource<ErrorOr<EnsureTable<T>>>(value), getEndpoint(),
+			                                          false);
+		} else {
+			if (queue->shouldFireImmediately()) {
+				queue->consumed(value.expectedSize());
+			}
+			queue->send(std::move(value));
+		}
+	}
+
+	template <class E>
+	void sendError(const E& exc) const {
+		if (queue->isRemoteEndpoint()) {
+			if (!queue->sentError && !queue->acknowledgements.failure.isValid()) {
+				queue->sentError = true;
+				FlowTransport::transport().sendUnreliable(SerializeSource<ErrorOr<EnsureTable<T>>>(exc), getEndpoint(),
+				                                          false);
+			}
+		} else {
+			queue->sendError(exc);
+			queue->close();
+		}
+	}
+
+	// Ready when the receiver has acknowledged enough of what was sent; throws if the receiver is gone
+	Future<Void> onReady() const {
+		if (queue->acknowledgements.failure.isValid()) {
+			return queue->acknowledgements.failure;
+		}
+		if (queue->acknowledgements.canSend()) {
+			return Void();
+		}
+		queue->acknowledgements.ready = Promise<Void>();
+		return queue->acknowledgements.ready.getFuture();
+	}
+
+	// Fires when the stream has ended on the receiving side, either with an error or because it was dropped
+	Future<Void> onClosed() const { return queue->closed.getFuture(); }
+
+	void setByteLimit(int64_t byteLimit) const { queue->acknowledgements.bytesLimit = byteLimit; }
+
+	FutureStream<T> getFuture() const {
+		queue->addFutureRef();
+		return FutureStream<T>(queue);
+	}
+
+	ReplyPromiseStream() : queue(new NetNotifiedQueueWithAcknowledgements<T>(0, 1)) {}
+	explicit ReplyPromiseStream(const Endpoint& endpoint)
+	  : queue(new NetNotifiedQueueWithAcknowledgements<T>(0, 1, endpoint)) {}
+	ReplyPromiseStream(const ReplyPromiseStream& rhs) : queue(rhs.queue) { queue->addPromiseRef(); }
+	ReplyPromiseStream(ReplyPromiseStream&& rhs) BOOST_NOEXCEPT : queue(rhs.queue) { rhs.queue = 0; }
+	~ReplyPromiseStream() {
+		if (queue) queue->delPromiseRef();
+	}
+
+	void operator=(const ReplyPromiseStream& rhs) {
+		rhs.queue->addPromiseRef();
+		if (queue) queue->delPromiseRef();
+		queue = rhs.queue;
+	}
+	void operator=(ReplyPromiseStream&& rhs) BOOST_NOEXCEPT {
+		if (queue != rhs.queue) {
+			if (queue) queue->delPromiseRef();
+			queue = rhs.queue;
+			rhs.queue = 0;
+		}
+	}
+	void reset() { *this = ReplyPromiseStream<T>(); }
+
+	const Endpoint& getEndpoint(TaskPriority taskID = TaskPriority::ReadSocket) const {
+		return queue->getEndpoint(taskID);
+	}
+
+	int getFutureReferenceCount() const { return queue->getFutureReferenceCount(); }
+	int getPromiseReferenceCount() const { return queue->getPromiseReferenceCount(); }
+	bool isRemote() const { return queue->isRemoteEndpoint(); }
+
+private:
+	NetNotifiedQueueWithAcknowledgements<T>* queue;
+};
+
+template <class Ar, class T>
+void save(Ar& ar, const ReplyPromiseStream<T>& value) {
+	auto const& ep = value.getEndpoint().token;
+	ar << ep;
+}
+
+template <class Ar, class T>
+void load(Ar& ar, ReplyPromiseStream<T>& value) {
+	UID token;
+	ar >> token;
+	value = ReplyPromiseStream<T>(FlowTransport::transport().loadedEndpoint(token));
+}
+
+template <class T>
+struct serializable_traits<ReplyPromiseStream<T>> : std::true_type {
+	template <class Archiver>
+	static void serialize(Archiver& ar, ReplyPromiseStream<T>& p) {
+		if constexpr (Archiver::isDeserializing) {
+			UID token;
+			serializer(ar, token);
+			p = ReplyPromiseStream<T>(FlowTransport::transport().loadedEndpoint(token));
+		} else {
+			const auto& ep = p.getEndpoint().token;
+			serializer(ar, ep);
+		}
+	}
+};
+
+template <class Reply>
+ReplyPromiseStream<Reply> const& getReplyPromiseStream(ReplyPromiseStream<Reply> const& p) {
+	return p;
+}
+
+template <class Request>
+decltype(fake<Request>().reply) const& getReplyPromiseStream(Request const& r) {
+	return r.reply;
+}
+
+#define REPLYSTREAM_TYPE(RequestType) decltype(getReplyPromiseStream(fake<RequestType>()).getFuture().pop())
+
 
 template <class T>
 class RequestStream {
@@ -350,6 +659,26 @@ public:
 		return getReplyUnlessFailedFor(ReplyPromise<X>(), sustainedFailureDuration, sustainedFailureSlope);
 	}
 
+	// stream.getReplyStream( request )
+	//   Unreliable at most once delivery: Either delivers request and returns a stream of replies, or delivers
+	//     nothing and the stream ends with an error.
+	//   The stream ends with end_of_stream once the server has sent everything, or with connection_failed if the
+	//     server becomes unreachable.  Dropping the returned stream tells the server to stop sending.
+	template <class X>
+	FutureStream<REPLYSTREAM_TYPE(X)> getReplyStream(const X& value) const {
+		auto const& p = getReplyPromiseStream(value);
+		if (queue->isRemoteEndpoint()) {
+			Future<Void> disc =
+			    makeDependent<T>(IFailureMonitor::failureMonitor()).onDisconnectOrFailure(getEndpoint());
+			Reference<Peer> peer =
+			    FlowTransport::transport().sendUnreliable(SerializeSource<T>(value), getEndpoint(), true);
+			endStreamOnDisconnect(disc, p, peer);
+		} else {
+			send(value);
+		}
+		return p.getFuture();
+	}
+
 	explicit RequestStream(const Endpoint& endpoint) : queue(new NetNotifiedQueue<T>(0, 1, endpoint)) {}
 
 	FutureStream<T> getFuture() const { queue->addFutureRef(); return FutureStream<T>(queue); }
@@ -0,0 +1,244 @@
+/*
+ * linux_io_uring.h
+ *
+ * This source file is part of the FoundationDB open source project
+ *
+ * Copyright 2013-2018 Apple Inc. and the FoundationDB project authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// io_uring system calls and ring layout, mirroring <linux/io_uring.h> so that we don't depend on the kernel headers
+// of the build machine.  Only what the 5.1 kernel ABI offers is used.
+
+#include <sys/mman.h>
+#include <sys/uio.h>
+
+// The io_uring system calls have the same numbers on every architecture
+#ifndef __NR_io_uring_setup
+#define __NR_io_uring_setup 425
+#endif
+#ifndef __NR_io_uring_enter
+#define __NR_io_uring_enter 426
+#endif
+#ifndef __NR_io_uring_register
+#define __NR_io_uring_register 427
+#endif
+
+enum {
+	IO_URING_OP_NOP = 0,
+	IO_URING_OP_READV = 1,
+	IO_URING_OP_WRITEV = 2,
+	IO_URING_OP_FSYNC = 3,
+	IO_URING_OP_READ_FIXED = 4,
+	IO_URING_OP_WRITE_FIXED = 5
+};
+
+enum {
+	IO_URING_FSYNC_DATASYNC = 1,
+	IO_URING_ENTER_GETEVENTS = 1,
+	IO_URING_REGISTER_BUFFERS = 0,
+	IO_URING_UNREGISTER_BUFFERS = 1,
+	IO_URING_REGISTER_EVENTFD = 4,
+	IO_URING_FEAT_SINGLE_MMAP = 1
+};
+
+static const uint64_t IO_URING_OFF_SQ_RING = 0;
+static const uint64_t IO_URING_OFF_CQ_RING = 0x8000000ULL;
+static const uint64_t IO_URING_OFF_SQES = 0x10000000ULL;
+
+struct linux_io_uring_sqe {
+	uint8_t opcode;
+	uint8_t flags;
+	uint16_t ioprio;
+	int32_t fd;
+	uint64_t off;
+	uint64_t addr;
+	uint32_t len;
+	uint32_t op_flags;  // rw_flags or fsync_flags, depending on opcode
+	uint64_t user_data;
+	uint16_t buf_index;
+	uint16_t personality;
+	uint32_t unused;
+	uint64_t unused2[2];
+};
+
+struct linux_io_uring_cqe {
+	uint64_t user_data;
+	int32_t res;
+	uint32_t flags;
+};
+
+struct linux_io_sqring_offsets {
+	uint32_t head, tail, ring_mask, ring_entries, flags, dropped, array, resv1;
+	uint64_t resv2;
+};
+
+struct linux_io_cqring_offsets {
+	uint32_t head, tail, ring_mask, ring_entries, overflow, cqes, flags, resv1;
+	uint64_t resv2;
+};
+
+struct linux_io_uring_params {
+	uint32_t sq_entries;
+	uint32_t cq_entries;
+	uint32_t flags;
+	uint32_t sq_thread_cpu;
+	uint32_t sq_thread_idle;
+	uint32_t features;
+	uint32_t wq_fd;
+	uint32_t resv[3];
+	linux_io_sqring_offsets sq_off;
+	linux_io_cqring_offsets cq_off;
+};
+
+static int io_uring_setup(unsigned entries, linux_io_uring_params* p) { return syscall( __NR_io_uring_setup, entries, p ); }
+static int io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) { return syscall( __NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0 ); }
+static int io_uring_register(int fd, unsigned opcode, const void* arg, unsigned nr_args) { return syscall( __NR_io_uring_register, fd, opcode, arg, nr_args ); }
+
+// The submission and completion rings shared with the kernel.  The kernel only advances the submission head and the
+// completion tail, and we only advance the submission tail and the completion head, so a single thread needs no
+// locking, only acquire/release ordering on the indices the other side writes.
+struct linux_io_uring {
+	int fd;
+
+	uint32_t* sqHead;
+	uint32_t* sqTail;
+	uint32_t sqMask;
+	uint32_t sqEntries;
+	uint32_t* sqArray;
+	linux_io_uring_sqe* sqes;
+	uint32_t sqNextTail;  // Entries before this have been filled, and are published to the kernel by submit()
+
+	uint32_t* cqHead;
+	uint32_t* cqTail;
+	uint32_t cqMask;
+	linux_io_uring_cqe* cqes;
+
+	void* sqRing;
+	size_t sqRingBytes;
+	void* cqRing;
+	size_t cqRingBytes;
+	size_t sqesBytes;
+
+	linux_io_uring() : fd(-1), sqes((linux_io_uring_sqe*)MAP_FAILED), sqRing(MAP_FAILED), cqRing(MAP_FAILED) {}
+
+	// Returns 0, or -errno if the kernel refused to create or map the rings
+	int setup(unsigned entries) {
+		linux_io_uring_params p;
+		memset(&p, 0, sizeof(p));
+		fd = io_uring_setup(entries, &p);
+		if (fd < 0) {
+			fd = -1;
+			return -errno;
+		}
+
+		sqRingBytes = p.sq_off.array + p.sq_entries * sizeof(uint32_t);
+		cqRingBytes = p.cq_off.cqes + p.cq_entries * sizeof(linux_io_uring_cqe);
+		if (p.features & IO_URING_FEAT_SINGLE_MMAP) {
+			sqRingBytes = cqRingBytes = std::max(sqRingBytes, cqRingBytes);
+		}
+		sqesBytes = p.sq_entries * sizeof(linux_io_uring_sqe);
+
+		sqRing = mmap(nullptr, sqRingBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IO_URING_OFF_SQ_RING);
+		if (sqRing == MAP_FAILED) return teardown();
+		if (p.features & IO_URING_FEAT_SINGLE_MMAP) {
+			cqRing = sqRing;
+		} else {
+			cqRing = mmap(nullptr, cqRingBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IO_URING_OFF_CQ_RING);
+			if (cqRing == MAP_FAILED) return teardown();
+		}
+		sqes = (linux_io_uring_sqe*)mmap(nullptr, sqesBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IO_URING_OFF_SQES);
+		if (sqes == MAP_FAILED) return teardown();
+
+		uint8_t* sq = (uint8_t*)sqRing;
+		sqHead = (uint32_t*)(sq + p.sq_off.head);
+		sqTail = (uint32_t*)(sq + p.sq_off.tail);
+		sqMask = *(uint32_t*)(sq + p.sq_off.ring_mask);
+		sqEntries = *(uint32_t*)(sq + p.sq_off.ring_entries);
+		sqArray = (uint32_t*)(sq + p.sq_off.array);
+		sqNextTail = *sqTail;
+
+		uint8_t* cq = (uint8_t*)cqRing;
+		cqHead = (uint32_t*)(cq + p.cq_off.head);
+		cqTail = (uint32_t*)(cq + p.cq_off.tail);
+		cqMask = *(uint32_t*)(cq + p.cq_off.ring_mask);
+		cqes = (linux_io_uring_cqe*)(cq + p.cq_off.cqes);
+		return 0;
+	}
+
+	// Unmaps and closes whatever setup() created, returning -errno of the failure that led here
+	int teardown() {
+		int err = -errno;
+		if (sqes != MAP_FAILED) munmap(sqes, sqesBytes);
+		if (cqRing != MAP_FAILED && cqRing != sqRing) munmap(cqRing, cqRingBytes);
+		if (sqRing != MAP_FAILED) munmap(sqRing, sqRingBytes);
+		if (fd >= 0) ::close(fd);
+		fd = -1;
+		sqRing = cqRing = MAP_FAILED;
+		sqes = (linux_io_uring_sqe*)MAP_FAILED;
+		return err;
+	}
+
+	// Returns the next free submission entry, zeroed, or nullptr if the submission ring is full.  The entry is
+	// handed to the kernel by the next call to submit().
+	linux_io_uring_sqe* getSqe() {
+		if (unsubmitted() >= sqEntries) return nullptr;
+		uint32_t index = sqNextTail++ & sqMask;
+		linux_io_uring_sqe* sqe = &sqes[index];
+		memset(sqe, 0, sizeof(*sqe));
+		sqArray[index] = index;
+		return sqe;
+	}
+
+	// Number of entries returned by getSqe() that the kernel has not consumed yet
+	uint32_t unsubmitted() const { return sqNextTail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE); }
+
+	// Publishes the filled entries and asks the kernel to start them, returning the number it consumed or -errno.
+	// Entries the kernel did not consume stay in the ring for the next call.
+	int submit() {
+		__atomic_store_n(sqTail, sqNextTail, __ATOMIC_RELEASE);
+		int rc;
+		do {
+			rc = io_uring_enter(fd, unsubmitted(), 0, 0);
+		} while (rc < 0 && errno == EINTR);
+		return rc < 0 ? -errno : rc;
+	}
+
+	// Takes back the entries the kernel has not consumed, calling f on each in submission order.  The kernel only
+	// reads the tail inside io_uring_enter (there is no submission polling thread), so moving it back is safe.
+	template <class F>
+	int discard(F f) {
+		uint32_t head = __atomic_load_n(sqHead, __ATOMIC_ACQUIRE);
+		int n = 0;
+		for (; head != sqNextTail; ++head, ++n) {
+			f(sqes[head & sqMask]);
+		}
+		sqNextTail -= n;
+		__atomic_store_n(sqTail, sqNextTail, __ATOMIC_RELEASE);
+		return n;
+	}
+
+	// Calls f on every completion posted so far and releases their slots.  This only reads shared memory.
+	template <class F>
+	int reap(F f) {
+		uint32_t head = *cqHead;
+		uint32_t tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+		int n = 0;
+		for (; head != tail; ++head, ++n) {
+			f(cqes[head & cqMask]);
+		}
+		__atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+		return n;
+	}
+};
@@ -152,6 +152,27 @@ void applyMetadataMutations(UID const& dbgid, Arena &arena, VectorRef<MutationRe
 					}
 				}
 				if(!initialCommit) txnStateStore->set(KeyValueRef(m.param1, m.param2));
+			} else if (m.param1.startsWith(changeFeedPrefix)) {
+				// Tell the storage servers holding the feed's range to start recording it at this version
+				if(toCommit && keyInfo) {
+					KeyRange feedRange = decodeChangeFeedValue(m.param2);
+					MutationRef privatized = m;
+					privatized.param1 = m.param1.withPrefix(systemKeys.begin, arena);
+					TraceEvent(SevDebug, "SendingPrivateMutation", dbgid).detail("Original", m.toString()).detail("Privatized", privatized.toString());
+
+					std::set<Tag> allTags;
+					for(auto it : keyInfo->intersectingRanges(feedRange)) {
+						auto& r = it.value();
+						for(auto info : r.src_info) {
+							allTags.insert(info->tag);
+						}
+						for(auto info : r.dest_info) {
+							allTags.insert(info->tag);
+						}
+					}
+					toCommit->addTags(allTags);
+					toCommit->addTypedMessage(privatized);
+				}
 			} else if (m.param1.startsWith(cacheKeysPrefix)) {
 				// Create a private mutation for cache servers
 				// This is done to make the cache servers aware of the cached key-ranges
@@ -465,6 +486,23 @@ void applyMetadataMutations(UID const& dbgid, Arena &arena, VectorRef<MutationRe
 
 				if(!initialCommit) txnStateStore->clear(commonLogRange);
 			}
+			if (changeFeedKeys.intersects(range)) {
+				// The ranges of the removed feeds are not known here, so every storage server is told
+				if(toCommit) {
+					KeyRangeRef r = range & changeFeedKeys;
+					MutationRef privatized = m;
+					privatized.param1 = r.begin.withPrefix(systemKeys.begin, arena);
+					privatized.param2 = r.end.withPrefix(systemKeys.begin, arena);
+					TraceEvent(SevDebug, "SendingPrivateMutation", dbgid).detail("Original", m.toString()).detail("Privatized", privatized.toString());
+
+					std::set<Tag> allTags;
+					for (auto &kv : txnStateStore->readRange(serverTagKeys).get()) {
+						allTags.insert(decodeServerTagValue(kv.value));
+					}
+					toCommit->addTags(allTags);
+					toCommit->addTypedMessage(privatized);
+				}
+			}
 		}
 	}
 
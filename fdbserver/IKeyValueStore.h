@@ -42,15 +42,40 @@ public:
 	virtual void clear( KeyRangeRef range, const Arena* arena = NULL ) = 0;
 	virtual Future<Void> commit(bool sequential = false) = 0;  // returns when prior sets and clears are (atomically) durable
 
+	// Sets each pair in data, which is sorted by key, into a part of the store that holds no keys between data's first
+	// and last keys, such as a range being filled after it was cleared.  Engines can then place each pair after the
+	// previous one instead of searching for it.
+	virtual void setSorted( VectorRef<KeyValueRef> data, const Arena* arena = NULL ) {
+		for(auto& kv : data) set( kv, arena );
+	}
+
 	virtual Future<Optional<Value>> readValue( KeyRef key, Optional<UID> debugID = Optional<UID>() ) = 0;
 
 	// Like readValue(), but returns only the first maxLength bytes of the value if it is longer
 	virtual Future<Optional<Value>> readValuePrefix( KeyRef key, int maxLength, Optional<UID> debugID = Optional<UID>() ) = 0;
 
+	// Like readValuePrefix() for each (key, maxLength) pair in keys, which is sorted by key, returning the values in the
+	// same order.  Engines read sorted runs of the keys with one cursor each instead of seeking for every key.
+	virtual Future<std::vector<Optional<Value>>> readValuePrefixes( std::vector<std::pair<KeyRef, int>> const& keys, Optional<UID> debugID = Optional<UID>() ) {
+		std::vector<Future<Optional<Value>>> values;
+		values.reserve( keys.size() );
+		for(auto& k : keys) values.push_back( readValuePrefix( k.first, k.second, debugID ) );
+		return getAll( values );
+	}
+
 	// If rowLimit>=0, reads first rows sorted ascending, otherwise reads last rows sorted descending
 	// The total size of the returned value (less the last entry) will be less than byteLimit
 	virtual Future<Standalone<RangeResultRef>> readRange( KeyRangeRef keys, int rowLimit = 1<<30, int byteLimit = 1<<30 ) = 0;
 
+	// True if the store keeps the contents of earlier commits readable.  Such a store labels each commit with the
+	// version given to setCommitVersion() and keeps every commit at or after oldestReadable, and
+	// readValueAtVersion() and readRangeAtVersion() read the latest kept commit at or before a version, throwing
+	// transaction_too_old or version_invalid if it is no longer kept.
+	virtual bool supportsVersionedReads() { return false; }
+	virtual void setCommitVersion( Version version, Version oldestReadable ) {}
+	virtual Future<Optional<Value>> readValueAtVersion( KeyRef key, Version version, Optional<UID> debugID = Optional<UID>() ) { UNREACHABLE(); }
+	virtual Future<Standalone<RangeResultRef>> readRangeAtVersion( KeyRangeRef keys, Version version, int rowLimit = 1<<30, int byteLimit = 1<<30 ) { UNREACHABLE(); }
+
 	// To debug MEMORY_RADIXTREE type ONLY
 	// Returns (1) how many key & value pairs have been inserted (2) how many nodes have been created (3) how many
 	// key size is less than 12 bytes
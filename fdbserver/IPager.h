@@ -86,9 +86,27 @@ public:
 	mutable void (*userDataDestructor)(void *);
 };
 
+// How a page read uses the pager's page cache
+enum class PageCacheHint {
+	Normal,   // Cached, and kept longer once read again
+	Internal, // An internal B-tree page, which is evicted only when no other page can be
+	NoHit,    // Cached without counting as a use, such as when preloading or overwriting the page
+	Scan      // Part of a scan, so cached to be evicted first and not counted as a use
+};
+
 class IPagerSnapshot {
 public:
-	virtual Future<Reference<const IPage>> getPhysicalPage(LogicalPageID pageID, bool cacheable, bool nohit) = 0;
+	virtual Future<Reference<const IPage>> getPhysicalPage(LogicalPageID pageID, bool cacheable, PageCacheHint hint) = 0;
+
+	// Like getPhysicalPage() for each of pageIDs.  A pager may read pages which are adjacent in its file with one read.
+	virtual std::vector<Future<Reference<const IPage>>> getPhysicalPages(VectorRef<LogicalPageID> pageIDs, bool cacheable, PageCacheHint hint) {
+		std::vector<Future<Reference<const IPage>>> pages;
+		for(LogicalPageID pageID : pageIDs) {
+			pages.push_back(getPhysicalPage(pageID, cacheable, hint));
+		}
+		return pages;
+	}
+
 	virtual Version getVersion() const = 0;
 
 	virtual Key getMetaKey() const = 0;
@@ -133,9 +151,9 @@ public:
 	//   - the most recent committed atomic
 	//   - the most recent non-atomic write
 	// Cacheable indicates that the page should be added to the page cache (if applicable?) as a result of this read.
-	// NoHit indicates that the read should not be considered a cache hit, such as when preloading pages that are
+	// The hint says how the read uses the cache, such as not counting as a cache hit when preloading pages that are
 	// considered likely to be needed soon.
-	virtual Future<Reference<IPage>> readPage(LogicalPageID pageID, bool cacheable = true, bool noHit = false) = 0;
+	virtual Future<Reference<IPage>> readPage(LogicalPageID pageID, bool cacheable = true, PageCacheHint hint = PageCacheHint::Normal) = 0;
 
 	// Get a snapshot of the metakey and all pages as of the version v which must be >= getOldestVersion()
 	// Note that snapshots at any version may still see the results of updatePage() calls.
@@ -229,6 +229,17 @@ ServerKnobs::ServerKnobs(bool randomize, ClientKnobs* clientKnobs, bool isSimula
 	// Redwood Storage Engine
 	init( PREFIX_TREE_IMMEDIATE_KEY_SIZE_LIMIT,                   30 );
 	init( PREFIX_TREE_IMMEDIATE_KEY_SIZE_MIN,                      0 );
+	init( REDWOOD_PAGE_COMPRESSION_LEVEL,                          0 ); if( randomize && BUGGIFY ) REDWOOD_PAGE_COMPRESSION_LEVEL = deterministicRandom()->randomInt(1, 10);
+	init( REDWOOD_COMPRESSED_PAGE_BLOCKS,                          4 ); if( randomize && BUGGIFY ) REDWOOD_COMPRESSED_PAGE_BLOCKS = deterministicRandom()->randomInt(1, 9);
+	init( REDWOOD_PAGE_CACHE_PROTECTED_FRACTION,                 0.8 ); if( randomize && BUGGIFY ) REDWOOD_PAGE_CACHE_PROTECTED_FRACTION = deterministicRandom()->random01();
+	init( REDWOOD_METRICS_INTERVAL,                              5.0 );
+	init( REDWOOD_READ_AHEAD_PAGES,                               16 ); if( randomize && BUGGIFY ) REDWOOD_READ_AHEAD_PAGES = deterministicRandom()->randomInt(1, 4);
+	init( REDWOOD_LARGE_VALUE_PAGES,                             2.0 ); if( randomize && BUGGIFY ) REDWOOD_LARGE_VALUE_PAGES = deterministicRandom()->random01() * 4;
+	init( REDWOOD_LAZY_CLEAR_BATCH_SIZE,                          10 ); if( randomize && BUGGIFY ) REDWOOD_LAZY_CLEAR_BATCH_SIZE = deterministicRandom()->randomInt(1, 20);
+	init( REDWOOD_LAZY_CLEAR_MIN_PAGES,                            0 ); if( randomize && BUGGIFY ) REDWOOD_LAZY_CLEAR_MIN_PAGES = deterministicRandom()->randomInt(0, 100);
+	init( REDWOOD_LAZY_CLEAR_MAX_PAGES,                      1000000 ); if( randomize && BUGGIFY ) REDWOOD_LAZY_CLEAR_MAX_PAGES = deterministicRandom()->randomInt(1, 100);
+	init( REDWOOD_LEAF_PAGE_BLOCKS,                                1 ); if( randomize && BUGGIFY ) REDWOOD_LEAF_PAGE_BLOCKS = deterministicRandom()->randomInt(1, 17);
+	init( REDWOOD_INTERNAL_PAGE_BLOCKS,                            1 ); if( randomize && BUGGIFY ) REDWOOD_INTERNAL_PAGE_BLOCKS = deterministicRandom()->randomInt(1, 5);
 
 	// KeyValueStore SQLITE
 	init( CLEAR_BUFFER_SIZE,                                   20000 );
@@ -245,6 +256,7 @@ ServerKnobs::ServerKnobs(bool randomize, ClientKnobs* clientKnobs, bool isSimula
 	init( SQLITE_BTREE_PAGE_USABLE,                          4096 - 8);  // pageSize - reserveSize for page checksum
 	init( SQLITE_CHUNK_SIZE_PAGES,                             25600 );  // 100MB
 	init( SQLITE_CHUNK_SIZE_PAGES_SIM,                          1024 );  // 4MB
+	init( SQLITE_READ_BATCH_KEYS_PER_THREAD,                      16 ); if( randomize && BUGGIFY ) SQLITE_READ_BATCH_KEYS_PER_THREAD = 1;
 
 	// Maximum and minimum cell payload bytes allowed on primary page as calculated in SQLite.
 	// These formulas are copied from SQLite, using its hardcoded constants, so if you are
@@ -500,16 +512,43 @@ ServerKnobs::ServerKnobs(bool randomize, ClientKnobs* clientKnobs, bool isSimula
 	init( BYTE_SAMPLING_FACTOR,                                  250 ); //cannot buggify because of differences in restarting tests
 	init( BYTE_SAMPLING_OVERHEAD,                                100 );
 	init( MAX_STORAGE_SERVER_WATCH_BYTES,                      100e6 ); if( randomize && BUGGIFY ) MAX_STORAGE_SERVER_WATCH_BYTES = 10e3;
+	init( WATCH_FIRE_BATCH_DELAY,                              0.001 ); if( randomize && BUGGIFY ) WATCH_FIRE_BATCH_DELAY = 0.1;
 	init( MAX_BYTE_SAMPLE_CLEAR_MAP_SIZE,                        1e9 ); if( randomize && BUGGIFY ) MAX_BYTE_SAMPLE_CLEAR_MAP_SIZE = 1e3;
 	init( LONG_BYTE_SAMPLE_RECOVERY_DELAY,                      60.0 );
 	init( BYTE_SAMPLE_LOAD_PARALLELISM,                            8 ); if( randomize && BUGGIFY ) BYTE_SAMPLE_LOAD_PARALLELISM = 1;
 	init( BYTE_SAMPLE_LOAD_DELAY,                                0.0 ); if( randomize && BUGGIFY ) BYTE_SAMPLE_LOAD_DELAY = 0.1;
 	init( BYTE_SAMPLE_START_DELAY,                               1.0 ); if( randomize && BUGGIFY ) BYTE_SAMPLE_START_DELAY = 0.0;
+	init( BYTE_SAMPLE_SNAPSHOT_INTERVAL,                       600.0 ); if( randomize && BUGGIFY ) BYTE_SAMPLE_SNAPSHOT_INTERVAL = deterministicRandom()->coinflip() ? 0.0 : 5.0;
+	init( BYTE_SAMPLE_SNAPSHOT_CHUNK_ENTRIES,                   1000 ); if( randomize && BUGGIFY ) BYTE_SAMPLE_SNAPSHOT_CHUNK_ENTRIES = 3;
+	init( BYTE_SAMPLE_SNAPSHOT_CHUNK_DELAY,                    0.005 ); if( randomize && BUGGIFY ) BYTE_SAMPLE_SNAPSHOT_CHUNK_DELAY = 0.1;
+	init( STORAGE_WARM_UP_CAPTURE_INTERVAL,                     60.0 ); if( randomize && BUGGIFY ) STORAGE_WARM_UP_CAPTURE_INTERVAL = deterministicRandom()->coinflip() ? 0.0 : 5.0;
+	init( STORAGE_WARM_UP_KEYS,                                 1000 ); if( randomize && BUGGIFY ) STORAGE_WARM_UP_KEYS = 3;
+	init( STORAGE_WARM_UP_BYTES_PER_KEY,                       64000 ); if( randomize && BUGGIFY ) STORAGE_WARM_UP_BYTES_PER_KEY = 100;
+	init( STORAGE_WARM_UP_MAX_BYTES,                           256e6 ); if( randomize && BUGGIFY ) STORAGE_WARM_UP_MAX_BYTES = 10e3;
+	init( STORAGE_WARM_UP_BYTES_PER_SECOND,                     20e6 ); if( randomize && BUGGIFY ) STORAGE_WARM_UP_BYTES_PER_SECOND = 1e5;
+	init( STORAGE_VERSIONED_READS,                             false ); if( randomize && BUGGIFY ) STORAGE_VERSIONED_READS = true;
+	init( STORAGE_VERSIONED_MEMORY_VERSIONS,      VERSIONS_PER_SECOND ); if( randomize && BUGGIFY ) STORAGE_VERSIONED_MEMORY_VERSIONS = std::max<int>(1, 0.1 * VERSIONS_PER_SECOND);
+	init( STORAGE_VERSIONED_READ_MAX_RANGES,                    10000 ); if( randomize && BUGGIFY ) STORAGE_VERSIONED_READ_MAX_RANGES = 3;
 	init( UPDATE_STORAGE_PROCESS_STATS_INTERVAL,                 5.0 );
 	init( BEHIND_CHECK_DELAY,                                    2.0 );
 	init( BEHIND_CHECK_COUNT,                                      2 );
 	init( BEHIND_CHECK_VERSIONS,             5 * VERSIONS_PER_SECOND );
 	init( WAIT_METRICS_WRONG_SHARD_CHANCE,   isSimulated ? 1.0 : 0.1 );
+	init( RANGESTREAM_FRAGMENT_BYTES,                          80000 ); if( randomize && BUGGIFY ) RANGESTREAM_FRAGMENT_BYTES = 100;
+	init( RANGESTREAM_LIMIT_BYTES,                               2e6 ); if( randomize && BUGGIFY ) RANGESTREAM_LIMIT_BYTES = 1;
+	init( CHANGEFEEDSTREAM_FRAGMENT_BYTES,                    100000 ); if( randomize && BUGGIFY ) CHANGEFEEDSTREAM_FRAGMENT_BYTES = 100;
+	init( CHANGEFEEDSTREAM_LIMIT_BYTES,                          2e6 ); if( randomize && BUGGIFY ) CHANGEFEEDSTREAM_LIMIT_BYTES = 1;
+	init( CHANGEFEEDSTREAM_IDLE_INTERVAL,                        0.1 ); if( randomize && BUGGIFY ) CHANGEFEEDSTREAM_IDLE_INTERVAL = 0.001;
+	init( STORAGE_ROW_CACHE_BYTES,                                 0 ); if( randomize && BUGGIFY ) STORAGE_ROW_CACHE_BYTES = deterministicRandom()->coinflip() ? 1e4 : 1e7;
+	init( STORAGE_VERSIONED_MAP_BTREE,                         false ); if( randomize && BUGGIFY ) STORAGE_VERSIONED_MAP_BTREE = true;
+	init( CLEAR_RANGE_EAGER_READS,                              true ); if( randomize && BUGGIFY ) CLEAR_RANGE_EAGER_READS = false;
+	init( FETCH_KEYS_STREAMING,                                 true ); if( randomize && BUGGIFY ) FETCH_KEYS_STREAMING = false;
+	init( FETCH_KEYS_COMMIT_BYTES,                               5e6 ); if( randomize && BUGGIFY ) FETCH_KEYS_COMMIT_BYTES = 5e4;
+	init( MAPPED_RECORDS_PARALLELISM,                           100 ); if( randomize && BUGGIFY ) MAPPED_RECORDS_PARALLELISM = 1;
+	init( STORAGE_READ_QUEUE_SLOTS,                              200 ); if( randomize && BUGGIFY ) STORAGE_READ_QUEUE_SLOTS = deterministicRandom()->randomInt(1, 10);
+	init( STORAGE_READ_QUEUE_COST_BYTES,                         1e4 ); if( randomize && BUGGIFY ) STORAGE_READ_QUEUE_COST_BYTES = 100;
+	init( STORAGE_READ_QUEUE_MAX_DELAY,                          1.0 ); if( randomize && BUGGIFY ) STORAGE_READ_QUEUE_MAX_DELAY = 0.1;
+	init( STORAGE_READ_QUEUE_BATCH_MAX_DELAY,                    0.5 ); if( randomize && BUGGIFY ) STORAGE_READ_QUEUE_BATCH_MAX_DELAY = 0.05;
 
 	//Wait Failure
 	init( MAX_OUTSTANDING_WAIT_FAILURE_REQUESTS,                 250 ); if( randomize && BUGGIFY ) MAX_OUTSTANDING_WAIT_FAILURE_REQUESTS = 2;
@@ -192,6 +192,17 @@ public:
 	// Redwood Storage Engine
 	int PREFIX_TREE_IMMEDIATE_KEY_SIZE_LIMIT;
 	int PREFIX_TREE_IMMEDIATE_KEY_SIZE_MIN;
+	int REDWOOD_PAGE_COMPRESSION_LEVEL; // zlib level at which BTree pages larger than a block are compressed; 0 disables compression
+	int REDWOOD_COMPRESSED_PAGE_BLOCKS; // Blocks a leaf page is filled to before compression when compression is enabled
+	double REDWOOD_PAGE_CACHE_PROTECTED_FRACTION; // Share of the page cache kept for pages read more than once and internal pages, so scans cannot evict them
+	double REDWOOD_METRICS_INTERVAL; // Seconds between traces of Redwood page cache hits, misses and evictions
+	int REDWOOD_READ_AHEAD_PAGES; // Leaf pages read ahead of a range read cursor
+	double REDWOOD_LARGE_VALUE_PAGES; // Values filling at least this many pages are stored out of line in pages of their own; 0 disables
+	int REDWOOD_LAZY_CLEAR_BATCH_SIZE; // Pages of cleared subtrees read at once to be freed
+	int REDWOOD_LAZY_CLEAR_MIN_PAGES; // Pages of cleared subtrees freed with each commit, if that many are queued, even after the commit is written
+	int REDWOOD_LAZY_CLEAR_MAX_PAGES; // Most pages of cleared subtrees freed with each commit
+	int REDWOOD_LEAF_PAGE_BLOCKS; // Blocks a leaf page is filled to before it is split, set when a tree is created
+	int REDWOOD_INTERNAL_PAGE_BLOCKS; // Blocks an internal page is filled to before it is split, set when a tree is created
 
 	// KeyValueStore SQLITE
 	int CLEAR_BUFFER_SIZE;
@@ -213,6 +224,7 @@ public:
 	double SQLITE_FRAGMENT_MIN_SAVINGS;
 	int SQLITE_CHUNK_SIZE_PAGES;
 	int SQLITE_CHUNK_SIZE_PAGES_SIM;
+	int SQLITE_READ_BATCH_KEYS_PER_THREAD; // Fewest keys of a batched point read given to each read thread
 
 	// KeyValueStoreSqlite spring cleaning
 	double SPRING_CLEANING_NO_ACTION_INTERVAL;
@@ -439,16 +451,43 @@ public:
 	int BYTE_SAMPLING_FACTOR;
 	int BYTE_SAMPLING_OVERHEAD;
 	int MAX_STORAGE_SERVER_WATCH_BYTES;
+	double WATCH_FIRE_BATCH_DELAY; // How long a multi-key watch waits after one key fires for others to fire with it
 	int MAX_BYTE_SAMPLE_CLEAR_MAP_SIZE;
 	double LONG_BYTE_SAMPLE_RECOVERY_DELAY;
 	int BYTE_SAMPLE_LOAD_PARALLELISM;
 	double BYTE_SAMPLE_LOAD_DELAY;
 	double BYTE_SAMPLE_START_DELAY;
+	double BYTE_SAMPLE_SNAPSHOT_INTERVAL; // Seconds between snapshots of the byte sample, which restarts load instead of the sampled keys; 0 disables them
+	int BYTE_SAMPLE_SNAPSHOT_CHUNK_ENTRIES; // Byte sample entries per key of a snapshot
+	double BYTE_SAMPLE_SNAPSHOT_CHUNK_DELAY; // Seconds to wait between writing the keys of a snapshot
+	double STORAGE_WARM_UP_CAPTURE_INTERVAL; // Seconds between recording the most read keys, which a restart reads to warm the storage engine's cache; 0 disables it
+	int STORAGE_WARM_UP_KEYS; // Most read keys recorded
+	int STORAGE_WARM_UP_BYTES_PER_KEY; // Bytes read from each recorded key onward when warming up
+	int64_t STORAGE_WARM_UP_MAX_BYTES; // Bytes read in all when warming up
+	int64_t STORAGE_WARM_UP_BYTES_PER_SECOND; // Rate at which warm-up reads
+	bool STORAGE_VERSIONED_READS; // Serve reads older than the versions kept in memory from earlier commits of storage engines that keep them
+	int64_t STORAGE_VERSIONED_MEMORY_VERSIONS; // Versions kept in memory when reads of older versions are served by the storage engine
+	int STORAGE_VERSIONED_READ_MAX_RANGES; // Ranges changed between two commits tracked before reads between them are all refused
 	double UPDATE_STORAGE_PROCESS_STATS_INTERVAL;
 	double BEHIND_CHECK_DELAY;
 	int BEHIND_CHECK_COUNT;
 	int64_t BEHIND_CHECK_VERSIONS;
 	double WAIT_METRICS_WRONG_SHARD_CHANCE;
+	int RANGESTREAM_FRAGMENT_BYTES;
+	int64_t RANGESTREAM_LIMIT_BYTES;
+	int CHANGEFEEDSTREAM_FRAGMENT_BYTES;
+	int64_t CHANGEFEEDSTREAM_LIMIT_BYTES;
+	double CHANGEFEEDSTREAM_IDLE_INTERVAL;
+	int64_t STORAGE_ROW_CACHE_BYTES; // Memory for caching point reads from storage; 0 disables the cache
+	bool STORAGE_VERSIONED_MAP_BTREE; // Keep the versions not yet durable in a persistent B+tree instead of a PTree
+	bool CLEAR_RANGE_EAGER_READS; // Read the next key from storage to widen each clear range to it before applying the clear
+	bool FETCH_KEYS_STREAMING; // Stream whole shards from the source servers in fetchKeys instead of reading a block per transaction
+	int64_t FETCH_KEYS_COMMIT_BYTES; // Bytes fetchKeys may write to the storage engine between commits of updateStorage
+	int MAPPED_RECORDS_PARALLELISM; // Reads of the records mapped index entries name that a storage server runs at once
+	int STORAGE_READ_QUEUE_SLOTS; // Reads a storage server runs at once, with the rest fair queued; 0 runs every read at once
+	int64_t STORAGE_READ_QUEUE_COST_BYTES; // A range read costs one point read in the read queue per this many bytes of its byte limit
+	double STORAGE_READ_QUEUE_MAX_DELAY; // Seconds a default priority read may wait in the read queue before it is shed
+	double STORAGE_READ_QUEUE_BATCH_MAX_DELAY; // Seconds a batch priority read may wait in the read queue before it is shed
 
 	//Wait Failure
 	int MAX_OUTSTANDING_WAIT_FAILURE_REQUESTS;
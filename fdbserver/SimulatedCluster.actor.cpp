@@ -693,7 +693,7 @@ ACTOR Future<Void> restartSimulatedSystem(vector<Future<Void>>* systemActors, st
 }
 
 struct SimulationConfig {
-	explicit SimulationConfig(int extraDB, int minimumReplication, int minimumRegions);
+	explicit SimulationConfig(int extraDB, int minimumReplication, int minimumRegions, int storageEngineType);
 	int extraDB;
 
 	DatabaseConfiguration db;
@@ -706,11 +706,11 @@ struct SimulationConfig {
 	int processes_per_machine;
 	int coordinators;
 private:
-	void generateNormalConfig(int minimumReplication, int minimumRegions);
+	void generateNormalConfig(int minimumReplication, int minimumRegions, int storageEngineType);
 };
 
-SimulationConfig::SimulationConfig(int extraDB, int minimumReplication, int minimumRegions) : extraDB(extraDB) {
-	generateNormalConfig(minimumReplication, minimumRegions);
+SimulationConfig::SimulationConfig(int extraDB, int minimumReplication, int minimumRegions, int storageEngineType) : extraDB(extraDB) {
+	generateNormalConfig(minimumReplication, minimumRegions, storageEngineType);
 }
 
 void SimulationConfig::set_config(std::string config) {
@@ -725,7 +725,7 @@ StringRef StringRefOf(const char* s) {
   return StringRef((uint8_t*)s, strlen(s));
 }
 
-void SimulationConfig::generateNormalConfig(int minimumReplication, int minimumRegions) {
+void SimulationConfig::generateNormalConfig(int minimumReplication, int minimumRegions, int storageEngineType) {
 	set_config("new");
 	const bool simple = false;  // Set true to simplify simulation configs for easier debugging
 	// generateMachineTeamTestConfig set up the number of servers per machine and the number of machines such that
@@ -737,7 +737,7 @@ void SimulationConfig::generateNormalConfig(int minimumReplication, int minimumR
 	if (deterministicRandom()->random01() < 0.25) db.desiredTLogCount = deterministicRandom()->randomInt(1,7);
 	if (deterministicRandom()->random01() < 0.25) db.masterProxyCount = deterministicRandom()->randomInt(1,7);
 	if (deterministicRandom()->random01() < 0.25) db.resolverCount = deterministicRandom()->randomInt(1,7);
-	int storage_engine_type = deterministicRandom()->randomInt(0, 3);
+	int storage_engine_type = storageEngineType >= 0 ? storageEngineType : deterministicRandom()->randomInt(0, 3);
 	switch (storage_engine_type) {
 	case 0: {
 		TEST(true); // Simulated cluster using ssd storage engine
@@ -1050,9 +1050,10 @@ void SimulationConfig::generateNormalConfig(int minimumReplication, int minimumR
 
 void setupSimulatedSystem(vector<Future<Void>>* systemActors, std::string baseFolder, int* pTesterCount,
                           Optional<ClusterConnectionString>* pConnString, Standalone<StringRef>* pStartingConfiguration,
-                          int extraDB, int minimumReplication, int minimumRegions, std::string whitelistBinPaths, bool configureLocked) {
+                          int extraDB, int minimumReplication, int minimumRegions, std::string whitelistBinPaths, bool configureLocked,
+                          int storageEngineType) {
 	// SOMEDAY: this does not test multi-interface configurations
-	SimulationConfig simconfig(extraDB, minimumReplication, minimumRegions);
+	SimulationConfig simconfig(extraDB, minimumReplication, minimumRegions, storageEngineType);
 	StatusObject startingConfigJSON = simconfig.db.toJSON(true);
 	std::string startingConfigString = "new";
 	if (configureLocked) {
@@ -1330,8 +1331,10 @@ void setupSimulatedSystem(vector<Future<Void>>* systemActors, std::string baseFo
 		.detail("StartingConfiguration", pStartingConfiguration->toString());
 }
 
+// Reads the options of the simulated cluster from the top of a test file.  A line knob_<name>=<value> sets a knob
+// before the cluster starts, so that every simulated process uses it.
 void checkTestConf(const char* testFile, int& extraDB, int& minimumReplication, int& minimumRegions,
-                   int& configureLocked) {
+                   int& configureLocked, int& storageEngineType) {
 	std::ifstream ifs;
 	ifs.open(testFile, std::ifstream::in);
 	if (!ifs.good())
@@ -1367,6 +1370,19 @@ void checkTestConf(const char* testFile, int& extraDB, int& minimumReplication,
 		if (attrib == "configureLocked") {
 			sscanf(value.c_str(), "%d", &configureLocked);
 		}
+
+		if (attrib == "storageEngineType") {
+			sscanf(value.c_str(), "%d", &storageEngineType);
+		}
+
+		if (attrib.find("knob_") == 0) {
+			std::string knob = attrib.substr(5);
+			if (!const_cast<FlowKnobs*>(FLOW_KNOBS)->setKnob(knob, value) &&
+			    !const_cast<ClientKnobs*>(CLIENT_KNOBS)->setKnob(knob, value) &&
+			    !const_cast<ServerKnobs*>(SERVER_KNOBS)->setKnob(knob, value)) {
+				TraceEvent(SevError, "UnrecognizedTestKnob").detail("Knob", knob).detail("Value", value);
+			}
+		}
 	}
 
 	ifs.close();
@@ -1381,7 +1397,8 @@ ACTOR void setupAndRun(std::string dataFolder, const char *testFile, bool reboot
 	state int minimumReplication = 0;
 	state int minimumRegions = 0;
 	state int configureLocked = 0;
-	checkTestConf(testFile, extraDB, minimumReplication, minimumRegions, configureLocked);
+	state int storageEngineType = -1;
+	checkTestConf(testFile, extraDB, minimumReplication, minimumRegions, configureLocked, storageEngineType);
 
 	// TODO (IPv6) Use IPv6?
 	wait(g_simulator.onProcess(
@@ -1408,7 +1425,7 @@ ACTOR void setupAndRun(std::string dataFolder, const char *testFile, bool reboot
 		else {
 			g_expect_full_pointermap = 1;
 			setupSimulatedSystem(&systemActors, dataFolder, &testerCount, &connFile, &startingConfiguration, extraDB,
-			                     minimumReplication, minimumRegions, whitelistBinPaths, configureLocked);
+			                     minimumReplication, minimumRegions, whitelistBinPaths, configureLocked, storageEngineType);
 			wait( delay(1.0) ); // FIXME: WHY!!!  //wait for machines to boot
 		}
 		std::string clusterFileDir = joinPath( dataFolder, deterministicRandom()->randomUniqueID().toString() );
@@ -51,12 +51,12 @@ inline bool canReplyWith(Error e) {
 const int VERSION_OVERHEAD = 64 + sizeof(Version) + sizeof(Standalone<VersionUpdateRef>) + //mutationLog, 64b overhead for map
 	2 * (64 + sizeof(Version) + sizeof(Reference<VersionedMap<KeyRef,
 									   ValueOrClearToRef>::PTreeT>)); //versioned map [ x2 for createNewVersion(version+1) ], 64b overhead for map
-static int mvccStorageBytes( MutationRef const& m ) { return VersionedMap<KeyRef, ValueOrClearToRef>::overheadPerItem * 2 + (MutationRef::OVERHEAD_BYTES + m.param1.size() + m.param2.size()) * 2; }
+static int mvccStorageBytes( VersionedMap<KeyRef, ValueOrClearToRef> const& data, MutationRef const& m ) { return data.overheadPerItem() * 2 + (MutationRef::OVERHEAD_BYTES + m.param1.size() + m.param2.size()) * 2; }
 
 struct StorageCacheData {
 	typedef VersionedMap<KeyRef, ValueOrClearToRef> VersionedData;
 private:
-	// in-memory versioned struct (PTree as of now. Subject to change)
+	// in-memory versioned struct (a PTree, or a PBTree if STORAGE_VERSIONED_MAP_BTREE is set)
 	VersionedData versionedData;
 	// in-memory mutationLog that the versionedData contains references to
 	// TODO change it to a deque, already contains mutations in version order
@@ -88,7 +88,7 @@ public:
 	// TODO double check which ones we need for storageCache servers
 	struct Counters {
 		CounterCollection cc;
-		Counter allQueries, getKeyQueries, getValueQueries, getRangeQueries, finishedQueries, rowsQueried, bytesQueried, watchQueries;
+		Counter allQueries, getKeyQueries, getValueQueries, getValuesQueries, getRangeQueries, finishedQueries, rowsQueried, bytesQueried, watchQueries;
 		Counter bytesInput, mutationBytes;  // Like bytesInput but without MVCC accounting
 		Counter mutations, setMutations, clearRangeMutations, atomicMutations;
 		Counter updateBatches, updateVersions;
@@ -101,6 +101,7 @@ public:
 			: cc("StorageCacheServer", self->thisServerID.toString()),
 			getKeyQueries("GetKeyQueries", cc),
 			getValueQueries("GetValueQueries",cc),
+			getValuesQueries("GetValuesQueries",cc),
 			getRangeQueries("GetRangeQueries", cc),
 			allQueries("QueryQueue", cc),
 			finishedQueries("FinishedQueries", cc),
@@ -125,7 +126,8 @@ public:
 	} counters;
 
 	explicit StorageCacheData(UID thisServerID, uint16_t index)
-		:   thisServerID(thisServerID), index(index),
+		:   versionedData(SERVER_KNOBS->STORAGE_VERSIONED_MAP_BTREE),
+			thisServerID(thisServerID), index(index),
 			logSystem(new AsyncVar<Reference<ILogSystem>>()),
 			lastTLogVersion(0), lastVersionWithData(0),
 			compactionInProgress(Void()),
@@ -170,7 +172,7 @@ public:
 	MutationRef addMutationToMutationLog(Standalone<VersionUpdateRef> &mLV, MutationRef const& m){
 		//TODO find out more
 		//byteSampleApplyMutation(m, mLV.version);
-		counters.bytesInput += mvccStorageBytes(m);
+		counters.bytesInput += mvccStorageBytes(versionedData, m);
 		return mLV.mutations.push_back_deep( mLV.arena(), m );
 	}
 
@@ -297,6 +299,40 @@ ACTOR Future<Void> getValueQ( StorageCacheData* data, GetValueRequest req ) {
 	return Void();
 };
 
+ACTOR Future<Void> getValuesQ( StorageCacheData* data, GetValuesRequest req ) {
+	try {
+		++data->counters.getValuesQueries;
+		++data->counters.allQueries;
+
+		wait( delay(0, TaskPriority::DefaultEndpoint) );
+
+		state Version version = wait( waitForVersion( data, req.version ) );
+
+		GetValuesReply reply;
+		auto view = data->data().at(version);
+		for (auto& key : req.keys) {
+			if (!data->cachedRangeMap[key]) {
+				throw wrong_shard_server();
+			}
+			auto i = view.lastLessOrEqual(key);
+			if (i && i->isValue() && i.key() == key) {
+				++data->counters.rowsQueried;
+				data->counters.bytesQueried += i->getValue().size();
+				reply.data.push_back_deep(reply.arena, KeyValueRef(key, i->getValue()));
+			}
+		}
+		req.reply.send(reply);
+	} catch (Error& e) {
+		if(!canReplyWith(e))
+			throw;
+		req.reply.sendError(e);
+	}
+
+	++data->counters.finishedQueries;
+
+	return Void();
+}
+
 //TODO Implement the reverse readRange
 GetKeyValuesReply readRange(StorageCacheData* data, Version version, KeyRangeRef range, int limit, int* pLimitBytes) {
 	GetKeyValuesReply result;
@@ -981,15 +1017,33 @@ ACTOR Future<Void> storageCache(StorageServerInterface ssi, uint16_t id, Referen
 			//actors.add(self->readGuard(req , getValueQ));
 			actors.add(getValueQ(&self, req));
 		}
+		when( GetValuesRequest req = waitNext(ssi.getValues.getFuture()) ) {
+			actors.add(getValuesQ(&self, req));
+		}
 		when( WatchValueRequest req = waitNext(ssi.watchValue.getFuture()) ) {
 			ASSERT(false);
 		}
+		when( WatchValuesRequest req = waitNext(ssi.watchValues.getFuture()) ) {
+			req.reply.sendError(unsupported_operation());
+		}
 		when (GetKeyRequest req = waitNext(ssi.getKey.getFuture())) {
 			actors.add(getKey(&self, req));
 		}
 		when (GetKeyValuesRequest req = waitNext(ssi.getKeyValues.getFuture()) ) {
 			actors.add(getKeyValues(&self, req));
 		}
+		when (GetKeyValuesStreamRequest req = waitNext(ssi.getKeyValuesStream.getFuture()) ) {
+			req.reply.sendError(unsupported_operation());
+		}
+		when (GetMappedKeyValuesRequest req = waitNext(ssi.getMappedKeyValues.getFuture()) ) {
+			req.reply.sendError(unsupported_operation());
+		}
+		when (ChangeFeedStreamRequest req = waitNext(ssi.changeFeedStream.getFuture()) ) {
+			req.reply.sendError(unsupported_operation());
+		}
+		when (ChangeFeedPopRequest req = waitNext(ssi.changeFeedPop.getFuture()) ) {
+			req.reply.sendError(unsupported_operation());
+		}
 		when (GetShardStateRequest req = waitNext(ssi.getShardState.getFuture()) ) {
 			ASSERT(false);
 		}
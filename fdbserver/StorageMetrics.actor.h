@@ -378,6 +378,20 @@ struct StorageServerMetrics {
 		}
 	}
 
+	// Cuts req.keys into chunks of about req.chunkSize bytes according to the byte sample
+	void getSplitPoints( SplitRangeRequest req ) {
+		SplitRangeReply reply;
+		KeyRef lastKey = req.keys.begin;
+		while (req.chunkSize > 0) {
+			KeyRef key = byteSample.splitEstimate( KeyRangeRef(lastKey, req.keys.end), req.chunkSize );
+			if( key == req.keys.end )
+				break;
+			reply.splitPoints.push_back_deep( reply.splitPoints.arena(), key );
+			lastKey = reply.splitPoints.back();
+		}
+		req.reply.send(reply);
+	}
+
 	void getStorageMetrics( GetStorageMetricsRequest req, StorageBytes sb, double bytesInputRate ){
 		GetStorageMetricsReply rep;
 
@@ -34,6 +34,8 @@
 #include "fdbclient/CommitTransaction.h"
 #include "fdbserver/IKeyValueStore.h"
 #include "fdbserver/DeltaTree.h"
+#include "fdbserver/Knobs.h"
+#include "fdbrpc/zlib/zlib.h"
 #include <string.h>
 #include "flow/actorcompiler.h"
 #include <cinttypes>
@@ -737,22 +739,34 @@ private:
 //   bool evictable() const;            // return true if the entry can be evicted
 //   Future<Void> onEvictable() const;  // ready when entry can be evicted
 // indicating if it is safe to evict.
+// Objects are evicted by a segmented LRU policy that resists scans.  New objects start on probation and are protected
+// when used again, and the least recently used protected objects return to probation when protected and internal
+// objects exceed REDWOOD_PAGE_CACHE_PROTECTED_FRACTION of the cache.  Objects read by scans are not promoted, and go to
+// the front of probation once the scan reads them, so a scan only displaces objects that were not used since they were
+// cached.  Objects read ahead of a scan wait at the back of probation until the scan reaches them.
+// Internal objects are only evicted when no others are left.
 template<class IndexType, class ObjectType>
 class ObjectCache : NonCopyable {
 
+	enum Segment { PROBATION, PROTECTED, INTERNAL, SEGMENT_COUNT };
+
 	struct Entry : public boost::intrusive::list_base_hook<> {
-		Entry() : hits(0) {
+		Entry() : hits(0), segment(PROBATION) {
 		}
 		IndexType index;
 		ObjectType item;
 		int hits;
+		Segment segment;
 	};
 
 	typedef std::unordered_map<IndexType, Entry> CacheT;
 	typedef boost::intrusive::list<Entry> EvictionOrderT;
 
 public:
-	ObjectCache(int sizeLimit = 1) : sizeLimit(sizeLimit), cacheHits(0), cacheMisses(0), noHitEvictions(0), failedEvictions(0) {
+	ObjectCache(int sizeLimit = 1) : sizeLimit(sizeLimit), noHitEvictions(0), failedEvictions(0) {
+		for(int i = 0; i < 2; ++i) {
+			cacheHits[i] = cacheMisses[i] = evictions[i] = 0;
+		}
 	}
 
 	void setSizeLimit(int n) {
@@ -771,82 +785,97 @@ public:
 		return nullptr;
 	}
 
-	// Get the object for i or create a new one.
-	// After a get(), the object for i is the last in evictionOrder.
-	ObjectType & get(const IndexType &index, bool noHit = false) {
+	// Returns whether the object for index is cached, without counting as a use of it
+	bool exists(const IndexType &index) const {
+		return cache.count(index) != 0;
+	}
+
+	// Get the object for i or create a new one, placing it in the eviction order as hint describes.
+	ObjectType & get(const IndexType &index, PageCacheHint hint = PageCacheHint::Normal) {
 		Entry &entry = cache[index];
+		bool used = hint == PageCacheHint::Normal || hint == PageCacheHint::Internal;
 
-		// If entry is linked into evictionOrder then move it to the back of the order
 		if(entry.is_linked()) {
-			if(!noHit) {
+			if(used) {
 				++entry.hits;
-				++cacheHits;
+				++cacheHits[entry.segment == INTERNAL];
+				// Move the entry to the back of the protected or internal eviction order
+				lists[entry.segment].erase(lists[entry.segment].iterator_to(entry));
+				entry.segment = (hint == PageCacheHint::Internal || entry.segment == INTERNAL) ? INTERNAL : PROTECTED;
+				lists[entry.segment].push_back(entry);
+				demoteProtected();
+			}
+			else if(hint == PageCacheHint::Scan && entry.segment == PROBATION && entry.hits == 0) {
+				// The scan has now read an object read ahead of it, so it is evicted first
+				lists[PROBATION].erase(lists[PROBATION].iterator_to(entry));
+				lists[PROBATION].push_front(entry);
 			}
-			// Move the entry to the back of the eviction order
-			evictionOrder.erase(evictionOrder.iterator_to(entry));
-			evictionOrder.push_back(entry);
 		}
 		else {
-			++cacheMisses;
 			// Finish initializing entry
 			entry.index = index;
-			entry.hits = noHit ? 0 : 1;
-			// Insert the newly created Entry at the back of the eviction order
-			evictionOrder.push_back(entry);
+			entry.hits = used ? 1 : 0;
+			entry.segment = hint == PageCacheHint::Internal ? INTERNAL : PROBATION;
+			++cacheMisses[entry.segment == INTERNAL];
 
 			// While the cache is too big, evict the oldest entry until the oldest entry can't be evicted.
+			// Entry is not linked yet so it can't be chosen, and since sizeLimit must be > 0 some other entry is.
 			while(cache.size() > sizeLimit) {
-				Entry &toEvict = evictionOrder.front();
+				EvictionOrderT &order = !lists[PROBATION].empty() ? lists[PROBATION] : !lists[PROTECTED].empty() ? lists[PROTECTED] : lists[INTERNAL];
+				Entry &toEvict = order.front();
 				debug_printf("Trying to evict %s to make room for %s\n", toString(toEvict.index).c_str(), toString(index).c_str());
 
-				// It's critical that we do not evict the item we just added (or the reference we return would be invalid) but
-				// since sizeLimit must be > 0, entry was just added to the end of the evictionOrder, and this loop will end
-				// if we move anything to the end of the eviction order, we can be guaraunted that entry != toEvict, so we
-				// do not need to check.
-				// If the item is not evictable then move it to the back of the eviction order and stop.
+				// If the item is not evictable then move it to the back of its eviction order and stop.
 				if(!toEvict.item.evictable()) {
-					evictionOrder.erase(evictionOrder.iterator_to(toEvict));
-					evictionOrder.push_back(toEvict);
+					order.pop_front();
+					order.push_back(toEvict);
 					++failedEvictions;
 					break;
 				} else {
 					if(toEvict.hits == 0) {
 						++noHitEvictions;
 					}
+					++evictions[toEvict.segment == INTERNAL];
 					debug_printf("Evicting %s to make room for %s\n", toString(toEvict.index).c_str(), toString(index).c_str());
-					evictionOrder.pop_front();
+					order.pop_front();
 					cache.erase(toEvict.index);
 				}
 			}
+
+			if(hint == PageCacheHint::Scan) {
+				lists[PROBATION].push_front(entry);
+			}
+			else {
+				lists[entry.segment].push_back(entry);
+			}
+			demoteProtected();
 		}
 
 		return entry.item;
 	}
 
-	// Clears the cache, saving the entries, and then waits for eachWaits for each item to be evictable and evicts it.
-	// The cache should not be Evicts all evictable entries
+	// Clears the cache, saving the entries, and then waits for each item to be evictable and evicts it.
 	ACTOR static Future<Void> clear_impl(ObjectCache *self) {
 		state ObjectCache::CacheT cache;
-		state EvictionOrderT evictionOrder;
 
-		// Swap cache contents to local state vars
+		// Swap cache contents to a local state var
 		// After this, no more entries will be added to or read from these 
 		// structures so we know for sure that no page will become unevictable
 		// after it is either evictable or onEvictable() is ready.
+		for(auto &order : self->lists) {
+			order.clear();
+		}
 		cache.swap(self->cache);
-		evictionOrder.swap(self->evictionOrder);
 
-		state typename EvictionOrderT::iterator i = evictionOrder.begin();
-		state typename EvictionOrderT::iterator iEnd = evictionOrder.begin();
+		state typename CacheT::iterator i = cache.begin();
 
-		while(i != iEnd) {
-			if(!i->item.evictable()) {
-				wait(i->item.onEvictable());
+		while(i != cache.end()) {
+			if(!i->second.item.evictable()) {
+				wait(i->second.item.onEvictable());
 			}
 			++i;
 		}
 
-		evictionOrder.clear();
 		cache.clear();
 
 		return Void();
@@ -857,19 +886,45 @@ public:
 	}
 
 	int count() const {
-		ASSERT(evictionOrder.size() == cache.size());
-		return evictionOrder.size();
+		ASSERT(lists[PROBATION].size() + lists[PROTECTED].size() + lists[INTERNAL].size() == cache.size());
+		return cache.size();
+	}
+
+	void toTraceEvent(TraceEvent &e) const {
+		e.detail("Pages", cache.size());
+		e.detail("ProtectedPages", lists[PROTECTED].size());
+		e.detail("InternalPages", lists[INTERNAL].size());
+		e.detail("LeafHits", cacheHits[0]);
+		e.detail("LeafMisses", cacheMisses[0]);
+		e.detail("LeafEvictions", evictions[0]);
+		e.detail("InternalHits", cacheHits[1]);
+		e.detail("InternalMisses", cacheMisses[1]);
+		e.detail("InternalEvictions", evictions[1]);
+		e.detail("NoHitEvictions", noHitEvictions);
+		e.detail("FailedEvictions", failedEvictions);
 	}
 
 private:
 	int64_t sizeLimit;
-	int64_t cacheHits;
-	int64_t cacheMisses;
+	// Indexed by whether the entry is internal
+	int64_t cacheHits[2];
+	int64_t cacheMisses[2];
+	int64_t evictions[2];
 	int64_t noHitEvictions;
 	int64_t failedEvictions;
 
 	CacheT cache;
-	EvictionOrderT evictionOrder;
+	EvictionOrderT lists[SEGMENT_COUNT];
+
+	void demoteProtected() {
+		int64_t protectedLimit = sizeLimit * SERVER_KNOBS->REDWOOD_PAGE_CACHE_PROTECTED_FRACTION;
+		while(!lists[PROTECTED].empty() && lists[PROTECTED].size() + lists[INTERNAL].size() > protectedLimit) {
+			Entry &entry = lists[PROTECTED].front();
+			lists[PROTECTED].pop_front();
+			entry.segment = PROBATION;
+			lists[PROBATION].push_back(entry);
+		}
+	}
 };
 
 ACTOR template<class T> Future<T> forwardError(Future<T> f, Promise<Void> target) {
@@ -938,13 +993,27 @@ public:
 	// If the file already exists, pageSize might be different than desiredPageSize
 	// Use pageCacheSizeBytes == 0 for default
 	DWALPager(int desiredPageSize, std::string filename, int64_t pageCacheSizeBytes)
-		: desiredPageSize(desiredPageSize), filename(filename), pHeader(nullptr), pageCacheBytes(pageCacheSizeBytes)
+		: desiredPageSize(desiredPageSize), filename(filename), pHeader(nullptr), pageCacheBytes(pageCacheSizeBytes),
+		  multiPageReads(0), multiPageReadPages(0)
  	{
 		if(pageCacheBytes == 0) {
 			pageCacheBytes = g_network->isSimulated() ? (BUGGIFY ? FLOW_KNOBS->BUGGIFY_SIM_PAGE_CACHE_4K : FLOW_KNOBS->SIM_PAGE_CACHE_4K) : FLOW_KNOBS->PAGE_CACHE_4K;
 		}
 		commitFuture = Void();
 		recoverFuture = forwardError(recover(this), errorPromise);
+		metricsFuture = logMetrics(this);
+	}
+
+	ACTOR static Future<Void> logMetrics(DWALPager *self) {
+		loop {
+			wait(delay(SERVER_KNOBS->REDWOOD_METRICS_INTERVAL));
+			TraceEvent e("RedwoodPageCacheMetrics");
+			e.detail("Filename", self->filename);
+			self->pageCache.toTraceEvent(e);
+			e.detail("MultiPageReads", self->multiPageReads);
+			e.detail("MultiPageReadPages", self->multiPageReadPages);
+			e.trackLatest(self->filename + "/RedwoodPageCacheMetrics");
+		}
 	}
 
 	void setPageSize(int size) {
@@ -1186,7 +1255,7 @@ public:
 
 	void updatePage(LogicalPageID pageID, Reference<IPage> data) override {
 		// Get the cache entry for this page, without counting it as a cache hit as we're replacing its contents now
-		PageCacheEntry &cacheEntry = pageCache.get(pageID, true);
+		PageCacheEntry &cacheEntry = pageCache.get(pageID, PageCacheHint::NoHit);
 		debug_printf("DWALPager(%s) op=write %s cached=%d reading=%d writing=%d\n", filename.c_str(), toString(pageID).c_str(), cacheEntry.initialized(), cacheEntry.initialized() && cacheEntry.reading(), cacheEntry.initialized() && cacheEntry.writing());
 
 		// If the page is still being read then it's not also being written because a write places
@@ -1276,30 +1345,59 @@ public:
 
 		// Header reads are checked explicitly during recovery
 		if(!header) {
-			Page *p = (Page *)page.getPtr();
-			if(!p->verifyChecksum(pageID)) {
-				debug_printf("DWALPager(%s) checksum failed for %s\n", self->filename.c_str(), toString(pageID).c_str());
-				Error e = checksum_failed();
-				TraceEvent(SevError, "DWALPagerChecksumFailed")
-					.detail("Filename", self->filename.c_str())
-					.detail("PageID", pageID)
-					.detail("PageSize", self->physicalPageSize)
-					.detail("Offset", pageID * self->physicalPageSize)
-					.detail("CalculatedChecksum", p->calculateChecksum(pageID))
-					.detail("ChecksumInPage", p->getChecksum())
-					.error(e);
-				throw e;
-			}
+			verifyChecksum(self, page, pageID);
 		}
 		return page;
 	}
 
+	// Reads count pages which are adjacent in the page file, starting at pageID, with one read
+	ACTOR static Future<std::vector<Reference<IPage>>> readPhysicalPages(DWALPager *self, PhysicalPageID pageID, int count) {
+		if(g_network->getCurrentTask() > TaskPriority::DiskRead) {
+			wait(delay(0, TaskPriority::DiskRead));
+		}
+
+		state int bytes = count * self->physicalPageSize;
+		state std::shared_ptr<uint8_t> buffer((uint8_t *)aligned_alloc(smallestPhysicalBlock, bytes), aligned_free);
+		debug_printf("DWALPager(%s) op=readPhysicalPagesStart %s count=%d\n", self->filename.c_str(), toString(pageID).c_str(), count);
+
+		++self->multiPageReads;
+		self->multiPageReadPages += count;
+		int readBytes = wait(self->pageFile->read(buffer.get(), bytes, (int64_t)pageID * self->physicalPageSize));
+		debug_printf("DWALPager(%s) op=readPhysicalPagesComplete %s count=%d bytes=%d\n", self->filename.c_str(), toString(pageID).c_str(), count, readBytes);
+
+		std::vector<Reference<IPage>> pages;
+		for(int i = 0; i < count; ++i) {
+			Reference<IPage> page = self->newPageBuffer();
+			memcpy(page->mutate(), buffer.get() + i * self->physicalPageSize, self->physicalPageSize);
+			verifyChecksum(self, page, pageID + i);
+			pages.push_back(page);
+		}
+		return pages;
+	}
+
+	static void verifyChecksum(DWALPager *self, Reference<IPage> const &page, PhysicalPageID pageID) {
+		Page *p = (Page *)page.getPtr();
+		if(!p->verifyChecksum(pageID)) {
+			debug_printf("DWALPager(%s) checksum failed for %s\n", self->filename.c_str(), toString(pageID).c_str());
+			Error e = checksum_failed();
+			TraceEvent(SevError, "DWALPagerChecksumFailed")
+				.detail("Filename", self->filename.c_str())
+				.detail("PageID", pageID)
+				.detail("PageSize", self->physicalPageSize)
+				.detail("Offset", pageID * self->physicalPageSize)
+				.detail("CalculatedChecksum", p->calculateChecksum(pageID))
+				.detail("ChecksumInPage", p->getChecksum())
+				.error(e);
+			throw e;
+		}
+	}
+
 	static Future<Reference<IPage>> readHeaderPage(DWALPager *self, PhysicalPageID pageID) {
 		return readPhysicalPage(self, pageID, true);
 	}
 
 	// Reads the most recent version of pageID either committed or written using updatePage()
-	Future<Reference<IPage>> readPage(LogicalPageID pageID, bool cacheable, bool noHit = false) override {
+	Future<Reference<IPage>> readPage(LogicalPageID pageID, bool cacheable, PageCacheHint hint = PageCacheHint::Normal) override {
 		// Use cached page if present, without triggering a cache hit.
 		// Otherwise, read the page and return it but don't add it to the cache
 		if(!cacheable) {
@@ -1314,8 +1412,8 @@ public:
 			return forwardError(readPhysicalPage(this, (PhysicalPageID)pageID), errorPromise);
 		}
 
-		PageCacheEntry &cacheEntry = pageCache.get(pageID, noHit);
-		debug_printf("DWALPager(%s) op=read %s cached=%d reading=%d writing=%d noHit=%d\n", filename.c_str(), toString(pageID).c_str(), cacheEntry.initialized(), cacheEntry.initialized() && cacheEntry.reading(), cacheEntry.initialized() && cacheEntry.writing(), noHit);
+		PageCacheEntry &cacheEntry = pageCache.get(pageID, hint);
+		debug_printf("DWALPager(%s) op=read %s cached=%d reading=%d writing=%d hint=%d\n", filename.c_str(), toString(pageID).c_str(), cacheEntry.initialized(), cacheEntry.initialized() && cacheEntry.reading(), cacheEntry.initialized() && cacheEntry.writing(), (int)hint);
 
 		if(!cacheEntry.initialized()) {
 			debug_printf("DWALPager(%s) issuing actual read of %s\n", filename.c_str(), toString(pageID).c_str());
@@ -1327,7 +1425,8 @@ public:
 		return cacheEntry.readFuture;
 	}
 
-	Future<Reference<IPage>> readPageAtVersion(LogicalPageID pageID, Version v, bool cacheable, bool noHit) {
+	// Returns the page holding pageID's version at v
+	LogicalPageID getRemappedPageID(LogicalPageID pageID, Version v) {
 		auto i = remappedPages.find(pageID);
 
 		if(i != remappedPages.end()) {
@@ -1335,14 +1434,71 @@ public:
 			if(j != i->second.begin()) {
 				--j;
 				debug_printf("DWALPager(%s) read %s @%" PRId64 " -> %s\n", filename.c_str(), toString(pageID).c_str(), v, toString(j->second).c_str());
-				pageID = j->second;
+				return j->second;
 			}
 		}
 		else {
 			debug_printf("DWALPager(%s) read %s @%" PRId64 " (not remapped)\n", filename.c_str(), toString(pageID).c_str(), v);
 		}
 
-		return readPage(pageID, cacheable, noHit);
+		return pageID;
+	}
+
+	Future<Reference<IPage>> readPageAtVersion(LogicalPageID pageID, Version v, bool cacheable, PageCacheHint hint) {
+		return readPage(getRemappedPageID(pageID, v), cacheable, hint);
+	}
+
+	// Like readPageAtVersion() for each of pageIDs, except that each run of pages which are not cached and are adjacent
+	// in the page file is read with one read.  The blocks of a multi-block B-tree page are allocated one after another,
+	// and freed and reused together, so they are usually adjacent.
+	std::vector<Future<Reference<IPage>>> readPagesAtVersion(VectorRef<LogicalPageID> pageIDs, Version v, bool cacheable, PageCacheHint hint) {
+		std::vector<Future<Reference<IPage>>> pages(pageIDs.size());
+
+		// Index in pageIDs and page to read of each page that is not cached
+		std::vector<std::pair<int, LogicalPageID>> uncached;
+		for(int i = 0; i < pageIDs.size(); ++i) {
+			LogicalPageID pageID = getRemappedPageID(pageIDs[i], v);
+			if(pageCache.exists(pageID)) {
+				pages[i] = readPage(pageID, cacheable, hint);
+			}
+			else {
+				uncached.push_back({i, pageID});
+			}
+		}
+
+		int start = 0;
+		while(start < uncached.size()) {
+			int end = start + 1;
+			while(end < uncached.size() && uncached[end].second == uncached[end - 1].second + 1) {
+				++end;
+			}
+
+			if(end - start == 1) {
+				pages[uncached[start].first] = readPage(uncached[start].second, cacheable, hint);
+			}
+			else {
+				debug_printf("DWALPager(%s) op=readRun %s count=%d\n", filename.c_str(), toString(uncached[start].second).c_str(), end - start);
+				Future<std::vector<Reference<IPage>>> run = forwardError(readPhysicalPages(this, (PhysicalPageID)uncached[start].second, end - start), errorPromise);
+				for(int i = start; i < end; ++i) {
+					int offset = i - start;
+					Future<Reference<IPage>> page = map(run, [=](std::vector<Reference<IPage>> const &runPages) {
+						return runPages[offset];
+					});
+					if(cacheable) {
+						PageCacheEntry &cacheEntry = pageCache.get(uncached[i].second, hint);
+						if(!cacheEntry.initialized()) {
+							cacheEntry.readFuture = page;
+							cacheEntry.writeFuture = Void();
+						}
+						page = cacheEntry.readFuture;
+					}
+					pages[uncached[i].first] = page;
+				}
+			}
+			start = end;
+		}
+
+		return pages;
 	}
 
 	// Get snapshot as of the most recent committed version of the pager
@@ -1516,6 +1672,7 @@ public:
 		self->commitFuture.cancel();
 		debug_printf("DWALPager(%s) shutdown cancel remap\n", self->filename.c_str());
 		self->remapUndoFuture.cancel();
+		self->metricsFuture.cancel();
 
 		if(self->errorPromise.canBeSet()) {
 			debug_printf("DWALPager(%s) shutdown sending error\n", self->filename.c_str());
@@ -1562,6 +1719,8 @@ public:
 		int64_t free;
 		int64_t total;
 		g_network->getDiskBytes(parentDirectory(filename), free, total);
+		// B-tree pages of several blocks are made of that many pages, each allocated, freed and reused on its own, so
+		// counting pages counts every block of them and free pages never need to be adjacent to be reused.
 		int64_t pagerSize = pHeader->pageCount * physicalPageSize;
 
 		// It is not exactly known how many pages on the delayed free list are usable as of right now.  It could be known,
@@ -1690,12 +1849,17 @@ private:
 	typedef ObjectCache<LogicalPageID, PageCacheEntry> PageCacheT;
 	PageCacheT pageCache;
 
+	// Reads of runs of adjacent pages, and the pages they read
+	int64_t multiPageReads;
+	int64_t multiPageReadPages;
+
 	Promise<Void> closedPromise;
 	Promise<Void> errorPromise; 
 	Future<Void> commitFuture;
 	SignalableActorCollection operations;
 	Future<Void> recoverFuture;
 	Future<Void> remapUndoFuture;
+	Future<Void> metricsFuture;
 	bool remapUndoStop;
 
 	Reference<IAsyncFile> pageFile;
@@ -1738,15 +1902,28 @@ public:
 	virtual ~DWALPagerSnapshot() {
 	}
 
-	Future<Reference<const IPage>> getPhysicalPage(LogicalPageID pageID, bool cacheable, bool noHit) override {
+	Future<Reference<const IPage>> getPhysicalPage(LogicalPageID pageID, bool cacheable, PageCacheHint hint) override {
 		if(expired.isError()) {
 			throw expired.getError();
 		}
-		return map(pager->readPageAtVersion(pageID, version, cacheable, noHit), [=](Reference<IPage> p) {
+		return map(pager->readPageAtVersion(pageID, version, cacheable, hint), [=](Reference<IPage> p) {
 			return Reference<const IPage>(p);
 		});
 	}
 
+	std::vector<Future<Reference<const IPage>>> getPhysicalPages(VectorRef<LogicalPageID> pageIDs, bool cacheable, PageCacheHint hint) override {
+		if(expired.isError()) {
+			throw expired.getError();
+		}
+		std::vector<Future<Reference<const IPage>>> pages;
+		for(auto &f : pager->readPagesAtVersion(pageIDs, version, cacheable, hint)) {
+			pages.push_back(map(f, [=](Reference<IPage> p) {
+				return Reference<const IPage>(p);
+			}));
+		}
+		return pages;
+	}
+
 	Key getMetaKey() const override {
 		return metaKey;
 	}
@@ -2085,6 +2262,14 @@ struct RedwoodRecordRef {
 		return chunk.total != 0;
 	}
 
+	// A value stored out of line in pages of its own is represented by a single record whose value locates those pages.
+	// It is marked by a chunk start that no part of a split value can have, as its chunk total is 0.
+	static constexpr uint32_t VALUE_PAGES_CHUNK_START = 0xffffff;
+
+	bool isValuePages() const {
+		return chunk.total == 0 && chunk.start == VALUE_PAGES_CHUNK_START;
+	}
+
 	// Generate a kv shard from a complete kv
 	RedwoodRecordRef split(int start, int len) {
 		ASSERT(!isMultiPart());
@@ -2337,12 +2522,16 @@ struct RedwoodRecordRef {
 			// Get value length
 			int valueLen = (flags & HAS_VALUE) ? r.read<uint8_t>() : 0;
 
-			// Skip key suffix bytes and int field suffix bytes
+			// Skip key suffix bytes
 			r.readString(keySuffixLen);
-			r.readBytes(flags & INT_FIELD_SUFFIX_BITS);
 
-			// Return record with only the optional value populated
-			return RedwoodRecordRef(StringRef(), 0, (flags & HAS_VALUE ? r.readString(valueLen) : Optional<ValueRef>()) );
+			// The int field suffix of a record for a value stored out of line is always its whole chunk total and start
+			int intFieldSuffixLen = flags & INT_FIELD_SUFFIX_BITS;
+			const byte *intFieldSuffix = r.readBytes(intFieldSuffixLen);
+			bool valuePages = !(flags & HAS_VERSION) && intFieldSuffixLen == 6 && memcmp(intFieldSuffix, "\x00\x00\x00\xff\xff\xff", 6) == 0;
+
+			// Return record with only the optional value and whether it locates value pages populated
+			return RedwoodRecordRef(StringRef(), 0, (flags & HAS_VALUE ? r.readString(valueLen) : Optional<ValueRef>()), 0, valuePages ? VALUE_PAGES_CHUNK_START : 0);
 		}
 	};
 #pragma pack(pop)
@@ -2383,6 +2572,9 @@ struct RedwoodRecordRef {
 
 		// Size of prefix length
 		int prefixLen = getCommonPrefixLen(base, skipLen);
+		if(isValuePages()) {
+			prefixLen = std::min(prefixLen, key.size());
+		}
 		size += (worstCase || prefixLen >= 128) ? 2 : 1;
 
 		int intFieldPrefixLen;
@@ -2438,6 +2630,12 @@ struct RedwoodRecordRef {
 			commonPrefix = getCommonPrefixLen(base, 0);
 		}
 
+		// A record for a value stored out of line never borrows int fields from its base, so its int field suffix
+		// always identifies it, even to a DeltaValueOnly reader which does not know the base.
+		if(isValuePages()) {
+			commonPrefix = std::min(commonPrefix, key.size());
+		}
+
 		Writer w(d.data());
 
 		// prefix len
@@ -2600,6 +2798,61 @@ struct BTreePage {
 	}
 };
 
+// A BTreePage stored zlib-compressed in fewer blocks than it takes decoded.  Its first byte is zero where a BTreePage has
+// its height, which is at least 1, so compressed and plain pages are told apart without a per-page format version.
+#pragma pack(push,1)
+struct CompressedBTreePage {
+	uint8_t zero;
+	uint32_t logicalSize;    // Bytes of the decoded page, including the free space its tree can grow into
+	uint32_t compressedSize; // Bytes of compressed data after this header
+
+	static bool isCompressed(const uint8_t *page) {
+		return page[0] == 0;
+	}
+
+	uint8_t * data() {
+		return (uint8_t *)(this + 1);
+	}
+
+	const uint8_t * data() const {
+		return (const uint8_t *)(this + 1);
+	}
+};
+#pragma pack(pop)
+
+// Compresses size bytes from src into at most capacity bytes at dst.  Returns the compressed size, or 0 if it does not fit.
+static int compressPageBytes(const uint8_t *src, int size, uint8_t *dst, int capacity, int level) {
+	z_stream z;
+	memset(&z, 0, sizeof(z));
+	if(deflateInit(&z, level) != Z_OK) {
+		return 0;
+	}
+	z.next_in = (Bytef *)src;
+	z.avail_in = size;
+	z.next_out = dst;
+	z.avail_out = capacity;
+	int result = deflate(&z, Z_FINISH);
+	int written = capacity - z.avail_out;
+	deflateEnd(&z);
+	return result == Z_STREAM_END ? written : 0;
+}
+
+// Decompresses size bytes from src into dst, which has room for capacity bytes.  Returns the decompressed size.
+static int decompressPageBytes(const uint8_t *src, int size, uint8_t *dst, int capacity) {
+	z_stream z;
+	memset(&z, 0, sizeof(z));
+	ASSERT(inflateInit(&z) == Z_OK);
+	z.next_in = (Bytef *)src;
+	z.avail_in = size;
+	z.next_out = dst;
+	z.avail_out = capacity;
+	int result = inflate(&z, Z_FINISH);
+	int written = capacity - z.avail_out;
+	inflateEnd(&z);
+	ASSERT(result == Z_STREAM_END);
+	return written;
+}
+
 static void makeEmptyRoot(Reference<IPage> page) {
 	BTreePage *btpage = (BTreePage *)page->begin();
 	btpage->height = 1;
@@ -2704,10 +2957,17 @@ public:
 
 #pragma pack(push, 1)
 	struct MetaKey {
-		static constexpr int FORMAT_VERSION = 4;
+		static constexpr int FORMAT_VERSION = 7;
+		enum EFlags {
+			HAS_VALUE_PAGES = 0x01  // Set once any value has been stored out of line, and never cleared
+		};
 		// This serves as the format version for the entire tree, individual pages will not be versioned
 		uint16_t formatVersion;
 		uint8_t height;
+		uint8_t flags;
+		// Blocks that leaf and internal pages are filled to before they are split, fixed when the tree is created
+		uint8_t leafPageBlocks;
+		uint8_t internalPageBlocks;
 		LazyDeleteQueueT::QueueState lazyDeleteQueue;
 		InPlaceArray<LogicalPageID> root;
 
@@ -2720,8 +2980,12 @@ public:
 			ASSERT(formatVersion == FORMAT_VERSION);
 		}
 
+		bool hasValuePages() const {
+			return flags & HAS_VALUE_PAGES;
+		}
+
 		std::string toString() {
-			return format("{height=%d  formatVersion=%d  root=%s  lazyDeleteQueue=%s}", (int)height, (int)formatVersion, ::toString(root.get()).c_str(), lazyDeleteQueue.toString().c_str());
+			return format("{height=%d  formatVersion=%d  flags=0x%x  leafPageBlocks=%d  internalPageBlocks=%d  root=%s  lazyDeleteQueue=%s}", (int)height, (int)formatVersion, (int)flags, (int)leafPageBlocks, (int)internalPageBlocks, ::toString(root.get()).c_str(), lazyDeleteQueue.toString().c_str());
 		}
 
 	};
@@ -2753,11 +3017,16 @@ public:
 		int64_t commitToPage;
 		int64_t commitToPageStart;
 		int64_t pageUpdates;
+		int64_t compressedPageWrites;
+		int64_t compressedBlocksSaved;
+		int64_t pageDecompressions;
+		int64_t valuePageWrites;
+		int64_t valuePageReads;
 		double startTime;
 
 		std::string toString(bool clearAfter = false) {
-			const char *labels[] = {"set", "clear", "clearSingleKey", "get", "getRange", "commit", "pageReads", "extPageRead", "pagePreloads", "extPagePreloads", "pageWrite", "extPageWrite", "commitPage", "commitPageStart", "pageUpdates"};
-			const int64_t values[] = {sets, clears, clearSingleKey, gets, getRanges, commits, pageReads, extPageReads, pagePreloads, extPagePreloads, pageWrites, extPageWrites, commitToPage, commitToPageStart, pageUpdates};
+			const char *labels[] = {"set", "clear", "clearSingleKey", "get", "getRange", "commit", "pageReads", "extPageRead", "pagePreloads", "extPagePreloads", "pageWrite", "extPageWrite", "commitPage", "commitPageStart", "pageUpdates", "compressedPageWrite", "compressedBlocksSaved", "pageDecompress", "valuePageWrite", "valuePageRead"};
+			const int64_t values[] = {sets, clears, clearSingleKey, gets, getRanges, commits, pageReads, extPageReads, pagePreloads, extPagePreloads, pageWrites, extPageWrites, commitToPage, commitToPageStart, pageUpdates, compressedPageWrites, compressedBlocksSaved, pageDecompressions, valuePageWrites, valuePageReads};
 
 			double elapsed = now() - startTime;
 			std::string s;
@@ -2903,33 +3172,43 @@ public:
 				const BTreePage &btPage = *(BTreePage *)p->begin();
 				debug_printf("LazyDelete: processing %s\n", toString(entry).c_str());
 
-				// Level 1 (leaf) nodes should never be in the lazy delete queue
-				ASSERT(btPage.height > 1);
-				
 				// Iterate over page entries, skipping key decoding using BTreePage::ValueTree which uses
 				// RedwoodRecordRef::DeltaValueOnly as the delta type type to skip key decoding
 				BTreePage::ValueTree::Mirror reader(&btPage.valueTree(), &dbBegin, &dbEnd);
 				auto c = reader.getCursor();
-				ASSERT(c.moveFirst());
 				Version v = entry.version;
-				while(1) {
-					if(c.get().value.present()) {
-						BTreePageID btChildPageID = c.get().getChildPage();
-						// If this page is height 2, then the children are leaves so free
-						if(btPage.height == 2) {
-							debug_printf("LazyDelete: freeing child %s\n", toString(btChildPageID).c_str());
-							self->freeBtreePage(btChildPageID, v);
-							freedPages += btChildPageID.size();
+
+				// Level 1 (leaf) nodes are only in the lazy delete queue if they could locate value pages, which are freed here
+				if(btPage.isLeaf()) {
+					ASSERT(self->m_header.hasValuePages());
+					bool more = c.moveFirst();
+					while(more) {
+						freedPages += self->freeValuePages(c.get(), v);
+						more = c.moveNext();
+					}
+				}
+				else {
+					ASSERT(c.moveFirst());
+					while(1) {
+						if(c.get().value.present()) {
+							BTreePageID btChildPageID = c.get().getChildPage();
+							// If this page is height 2, then the children are leaves so free them, unless they could locate
+							// value pages
+							if(btPage.height == 2 && !self->m_header.hasValuePages()) {
+								debug_printf("LazyDelete: freeing child %s\n", toString(btChildPageID).c_str());
+								self->freeBtreePage(btChildPageID, v);
+								freedPages += btChildPageID.size();
+							}
+							else {
+								// Otherwise, queue them for lazy delete.
+								debug_printf("LazyDelete: queuing child %s\n", toString(btChildPageID).c_str());
+								self->m_lazyDeleteQueue.pushFront(LazyDeleteQueueEntry{v, btChildPageID});
+							}
 						}
-						else {
-							// Otherwise, queue them for lazy delete.
-							debug_printf("LazyDelete: queuing child %s\n", toString(btChildPageID).c_str());
-							self->m_lazyDeleteQueue.pushFront(LazyDeleteQueueEntry{v, btChildPageID});
+						if(!c.moveNext()) {
+							break;
 						}
 					}
-					if(!c.moveNext()) {
-						break;
-					}
 				}
 
 				// Free the page, now that its children have either been freed or queued
@@ -2964,6 +3243,9 @@ public:
 			debug_printf("new root %s\n", toString(newRoot).c_str());
 			self->m_header.root.set(newRoot, sizeof(headerSpace) - sizeof(m_header));
 			self->m_header.height = 1;
+			self->m_header.flags = 0;
+			self->m_header.leafPageBlocks = self->clampPageBlocks(SERVER_KNOBS->REDWOOD_LEAF_PAGE_BLOCKS);
+			self->m_header.internalPageBlocks = self->clampPageBlocks(SERVER_KNOBS->REDWOOD_INTERNAL_PAGE_BLOCKS);
 			++latest;
 			Reference<IPage> page = self->m_pager->newPageBuffer();
 			makeEmptyRoot(page);
@@ -3466,15 +3748,65 @@ private:
 	LazyDeleteQueueT m_lazyDeleteQueue;
 	int m_maxPartSize;
 
+	// Returns blocks limited to the number of blocks a BTree page can span
+	int clampPageBlocks(int blocks) {
+		return std::max(1, std::min<int>(blocks, (BTreePage::BinaryTree::MaximumTreeSize() + sizeof(BTreePage)) / m_pager->getUsablePageSize()));
+	}
+
 	// Writes entries to 1 or more pages and return a vector of boundary keys with their IPage(s)
+	// Splits a BTree page taking logicalSize bytes into pager blocks.  With compression enabled, a page of more than one
+	// block is stored compressed if that saves a block, and otherwise, as when it hardly compresses, as it is.
+	std::vector<Reference<IPage>> makeBlocks(const BTreePage *btPage, int logicalSize) {
+		int blockSize = m_pager->getUsablePageSize();
+		int blockCount = logicalSize / blockSize;
+		ASSERT(blockCount * blockSize == logicalSize);
+
+		const uint8_t *src = (const uint8_t *)btPage;
+		int size = logicalSize;
+		std::unique_ptr<uint8_t[]> compressed;
+		if(SERVER_KNOBS->REDWOOD_PAGE_COMPRESSION_LEVEL > 0 && blockCount > 1) {
+			int capacity = (blockCount - 1) * blockSize;
+			compressed.reset(new uint8_t[capacity]);
+			CompressedBTreePage *cPage = (CompressedBTreePage *)compressed.get();
+			int compressedSize = compressPageBytes(src, btPage->size(), cPage->data(), capacity - sizeof(CompressedBTreePage), SERVER_KNOBS->REDWOOD_PAGE_COMPRESSION_LEVEL);
+			if(compressedSize > 0) {
+				cPage->zero = 0;
+				cPage->logicalSize = logicalSize;
+				cPage->compressedSize = compressedSize;
+				src = compressed.get();
+				size = sizeof(CompressedBTreePage) + compressedSize;
+			}
+		}
+
+		std::vector<Reference<IPage>> pages;
+		for(int offset = 0; offset < size; offset += blockSize) {
+			Reference<IPage> page = m_pager->newPageBuffer();
+			int bytes = std::min(blockSize, size - offset);
+			memcpy(page->mutate(), src + offset, bytes);
+			memset(page->mutate() + bytes, 0, blockSize - bytes);
+			pages.push_back(std::move(page));
+		}
+
+		if(pages.size() < blockCount) {
+			++counts.compressedPageWrites;
+			counts.compressedBlocksSaved += blockCount - pages.size();
+		}
+		return pages;
+	}
+
 	ACTOR static Future<Standalone<VectorRef<RedwoodRecordRef>>> writePages(VersionedBTree *self, bool minimalBoundaries, const RedwoodRecordRef *lowerBound, const RedwoodRecordRef *upperBound, VectorRef<RedwoodRecordRef> entries, int height, Version v, BTreePageID previousID) {
 		ASSERT(entries.size() > 0);
 		state Standalone<VectorRef<RedwoodRecordRef>> records;
 
 		// This is how much space for the binary tree exists in the page, after the header
 		state int blockSize = self->m_pager->getUsablePageSize();
-		state int pageSize = blockSize - sizeof(BTreePage);
-		state int blockCount = 1;
+		// Pages are filled to the number of blocks set for their level, and with compression enabled leaf pages start
+		// out at least REDWOOD_COMPRESSED_PAGE_BLOCKS large, so that they have room to shrink when written
+		state int blockCount = height == 1 ? self->m_header.leafPageBlocks : self->m_header.internalPageBlocks;
+		if(minimalBoundaries && SERVER_KNOBS->REDWOOD_PAGE_COMPRESSION_LEVEL > 0) {
+			blockCount = self->clampPageBlocks(std::max(blockCount, SERVER_KNOBS->REDWOOD_COMPRESSED_PAGE_BLOCKS));
+		}
+		state int pageSize = blockSize * blockCount - sizeof(BTreePage);
 
 		state int kvBytes = 0;
 		state int compressedBytes = BTreePage::BinaryTree::GetTreeOverhead();
@@ -3592,18 +3924,15 @@ private:
 					ASSERT(false);
 				}
 
-				// Create chunked pages
+				// Create chunked pages, of only as many blocks as the page's contents need.  In-place updates must then
+				// stay within those blocks, so the tree's free space no longer counts the blocks that are left out.
 				// TODO: Avoid copying page bytes, but this is not trivial due to how pager checksums are currently handled.
 				if(blockCount != 1) {
+					int usedBlocks = (sizeof(BTreePage) + written + blockSize - 1) / blockSize;
+					btPage->tree().nodeBytesFree -= (blockCount - usedBlocks) * blockSize;
 					// Mark the slack in the page buffer as defined
 					VALGRIND_MAKE_MEM_DEFINED(((uint8_t *)btPage) + written, (blockCount * blockSize) - written);
-					const uint8_t *rptr = (const uint8_t *)btPage;
-					for(int b = 0; b < blockCount; ++b) {
-						Reference<IPage> page = self->m_pager->newPageBuffer();
-						memcpy(page->mutate(), rptr, blockSize);
-						rptr += blockSize;
-						pages.push_back(std::move(page));
-					}
+					pages = self->makeBlocks(btPage, usedBlocks * blockSize);
 					delete [] (uint8_t *)btPage;
 				}
 
@@ -3684,6 +4013,10 @@ private:
 
 	class SuperPage : public IPage, ReferenceCounted<SuperPage>, public FastAllocated<SuperPage>{
 	public:
+		explicit SuperPage(int size) : m_size(size) {
+			m_data = new uint8_t[m_size];
+		}
+
 		SuperPage(std::vector<Reference<const IPage>> pages) {
 			int blockSize = pages.front()->size();
 			m_size = blockSize * pages.size();
@@ -3729,7 +4062,42 @@ private:
 		int m_size;
 	};
 
-	ACTOR static Future<Reference<const IPage>> readPage(Reference<IPagerSnapshot> snapshot, BTreePageID id, const RedwoodRecordRef *lowerBound, const RedwoodRecordRef *upperBound, bool forLazyDelete = false) {
+	// Returns the BTreePage stored compressed in pages.  The decoded page is kept with the first page, so it is decoded
+	// again only once that leaves the pager's cache or is replaced.
+	static Reference<const IPage> decompressPage(std::vector<Reference<const IPage>> const &pages) {
+		const IPage &first = *pages.front();
+		if(first.userData != nullptr) {
+			return *(Reference<const IPage> *)first.userData;
+		}
+
+		const CompressedBTreePage *cPage = (const CompressedBTreePage *)first.begin();
+		int size = sizeof(CompressedBTreePage) + cPage->compressedSize;
+		std::unique_ptr<uint8_t[]> joined;
+		if(pages.size() > 1) {
+			joined.reset(new uint8_t[size]);
+			uint8_t *wptr = joined.get();
+			for(int offset = 0; offset < size; offset += first.size()) {
+				int bytes = std::min(first.size(), size - offset);
+				memcpy(wptr, pages[offset / first.size()]->begin(), bytes);
+				wptr += bytes;
+			}
+			cPage = (const CompressedBTreePage *)joined.get();
+		}
+		ASSERT(size <= first.size() * pages.size());
+
+		SuperPage *decoded = new SuperPage(cPage->logicalSize);
+		int written = decompressPageBytes(cPage->data(), cPage->compressedSize, decoded->mutate(), decoded->size());
+		// Only the used part of the page was compressed; the rest is free space for its tree
+		memset(decoded->mutate() + written, 0, decoded->size() - written);
+		++counts.pageDecompressions;
+
+		Reference<const IPage> page(decoded);
+		first.userData = new Reference<const IPage>(page);
+		first.userDataDestructor = [](void *ptr) { delete (Reference<const IPage> *)ptr; };
+		return page;
+	}
+
+	ACTOR static Future<Reference<const IPage>> readPage(Reference<IPagerSnapshot> snapshot, BTreePageID id, const RedwoodRecordRef *lowerBound, const RedwoodRecordRef *upperBound, bool forLazyDelete = false, PageCacheHint hint = PageCacheHint::Normal) {
 		if(!forLazyDelete) {
 			debug_printf("readPage() op=read %s @%" PRId64 " lower=%s upper=%s\n", toString(id).c_str(), snapshot->getVersion(), lowerBound->toString().c_str(), upperBound->toString().c_str());
 		}
@@ -3743,19 +4111,20 @@ private:
 
 		++counts.pageReads;
 		if(id.size() == 1) {
-			Reference<const IPage> p = wait(snapshot->getPhysicalPage(id.front(), !forLazyDelete, false));
-			page = p;
+			Reference<const IPage> p = wait(snapshot->getPhysicalPage(id.front(), !forLazyDelete, hint));
+			page = CompressedBTreePage::isCompressed(p->begin()) ? decompressPage({p}) : p;
 		}
 		else {
 			ASSERT(!id.empty());
 			counts.extPageReads += (id.size() - 1);
-			std::vector<Future<Reference<const IPage>>> reads;
-			for(auto &pageID : id) {
-				reads.push_back(snapshot->getPhysicalPage(pageID, !forLazyDelete, false));
-			}
-			std::vector<Reference<const IPage>> pages = wait(getAll(reads));
+			std::vector<Reference<const IPage>> pages = wait(getAll(snapshot->getPhysicalPages(id, !forLazyDelete, hint)));
 			// TODO:  Cache reconstituted super pages somehow, perhaps with help from the Pager.
-			page = Reference<const IPage>(new SuperPage(pages));
+			if(CompressedBTreePage::isCompressed(pages.front()->begin())) {
+				page = decompressPage(pages);
+			}
+			else {
+				page = Reference<const IPage>(new SuperPage(pages));
+			}
 		}
 
 		debug_printf("readPage() op=readComplete %s @%" PRId64 " \n", toString(id).c_str(), snapshot->getVersion());
@@ -3774,13 +4143,11 @@ private:
 		return page;
 	}
 
-	static void preLoadPage(IPagerSnapshot *snapshot, BTreePageID id) {
+	static void preLoadPage(IPagerSnapshot *snapshot, BTreePageID id, PageCacheHint hint = PageCacheHint::NoHit) {
 		++counts.pagePreloads;
 		counts.extPagePreloads += (id.size() - 1);
 	
-		for(auto pageID : id) {
-			snapshot->getPhysicalPage(pageID, true, true);
-		}
+		snapshot->getPhysicalPages(id, true, hint);
 	}
 
 	void freeBtreePage(BTreePageID btPageID, Version v) {
@@ -3790,37 +4157,130 @@ private:
 		}
 	}
 
+	// The value of a record for a value stored out of line is the value's size followed by the IDs of the pages holding
+	// it, in order.  The value is stored this way if it fills at least REDWOOD_LARGE_VALUE_PAGES pages and the page IDs
+	// fit in an unsplit record value.
+	bool isLargeValue(int size) {
+		if(SERVER_KNOBS->REDWOOD_LARGE_VALUE_PAGES <= 0 || size <= m_maxPartSize) {
+			return false;
+		}
+		int pageSize = m_pager->getUsablePageSize();
+		int pages = (size + pageSize - 1) / pageSize;
+		return size >= SERVER_KNOBS->REDWOOD_LARGE_VALUE_PAGES * pageSize && sizeof(uint32_t) + pages * sizeof(LogicalPageID) <= m_maxPartSize;
+	}
+
+	static BTreePageID getValuePageIDs(ValueRef pointer) {
+		return BTreePageID((LogicalPageID *)(pointer.begin() + sizeof(uint32_t)), (pointer.size() - sizeof(uint32_t)) / sizeof(LogicalPageID));
+	}
+
+	// Writes value to new pages and returns the record value which locates them
+	ACTOR static Future<Standalone<StringRef>> writeValuePages(VersionedBTree *self, ValueRef value) {
+		state int pageSize = self->m_pager->getUsablePageSize();
+		state int count = (value.size() + pageSize - 1) / pageSize;
+		state Standalone<StringRef> pointer = makeString(sizeof(uint32_t) + count * sizeof(LogicalPageID));
+		*(uint32_t *)mutateString(pointer) = value.size();
+		self->m_header.flags |= MetaKey::HAS_VALUE_PAGES;
+
+		state int i;
+		for(i = 0; i < count; ++i) {
+			LogicalPageID id = wait(self->m_pager->newPageID());
+			Reference<IPage> page = self->m_pager->newPageBuffer();
+			int offset = i * pageSize;
+			int len = std::min(pageSize, value.size() - offset);
+			memcpy(page->mutate(), value.begin() + offset, len);
+			memset(page->mutate() + len, 0, pageSize - len);
+			self->m_pager->updatePage(id, page);
+			((LogicalPageID *)(mutateString(pointer) + sizeof(uint32_t)))[i] = id;
+			++counts.valuePageWrites;
+		}
+
+		debug_printf("writeValuePages() %d bytes to %s\n", value.size(), toString(getValuePageIDs(pointer)).c_str());
+		return pointer;
+	}
+
+	// Reads the value located by pointer into arena.  The pages are read as a scan's are so that large values read
+	// once do not displace the tree's pages from the cache.
+	ACTOR static Future<ValueRef> readValuePages(Reference<IPagerSnapshot> snapshot, ValueRef pointer, Arena *arena) {
+		state int size = *(uint32_t *)pointer.begin();
+		std::vector<Future<Reference<const IPage>>> reads;
+		for(LogicalPageID id : getValuePageIDs(pointer)) {
+			reads.push_back(snapshot->getPhysicalPage(id, true, PageCacheHint::Scan));
+			++counts.valuePageReads;
+		}
+		std::vector<Reference<const IPage>> pages = wait(getAll(reads));
+
+		ValueRef value = makeString(size, *arena);
+		int offset = 0;
+		for(auto &page : pages) {
+			int len = std::min(page->size(), size - offset);
+			memcpy(mutateString(value) + offset, page->begin(), len);
+			offset += len;
+		}
+		ASSERT(offset == size);
+		return value;
+	}
+
+	// Frees the pages holding rec's value at v if it is stored out of line, returning how many were freed.  Only records
+	// being removed from the tree free their value pages, as rewritten leaves copy the records and so still reference them.
+	int freeValuePages(const RedwoodRecordRef &rec, Version v) {
+		if(!rec.isValuePages()) {
+			return 0;
+		}
+		debug_printf("freeValuePages() %s @%" PRId64 "\n", rec.toString().c_str(), v);
+		BTreePageID ids = getValuePageIDs(rec.value.get());
+		for(LogicalPageID id : ids) {
+			m_pager->freePage(id, v);
+		}
+		return ids.size();
+	}
+
+	// Deletes the subtree at id as of v.  Leaves are freed at once unless they could locate value pages, in which case
+	// they are queued like internal pages for the lazy delete queue to read and free them.
+	void clearSubtree(BTreePageID id, bool isLeaf, Version v) {
+		if(isLeaf && !m_header.hasValuePages()) {
+			freeBtreePage(id, v);
+		}
+		else {
+			m_lazyDeleteQueue.pushBack(LazyDeleteQueueEntry{v, id});
+		}
+	}
+
 	// Write new version of pageID at version v using page as its data.
 	// Attempts to reuse original id(s) in btPageID, returns BTreePageID.
 	ACTOR static Future<BTreePageID> updateBtreePage(VersionedBTree *self, BTreePageID oldID, Arena *arena, Reference<IPage> page, Version writeVersion) {
 		state BTreePageID newID;
-		newID.resize(*arena, oldID.size());
+		state std::vector<Reference<IPage>> pages;
+		state int i = 0;
 
-		if(oldID.size() == 1) {
-			LogicalPageID id = wait(self->m_pager->atomicUpdatePage(oldID.front(), page, writeVersion));
-			newID.front() = id;
+		// In-place updates are bounded by the page's free space, so never grow a page past its buffer
+		ASSERT(((const BTreePage *)page->begin())->size() <= page->size());
+
+		// A single block page is the pager's own buffer and is written as is
+		if(page->size() == self->m_pager->getUsablePageSize()) {
+			pages.push_back(page);
 		}
 		else {
-			state std::vector<Reference<IPage>> pages;
-			const uint8_t *rptr = page->begin();
-			int bytesLeft = page->size();
-			while(bytesLeft > 0) {
-				Reference<IPage> p = self->m_pager->newPageBuffer();
-				int blockSize = p->size();
-				memcpy(p->mutate(), rptr, blockSize);
-				rptr += blockSize;
-				bytesLeft -= blockSize;
-				pages.push_back(p);
-			}
-			ASSERT(pages.size() == oldID.size());
+			pages = self->makeBlocks((const BTreePage *)page->begin(), page->size());
+		}
 
+		if(pages.size() == oldID.size()) {
 			// Write pages, trying to reuse original page IDs
-			state int i = 0;
+			newID.resize(*arena, oldID.size());
 			for(; i < pages.size(); ++i) {
 				LogicalPageID id = wait(self->m_pager->atomicUpdatePage(oldID[i], pages[i], writeVersion));
 				newID[i] = id;
 			}
 		}
+		else {
+			// The page compressed into a different number of blocks than before, so it moves to new page IDs
+			self->freeBtreePage(oldID, writeVersion);
+			newID.resize(*arena, pages.size());
+			for(; i < pages.size(); ++i) {
+				LogicalPageID id = wait(self->m_pager->newPageID());
+				self->m_pager->updatePage(id, pages[i]);
+				newID[i] = id;
+			}
+		}
 
 		// Update activity counts
 		++counts.pageWrites;
@@ -3901,12 +4361,7 @@ private:
 		if(iMutationBoundary == iMutationBoundaryEnd) {
 			if(iMutationBoundary.mutation().boundaryChanged) {
 				debug_printf("%s lower and upper bound key/version match and key is modified so deleting page, returning %s\n", context.c_str(), toString(result).c_str());
-				if(isLeaf) {
-					self->freeBtreePage(rootID, writeVersion);
-				}
-				else {
-					self->m_lazyDeleteQueue.pushBack(LazyDeleteQueueEntry{writeVersion, rootID});
-				}
+				self->clearSubtree(rootID, isLeaf, writeVersion);
 				return result;
 			}
 
@@ -3975,12 +4430,7 @@ private:
 			// If subtree is cleared
 			if(cleared) {
 				debug_printf("%s %s cleared, deleting it, returning %s\n", context.c_str(), isLeaf ? "Page" : "Subtree", toString(result).c_str());
-				if(isLeaf) {
-					self->freeBtreePage(rootID, writeVersion);
-				}
-				else {
-					self->m_lazyDeleteQueue.pushBack(LazyDeleteQueueEntry{writeVersion, rootID});
-				}
+				self->clearSubtree(rootID, isLeaf, writeVersion);
 				return result;
 			}
 		}
@@ -4008,6 +4458,20 @@ private:
 
 		// Leaf Page
 		if(isLeaf) {
+			// The merge below cannot wait, so the large values it will set are first written to value pages of their own,
+			// in mutation order, and the records merged into the page locate them.
+			state std::vector<Future<Standalone<StringRef>>> valuePages;
+			for(auto i = iMutationBoundary; i != iMutationBoundaryEnd; ++i) {
+				if(i.mutation().boundarySet() && (i != iMutationBoundary || i.key() >= lowerBound->key) && self->isLargeValue(i.mutation().boundaryValue.get().size())) {
+					valuePages.push_back(writeValuePages(self, i.mutation().boundaryValue.get()));
+				}
+			}
+			wait(waitForAll(valuePages));
+			int nextValuePages = 0;
+
+			// Records removed by the merge free their value pages as of the version being written
+			writeVersion = self->getLastCommittedVersion() + 1;
+
 			// Try to update page unless it's an oversized page or empty or the boundaries have changed
 			// TODO: Caller already knows if boundaries are the same.
             bool updating = btPage->tree().numItems > 0 && !(*decodeLowerBound != *lowerBound || *decodeUpperBound != *upperBound);
@@ -4069,6 +4533,7 @@ private:
 					}
 					else {
 						changesMade = true;
+						self->freeValuePages(cursor.get(), writeVersion);
 						// If updating, erase from the page, otherwise do not add to the output set
 						if(updating) {
 							debug_printf("%s Erasing %s [existing, boundary start]\n", context.c_str(), cursor.get().toString().c_str());
@@ -4089,6 +4554,10 @@ private:
 					RedwoodRecordRef rec(iMutationBoundary.key(), 0, iMutationBoundary.mutation().boundaryValue.get());
 					changesMade = true;
 
+					if(self->isLargeValue(rec.value.get().size())) {
+						rec = RedwoodRecordRef(rec.key, 0, valuePages[nextValuePages++].get(), 0, RedwoodRecordRef::VALUE_PAGES_CHUNK_START);
+					}
+
 					if(rec.value.get().size() <= self->m_maxPartSize) {
 						// If updating, add to the page, else add to the output set
 						if(updating) {
@@ -4157,8 +4626,18 @@ private:
 						changesMade = true;
 					}
 
-					debug_printf("%s Seeking forward to next boundary (remove=%d updating=%d) %s\n", context.c_str(), remove, updating, iMutationBoundary.key().toString().c_str());
-					cursor.seekGreaterThanOrEqual(end, skipLen);
+					// Removed records must be visited if they could have value pages to free
+					if(remove && self->m_header.hasValuePages()) {
+						while(cursor.valid() && cursor.get().compare(end, skipLen) < 0) {
+							debug_printf("%s Skipped %s [existing, middle]\n", context.c_str(), cursor.get().toString().c_str());
+							self->freeValuePages(cursor.get(), writeVersion);
+							cursor.moveNext();
+						}
+					}
+					else {
+						debug_printf("%s Seeking forward to next boundary (remove=%d updating=%d) %s\n", context.c_str(), remove, updating, iMutationBoundary.key().toString().c_str());
+						cursor.seekGreaterThanOrEqual(end, skipLen);
+					}
 				}
 				else {
 					// Otherwise we must visit the records.  If updating, the visit is to erase them, and if doing a 
@@ -4166,6 +4645,7 @@ private:
 					while(cursor.valid() && cursor.get().compare(end, skipLen) < 0) {
 						if(updating) {
 							debug_printf("%s Erasing %s [existing, boundary start]\n", context.c_str(), cursor.get().toString().c_str());
+							self->freeValuePages(cursor.get(), writeVersion);
 							cursor.erase();
 							changesMade = true;
 						}
@@ -4190,6 +4670,13 @@ private:
 				// If we do have to remove the records and we are not updating, do nothing.
 				if(remove != updating) {
 					debug_printf("%s Ignoring remaining records, remove=%d updating=%d\n", context.c_str(), remove, updating);
+					// Unless they are being removed and could have value pages to free
+					if(remove && self->m_header.hasValuePages()) {
+						while(cursor.valid()) {
+							self->freeValuePages(cursor.get(), writeVersion);
+							cursor.moveNext();
+						}
+					}
 				}
 				else {
 					// If updating and the key is changing, we must visit the records to erase them.
@@ -4197,6 +4684,7 @@ private:
 					while(cursor.valid()) {
 						if(updating) {
 							debug_printf("%s Erasing %s and beyond [existing, matches changed upper mutation boundary]\n", context.c_str(), cursor.get().toString().c_str());
+							self->freeValuePages(cursor.get(), writeVersion);
 							cursor.erase();
 						}
 						else {
@@ -4221,8 +4709,6 @@ private:
 				debug_printf("%s Changes were made, writing.\n", context.c_str());
 			}
 
-			writeVersion = self->getLastCommittedVersion() + 1;
-
 			if(updating) {
 				const BTreePage::BinaryTree &deltaTree = ((const BTreePage *)newPage->begin())->tree();
 				if(deltaTree.numItems == 0) {
@@ -4387,8 +4873,12 @@ private:
 		self->m_pager->setOldestVersion(self->m_newOldestVersion);
 		debug_printf("%s: Beginning commit of version %" PRId64 ", new oldest version set to %" PRId64 "\n", self->m_name.c_str(), writeVersion, self->m_newOldestVersion);
 
+		// Cleared subtrees are freed from the lazy delete queue while this commit is written.  Once it is written, freeing
+		// stops when at least REDWOOD_LAZY_CLEAR_MIN_PAGES pages were freed, and it never frees more than
+		// REDWOOD_LAZY_CLEAR_MAX_PAGES, so a large clear is spread over many commits without lengthening any of them much.
+		// The queue's position is committed with the tree, so freeing resumes where it left off after a restart.
 		state bool lazyDeleteStop = false;
-		state Future<int> lazyDelete = incrementalSubtreeClear(self, &lazyDeleteStop);
+		state Future<int> lazyDelete = incrementalSubtreeClear(self, &lazyDeleteStop, SERVER_KNOBS->REDWOOD_LAZY_CLEAR_BATCH_SIZE, SERVER_KNOBS->REDWOOD_LAZY_CLEAR_MIN_PAGES, SERVER_KNOBS->REDWOOD_LAZY_CLEAR_MAX_PAGES);
 
 		// Get the latest version from the pager, which is what we will read at
 		state Version latestVersion = self->m_pager->getLatestVersion();
@@ -4487,24 +4977,31 @@ private:
 				return btPage()->isLeaf();
 			}
 
-			Future<Reference<PageCursor>> getChild(Reference<IPagerSnapshot> pager, int readAheadBytes = 0) {
+			// A scan moving from leaf to leaf reads the leaves as such, so they do not displace pages used more often
+			Future<Reference<PageCursor>> getChild(Reference<IPagerSnapshot> pager, int readAheadBytes = 0, bool scan = false, bool forward = true) {
 				ASSERT(!isLeaf());
 				BTreePage::BinaryTree::Cursor next = cursor;
 				next.moveNext();
 				const RedwoodRecordRef &rec = cursor.get();
 				BTreePageID id = rec.getChildPage();
-				Future<Reference<const IPage>> child = readPage(pager, id, &rec, &next.getOrUpperBound());
-
-				// Read ahead siblings at level 2
-				if(readAheadBytes > 0 && btPage()->height == 2 && next.valid()) {
-					do {
-						debug_printf("preloading %s %d bytes left\n", ::toString(next.get().getChildPage()).c_str(), readAheadBytes);
-						// If any part of the page was already loaded then stop
-						if(next.get().value.present()) {
-							preLoadPage(pager.getPtr(), next.get().getChildPage());
+				PageCacheHint hint = btPage()->height > 2 ? PageCacheHint::Internal : scan ? PageCacheHint::Scan : PageCacheHint::Normal;
+				Future<Reference<const IPage>> child = readPage(pager, id, &rec, &next.getOrUpperBound(), false, hint);
+
+				// Read ahead the siblings at level 2 in the direction of travel, up to REDWOOD_READ_AHEAD_PAGES of them
+				// and readAheadBytes, so that they are read concurrently instead of as the cursor reaches each one.
+				// Siblings already read ahead are found in the page cache.  They wait at the back of probation until
+				// the cursor reads them, when a scan's leaves move to the front.
+				if(readAheadBytes > 0 && btPage()->height == 2) {
+					BTreePage::BinaryTree::Cursor sibling = cursor;
+					int pages = 0;
+					while(readAheadBytes > 0 && pages < SERVER_KNOBS->REDWOOD_READ_AHEAD_PAGES && (forward ? sibling.moveNext() : sibling.movePrev())) {
+						if(sibling.get().value.present()) {
+							debug_printf("preloading %s %d bytes left\n", ::toString(sibling.get().getChildPage()).c_str(), readAheadBytes);
+							preLoadPage(pager.getPtr(), sibling.get().getChildPage());
 							readAheadBytes -= page->size();
+							++pages;
 						}
-					} while(readAheadBytes > 0 && next.moveNext());
+					}
 				}
 
 				return map(child, [=](Reference<const IPage> page) {
@@ -4520,13 +5017,14 @@ private:
 		Standalone<BTreePageID> rootPageID;
 		Reference<IPagerSnapshot> pager;
 		Reference<PageCursor> pageCursor;
+		int readAheadBytes; // Left to read ahead of the cursor as it moves from leaf to leaf
 
 	public:
-		InternalCursor() {
+		InternalCursor() : readAheadBytes(0) {
 		}
 
 		InternalCursor(Reference<IPagerSnapshot> pager, BTreePageID root)
-			: pager(pager), rootPageID(root) {
+			: pager(pager), rootPageID(root), readAheadBytes(0) {
 		}
 
 		std::string toString() const {
@@ -4580,6 +5078,10 @@ private:
 			return pageCursor->cursor.get();
 		}
 
+		Reference<IPagerSnapshot> getPager() const {
+			return pager;
+		}
+
 		// Ensure that pageCursor is not shared with other cursors so we can modify it
 		void ensureUnshared() {
 			if(!pageCursor->isSoleOwner()) {
@@ -4597,14 +5099,15 @@ private:
 			}
 
 			// Otherwise read the root page
-			Future<Reference<const IPage>> root = readPage(pager, rootPageID, &dbBegin, &dbEnd);
+			Future<Reference<const IPage>> root = readPage(pager, rootPageID, &dbBegin, &dbEnd, false, PageCacheHint::Internal);
 			return map(root, [=](Reference<const IPage> p) {
 				pageCursor = Reference<PageCursor>(new PageCursor(rootPageID, p));
 				return Void();
 			});
 		}
 
-		ACTOR Future<bool> seekLessThanOrEqual_impl(InternalCursor *self, RedwoodRecordRef query, int prefetchBytes) {
+		// Reads ahead up to prefetchBytes in the given direction, at the seek and as the cursor then moves that way
+		ACTOR Future<bool> seekLessThanOrEqual_impl(InternalCursor *self, RedwoodRecordRef query, int prefetchBytes, bool forward) {
 			Future<Void> f = self->moveToRoot();
 
 			// f will almost always be ready
@@ -4631,7 +5134,7 @@ private:
 						return true;
 					}
 
-					Reference<PageCursor> child = wait(self->pageCursor->getChild(self->pager, prefetchBytes));
+					Reference<PageCursor> child = wait(self->pageCursor->getChild(self->pager, prefetchBytes, false, forward));
 					self->pageCursor = child;
 				}
 				else {
@@ -4642,8 +5145,9 @@ private:
 			}
 		}
 
-		Future<bool> seekLTE(RedwoodRecordRef query, int prefetchBytes) {
-			return seekLessThanOrEqual_impl(this, query, prefetchBytes);
+		Future<bool> seekLTE(RedwoodRecordRef query, int prefetchBytes, bool forward = true) {
+			readAheadBytes = prefetchBytes;
+			return seekLessThanOrEqual_impl(this, query, prefetchBytes, forward);
 		}
 
 		ACTOR Future<bool> move_impl(InternalCursor *self, bool forward) {
@@ -4684,8 +5188,11 @@ private:
 					}
 				}
 
-				Reference<PageCursor> child = wait(self->pageCursor->getChild(self->pager));
+				Reference<PageCursor> child = wait(self->pageCursor->getChild(self->pager, self->readAheadBytes, true, forward));
 				forward ? child->cursor.moveFirst() : child->cursor.moveLast();
+				if(child->isLeaf()) {
+					self->readAheadBytes -= child->page->size();
+				}
 				self->pageCursor = child;
 			}
 
@@ -4762,7 +5269,7 @@ private:
 		// If kv is valid
 		//   - kv.key references memory held by cur1
 		//   - If cur1 points to a non split KV pair
-		//       - kv.value references memory held by cur1
+		//       - kv.value references memory held by cur1, or in arena if it is stored in value pages
 		//       - cur2 points to the next internal record after cur1
 		//     Else
 		//       - kv.value references memory in arena
@@ -4837,7 +5344,7 @@ private:
 			state RedwoodRecordRef query(key, self->m_version, {}, 0, std::numeric_limits<int32_t>::max());
 			self->m_kv.reset();
 
-			wait(success(self->m_cur1.seekLTE(query, prefetchBytes)));
+			wait(success(self->m_cur1.seekLTE(query, prefetchBytes, cmp >= 0)));
 			debug_printf("find%sE(%s): %s\n", cmp > 0 ? "GT" : (cmp == 0 ? "" : "LT"), query.toString().c_str(), self->toString().c_str());
 
 			// If we found the target key with a present value then return it as it is valid for any cmp type
@@ -4963,11 +5470,21 @@ private:
 		// Read all of the current key-value record starting at cur1 into kv
 		ACTOR static Future<Void> readFullKVPair(Cursor *self) {
 			self->m_arena = Arena();
-			const RedwoodRecordRef &rec = self->m_cur1.get();
 	
 			self->m_kv.reset();
 			debug_printf("readFullKVPair:  Starting at %s\n", self->toString().c_str());
 
+			// Value stored out of line, cur1 will hold the key memory and arena the value
+			if(self->m_cur1.get().isValuePages()) {
+				ValueRef value = wait(readValuePages(self->m_cur1.getPager(), self->m_cur1.get().value.get(), &self->m_arena));
+				self->m_kv = KeyValueRef(self->m_cur1.get().key, value);
+				debug_printf("readFullKVPair:  Value pages, exit.  %s\n", self->toString().c_str());
+
+				return Void();
+			}
+
+			const RedwoodRecordRef &rec = self->m_cur1.get();
+
 			// Unsplit value, cur1 will hold the key and value memory
 			if(!rec.isMultiPart()) {
 				self->m_kv = KeyValueRef(rec.key, rec.value.get());
@@ -5014,7 +5531,7 @@ VersionedBTree::Counts VersionedBTree::counts;
 
 class KeyValueStoreRedwoodUnversioned : public IKeyValueStore {
 public:
-	KeyValueStoreRedwoodUnversioned(std::string filePrefix, UID logID) : m_filePrefix(filePrefix) {
+	KeyValueStoreRedwoodUnversioned(std::string filePrefix, UID logID) : m_filePrefix(filePrefix), m_oldestVersion(invalidVersion), m_oldestReadable(invalidVersion), m_bytesPerRow(0) {
 		// TODO: This constructor should really just take an IVersionedStore
 		IPager2 *pager = new DWALPager(4096, filePrefix, 0);
 		m_tree = new VersionedBTree(pager, filePrefix);
@@ -5029,6 +5546,7 @@ public:
 		TraceEvent(SevInfo, "RedwoodInit").detail("FilePrefix", self->m_filePrefix);
 		wait(self->m_tree->init());
 		Version v = self->m_tree->getLatestVersion();
+		self->m_oldestVersion = self->m_tree->getOldestVersion();
 		self->m_tree->setWriteVersion(v + 1);
 		TraceEvent(SevInfo, "RedwoodInitComplete").detail("FilePrefix", self->m_filePrefix);
 		return Void();
@@ -5065,11 +5583,26 @@ public:
 
 	Future<Void> commit(bool sequential = false) {
 		Future<Void> c = m_tree->commit();
-		m_tree->setOldestVersion(m_tree->getLatestVersion());
+		// Only this commit is kept unless the commits back to m_oldestReadable are still being read
+		Version oldest = m_tree->getLatestVersion();
+		if(m_oldestReadable != invalidVersion) {
+			oldest = std::max(m_oldestVersion, std::min(m_oldestReadable, oldest));
+		}
+		m_oldestVersion = oldest;
+		m_tree->setOldestVersion(oldest);
 		m_tree->setWriteVersion(m_tree->getWriteVersion() + 1);
 		return catchError(c);
 	}
 
+	bool supportsVersionedReads() {
+		return true;
+	}
+
+	void setCommitVersion(Version version, Version oldestReadable) {
+		m_tree->setWriteVersion(version);
+		m_oldestReadable = oldestReadable;
+	}
+
 	KeyValueStoreType getType() {
 		return KeyValueStoreType::SSD_REDWOOD_V1;
 	}
@@ -5094,10 +5627,15 @@ public:
 
 	Future< Standalone< RangeResultRef > > readRange(KeyRangeRef keys, int rowLimit = 1<<30, int byteLimit = 1<<30) {
 		debug_printf("READRANGE %s\n", printable(keys).c_str());
-		return catchError(readRange_impl(this, keys, rowLimit, byteLimit));
+		return catchError(readRange_impl(this, keys, m_tree->getLastCommittedVersion(), rowLimit, byteLimit));
 	}
 
-	ACTOR static Future< Standalone< RangeResultRef > > readRange_impl(KeyValueStoreRedwoodUnversioned *self, KeyRange keys, int rowLimit, int byteLimit) {
+	Future< Standalone< RangeResultRef > > readRangeAtVersion(KeyRangeRef keys, Version version, int rowLimit = 1<<30, int byteLimit = 1<<30) {
+		debug_printf("READRANGE %s @%" PRId64 "\n", printable(keys).c_str(), version);
+		return catchError(readRange_impl(this, keys, version, rowLimit, byteLimit));
+	}
+
+	ACTOR static Future< Standalone< RangeResultRef > > readRange_impl(KeyValueStoreRedwoodUnversioned *self, KeyRange keys, Version version, int rowLimit, int byteLimit) {
 		self->m_tree->counts.getRanges++;
 		state Standalone<RangeResultRef> result;
 		state int accumulatedBytes = 0;
@@ -5107,9 +5645,13 @@ public:
 			return result;
 		}
 
-		state Reference<IStoreCursor> cur = self->m_tree->readAtVersion(self->m_tree->getLastCommittedVersion());
-		// Prefetch is currently only done in the forward direction
-		state int prefetchBytes = rowLimit > 1 ? byteLimit : 0;
+		state Reference<IStoreCursor> cur = self->m_tree->readAtVersion(version);
+		// Read ahead what the read can still return: byteLimit, or fewer bytes when rowLimit rows of the size recent
+		// reads returned are smaller
+		state int prefetchBytes = 0;
+		if(std::abs(rowLimit) > 1) {
+			prefetchBytes = self->m_bytesPerRow > 0 ? std::min<int64_t>(byteLimit, std::abs(rowLimit) * self->m_bytesPerRow) : byteLimit;
+		}
 
 		if(rowLimit > 0) {
 			wait(cur->findFirstEqualOrGreater(keys.begin, prefetchBytes));
@@ -5123,7 +5665,7 @@ public:
 				wait(cur->next());
 			}
 		} else {
-			wait(cur->findLastLessOrEqual(keys.end));
+			wait(cur->findLastLessOrEqual(keys.end, prefetchBytes));
 			if(cur->isValid() && cur->getKey() == keys.end)
 				wait(cur->prev());
 
@@ -5143,12 +5685,16 @@ public:
 			ASSERT(result.size() > 0);
 			result.readThrough = result[result.size()-1].key;
 		}
+		if(result.size() > 0) {
+			double bytesPerRow = (double)accumulatedBytes / result.size();
+			self->m_bytesPerRow = self->m_bytesPerRow > 0 ? self->m_bytesPerRow * 0.9 + bytesPerRow * 0.1 : bytesPerRow;
+		}
 		return result;
 	}
 
-	ACTOR static Future< Optional<Value> > readValue_impl(KeyValueStoreRedwoodUnversioned *self, Key key, Optional< UID > debugID) {
+	ACTOR static Future< Optional<Value> > readValue_impl(KeyValueStoreRedwoodUnversioned *self, Key key, Version version, Optional< UID > debugID) {
 		self->m_tree->counts.gets++;
-		state Reference<IStoreCursor> cur = self->m_tree->readAtVersion(self->m_tree->getLastCommittedVersion());
+		state Reference<IStoreCursor> cur = self->m_tree->readAtVersion(version);
 
 		wait(cur->findEqual(key));
 		if(cur->isValid()) {
@@ -5158,7 +5704,11 @@ public:
 	}
 
 	Future< Optional< Value > > readValue(KeyRef key, Optional< UID > debugID = Optional<UID>()) {
-		return catchError(readValue_impl(this, key, debugID));
+		return catchError(readValue_impl(this, key, m_tree->getLastCommittedVersion(), debugID));
+	}
+
+	Future< Optional< Value > > readValueAtVersion(KeyRef key, Version version, Optional< UID > debugID = Optional<UID>()) {
+		return catchError(readValue_impl(this, key, version, debugID));
 	}
 
 	ACTOR static Future< Optional<Value> > readValuePrefix_impl(KeyValueStoreRedwoodUnversioned *self, Key key, int maxLength, Optional< UID > debugID) {
@@ -5178,6 +5728,39 @@ public:
 		return catchError(readValuePrefix_impl(this, key, maxLength, debugID));
 	}
 
+	ACTOR static Future< std::vector<Optional<Value>> > readValuePrefixes_impl(KeyValueStoreRedwoodUnversioned *self, Standalone<VectorRef<KeyRef>> keys, std::vector<int> maxLengths, Optional< UID > debugID) {
+		self->m_tree->counts.gets += keys.size();
+		// One cursor at one version serves every key, so each search starts from pages the previous one just visited
+		state Reference<IStoreCursor> cur = self->m_tree->readAtVersion(self->m_tree->getLastCommittedVersion());
+		state std::vector<Optional<Value>> values;
+		state int i = 0;
+		values.reserve(keys.size());
+
+		for(; i < keys.size(); ++i) {
+			wait(cur->findEqual(keys[i]));
+			if(cur->isValid()) {
+				ValueRef v = cur->getValue();
+				values.push_back(Value(v.substr(0, std::min(v.size(), maxLengths[i]))));
+			}
+			else {
+				values.push_back(Optional<Value>());
+			}
+		}
+		return values;
+	}
+
+	Future< std::vector<Optional<Value>> > readValuePrefixes(std::vector<std::pair<KeyRef, int>> const& keys, Optional< UID > debugID = Optional<UID>()) {
+		Standalone<VectorRef<KeyRef>> keyRefs;
+		std::vector<int> maxLengths;
+		keyRefs.reserve(keyRefs.arena(), keys.size());
+		maxLengths.reserve(keys.size());
+		for(auto& k : keys) {
+			keyRefs.push_back_deep(keyRefs.arena(), k.first);
+			maxLengths.push_back(k.second);
+		}
+		return catchError(readValuePrefixes_impl(this, keyRefs, maxLengths, debugID));
+	}
+
 	virtual ~KeyValueStoreRedwoodUnversioned() {
 	};
 
@@ -5187,6 +5770,9 @@ private:
 	Future<Void> m_init;
 	Promise<Void> m_closed;
 	Promise<Void> m_error;
+	Version m_oldestVersion;
+	Version m_oldestReadable;
+	double m_bytesPerRow; // Average over recent range reads
 
 	template <typename T> inline Future<T> catchError(Future<T> f) {
 		return forwardError(f, m_error);
@@ -6257,6 +6843,202 @@ TEST_CASE("!/redwood/correctness/unit/deltaTree/IntIntPair") {
 	return Void();
 }
 
+TEST_CASE("!/redwood/correctness/unit/pageCompression") {
+	const int size = 16384;
+	std::unique_ptr<uint8_t[]> page(new uint8_t[size]);
+	std::unique_ptr<uint8_t[]> compressed(new uint8_t[size]);
+	std::unique_ptr<uint8_t[]> decompressed(new uint8_t[size]);
+
+	// Repetitive records, like serialized documents, compress well and come back unchanged
+	std::string record = deterministicRandom()->randomAlphaNumeric(100);
+	for(int i = 0; i < size; ++i) {
+		page[i] = record[i % record.size()];
+	}
+	int level = deterministicRandom()->randomInt(1, 10);
+	int compressedSize = compressPageBytes(page.get(), size, compressed.get(), size, level);
+	ASSERT(compressedSize > 0 && compressedSize < size / 4);
+	ASSERT(decompressPageBytes(compressed.get(), compressedSize, decompressed.get(), size) == size);
+	ASSERT(memcmp(page.get(), decompressed.get(), size) == 0);
+
+	// Random bytes do not shrink, so they do not fit in less space than they take
+	for(int i = 0; i < size; ++i) {
+		page[i] = deterministicRandom()->randomInt(0, 256);
+	}
+	ASSERT(compressPageBytes(page.get(), size, compressed.get(), size - 4096, level) == 0);
+
+	return Void();
+}
+
+struct EvictableObject {
+	bool evictable() const { return true; }
+	Future<Void> onEvictable() const { return Void(); }
+};
+
+TEST_CASE("!/redwood/correctness/unit/pageCache") {
+	state ObjectCache<LogicalPageID, EvictableObject> cache(10);
+
+	// Pages read twice survive a scan many times larger than the cache
+	for(LogicalPageID id = 0; id < 5; ++id) {
+		cache.get(id);
+		cache.get(id);
+	}
+	for(LogicalPageID id = 100; id < 1000; ++id) {
+		cache.get(id, PageCacheHint::Scan);
+	}
+	for(LogicalPageID id = 0; id < 5; ++id) {
+		ASSERT(cache.getIfExists(id) != nullptr);
+	}
+	ASSERT(cache.count() == 10);
+
+	// Internal pages survive pages that are each read once
+	cache.get(2000, PageCacheHint::Internal);
+	for(LogicalPageID id = 3000; id < 4000; ++id) {
+		cache.get(id);
+	}
+	ASSERT(cache.getIfExists(2000) != nullptr);
+	ASSERT(cache.count() == 10);
+
+	wait(cache.clear());
+	ASSERT(cache.count() == 0);
+
+	// Pages read ahead of a scan stay cached until the scan reads them, and are then evicted first
+	for(LogicalPageID id = 100; id < 1000; ++id) {
+		for(LogicalPageID ahead = id + 1; ahead <= id + 4; ++ahead) {
+			cache.get(ahead, PageCacheHint::NoHit);
+		}
+		ASSERT(id == 100 || cache.exists(id));
+		cache.get(id, PageCacheHint::Scan);
+	}
+	ASSERT(cache.count() == 10);
+	for(LogicalPageID id = 1000; id <= 1003; ++id) {
+		ASSERT(cache.exists(id));
+	}
+
+	wait(cache.clear());
+	return Void();
+}
+
+ACTOR Future<Optional<Value>> readValueAt(VersionedBTree *btree, Version v, Key key) {
+	state Reference<IStoreCursor> cur = btree->readAtVersion(v);
+	wait(cur->findEqual(key));
+	if(!cur->isValid()) {
+		return Optional<Value>();
+	}
+	return Value(cur->getValue());
+}
+
+TEST_CASE("!/redwood/correctness/unit/largeValues") {
+	state std::string pagerFile = "unittest_largeValues.redwood";
+	printf("Deleting old test data\n");
+	deleteFile(pagerFile);
+
+	state VersionedBTree *btree = new VersionedBTree(new DWALPager(4096, pagerFile, 0), pagerFile);
+	wait(btree->init());
+
+	// Values filling most of each of their pages, enough pages to be stored out of line unless REDWOOD_LARGE_VALUE_PAGES
+	// disables it
+	state bool outOfLine = SERVER_KNOBS->REDWOOD_LARGE_VALUE_PAGES > 0;
+	state int pages = std::max<int>(ceil(SERVER_KNOBS->REDWOOD_LARGE_VALUE_PAGES), 1) + 1;
+	state int size = pages * 4000;
+	state Version v1 = btree->getLatestVersion() + 1;
+	state int i;
+
+	btree->setWriteVersion(v1);
+	for(i = 0; i < 10; ++i) {
+		btree->set(KeyValueRef(StringRef(format("large%d", i)), StringRef(std::string(size, 'a' + i))));
+	}
+	btree->set(KeyValueRef(LiteralStringRef("small"), LiteralStringRef("1")));
+	state int64_t writes = VersionedBTree::counts.valuePageWrites;
+	wait(btree->commit());
+	ASSERT(VersionedBTree::counts.valuePageWrites - writes == (outOfLine ? 10 * pages : 0));
+
+	// Changing a small value in the same leaf does not rewrite the large values beside it
+	state Version v2 = v1 + 1;
+	btree->setWriteVersion(v2);
+	btree->set(KeyValueRef(LiteralStringRef("small"), LiteralStringRef("2")));
+	writes = VersionedBTree::counts.valuePageWrites;
+	wait(btree->commit());
+	ASSERT(VersionedBTree::counts.valuePageWrites == writes);
+
+	// Cleared values are still read at the versions before the clear
+	state Version v3 = v2 + 1;
+	btree->setWriteVersion(v3);
+	btree->clear(KeyRangeRef(LiteralStringRef("large0"), LiteralStringRef("large5")));
+	wait(btree->commit());
+
+	for(i = 0; i < 10; ++i) {
+		state Key key = StringRef(format("large%d", i));
+		Optional<Value> before = wait(readValueAt(btree, v2, key));
+		ASSERT(before.present() && before.get() == StringRef(std::string(size, 'a' + i)));
+		Optional<Value> after = wait(readValueAt(btree, v3, key));
+		ASSERT(after.present() == (i >= 5));
+	}
+
+	// Clearing the tree frees every value page
+	wait(btree->destroyAndCheckSanity());
+
+	Future<Void> closedFuture = btree->onClosed();
+	btree->close();
+	wait(closedFuture);
+
+	return Void();
+}
+
+TEST_CASE("!/redwood/correctness/unit/multiBlockLeafUpdates") {
+	state std::string pagerFile = "unittest_multiBlockLeafUpdates.redwood";
+	printf("Deleting old test data\n");
+	deleteFile(pagerFile);
+
+	// Leaf page size is fixed when the tree is created
+	state int leafPageBlocks = SERVER_KNOBS->REDWOOD_LEAF_PAGE_BLOCKS;
+	const_cast<ServerKnobs *>(SERVER_KNOBS)->REDWOOD_LEAF_PAGE_BLOCKS = 4;
+	state VersionedBTree *btree = new VersionedBTree(new DWALPager(4096, pagerFile, 0), pagerFile);
+	wait(btree->init());
+	const_cast<ServerKnobs *>(SERVER_KNOBS)->REDWOOD_LEAF_PAGE_BLOCKS = leafPageBlocks;
+
+	// A root leaf filling part of its 4 blocks, so it is written in fewer
+	state std::map<Key, Value> written;
+	state Version v = btree->getLatestVersion() + 1;
+	state int i;
+	btree->setWriteVersion(v);
+	for(i = 0; i < 150; ++i) {
+		Key k = StringRef(format("key%06d", i * 100));
+		Value val = StringRef(std::string(20, 'a' + i % 26));
+		btree->set(KeyValueRef(k, val));
+		written[k] = val;
+	}
+	wait(btree->commit());
+
+	// Adding records to it in place must not write past the blocks it was stored in
+	state int64_t updates = VersionedBTree::counts.pageUpdates;
+	state int round;
+	for(round = 0; round < 50; ++round) {
+		btree->setWriteVersion(++v);
+		for(i = 0; i < 5; ++i) {
+			Key k = StringRef(format("key%06d", deterministicRandom()->randomInt(0, 15000)));
+			Value val = StringRef(std::string(20, 'A' + round % 26));
+			btree->set(KeyValueRef(k, val));
+			written[k] = val;
+		}
+		wait(btree->commit());
+
+		state std::map<Key, Value>::iterator it = written.begin();
+		for(; it != written.end(); ++it) {
+			Optional<Value> val = wait(readValueAt(btree, v, it->first));
+			ASSERT(val.present() && val.get() == it->second);
+		}
+	}
+	ASSERT(VersionedBTree::counts.pageUpdates > updates);
+
+	wait(btree->destroyAndCheckSanity());
+
+	Future<Void> closedFuture = btree->onClosed();
+	btree->close();
+	wait(closedFuture);
+
+	return Void();
+}
+
 struct SimpleCounter {
 	SimpleCounter() : x(0), xt(0), t(timer()), start(t) {}
 	void operator+=(int n) { x += n; }
@@ -6650,6 +7432,51 @@ TEST_CASE("!/redwood/correctness/pager/cow") {
 	return Void();
 }
 
+TEST_CASE("!/redwood/correctness/pager/multiPageReads") {
+	state std::string pagerFile = "unittest_multiPageReads.redwood";
+	printf("Deleting old test data\n");
+	deleteFile(pagerFile);
+
+	state IPager2 *pager = new DWALPager(4096, pagerFile, 0);
+	wait(success(pager->init()));
+
+	// Pages allocated from the end of the file are adjacent
+	state Standalone<VectorRef<LogicalPageID>> ids;
+	state int i;
+	for(i = 0; i < 8; ++i) {
+		LogicalPageID id = wait(pager->newPageID());
+		Reference<IPage> p = pager->newPageBuffer();
+		memset(p->mutate(), (char)i, p->size());
+		pager->updatePage(id, p);
+		ids.push_back(ids.arena(), id);
+	}
+	state Version v = pager->getLatestVersion() + 1;
+	pager->setCommitVersion(v);
+	pager->setMetaKey(LiteralStringRef("multiPageReads"));
+	wait(pager->commit());
+
+	state Future<Void> onClosed = pager->onClosed();
+	pager->close();
+	wait(onClosed);
+
+	// After reopening, with one page cached between two runs of uncached pages, every page reads back as written
+	pager = new DWALPager(4096, pagerFile, 0);
+	wait(success(pager->init()));
+	state Reference<IPagerSnapshot> snapshot = pager->getReadSnapshot(v);
+	wait(success(snapshot->getPhysicalPage(ids[3], true, PageCacheHint::Normal)));
+	std::vector<Reference<const IPage>> pages = wait(getAll(snapshot->getPhysicalPages(ids, true, PageCacheHint::Normal)));
+	for(i = 0; i < pages.size(); ++i) {
+		ASSERT(pages[i]->begin()[0] == (uint8_t)i && pages[i]->begin()[pages[i]->size() - 1] == (uint8_t)i);
+	}
+	snapshot.clear();
+
+	onClosed = pager->onClosed();
+	pager->close();
+	wait(onClosed);
+
+	return Void();
+}
+
 TEST_CASE("!/redwood/performance/set") {
 	state SignalableActorCollection actors;
 	VersionedBTree::counts.clear();
@@ -4739,6 +4739,22 @@ SQLITE_PRIVATE int sqlite3BtreeEof(BtCursor *pCur){
   return (CURSOR_VALID!=pCur->eState);
 }
 
+/*
+** Return the page number of the leaf page holding the cell the cursor
+** points at, or 0 if the cursor is not valid or points at a cell of an
+** interior page.  Comparing the result before and after a move tells
+** whether the cursor stayed on the same leaf, where an insert may reuse
+** the cursor position instead of seeking.
+*/
+SQLITE_PRIVATE int sqlite3BtreeCursorLeafPage(BtCursor *pCur){
+  MemPage *pPage;
+  if( CURSOR_VALID!=pCur->eState ){
+    return 0;
+  }
+  pPage = pCur->apPage[pCur->iPage];
+  return pPage->leaf ? (int)pPage->pgno : 0;
+}
+
 /*
 ** Advance the cursor to the next entry in the database.  If
 ** successful then set *pRes=0.  If the cursor
@@ -22,10 +22,12 @@
 #include "fdbrpc/fdbrpc.h"
 #include "fdbrpc/LoadBalance.h"
 #include "flow/IndexedSet.h"
+#include "flow/DeterministicRandom.h"
 #include "flow/Hash3.h"
 #include "flow/ActorCollection.h"
 #include "flow/SystemMonitor.h"
 #include "flow/Util.h"
+#include "flow/UnitTest.h"
 #include "fdbclient/Atomic.h"
 #include "fdbclient/DatabaseContext.h"
 #include "fdbclient/KeyRangeMap.h"
@@ -34,6 +36,7 @@
 #include "fdbclient/Notified.h"
 #include "fdbclient/StatusClient.h"
 #include "fdbclient/SystemData.h"
+#include "fdbclient/Tuple.h"
 #include "fdbclient/VersionedMap.h"
 #include "fdbserver/FDBExecHelper.actor.h"
 #include "fdbserver/IKeyValueStore.h"
@@ -70,6 +73,7 @@ inline bool canReplyWith(Error e) {
 		case error_code_future_version:
 		case error_code_wrong_shard_server:
 		case error_code_process_behind:
+		case error_code_server_overloaded:
 		//case error_code_all_alternatives_failed:
 			return true;
 		default:
@@ -146,8 +150,303 @@ struct ShardInfo : ReferenceCounted<ShardInfo>, NonCopyable {
 	}
 };
 
+// A memory-bounded LRU cache of values read from storage by point reads.  It always agrees with storage: the keys
+// written by a commit are invalidated when the commit completes, and a value read from storage is only cached if no
+// commit completed while it was being read.  A key is only admitted on its second miss within a while, so keys that
+// are read once do not push hot keys out.
+struct StorageRowCache : NonCopyable {
+	explicit StorageRowCache( int64_t capacity )
+	  : capacity(capacity), bytes(0), commits(0), recentMisses(capacity > 0 ? std::max<int64_t>(capacity / 256, 64) : 0) {}
+
+	bool enabled() const { return capacity > 0; }
+	int64_t getBytes() const { return bytes; }
+	uint64_t getCommits() const { return commits; }
+
+	// Returns the cached value of key, or nullptr if it is not cached
+	Optional<Value>* get( KeyRef key ) {
+		auto it = entries.find(key);
+		if (it == entries.end()) return nullptr;
+		lru.splice(lru.begin(), lru, it->second.lru);
+		return &it->second.value;
+	}
+
+	// Called on a miss; returns true if key has missed recently enough that it is worth caching
+	bool admit( KeyRef key ) {
+		uint32_t h = hashlittle(key.begin(), key.size(), 0);
+		uint32_t& slot = recentMisses[h % recentMisses.size()];
+		if (slot == (h | 1)) {
+			slot = 0;
+			return true;
+		}
+		slot = h | 1;
+		return false;
+	}
+
+	// Caches the value of key that was read from storage, unless a commit completed after readCommits
+	void insert( KeyRef key, Optional<Value> const& value, uint64_t readCommits ) {
+		if (readCommits != commits || entries.count(key)) return;
+		Key k(key);
+		lru.push_front(k);
+		entries[k] = Entry{ value, lru.begin() };
+		bytes += entryBytes(k, value);
+		while (bytes > capacity) {
+			auto it = entries.find(lru.back());
+			bytes -= entryBytes(it->first, it->second.value);
+			entries.erase(it);
+			lru.pop_back();
+		}
+	}
+
+	// Returns the first maxLength bytes of a cached value, as readValuePrefix would
+	static Optional<Value> prefix( Optional<Value> const& value, int maxLength ) {
+		if (!value.present() || value.get().size() <= maxLength) return value;
+		return Value(value.get().substr(0, maxLength), value.get().arena());
+	}
+
+	void written( KeyRangeRef keys ) {
+		if (enabled()) pendingWrites.push_back_deep(pendingWrites.arena(), keys);
+	}
+
+	// Returns the ranges written since the last call, to be passed to invalidate() once they are committed
+	Standalone<VectorRef<KeyRangeRef>> startCommit() {
+		Standalone<VectorRef<KeyRangeRef>> writes = pendingWrites;
+		pendingWrites = Standalone<VectorRef<KeyRangeRef>>();
+		return writes;
+	}
+
+	void invalidate( VectorRef<KeyRangeRef> const& writes ) {
+		++commits;
+		for (auto& keys : writes) {
+			auto it = entries.lower_bound(keys.begin);
+			while (it != entries.end() && it->first < keys.end) {
+				bytes -= entryBytes(it->first, it->second.value);
+				lru.erase(it->second.lru);
+				it = entries.erase(it);
+			}
+		}
+	}
+
+private:
+	struct Entry {
+		Optional<Value> value;
+		std::list<Key>::iterator lru;
+	};
+
+	int64_t capacity;
+	int64_t bytes;
+	uint64_t commits;
+	std::map<Key, Entry> entries;
+	std::list<Key> lru; // most recently used first
+	std::vector<uint32_t> recentMisses; // hashes of keys that missed, by hash; 0 for none
+	Standalone<VectorRef<KeyRangeRef>> pendingWrites;
+
+	static int64_t entryBytes( KeyRef key, Optional<Value> const& value ) {
+		return key.size() + value.expectedSize() + 128;
+	}
+};
+
+// Admits reads a limited number at a time.  Waiting reads are admitted in priority order and, within a priority, by
+// weighted fair queuing across the clients that sent them: each read is stamped with a virtual finish time, its cost
+// past the later of its client's previous stamp and the stamp last admitted, and the earliest stamp goes first.  A
+// client issuing large range reads therefore delays other clients' point reads only by its share.  Reads that waited
+// longer than their priority's delay target are shed with server_overloaded when they reach the front.
+struct StorageReadQueue : NonCopyable {
+	struct Releaser : NonCopyable {
+		StorageReadQueue* queue;
+		Releaser() : queue(nullptr) {}
+		explicit Releaser( StorageReadQueue& queue ) : queue(&queue) {}
+		Releaser(Releaser&& r) BOOST_NOEXCEPT : queue(r.queue) { r.queue = nullptr; }
+		void operator=(Releaser&& r) { if (queue) queue->release(); queue = r.queue; r.queue = nullptr; }
+
+		void release() {
+			if (queue) queue->release();
+			queue = nullptr;
+		}
+
+		~Releaser() { if (queue) queue->release(); }
+	};
+
+	explicit StorageReadQueue( int slots ) : slots(slots), active(0), waiting(0), sequence(0), shed(0) {}
+
+	// Returns when a read of the given cost may start, or throws server_overloaded.  The caller then holds a slot
+	// until it calls release(), normally through a Releaser.
+	Future<Void> take( int priority, NetworkAddress const& client, int64_t cost ) {
+		if (waiting == 0 && (slots <= 0 || active < slots)) {
+			++active;
+			return Void();
+		}
+		return takeActor(this, priority, client, cost);
+	}
+
+	void release() {
+		ASSERT( active > 0 );
+		--active;
+
+		// Promises are only signalled once the queue is consistent, since the takers run on this stack
+		std::vector<Promise<Void>> admitted, overloaded;
+		while (waiting > 0 && (slots <= 0 || active < slots)) {
+			int priority = READ_PRIORITY_COUNT - 1;
+			while (queues[priority].waiters.empty()) --priority;
+			Queue& q = queues[priority];
+
+			auto it = q.waiters.begin();
+			Waiter w = std::move(it->second);
+			q.virtualTime = it->first.first;
+			auto last = q.finishTags.find(w.client);
+			if (last != q.finishTags.end() && last->second <= q.virtualTime) q.finishTags.erase(last);
+			q.waiters.erase(it);
+			--waiting;
+			// Stamps no later than virtualTime no longer matter, so an idle priority forgets its clients
+			if (q.waiters.empty()) q.finishTags.clear();
+
+			if (priority != READ_PRIORITY_IMMEDIATE && now() - w.queued > maxDelay(priority)) {
+				++shed;
+				overloaded.push_back(std::move(w.admitted));
+			} else {
+				++active;
+				admitted.push_back(std::move(w.admitted));
+			}
+		}
+		for (auto& p : overloaded) p.sendError(server_overloaded());
+		for (auto& p : admitted) p.send(Void());
+	}
+
+	int getActive() const { return active; }
+	int getWaiting() const { return waiting; }
+	int64_t getShed() const { return shed; }
+
+private:
+	struct Waiter {
+		NetworkAddress client;
+		double queued;
+		Promise<Void> admitted;
+	};
+	struct Queue {
+		std::map<std::pair<double, uint64_t>, Waiter> waiters; // by (virtual finish time, arrival)
+		std::map<NetworkAddress, double> finishTags; // the last virtual finish time given to each client's reads
+		double virtualTime = 0;
+	};
+
+	int slots; // 0 admits every read at once
+	int active;
+	int waiting;
+	uint64_t sequence;
+	int64_t shed;
+	Queue queues[READ_PRIORITY_COUNT];
+
+	static double maxDelay( int priority ) {
+		return priority == READ_PRIORITY_BATCH ? SERVER_KNOBS->STORAGE_READ_QUEUE_BATCH_MAX_DELAY : SERVER_KNOBS->STORAGE_READ_QUEUE_MAX_DELAY;
+	}
+
+	ACTOR static Future<Void> takeActor( StorageReadQueue* self, int priority, NetworkAddress client, int64_t cost ) {
+		state std::map<std::pair<double, uint64_t>, Waiter>::iterator it;
+		{
+			Queue& q = self->queues[priority];
+			double& last = q.finishTags[client];
+			last = std::max(last, q.virtualTime) + cost;
+			it = q.waiters.emplace(std::make_pair(last, self->sequence++), Waiter{ client, now(), Promise<Void>() }).first;
+			++self->waiting;
+		}
+
+		try {
+			wait( it->second.admitted.getFuture() );
+		} catch (Error& e) {
+			if (e.code() == error_code_actor_cancelled) {
+				// Still queued, since release() signals a waiter only after removing it
+				self->queues[priority].waiters.erase(it);
+				--self->waiting;
+			}
+			throw;
+		}
+
+		try {
+			// So release()ing a slot doesn't run the read on its stack
+			wait( delay(0, TaskPriority::DefaultEndpoint) );
+			return Void();
+		} catch (...) {
+			self->release();
+			throw;
+		}
+	}
+};
+
+// The commits of a storage engine that keeps earlier commits readable, which serve reads older than the versions kept
+// in memory.  Such a read is served from the latest commit at or before its version, which is exact unless the keys read
+// changed between that commit and the read version.  So the ranges each commit changed are kept, without their values,
+// and reads that may have missed one of the changes are refused as too old.
+struct StorageHistory : NonCopyable {
+	explicit StorageHistory( bool enabled ) : enabled(enabled) { startCommit(); }
+
+	bool const enabled;
+
+	// The oldest version a read can be served at, or invalidVersion if none can be
+	Version oldestVersion() const { return commits.empty() ? invalidVersion : commits.front().version; }
+
+	// Records a change made by the commit in progress at the given version
+	void changed( KeyRangeRef keys, Version version ) {
+		pendingFirstChange = std::min(pendingFirstChange, version);
+		if (!pendingChanged) return;
+		pendingChanged->insert(keys, true);
+		pendingChanged->coalesce(keys);
+		if (++pendingChanges > SERVER_KNOBS->STORAGE_VERSIONED_READ_MAX_RANGES) pendingChanged.clear();
+	}
+
+	// Called when the commit in progress, at version end, is durable.  Reads at [version, end) are then served from the
+	// previous commit, at version.
+	void committed( Version version, Version end ) {
+		ASSERT( commits.empty() || commits.back().end == version );
+		commits.push_back( Commit{ version, end, pendingFirstChange, pendingChanged } );
+		startCommit();
+	}
+
+	// Drops the commits that can only serve reads before version
+	void expire( Version version ) {
+		while (!commits.empty() && commits.front().end <= version) commits.pop_front();
+	}
+
+	// Refuses reads of keys at all versions already committed, as when they are fetched from another server
+	void forget( KeyRangeRef keys ) {
+		for (auto& c : commits) {
+			c.firstChange = c.version;
+			if (c.changed) c.changed->insert(keys, true);
+		}
+	}
+
+	bool canRead( Version version, KeyRangeRef keys ) const {
+		auto c = std::upper_bound(commits.begin(), commits.end(), version, [](Version v, Commit const& c) { return v < c.version; });
+		if (c == commits.begin()) return false;
+		--c;
+		if (version >= c->end) return false;
+		if (version < c->firstChange) return true;
+		if (!c->changed) return false;
+		for (auto r : c->changed->intersectingRanges(keys))
+			if (r.value()) return false;
+		return true;
+	}
+
+private:
+	struct Commit {
+		Version version;
+		Version end; // of the next commit
+		Version firstChange; // The earliest version changed by the next commit
+		Reference<KeyRangeMap<bool>> changed; // by the next commit, or null if too many ranges changed to track
+	};
+
+	std::deque<Commit> commits;
+	Version pendingFirstChange;
+	Reference<KeyRangeMap<bool>> pendingChanged;
+	int pendingChanges;
+
+	void startCommit() {
+		pendingFirstChange = std::numeric_limits<Version>::max();
+		pendingChanged = Reference<KeyRangeMap<bool>>( new KeyRangeMap<bool>() );
+		pendingChanges = 0;
+	}
+};
+
 struct StorageServerDisk {
-	explicit StorageServerDisk( struct StorageServer* data, IKeyValueStore* storage ) : data(data), storage(storage) {}
+	explicit StorageServerDisk( struct StorageServer* data, IKeyValueStore* storage )
+	  : data(data), storage(storage), rowCache(SERVER_KNOBS->STORAGE_ROW_CACHE_BYTES) {}
 
 	void makeNewStorageServerDurable();
 	bool makeVersionMutationsDurable( Version& prevStorageVersion, Version newStorageVersion, int64_t& bytesLeft );
@@ -158,25 +457,35 @@ struct StorageServerDisk {
 
 	void writeMutation( MutationRef mutation );
 	void writeKeyValue( KeyValueRef kv );
+	void writeSortedKeyValues( VectorRef<KeyValueRef> kvs ); // into a range that holds no keys, such as a shard being fetched
 	void clearRange( KeyRangeRef keys );
 
 	Future<Void> getError() { return storage->getError(); }
 	Future<Void> init() { return storage->init(); }
-	Future<Void> commit() { return storage->commit(); }
+	Future<Void> commit() { return rowCache.enabled() ? commitAndInvalidate(this) : storage->commit(); }
 
 	// SOMEDAY: Put readNextKeyInclusive in IKeyValueStore
 	Future<Key> readNextKeyInclusive( KeyRef key ) { return readFirstKey(storage, KeyRangeRef(key, allKeys.end)); }
-	Future<Optional<Value>> readValue( KeyRef key, Optional<UID> debugID = Optional<UID>() ) { return storage->readValue(key, debugID); }
-	Future<Optional<Value>> readValuePrefix( KeyRef key, int maxLength, Optional<UID> debugID = Optional<UID>() ) { return storage->readValuePrefix(key, maxLength, debugID); }
+	// Point reads, including prefix reads, are answered from the row cache when they can be
+	Future<Optional<Value>> readValue( KeyRef key, Optional<UID> debugID = Optional<UID>() );
+	Future<Optional<Value>> readValuePrefix( KeyRef key, int maxLength, Optional<UID> debugID = Optional<UID>() );
+	Future<std::vector<Optional<Value>>> readValuePrefixes( std::vector<std::pair<KeyRef, int>> const& keys, Optional<UID> debugID = Optional<UID>() );
 	Future<Standalone<RangeResultRef>> readRange( KeyRangeRef keys, int rowLimit = 1<<30, int byteLimit = 1<<30 ) { return storage->readRange(keys, rowLimit, byteLimit); }
 
+	bool supportsVersionedReads() { return storage->supportsVersionedReads(); }
+	void setCommitVersion( Version version, Version oldestReadable ) { storage->setCommitVersion(version, oldestReadable); }
+	Future<Optional<Value>> readValueAtVersion( KeyRef key, Version version, Optional<UID> debugID = Optional<UID>() ) { return storage->readValueAtVersion(key, version, debugID); }
+	Future<Standalone<RangeResultRef>> readRangeAtVersion( KeyRangeRef keys, Version version, int rowLimit = 1<<30, int byteLimit = 1<<30 ) { return storage->readRangeAtVersion(keys, version, rowLimit, byteLimit); }
+
 	KeyValueStoreType getKeyValueStoreType() { return storage->getType(); }
 	StorageBytes getStorageBytes() { return storage->getStorageBytes(); }
 	std::tuple<size_t, size_t, size_t> getSize() { return storage->getSize(); }
+	int64_t getRowCacheBytes() const { return rowCache.getBytes(); }
 
 private:
 	struct StorageServer* data;
 	IKeyValueStore* storage;
+	StorageRowCache rowCache;
 
 	void writeMutations( MutationListRef mutations, Version debugVersion, const char* debugContext );
 
@@ -185,6 +494,43 @@ private:
 		if (r.size()) return r[0].key;
 		else return range.end;
 	}
+
+	ACTOR static Future<Optional<Value>> readValueAndCache( StorageServerDisk* self, Key key, Optional<UID> debugID ) {
+		state uint64_t commits = self->rowCache.getCommits();
+		Optional<Value> value = wait( self->storage->readValue(key, debugID) );
+		self->rowCache.insert(key, value, commits);
+		return value;
+	}
+
+	ACTOR static Future<Optional<Value>> readValuePrefixAndCache( StorageServerDisk* self, Key key, int maxLength, Optional<UID> debugID ) {
+		state uint64_t commits = self->rowCache.getCommits();
+		Optional<Value> value = wait( self->storage->readValuePrefix(key, maxLength, debugID) );
+		// A value as long as the prefix read may have been cut short
+		if (!value.present() || value.get().size() < maxLength) self->rowCache.insert(key, value, commits);
+		return value;
+	}
+
+	// Reads the keys of a batch that missed the row cache into values, and caches those that are worth it
+	ACTOR static Future<std::vector<Optional<Value>>> readValuePrefixesAndCache( StorageServerDisk* self, std::vector<Optional<Value>> values,
+	                                                                             std::vector<int> missIndexes, std::vector<std::pair<KeyRef, int>> misses,
+	                                                                             Optional<UID> debugID ) {
+		state uint64_t commits = self->rowCache.getCommits();
+		std::vector<Optional<Value>> read = wait( self->storage->readValuePrefixes(misses, debugID) );
+		for (int i = 0; i < read.size(); i++) {
+			values[missIndexes[i]] = read[i];
+			// A value as long as the prefix read may have been cut short
+			bool whole = !read[i].present() || read[i].get().size() < misses[i].second;
+			if (whole && self->rowCache.admit(misses[i].first)) self->rowCache.insert(misses[i].first, read[i], commits);
+		}
+		return values;
+	}
+
+	ACTOR static Future<Void> commitAndInvalidate( StorageServerDisk* self ) {
+		state Standalone<VectorRef<KeyRangeRef>> writes = self->rowCache.startCommit();
+		wait( self->storage->commit() );
+		self->rowCache.invalidate(writes);
+		return Void();
+	}
 };
 
 struct UpdateEagerReadInfo {
@@ -203,10 +549,12 @@ struct UpdateEagerReadInfo {
 
 	void addMutation( MutationRef const& m ) {
 		// SOMEDAY: Theoretically we can avoid a read if there is an earlier overlapping ClearRange
-		if (m.type == MutationRef::ClearRange && !m.param2.startsWith(systemKeys.end))
-			keyBegin.push_back( m.param2 );
-		else if (m.type == MutationRef::CompareAndClear) {
-			keyBegin.push_back(keyAfter(m.param1, arena));
+		if (m.type == MutationRef::ClearRange) {
+			if (SERVER_KNOBS->CLEAR_RANGE_EAGER_READS && !m.param2.startsWith(systemKeys.end))
+				keyBegin.push_back( m.param2 );
+		} else if (m.type == MutationRef::CompareAndClear) {
+			if (SERVER_KNOBS->CLEAR_RANGE_EAGER_READS)
+				keyBegin.push_back(keyAfter(m.param1, arena));
 			if (keys.size() > 0 && keys.back().first == m.param1) {
 				// Don't issue a second read, if the last read was equal to the current key.
 				// CompareAndClear is likely to be used after another atomic operation on same key.
@@ -244,13 +592,63 @@ struct UpdateEagerReadInfo {
 
 const int VERSION_OVERHEAD = 64 + sizeof(Version) + sizeof(Standalone<VersionUpdateRef>) + //mutationLog, 64b overhead for map
 							 2 * (64 + sizeof(Version) + sizeof(Reference<VersionedMap<KeyRef, ValueOrClearToRef>::PTreeT>)); //versioned map [ x2 for createNewVersion(version+1) ], 64b overhead for map
-static int mvccStorageBytes( MutationRef const& m ) { return VersionedMap<KeyRef, ValueOrClearToRef>::overheadPerItem * 2 + (MutationRef::OVERHEAD_BYTES + m.param1.size() + m.param2.size()) * 2; }
+static int mvccStorageBytes( VersionedMap<KeyRef, ValueOrClearToRef> const& data, MutationRef const& m ) { return data.overheadPerItem() * 2 + (MutationRef::OVERHEAD_BYTES + m.param1.size() + m.param2.size()) * 2; }
 
 struct FetchInjectionInfo {
 	Arena arena;
 	vector<VerUpdateRef> changes;
 };
 
+// A change feed records every mutation this server applies to keys in range, in version order.  Mutations at
+// versions <= durableVersion are in storage (see persistChangeFeedDataKeys), later ones are in memory.
+struct ChangeFeedInfo : ReferenceCounted<ChangeFeedInfo> {
+	Key id;
+	KeyRange range;
+	std::deque<Standalone<MutationsAndVersionRef>> mutations; // versions (durableVersion, version], in order
+	Version emptyVersion; // Mutations before this version were popped, or were never recorded by this server
+	std::vector<std::pair<KeyRange, Version>> movedIn; // Parts of range that moved to this server after it registered
+	                                                   // the feed, and the versions it began recording them at
+	Version durableVersion;
+	AsyncTrigger newMutations; // Triggered when mutations become visible to readers
+	bool removing;
+
+	ChangeFeedInfo() : emptyVersion(0), durableVersion(invalidVersion), removing(false) {}
+
+	// Mutations to keys before this version were popped, or were never recorded by this server
+	Version emptyVersionOf( KeyRangeRef keys ) const {
+		Version version = emptyVersion;
+		for (auto& m : movedIn) {
+			if (m.first.intersects(keys)) version = std::max(version, m.second);
+		}
+		return version;
+	}
+};
+
+// All of the watches on one key share a KeyWatch, whose actor (watchKeyChanges) re-reads the key once each time it
+// is mutated and fires the watchers that no longer see their value.
+struct KeyWatch : ReferenceCounted<KeyWatch> {
+	struct Watcher {
+		Optional<Value> value; // the value the client read
+		Version version; // the version at which it read it
+		Promise<Version> fired;
+
+		Watcher(Optional<Value> value, Version version) : value(value), version(version) {}
+	};
+
+	Key key;
+	Optional<Value> value; // the value at version
+	Version version;
+	bool isCurrent; // true if the key has not been mutated since version, so value is its latest value
+	std::vector<Watcher> watchers;
+	Future<Void> checker;
+
+	explicit KeyWatch(Key key) : key(key), version(invalidVersion), isCurrent(false) {}
+};
+
+// Bytes of watch budget (MAX_STORAGE_SERVER_WATCH_BYTES) charged for each watched key and for each watcher
+static int64_t keyWatchBytes(KeyRef key) { return key.expectedSize() + 1000; }
+static int64_t watcherBytes(KeyWatch::Watcher const& w) { return w.value.expectedSize() + sizeof(KeyWatch::Watcher); }
+
 struct StorageServer {
 	typedef VersionedMap<KeyRef, ValueOrClearToRef> VersionedData;
 
@@ -321,6 +719,8 @@ public:
 	void byteSampleApplyMutation( MutationRef const& m, Version ver );
 	void byteSampleApplySet( KeyValueRef kv, Version ver );
 	void byteSampleApplyClear( KeyRangeRef range, Version ver );
+	// Writes a change to the persisted byte sample at ver, and logs it to be replayed over the byte sample snapshot
+	void byteSamplePersist( MutationRef const& m, Version ver );
 
 	void popVersion(Version v, bool popAllTags = false) {
 		if(logSystem) {
@@ -365,10 +765,16 @@ public:
 
 	MutationRef addMutationToMutationLog(Standalone<VersionUpdateRef> &mLV, MutationRef const& m){
 		byteSampleApplyMutation(m, mLV.version);
-		counters.bytesInput += mvccStorageBytes(m);
+		counters.bytesInput += mvccStorageBytes(versionedData, m);
 		return mLV.mutations.push_back_deep( mLV.arena(), m );
 	}
 
+	// Like addMutationToMutationLog, for the byte sample snapshot and its log of changes, which are not themselves sampled
+	void addUnsampledMutationToMutationLog(Standalone<VersionUpdateRef> &mLV, MutationRef const& m){
+		counters.bytesInput += mvccStorageBytes(versionedData, m);
+		mLV.mutations.push_back_deep( mLV.arena(), m );
+	}
+
 	StorageServerDisk storage;
 
 	KeyRangeMap< Reference<ShardInfo> > shards;
@@ -376,6 +782,10 @@ public:
 
 	KeyRangeMap <bool> cachedRangeMap; // indicates if a key-range is being cached
 
+	std::map<Key, Reference<ChangeFeedInfo>> uidChangeFeed;
+	KeyRangeMap<std::vector<Reference<ChangeFeedInfo>>> keyChangeFeed;
+	std::vector<Reference<ChangeFeedInfo>> changeFeedsUpdated; // Feeds that recorded mutations not yet visible
+
 	// newestAvailableVersion[k]
 	//   == invalidVersion -> k is unavailable at all versions
 	//   <= storageVersion -> k is unavailable at all versions (but might be read anyway from storage if we are in the process of committing makeShardDurable)
@@ -391,6 +801,7 @@ public:
 	NotifiedVersion desiredOldestVersion;    // We can increase oldestVersion (and then durableVersion) to this version when the disk permits
 	NotifiedVersion oldestVersion;           // See also storageVersion()
 	NotifiedVersion durableVersion; 	     // At least this version will be readable from storage after a power failure
+	NotifiedVersion knownCommittedVersion;   // Versions <= this cannot be rolled back; change feeds are read up to it
 	Version rebootAfterDurableVersion;
 	int8_t primaryLocality;
 
@@ -411,9 +822,14 @@ public:
 	CoalescedKeyRangeMap<bool, int64_t, KeyBytesMetric<int64_t>> byteSampleClears;
 	AsyncVar<bool> byteSampleClearsTooLarge;
 	Future<Void> byteSampleRecovery;
+	uint64_t byteSampleDeltaSequence; // of the next change logged for replay over the byte sample snapshot
+	int byteSampleSnapshotGeneration; // of the last complete snapshot; the next one is written over the other
+	std::vector<Key> warmUpKeys; // The most read keys as of the last run, which are read at startup to warm the storage engine's cache
+	StorageHistory engineHistory; // Commits of the storage engine that serve reads before storageVersion()
 	Future<Void> durableInProgress;
 
 	AsyncMap<Key,bool> watches;
+	std::map<Key, Reference<KeyWatch>> watchRegistry;
 	int64_t watchBytes;
 	int64_t numWatches;
 	AsyncVar<bool> noRecentUpdates;
@@ -428,6 +844,9 @@ public:
 
 	FlowLock durableVersionLock;
 	FlowLock fetchKeysParallelismLock;
+	FlowLock mappedRecordsLock; // Bounds the mapped record reads of all getMappedKeyValues requests in flight
+	StorageReadQueue readQueue;
+	int64_t fetchKeysBytesBudget; // What fetchKeys may still write before the next commit, so it cannot swamp the disk
 	vector< Promise<FetchInjectionInfo*> > readyFetchKeys;
 
 	int64_t instanceID;
@@ -453,7 +872,7 @@ public:
 
 	struct Counters {
 		CounterCollection cc;
-		Counter allQueries, getKeyQueries, getValueQueries, getRangeQueries, finishedQueries, rowsQueried, bytesQueried, watchQueries, emptyQueries;
+		Counter allQueries, getKeyQueries, getValueQueries, getRangeQueries, getRangeStreamQueries, getValuesQueries, getMappedRangeQueries, changeFeedStreamQueries, finishedQueries, rowsQueried, bytesQueried, watchQueries, emptyQueries;
 		Counter bytesInput, bytesDurable, bytesFetched,
 			mutationBytes;  // Like bytesInput but without MVCC accounting
 		Counter sampledBytesCleared;
@@ -462,6 +881,8 @@ public:
 		Counter loops;
 		Counter fetchWaitingMS, fetchWaitingCount, fetchExecutingMS, fetchExecutingCount;
 		Counter readsRejected;
+		Counter mappedLocalReads, mappedRemoteReads;
+		Counter rowCacheHits, rowCacheMisses;
 
 		LatencyBands readLatencyBands;
 
@@ -470,6 +891,10 @@ public:
 			getKeyQueries("GetKeyQueries", cc),
 			getValueQueries("GetValueQueries",cc),
 			getRangeQueries("GetRangeQueries", cc),
+			getRangeStreamQueries("GetRangeStreamQueries", cc),
+			getValuesQueries("GetValuesQueries", cc),
+			getMappedRangeQueries("GetMappedRangeQueries", cc),
+			changeFeedStreamQueries("ChangeFeedStreamQueries", cc),
 			allQueries("QueryQueue", cc),
 			finishedQueries("FinishedQueries", cc),
 			rowsQueried("RowsQueried", cc),
@@ -493,6 +918,10 @@ public:
 			fetchExecutingMS("FetchExecutingMS", cc),
 			fetchExecutingCount("FetchExecutingCount", cc),
 			readsRejected("ReadsRejected", cc),
+			mappedLocalReads("MappedLocalReads", cc),
+			mappedRemoteReads("MappedRemoteReads", cc),
+			rowCacheHits("RowCacheHits", cc),
+			rowCacheMisses("RowCacheMisses", cc),
 			readLatencyBands("ReadLatencyMetrics", self->thisServerID, SERVER_KNOBS->STORAGE_LOGGING_DELAY)
 		{
 			specialCounter(cc, "LastTLogVersion", [self](){ return self->lastTLogVersion; });
@@ -509,10 +938,15 @@ public:
 			specialCounter(cc, "FetchKeysWaiting", [self](){ return self->fetchKeysParallelismLock.waiters(); });
 
 			specialCounter(cc, "QueryQueueMax", [self](){ return self->getAndResetMaxQueryQueueSize(); });
+			specialCounter(cc, "ReadQueueActive", [self](){ return self->readQueue.getActive(); });
+			specialCounter(cc, "ReadQueueWaiting", [self](){ return self->readQueue.getWaiting(); });
+			specialCounter(cc, "ReadsShed", [self](){ return self->readQueue.getShed(); });
 
 			specialCounter(cc, "BytesStored", [self](){ return self->metrics.byteSample.getEstimate(allKeys); });
 			specialCounter(cc, "ActiveWatches", [self](){ return self->numWatches; });
+			specialCounter(cc, "WatchedKeys", [self](){ return self->watchRegistry.size(); });
 			specialCounter(cc, "WatchBytes", [self](){ return self->watchBytes; });
+			specialCounter(cc, "RowCacheBytes", [self](){ return self->storage.getRowCacheBytes(); });
 
 			specialCounter(cc, "KvstoreBytesUsed", [self](){ return self->storage.getStorageBytes().used; });
 			specialCounter(cc, "KvstoreBytesFree", [self](){ return self->storage.getStorageBytes().free; });
@@ -525,19 +959,20 @@ public:
 	} counters;
 
 	StorageServer(IKeyValueStore* storage, Reference<AsyncVar<ServerDBInfo>> const& db, StorageServerInterface const& ssi)
-		:	instanceID(deterministicRandom()->randomUniqueID().first()),
-			storage(this, storage), db(db),
+		:	versionedData(SERVER_KNOBS->STORAGE_VERSIONED_MAP_BTREE),
+			instanceID(deterministicRandom()->randomUniqueID().first()),
+			storage(this, storage), db(db), engineHistory(SERVER_KNOBS->STORAGE_VERSIONED_READS && storage->supportsVersionedReads()),
 			lastTLogVersion(0), lastVersionWithData(0), restoredVersion(0),
 			rebootAfterDurableVersion(std::numeric_limits<Version>::max()),
 			durableInProgress(Void()),
 			versionLag(0), primaryLocality(tagLocalityInvalid),
 			updateEagerReads(0),
 			shardChangeCounter(0),
-			fetchKeysParallelismLock(SERVER_KNOBS->FETCH_KEYS_PARALLELISM_BYTES),
+			fetchKeysParallelismLock(SERVER_KNOBS->FETCH_KEYS_PARALLELISM_BYTES), mappedRecordsLock(SERVER_KNOBS->MAPPED_RECORDS_PARALLELISM), readQueue(SERVER_KNOBS->STORAGE_READ_QUEUE_SLOTS), fetchKeysBytesBudget(SERVER_KNOBS->FETCH_KEYS_COMMIT_BYTES),
 			shuttingDown(false), debug_inApplyUpdate(false), debug_lastValidateTime(0), watchBytes(0), numWatches(0),
 			logProtocol(0), counters(this), tag(invalidTag), maxQueryQueue(0), thisServerID(ssi.id()),
 			readQueueSizeMetric(LiteralStringRef("StorageServer.ReadQueueSize")),
-			behind(false), versionBehind(false), byteSampleClears(false, LiteralStringRef("\xff\xff\xff")), noRecentUpdates(false),
+			behind(false), versionBehind(false), byteSampleClears(false, LiteralStringRef("\xff\xff\xff")), byteSampleDeltaSequence(0), byteSampleSnapshotGeneration(0), noRecentUpdates(false),
 			lastUpdate(now()), poppedAllAfter(std::numeric_limits<Version>::max()), cpuUsage(0.0), diskUsage(0.0)
 	{
 		version.initMetric(LiteralStringRef("StorageServer.Version"), counters.cc.id);
@@ -551,7 +986,10 @@ public:
 
 		cx = openDBOnServer(db, TaskPriority::DefaultEndpoint, true, true);
 	}
-	//~StorageServer() { fclose(log); }
+	~StorageServer() {
+		// Each checker holds a reference to its KeyWatch, so they are not cancelled by destroying watchRegistry
+		for (auto& w : watchRegistry) w.second->checker.cancel();
+	}
 
 	// Puts the given shard into shards.  The caller is responsible for adding shards
 	//   for all ranges in shards.getAffectedRangesAfterInsertion(newShard->keys)), because these
@@ -566,11 +1004,14 @@ public:
 		shards.insert( newShard->keys, Reference<ShardInfo>(newShard) );
 	}
 	void addMutation(Version version, MutationRef const& mutation, KeyRangeRef const& shard, UpdateEagerReadInfo* eagerReads );
+	Future<Version> addWatch(KeyRef key, Optional<Value> value, Version version);
+	void pruneWatches(KeyRef key);
 	void setInitialVersion(Version ver) {
 		version = ver;
 		desiredOldestVersion = ver;
 		oldestVersion = ver;
 		durableVersion = ver;
+		knownCommittedVersion = ver;
 		lastVersionWithData = ver;
 		restoredVersion = ver;
 
@@ -638,6 +1079,19 @@ public:
 		promise.sendError(err);
 	}
 
+	template <class Reply>
+	static void sendErrorWithPenalty(const ReplyPromiseStream<Reply>& stream, const Error& err, double) {
+		stream.sendError(err);
+	}
+
+	// Returns when the read queue admits a read of the given cost, sent with reply (a ReplyPromise or
+	// ReplyPromiseStream) at a ReadPriority.  Reads from this process share one client identity.
+	template <class ReplyPromiseType>
+	Future<Void> takeReadSlot( ReplyPromiseType const& reply, int priority, int64_t cost ) {
+		NetworkAddress client = reply.isRemote() ? reply.getEndpoint().getPrimaryAddress() : NetworkAddress();
+		return readQueue.take( std::max<int>(0, std::min<int>(priority, READ_PRIORITY_COUNT - 1)), client, cost );
+	}
+
 	template<class Request, class HandleFunction>
 	Future<Void> readGuard(const Request& request, const HandleFunction& fun) {
 		auto rate = currentRate();
@@ -825,6 +1279,32 @@ ACTOR Future<Version> waitForVersionNoTooOld( StorageServer* data, Version versi
 	}
 }
 
+// Like waitForVersion(), but also accepts versions before those in memory that the storage engine's commits may serve.
+// The caller must check the keys it reads with StorageHistory::canRead().
+Future<Version> waitForVersionOrHistory( StorageServer* data, Version version ) {
+	Version oldest = data->engineHistory.oldestVersion();
+	if (oldest != invalidVersion && version != latestVersion && version >= oldest && version < data->oldestVersion.get())
+		return version;
+	return waitForVersion( data, version );
+}
+
+// Whether reads at version are still served, from memory or from the storage engine's commits
+bool canReadVersion( StorageServer* data, Version version ) {
+	Version oldest = data->engineHistory.oldestVersion();
+	return version >= data->oldestVersion.get() || (oldest != invalidVersion && version >= oldest);
+}
+
+ACTOR Future<Optional<Value>> readValueFromHistory( StorageServer* data, Key key, Version version, Optional<UID> debugID ) {
+	if (!data->engineHistory.canRead(version, singleKeyRange(key))) throw transaction_too_old();
+	try {
+		Optional<Value> v = wait( data->storage.readValueAtVersion(key, version, debugID) );
+		return v;
+	} catch (Error& e) {
+		if (e.code() == error_code_version_invalid) throw transaction_too_old();
+		throw;
+	}
+}
+
 ACTOR Future<Void> getValueQ( StorageServer* data, GetValueRequest req ) {
 	state int64_t resultSize = 0;
 
@@ -842,7 +1322,9 @@ ACTOR Future<Void> getValueQ( StorageServer* data, GetValueRequest req ) {
 			g_traceBatch.addEvent("GetValueDebug", req.debugID.get().first(), "getValueQ.DoRead"); //.detail("TaskID", g_network->getCurrentTask());
 
 		state Optional<Value> v;
-		state Version version = wait( waitForVersion( data, req.version ) );
+		state Version version = wait( waitForVersionOrHistory( data, req.version ) );
+		wait( data->takeReadSlot( req.reply, req.priority, 1 ) );
+		state StorageReadQueue::Releaser readSlot( data->readQueue );
 		if( req.debugID.present() )
 			g_traceBatch.addEvent("GetValueDebug", req.debugID.get().first(), "getValueQ.AfterVersion"); //.detail("TaskID", g_network->getCurrentTask());
 
@@ -854,20 +1336,27 @@ ACTOR Future<Void> getValueQ( StorageServer* data, GetValueRequest req ) {
 		}
 
 		state int path = 0;
-		auto i = data->data().at(version).lastLessOrEqual(req.key);
-		if (i && i->isValue() && i.key() == req.key) {
-			v = (Value)i->getValue();
-			path = 1;
-		} else if (!i || !i->isClearTo() || i->getEndKey() <= req.key) {
+		if (version < data->storageVersion()) {
 			path = 2;
-			Optional<Value> vv = wait( data->storage.readValue( req.key, req.debugID ) );
-			// Validate that while we were reading the data we didn't lose the version or shard
-			if (version < data->storageVersion()) {
-				TEST(true); // transaction_too_old after readValue
-				throw transaction_too_old();
-			}
+			Optional<Value> hv = wait( readValueFromHistory( data, req.key, version, req.debugID ) );
 			data->checkChangeCounter(changeCounter, req.key);
-			v = vv;
+			v = hv;
+		} else {
+			auto i = data->data().at(version).lastLessOrEqual(req.key);
+			if (i && i->isValue() && i.key() == req.key) {
+				v = (Value)i->getValue();
+				path = 1;
+			} else if (!i || !i->isClearTo() || i->getEndKey() <= req.key) {
+				path = 2;
+				Optional<Value> vv = wait( data->storage.readValue( req.key, req.debugID ) );
+				// Validate that while we were reading the data we didn't lose the version or shard
+				if (version < data->storageVersion()) {
+					TEST(true); // transaction_too_old after readValue
+					throw transaction_too_old();
+				}
+				data->checkChangeCounter(changeCounter, req.key);
+				v = vv;
+			}
 		}
 
 		debugMutation("ShardGetValue", version, MutationRef(MutationRef::DebugKey, req.key, v.present()?v.get():LiteralStringRef("<null>")));
@@ -919,74 +1408,241 @@ ACTOR Future<Void> getValueQ( StorageServer* data, GetValueRequest req ) {
 	return Void();
 };
 
-ACTOR Future<Void> watchValue_impl( StorageServer* data, WatchValueRequest req ) {
+ACTOR Future<Void> getValuesQ( StorageServer* data, GetValuesRequest req ) {
+	state int64_t resultSize = 0;
+
 	try {
-		++data->counters.watchQueries;
+		++data->counters.getValuesQueries;
+		++data->counters.allQueries;
+		++data->readQueueSizeMetric;
+		data->maxQueryQueue = std::max<int>( data->maxQueryQueue, data->counters.allQueries.getValue() - data->counters.finishedQueries.getValue());
+
+		// Active load balancing runs at a very high priority (to obtain accurate queue lengths)
+		// so we need to downgrade here
+		wait( delay(0, TaskPriority::DefaultEndpoint) );
 
 		if( req.debugID.present() )
-			g_traceBatch.addEvent("WatchValueDebug", req.debugID.get().first(), "watchValueQ.Before"); //.detail("TaskID", g_network->getCurrentTask());
+			g_traceBatch.addEvent("GetValueDebug", req.debugID.get().first(), "getValuesQ.DoRead");
 
-		wait(success(waitForVersionNoTooOld(data, req.version)));
+		state Version version = wait( waitForVersionOrHistory( data, req.version ) );
+		// Each key costs what a point read does.  The client only batches reads at the default priority.
+		wait( data->takeReadSlot( req.reply, READ_PRIORITY_DEFAULT, std::max<int64_t>(1, req.keys.size()) ) );
+		state StorageReadQueue::Releaser readSlot( data->readQueue );
 		if( req.debugID.present() )
-			g_traceBatch.addEvent("WatchValueDebug", req.debugID.get().first(), "watchValueQ.AfterVersion"); //.detail("TaskID", g_network->getCurrentTask());
+			g_traceBatch.addEvent("GetValueDebug", req.debugID.get().first(), "getValuesQ.AfterVersion");
 
-		loop {
-			try {
-				state Version latest = data->data().latestVersion;
-				state Future<Void> watchFuture = data->watches.onChange(req.key);
-				GetValueRequest getReq( req.key, latest, req.debugID );
-				state Future<Void> getValue = getValueQ( data, getReq ); //we are relying on the delay zero at the top of getValueQ, if removed we need one here
-				GetValueReply reply = wait( getReq.reply.getFuture() );
-				//TraceEvent("WatcherCheckValue").detail("Key",  req.key  ).detail("Value",  req.value  ).detail("CurrentValue",  v  ).detail("Ver", latest);
-
-				if(reply.error.present()) {
-					throw reply.error.get();
+		state uint64_t changeCounter = data->shardChangeCounter;
+
+		for (auto& key : req.keys) {
+			if (!data->shards[key]->isReadable()) {
+				throw wrong_shard_server();
+			}
+		}
+
+		// Answer what we can from the versioned map and read the rest from storage as one batch, which is sorted
+		// because req.keys is
+		state std::vector<Optional<Value>> values(req.keys.size());
+		state std::vector<int> storageIndexes;
+		state std::vector<std::pair<KeyRef, int>> storageKeys;
+		if (req.keys.size() && version < data->storageVersion()) {
+			// The version is older than the versioned map, so every key is read from the storage engine's commits
+			state std::vector<Future<Optional<Value>>> historyValues;
+			for (auto& key : req.keys) {
+				historyValues.push_back( readValueFromHistory( data, key, version, req.debugID ) );
+			}
+			wait( waitForAll(historyValues) );
+			data->checkChangeCounter(changeCounter, KeyRangeRef(req.keys.front(), keyAfter(req.keys.back())));
+			for (int k = 0; k < req.keys.size(); k++) {
+				values[k] = historyValues[k].get();
+			}
+		} else {
+			auto view = data->data().at(version);
+			for (int k = 0; k < req.keys.size(); k++) {
+				auto i = view.lastLessOrEqual(req.keys[k]);
+				if (i && i->isValue() && i.key() == req.keys[k]) {
+					values[k] = (Value)i->getValue();
+				} else if (!i || !i->isClearTo() || i->getEndKey() <= req.keys[k]) {
+					storageIndexes.push_back(k);
+					storageKeys.emplace_back(req.keys[k], CLIENT_KNOBS->VALUE_SIZE_LIMIT);
 				}
+			}
+		}
 
-				debugMutation("ShardWatchValue", latest, MutationRef(MutationRef::DebugKey, req.key, reply.value.present() ? StringRef( reply.value.get() ) : LiteralStringRef("<null>") ) );
+		if (storageKeys.size()) {
+			std::vector<Optional<Value>> storageValues = wait( data->storage.readValuePrefixes(storageKeys, req.debugID) );
+			// Validate that while we were reading the data we didn't lose the version or shard
+			if (version < data->storageVersion()) {
+				TEST(true); // transaction_too_old after readValuePrefixes in getValuesQ
+				throw transaction_too_old();
+			}
+			data->checkChangeCounter(changeCounter, KeyRangeRef(req.keys.front(), keyAfter(req.keys.back())));
+			for (int r = 0; r < storageValues.size(); r++) {
+				values[storageIndexes[r]] = storageValues[r];
+			}
+		}
 
-				if( req.debugID.present() )
-					g_traceBatch.addEvent("WatchValueDebug", req.debugID.get().first(), "watchValueQ.AfterRead"); //.detail("TaskID", g_network->getCurrentTask());
+		GetValuesReply reply;
+		for (int k = 0; k < req.keys.size(); k++) {
+			const KeyRef& key = req.keys[k];
+			if (values[k].present()) {
+				++data->counters.rowsQueried;
+				resultSize += values[k].get().size();
+				reply.data.push_back_deep(reply.arena, KeyValueRef(key, values[k].get()));
+			} else {
+				++data->counters.emptyQueries;
+			}
 
-				if( reply.value != req.value ) {
-					req.reply.send(WatchValueReply{ latest });
-					return Void();
-				}
+			if (SERVER_KNOBS->READ_SAMPLING_ENABLED) {
+				// If the read yields no value, randomly sample the empty read.
+				int64_t bytesReadPerKSecond =
+				    values[k].present() ? std::max((int64_t)(key.size() + values[k].get().size()), SERVER_KNOBS->EMPTY_READ_PENALTY)
+				                        : SERVER_KNOBS->EMPTY_READ_PENALTY;
+				data->metrics.notifyBytesReadPerKSecond(key, bytesReadPerKSecond);
+			}
+		}
+		data->counters.bytesQueried += resultSize;
+
+		if( req.debugID.present() )
+			g_traceBatch.addEvent("GetValueDebug", req.debugID.get().first(), "getValuesQ.AfterRead");
+
+		reply.penalty = data->getPenalty();
+		req.reply.send(reply);
+	} catch (Error& e) {
+		if(!canReplyWith(e))
+			throw;
+		data->sendErrorWithPenalty(req.reply, e, data->getPenalty());
+	}
+
+	++data->counters.finishedQueries;
+	--data->readQueueSizeMetric;
+	if(data->latencyBandConfig.present()) {
+		int maxReadBytes = data->latencyBandConfig.get().readConfig.maxReadBytes.orDefault(std::numeric_limits<int>::max());
+		data->counters.readLatencyBands.addMeasurement(timer() - req.requestTime(), resultSize > maxReadBytes);
+	}
+
+	return Void();
+}
 
-				if( data->watchBytes > SERVER_KNOBS->MAX_STORAGE_SERVER_WATCH_BYTES ) {
-					TEST(true); //Too many watches, reverting to polling
-					data->sendErrorWithPenalty(req.reply, watch_cancelled(), data->getPenalty());
-					return Void();
+ACTOR Future<Void> watchKeyChanges( StorageServer* data, Reference<KeyWatch> watch ) {
+	try {
+		loop {
+			watch->isCurrent = false;
+			state Version latest = data->data().latestVersion;
+			state Future<Void> changed = data->watches.onChange(watch->key);
+			GetValueRequest getReq( watch->key, latest, Optional<UID>(), READ_PRIORITY_IMMEDIATE );
+			state Future<Void> getValue = getValueQ( data, getReq ); //we are relying on the delay zero at the top of getValueQ, if removed we need one here
+			GetValueReply reply = wait( getReq.reply.getFuture() );
+
+			if(reply.error.present()) {
+				if(reply.error.get().code() == error_code_transaction_too_old) {
+					continue;
 				}
+				throw reply.error.get();
+			}
 
-				++data->numWatches;
-				data->watchBytes += ( req.key.expectedSize() + req.value.expectedSize() + 1000 );
-				try {
-					wait( watchFuture );
+			debugMutation("ShardWatchValue", latest, MutationRef(MutationRef::DebugKey, watch->key, reply.value.present() ? StringRef( reply.value.get() ) : LiteralStringRef("<null>") ) );
+
+			// A watcher that read the key after latest might have read a newer value than this one; if the key has
+			// been mutated since latest it is checked again on the next pass
+			bool readIsCurrent = !changed.isReady();
+			std::vector<Promise<Version>> toFire;
+			int kept = 0;
+			for(int i = 0; i < watch->watchers.size(); i++) {
+				KeyWatch::Watcher& w = watch->watchers[i];
+				bool fire = w.value != reply.value && (w.version <= latest || readIsCurrent);
+				if(fire || !w.fired.getFutureReferenceCount()) {
+					if(fire) toFire.push_back(w.fired);
 					--data->numWatches;
-					data->watchBytes -= ( req.key.expectedSize() + req.value.expectedSize() + 1000 );
-				} catch( Error &e ) {
-					--data->numWatches;
-					data->watchBytes -= ( req.key.expectedSize() + req.value.expectedSize() + 1000 );
-					throw;
+					data->watchBytes -= watcherBytes(w);
+				} else {
+					if(kept != i) watch->watchers[kept] = std::move(w);
+					++kept;
 				}
-			} catch( Error &e ) {
-				if( e.code() != error_code_transaction_too_old )
-					throw;
 			}
+			watch->watchers.erase(watch->watchers.begin() + kept, watch->watchers.end());
+			watch->value = reply.value;
+			watch->version = latest;
+			watch->isCurrent = readIsCurrent;
+
+			// The registry is up to date before anything fires, because firing a watcher can add another one
+			bool done = watch->watchers.empty();
+			if(done) {
+				data->watchRegistry.erase(watch->key);
+				data->watchBytes -= keyWatchBytes(watch->key);
+			}
+			for(int i = 0; i < toFire.size(); i++) {
+				toFire[i].send(latest);
+			}
+			if(done) {
+				return Void();
+			}
+			wait( changed );
 		}
 	} catch (Error& e) {
-		if(!canReplyWith(e))
+		if(e.code() == error_code_actor_cancelled) {
 			throw;
-		data->sendErrorWithPenalty(req.reply, e, data->getPenalty());
+		}
+		auto it = data->watchRegistry.find(watch->key);
+		if(it != data->watchRegistry.end() && it->second == watch) {
+			data->watchRegistry.erase(it);
+			data->watchBytes -= keyWatchBytes(watch->key);
+		}
+		std::vector<KeyWatch::Watcher> watchers = std::move(watch->watchers);
+		watch->watchers.clear();
+		for(int i = 0; i < watchers.size(); i++) {
+			--data->numWatches;
+			data->watchBytes -= watcherBytes(watchers[i]);
+			watchers[i].fired.sendError(e);
+		}
 	}
 	return Void();
 }
 
-ACTOR Future<Void> watchValueQ( StorageServer* data, WatchValueRequest req ) {
-	state Future<Void> watch = watchValue_impl( data, req );
-	state double startTime = now();
+// Returns a future that is set to a version at which key no longer has value, given that it had value at version
+Future<Version> StorageServer::addWatch(KeyRef key, Optional<Value> value, Version version) {
+	auto& watch = watchRegistry[key];
+	if(!watch) {
+		watch = Reference<KeyWatch>(new KeyWatch(key));
+		watchBytes += keyWatchBytes(key);
+		watch->checker = watchKeyChanges(this, watch);
+	} else if(watch->isCurrent && watch->value != value) {
+		TEST(true); // Watch fired without reading the key
+		return data().latestVersion;
+	}
+
+	watch->watchers.emplace_back(value, version);
+	++numWatches;
+	watchBytes += watcherBytes(watch->watchers.back());
+	return watch->watchers.back().fired.getFuture();
+}
 
+// Forgets the watchers of key that nobody is waiting on any more, and stops checking key if none are left
+void StorageServer::pruneWatches(KeyRef key) {
+	auto it = watchRegistry.find(key);
+	if(it == watchRegistry.end()) return;
+
+	Reference<KeyWatch> watch = it->second;
+	int kept = 0;
+	for(int i = 0; i < watch->watchers.size(); i++) {
+		if(!watch->watchers[i].fired.getFutureReferenceCount()) {
+			--numWatches;
+			watchBytes -= watcherBytes(watch->watchers[i]);
+		} else {
+			if(kept != i) watch->watchers[kept] = std::move(watch->watchers[i]);
+			++kept;
+		}
+	}
+	watch->watchers.erase(watch->watchers.begin() + kept, watch->watchers.end());
+
+	if(watch->watchers.empty()) {
+		watchRegistry.erase(it);
+		watchBytes -= keyWatchBytes(key);
+		watch->checker.cancel();
+	}
+}
+
+// Returns when the watch request has been outstanding longer than the client will wait for it
+ACTOR Future<Void> watchTimeout( StorageServer* data, double startTime ) {
 	loop {
 		double timeoutDelay = -1;
 		if(data->noRecentUpdates.get()) {
@@ -995,11 +1651,7 @@ ACTOR Future<Void> watchValueQ( StorageServer* data, WatchValueRequest req ) {
 			timeoutDelay = std::max(CLIENT_KNOBS->WATCH_TIMEOUT - (now() - startTime), 0.0);
 		}
 		choose {
-			when( wait( watch ) ) {
-				return Void();
-			}
 			when( wait( timeoutDelay < 0 ? Never() : delay(timeoutDelay) ) ) {
-				data->sendErrorWithPenalty(req.reply, timed_out(), data->getPenalty());
 				return Void();
 			}
 			when( wait( data->noRecentUpdates.onChange()) ) {}
@@ -1007,6 +1659,133 @@ ACTOR Future<Void> watchValueQ( StorageServer* data, WatchValueRequest req ) {
 	}
 }
 
+// Used instead of a watch when the storage server already holds too many.  Returns the latest version if key no
+// longer has value, so that the watch can fire at once, and otherwise throws watch_cancelled so the client polls.
+ACTOR Future<Version> watchOverBudget( StorageServer* data, Key key, Optional<Value> value ) {
+	TEST(true); //Too many watches, reverting to polling
+	state Version latest = data->data().latestVersion;
+	GetValueRequest getReq( key, latest, Optional<UID>(), READ_PRIORITY_IMMEDIATE );
+	state Future<Void> getValue = getValueQ( data, getReq );
+	GetValueReply reply = wait( getReq.reply.getFuture() );
+	if( !reply.error.present() && reply.value != value ) {
+		TEST(true); // Watch over budget fired because its key had already changed
+		return latest;
+	}
+	throw watch_cancelled();
+}
+
+ACTOR Future<Void> watchValue_impl( StorageServer* data, WatchValueRequest req ) {
+	state Future<Version> fired;
+	try {
+		++data->counters.watchQueries;
+
+		if( req.debugID.present() )
+			g_traceBatch.addEvent("WatchValueDebug", req.debugID.get().first(), "watchValueQ.Before"); //.detail("TaskID", g_network->getCurrentTask());
+
+		wait(success(waitForVersionNoTooOld(data, req.version)));
+		if( req.debugID.present() )
+			g_traceBatch.addEvent("WatchValueDebug", req.debugID.get().first(), "watchValueQ.AfterVersion"); //.detail("TaskID", g_network->getCurrentTask());
+
+		if( data->watchBytes > SERVER_KNOBS->MAX_STORAGE_SERVER_WATCH_BYTES ) {
+			Version version = wait( watchOverBudget( data, req.key, req.value ) );
+			req.reply.send(WatchValueReply{ version });
+			return Void();
+		}
+
+		fired = data->addWatch(req.key, req.value, req.version);
+		Version version = wait( fired );
+
+		if( req.debugID.present() )
+			g_traceBatch.addEvent("WatchValueDebug", req.debugID.get().first(), "watchValueQ.AfterRead"); //.detail("TaskID", g_network->getCurrentTask());
+
+		req.reply.send(WatchValueReply{ version });
+	} catch (Error& e) {
+		if(fired.isValid() && !fired.isReady()) {
+			fired = Future<Version>();
+			data->pruneWatches(req.key);
+		}
+		if(!canReplyWith(e) && e.code() != error_code_watch_cancelled)
+			throw;
+		data->sendErrorWithPenalty(req.reply, e, data->getPenalty());
+	}
+	return Void();
+}
+
+ACTOR Future<Void> watchValueQ( StorageServer* data, WatchValueRequest req ) {
+	choose {
+		when( wait( watchValue_impl( data, req ) ) ) {}
+		when( wait( watchTimeout( data, now() ) ) ) {
+			data->sendErrorWithPenalty(req.reply, timed_out(), data->getPenalty());
+		}
+	}
+	return Void();
+}
+
+// Watches many keys of one shard.  Replies once any of them changes, after waiting briefly for others that change at
+// about the same time, with every watch that fired.
+ACTOR Future<Void> watchValuesQ( StorageServer* data, WatchValuesRequest req ) {
+	state std::vector<Future<ErrorOr<Version>>> fired;
+	state double startTime = now();
+	try {
+		data->counters.watchQueries += req.watches.size();
+
+		wait(success(waitForVersionNoTooOld(data, req.version)));
+
+		// Each watch is charged as it is added, so the keys after the budget runs out only fire if they have already
+		// changed
+		for(int i = 0; i < req.watches.size(); i++) {
+			Key key = req.watches[i].key;
+			Optional<Value> value = req.watches[i].value.castTo<Value>();
+			if( data->watchBytes > SERVER_KNOBS->MAX_STORAGE_SERVER_WATCH_BYTES ) {
+				fired.push_back(errorOr(watchOverBudget(data, key, value)));
+			} else {
+				fired.push_back(errorOr(data->addWatch(key, value, req.version)));
+			}
+		}
+
+		choose {
+			when( wait( waitForAny(fired) ) ) {}
+			when( wait( watchTimeout( data, startTime ) ) ) {
+				throw timed_out();
+			}
+		}
+		wait( delay(SERVER_KNOBS->WATCH_FIRE_BATCH_DELAY) );
+
+		WatchValuesReply reply;
+		Optional<Error> err;
+		for(int i = 0; i < fired.size(); i++) {
+			if(!fired[i].isReady()) continue;
+			if(fired[i].get().isError()) {
+				err = fired[i].get().getError();
+			} else {
+				reply.fired.push_back(i);
+				reply.version = std::max(reply.version, fired[i].get().get());
+			}
+		}
+		if(reply.fired.empty()) {
+			throw err.get();
+		}
+		TEST(reply.fired.size() > 1); // Several watches fired in one reply
+
+		fired.clear();
+		for(int i = 0; i < req.watches.size(); i++) {
+			data->pruneWatches(req.watches[i].key);
+		}
+		req.reply.send(reply);
+	} catch (Error& e) {
+		if(!fired.empty()) {
+			fired.clear();
+			for(int i = 0; i < req.watches.size(); i++) {
+				data->pruneWatches(req.watches[i].key);
+			}
+		}
+		if(!canReplyWith(e) && e.code() != error_code_watch_cancelled && e.code() != error_code_timed_out)
+			throw;
+		data->sendErrorWithPenalty(req.reply, e, data->getPenalty());
+	}
+	return Void();
+}
+
 ACTOR Future<Void> getShardState_impl( StorageServer* data, GetShardStateRequest req ) {
 	ASSERT( req.mode != GetShardStateRequest::NO_WAIT );
 
@@ -1086,8 +1865,8 @@ void merge( Arena& arena, VectorRef<KeyValueRef, VecSerStrategy::String>& output
 }
 
 // If limit>=0, it returns the first rows in the range (sorted ascending), otherwise the last rows (sorted descending).
-// readRange has O(|result|) + O(log |data|) cost
-ACTOR Future<GetKeyValuesReply> readRange( StorageServer* data, Version version, KeyRange range, int limit, int* pLimitBytes ) {
+// readRangeFromMVCC has O(|result|) + O(log |data|) cost
+ACTOR Future<GetKeyValuesReply> readRangeFromMVCC( StorageServer* data, Version version, KeyRange range, int limit, int* pLimitBytes ) {
 	state GetKeyValuesReply result;
 	state StorageServer::VersionedData::ViewAtVersion view = data->data().at(version);
 	state StorageServer::VersionedData::iterator vStart = view.end();
@@ -1236,6 +2015,36 @@ ACTOR Future<GetKeyValuesReply> readRange( StorageServer* data, Version version,
 	return result;
 }
 
+// Like readRangeFromMVCC(), for a version before those in memory, which is read from the storage engine's commit at or
+// before it
+ACTOR Future<GetKeyValuesReply> readRangeFromHistory( StorageServer* data, Version version, KeyRange range, int limit, int* pLimitBytes ) {
+	state GetKeyValuesReply result;
+	if (!data->engineHistory.canRead(version, range)) throw transaction_too_old();
+	try {
+		Standalone<RangeResultRef> atVersion = wait( data->storage.readRangeAtVersion( range, version, limit, *pLimitBytes ) );
+		result.arena.dependsOn( atVersion.arena() );
+		result.data.append( result.arena, atVersion.begin(), atVersion.size() );
+		for (auto& kv : atVersion) {
+			*pLimitBytes -= sizeof(KeyValueRef) + kv.expectedSize();
+		}
+		result.more = limit == 0 || atVersion.more;
+	} catch (Error& e) {
+		if (e.code() == error_code_version_invalid) throw transaction_too_old();
+		throw;
+	}
+
+	auto cached = data->cachedRangeMap.intersectingRanges(range);
+	result.cached = (cached.begin() != cached.end());
+	result.version = version;
+	return result;
+}
+
+Future<GetKeyValuesReply> readRange( StorageServer* data, Version version, KeyRange range, int limit, int* pLimitBytes ) {
+	if (version < data->storageVersion())
+		return readRangeFromHistory( data, version, range, limit, pLimitBytes );
+	return readRangeFromMVCC( data, version, range, limit, pLimitBytes );
+}
+
 //bool selectorInRange( KeySelectorRef const& sel, KeyRangeRef const& range ) {
 	// Returns true if the given range suffices to at least begin to resolve the given KeySelectorRef
 //	return sel.getKey() >= range.begin && (sel.isBackward() ? sel.getKey() <= range.end : sel.getKey() < range.end);
@@ -1251,7 +2060,7 @@ ACTOR Future<Key> findKey( StorageServer* data, KeySelectorRef sel, Version vers
 // The range passed in to this function should specify a shard.  If range.begin is repeatedly not the beginning of a shard, then it is possible to get stuck looping here
 {
 	ASSERT( version != latestVersion );
-	ASSERT( selectorInRange(sel, range) && version >= data->oldestVersion.get() );
+	ASSERT( selectorInRange(sel, range) && canReadVersion(data, version) );
 
 	// Count forward or backward distance items, skipping the first one if it == key and skipEqualKey
 	state bool forward = sel.offset > 0;                  // If forward, result >= sel.getKey(); else result <= sel.getKey()
@@ -1353,7 +2162,9 @@ ACTOR Future<Void> getKeyValues( StorageServer* data, GetKeyValuesRequest req )
 	try {
 		if( req.debugID.present() )
 			g_traceBatch.addEvent("TransactionDebug", req.debugID.get().first(), "storageserver.getKeyValues.Before");
-		state Version version = wait( waitForVersion( data, req.version ) );
+		state Version version = wait( waitForVersionOrHistory( data, req.version ) );
+		wait( data->takeReadSlot( req.reply, req.priority, 1 + req.limitBytes / SERVER_KNOBS->STORAGE_READ_QUEUE_COST_BYTES ) );
+		state StorageReadQueue::Releaser readSlot( data->readQueue );
 
 		state uint64_t changeCounter = data->shardChangeCounter;
 //		try {
@@ -1467,6 +2278,358 @@ ACTOR Future<Void> getKeyValues( StorageServer* data, GetKeyValuesRequest req )
 	return Void();
 }
 
+ACTOR Future<Void> getKeyValuesStreamQ( StorageServer* data, GetKeyValuesStreamRequest req )
+// Like getKeyValues, but sends the range as a sequence of replies over req.reply instead of stopping at the first
+// batch.  Each batch waits until the client has acknowledged enough of the previous ones.
+{
+	state int64_t resultSize = 0;
+
+	// Let fetchKeys keep a block in flight while it writes the previous one
+	req.reply.setByteLimit(req.isFetchKeys ? std::max<int64_t>(SERVER_KNOBS->RANGESTREAM_LIMIT_BYTES, 2 * SERVER_KNOBS->FETCH_BLOCK_BYTES)
+	                                       : SERVER_KNOBS->RANGESTREAM_LIMIT_BYTES);
+	++data->counters.getRangeStreamQueries;
+	++data->counters.allQueries;
+	++data->readQueueSizeMetric;
+	data->maxQueryQueue = std::max<int>( data->maxQueryQueue, data->counters.allQueries.getValue() - data->counters.finishedQueries.getValue());
+
+	// Active load balancing runs at a very high priority (to obtain accurate queue lengths)
+	// so we need to downgrade here
+	state TaskPriority taskType = TaskPriority::DefaultEndpoint;
+	if (SERVER_KNOBS->FETCH_KEYS_LOWER_PRIORITY && req.isFetchKeys) {
+		taskType = TaskPriority::FetchKeys;
+	}
+	wait( delay(0, taskType) );
+
+	try {
+		if( req.debugID.present() )
+			g_traceBatch.addEvent("TransactionDebug", req.debugID.get().first(), "storageserver.getKeyValuesStream.Before");
+		state Version version = wait( waitForVersionOrHistory( data, req.version ) );
+
+		state uint64_t changeCounter = data->shardChangeCounter;
+		state KeyRange shard = getShardKeyRange( data, req.begin );
+
+		if( req.debugID.present() )
+			g_traceBatch.addEvent("TransactionDebug", req.debugID.get().first(), "storageserver.getKeyValuesStream.AfterVersion");
+
+		if ( !selectorInRange(req.end, shard) && !(req.end.isFirstGreaterOrEqual() && req.end.getKey() == shard.end) ) {
+			throw wrong_shard_server();
+		}
+
+		state int offset1;
+		state int offset2;
+		state Future<Key> fBegin = req.begin.isFirstGreaterOrEqual() ? Future<Key>(req.begin.getKey()) : findKey( data, req.begin, version, shard, &offset1 );
+		state Future<Key> fEnd = req.end.isFirstGreaterOrEqual() ? Future<Key>(req.end.getKey()) : findKey( data, req.end, version, shard, &offset2 );
+		state Key begin = wait(fBegin);
+		state Key end = wait(fEnd);
+		if( req.debugID.present() )
+			g_traceBatch.addEvent("TransactionDebug", req.debugID.get().first(), "storageserver.getKeyValuesStream.AfterKeys");
+
+		// See getKeyValues for why offsets of 0 and 1 are acceptable
+		if ((offset1 && offset1!=1) || (offset2 && offset2!=1)) {
+			TEST(true);  // wrong_shard_server due to offset in getKeyValuesStream
+			throw wrong_shard_server();
+		}
+
+		if (begin >= end) {
+			GetKeyValuesStreamReply none;
+			none.version = version;
+			none.more = false;
+
+			data->checkChangeCounter( changeCounter, KeyRangeRef( std::min<KeyRef>(req.begin.getKey(), req.end.getKey()), std::max<KeyRef>(req.begin.getKey(), req.end.getKey()) ) );
+			req.reply.send( none );
+		} else {
+			state int remainingLimit = req.limit;
+			state int remainingLimitBytes = req.limitBytes;
+			state KeyRange remaining = KeyRangeRef(begin, end);
+			state StorageReadQueue::Releaser readSlot;
+			// The read version leaves the MVCC window after STORAGE_VERSIONED_MEMORY_VERSIONS when older versions are
+			// read from the storage engine's commits, which keep them for the life of a read transaction
+			state Future<Void> versionExpired = data->engineHistory.enabled
+			    ? data->version.whenAtLeast( version + SERVER_KNOBS->MAX_READ_TRANSACTION_LIFE_VERSIONS )
+			    : data->oldestVersion.whenAtLeast( version+1 );
+
+			loop {
+				// Hold off until the client catches up, but give up once the read version can no longer be served
+				choose {
+					when( wait( req.reply.onReady() ) ) {}
+					when( wait( versionExpired ) ) { throw transaction_too_old(); }
+				}
+
+				// fetchKeys asks for whole shards, so it gets larger fragments to spend less per batch
+				state int fragmentBytes = std::min( remainingLimitBytes, req.isFetchKeys ? SERVER_KNOBS->FETCH_BLOCK_BYTES : SERVER_KNOBS->RANGESTREAM_FRAGMENT_BYTES );
+				state int fragmentBytesLeft = fragmentBytes;
+
+				// Each batch is read in its own slot, so that a stream waiting on its client holds none
+				wait( data->takeReadSlot( req.reply, req.priority, 1 + fragmentBytes / SERVER_KNOBS->STORAGE_READ_QUEUE_COST_BYTES ) );
+				readSlot = StorageReadQueue::Releaser( data->readQueue );
+				if (!canReadVersion(data, version)) throw transaction_too_old();
+
+				GetKeyValuesReply _r = wait( readRange(data, version, remaining, remainingLimit, &fragmentBytesLeft) );
+				state GetKeyValuesReply r = _r;
+				readSlot.release();
+
+				data->checkChangeCounter( changeCounter, KeyRangeRef( std::min<KeyRef>(begin, std::min<KeyRef>(req.begin.getKey(), req.end.getKey())), std::max<KeyRef>(end, std::max<KeyRef>(req.begin.getKey(), req.end.getKey())) ) );
+				if (EXPENSIVE_VALIDATION) {
+					for (int i = 0; i < r.data.size(); i++)
+						ASSERT(r.data[i].key >= remaining.begin && r.data[i].key < remaining.end);
+					ASSERT(r.data.size() <= std::abs(remainingLimit));
+				}
+
+				// For performance concerns, the cost of a range read is billed to the start key and end key of each batch.
+				int64_t totalByteSize = 0;
+				for (int i = 0; i < r.data.size(); i++) {
+					totalByteSize += r.data[i].expectedSize();
+				}
+				if (totalByteSize > 0 && SERVER_KNOBS->READ_SAMPLING_ENABLED) {
+					int64_t bytesReadPerKSecond = std::max(totalByteSize, SERVER_KNOBS->EMPTY_READ_PENALTY) / 2;
+					data->metrics.notifyBytesReadPerKSecond(r.data[0].key, bytesReadPerKSecond);
+					data->metrics.notifyBytesReadPerKSecond(r.data[r.data.size() - 1].key, bytesReadPerKSecond);
+				}
+
+				remainingLimit -= (req.limit < 0 ? -r.data.size() : r.data.size());
+				remainingLimitBytes -= fragmentBytes - fragmentBytesLeft;
+				resultSize += fragmentBytes - fragmentBytesLeft;
+				data->counters.bytesQueried += fragmentBytes - fragmentBytesLeft;
+				data->counters.rowsQueried += r.data.size();
+
+				// readRange only stops short of the range because of the limits, so more from readRange means
+				// there is data left in this fragment's range
+				bool finished = !r.more || remainingLimit == 0 || remainingLimitBytes <= 0;
+
+				GetKeyValuesStreamReply reply;
+				reply.arena = r.arena;
+				reply.data = r.data;
+				reply.version = version;
+				reply.more = r.more;
+				reply.cached = r.cached;
+				if (req.isFetchKeys) reply.checksum = reply.dataChecksum();
+				req.reply.send( reply );
+
+				if (finished) break;
+
+				if (req.limit >= 0)
+					remaining = KeyRangeRef(keyAfter(r.data.back().key), remaining.end);
+				else
+					remaining = KeyRangeRef(remaining.begin, r.data.back().key);
+			}
+
+			if( req.debugID.present() )
+				g_traceBatch.addEvent("TransactionDebug", req.debugID.get().first(), "storageserver.getKeyValuesStream.AfterReadRange");
+			if(resultSize == 0) {
+				++data->counters.emptyQueries;
+			}
+		}
+		req.reply.sendError( end_of_stream() );
+	} catch (Error& e) {
+		if(!canReplyWith(e) && e.code() != error_code_operation_obsolete)
+			throw;
+		data->sendErrorWithPenalty(req.reply, e, data->getPenalty());
+	}
+
+	// A stream's latency depends on how fast the client consumes it, so it is not added to readLatencyBands
+	++data->counters.finishedQueries;
+	--data->readQueueSizeMetric;
+
+	return Void();
+}
+
+// Errors of reading a mapped record that the client reports, as it would if it had read the record itself
+inline bool isMappedRecordsError(Error const& e) {
+	return e.code() == error_code_key_outside_legal_range || e.code() == error_code_key_too_large;
+}
+
+ACTOR Future<Standalone<RangeResultRef>> readMappedRecords( StorageServer* data, KeyRange records, bool isRangeQuery, Version version, int limitBytes )
+// Reads the records an index entry maps to, from this server's own data when it holds all of them and through the
+// database otherwise.  A range of records stops after about limitBytes, with more set in the result.
+{
+	wait( data->mappedRecordsLock.take() );
+	state FlowLock::Releaser holding( data->mappedRecordsLock );
+
+	auto shard = data->shards.rangeContaining(records.begin);
+	if (shard->value()->isReadable() && shard->range().contains(records)) {
+		++data->counters.mappedLocalReads;
+		state uint64_t changeCounter = data->shardChangeCounter;
+		state Standalone<RangeResultRef> result;
+		state bool fromHistory = version < data->storageVersion();
+		if (isRangeQuery) {
+			GetKeyValuesReply r = wait( readRange(data, version, records, std::numeric_limits<int>::max(), &limitBytes) );
+			result.arena().dependsOn(r.arena);
+			result.append(result.arena(), r.data.begin(), r.data.size());
+			result.more = r.more;
+		} else {
+			state Optional<Value> v;
+			if (fromHistory) {
+				Optional<Value> hv = wait( readValueFromHistory(data, records.begin, version, Optional<UID>()) );
+				v = hv;
+			} else {
+				auto i = data->data().at(version).lastLessOrEqual(records.begin);
+				if (i && i->isValue() && i.key() == records.begin) {
+					v = (Value)i->getValue();
+				} else if (!i || !i->isClearTo() || i->getEndKey() <= records.begin) {
+					Optional<Value> vv = wait( data->storage.readValue(records.begin) );
+					v = vv;
+				}
+			}
+			if (v.present()) {
+				result.push_back_deep(result.arena(), KeyValueRef(records.begin, v.get()));
+			}
+		}
+
+		// Validate that while we were reading the data we didn't lose the version or shard
+		if (!fromHistory && version < data->storageVersion()) {
+			TEST(true); // transaction_too_old after reading mapped records
+			throw transaction_too_old();
+		}
+		data->checkChangeCounter(changeCounter, records);
+		return result;
+	}
+
+	++data->counters.mappedRemoteReads;
+	state Transaction tr(data->cx);
+	tr.setVersion(version);
+	try {
+		if (isRangeQuery) {
+			GetRangeLimits limits;
+			if (limitBytes != std::numeric_limits<int>::max()) limits.bytes = limitBytes;
+			Standalone<RangeResultRef> r = wait( tr.getRange(records, limits, true) );
+			return r;
+		}
+		Optional<Value> v = wait( tr.get(records.begin, true) );
+		Standalone<RangeResultRef> result;
+		if (v.present()) {
+			result.push_back_deep(result.arena(), KeyValueRef(records.begin, v.get()));
+		}
+		return result;
+	} catch (Error& e) {
+		// The client retries the errors a storage server replies with, and reports bad record keys like its own
+		// reads would.  Anything else is not an error of the request.
+		if (e.code() != error_code_actor_cancelled && !canReplyWith(e) && !isMappedRecordsError(e)) {
+			TraceEvent(SevError, "MappedRecordsReadError", data->thisServerID).error(e).detail("Begin", records.begin);
+		}
+		throw;
+	}
+}
+
+ACTOR Future<Void> getMappedKeyValuesQ( StorageServer* data, GetMappedKeyValuesRequest req )
+// Reads index entries like getKeyValues and joins each of them with the records named by req.mapper.  The keys
+// must lie in a single shard of this server; the records may be anywhere.
+{
+	state int64_t resultSize = 0;
+
+	++data->counters.getMappedRangeQueries;
+	++data->counters.allQueries;
+	++data->readQueueSizeMetric;
+	data->maxQueryQueue = std::max<int>( data->maxQueryQueue, data->counters.allQueries.getValue() - data->counters.finishedQueries.getValue());
+
+	// Active load balancing runs at a very high priority (to obtain accurate queue lengths)
+	// so we need to downgrade here
+	wait( delay(0, TaskPriority::DefaultEndpoint) );
+
+	try {
+		if( req.debugID.present() )
+			g_traceBatch.addEvent("TransactionDebug", req.debugID.get().first(), "storageserver.getMappedKeyValues.Before");
+
+		state Tuple mapper;
+		try {
+			mapper = Tuple::unpack(req.mapper);
+		} catch (Error& e) {
+			throw mapper_not_tuple();
+		}
+
+		state Version version = wait( waitForVersionOrHistory( data, req.version ) );
+		wait( data->takeReadSlot( req.reply, req.priority, 1 + req.limitBytes / SERVER_KNOBS->STORAGE_READ_QUEUE_COST_BYTES ) );
+		state StorageReadQueue::Releaser readSlot( data->readQueue );
+		state uint64_t changeCounter = data->shardChangeCounter;
+		state KeyRange shard = getShardKeyRange( data, firstGreaterOrEqual(req.keys.begin) );
+		if (!shard.contains(req.keys)) {
+			throw wrong_shard_server();
+		}
+
+		if( req.debugID.present() )
+			g_traceBatch.addEvent("TransactionDebug", req.debugID.get().first(), "storageserver.getMappedKeyValues.AfterVersion");
+
+		state int remainingLimitBytes = req.limitBytes;
+		GetKeyValuesReply _index = wait( readRange(data, version, req.keys, req.limit, &remainingLimitBytes) );
+		remainingLimitBytes = std::max(remainingLimitBytes, 1);
+		state GetKeyValuesReply index = _index;
+		data->checkChangeCounter( changeCounter, req.keys );
+		// The records are read under mappedRecordsLock instead, since reading them may wait on this server's own queue
+		readSlot.release();
+
+		// Every record key is built before any record is read, so that a bad mapper fails the request right away
+		state std::vector<Future<Standalone<RangeResultRef>>> records;
+		{
+			std::vector<std::pair<KeyRange, bool>> mapped;
+			for (auto& kv : index.data) {
+				bool isRangeQuery;
+				Tuple mappedKey = constructMappedKey(kv, mapper, isRangeQuery);
+				mapped.emplace_back(isRangeQuery ? mappedKey.range() : singleKeyRange(mappedKey.pack()), isRangeQuery);
+			}
+			// The first entry is always returned whole, and the others only fit in what the index left of the limit
+			for (int i = 0; i < mapped.size(); i++) {
+				records.push_back(readMappedRecords(data, mapped[i].first, mapped[i].second, version,
+				                                    i == 0 ? std::numeric_limits<int>::max() : remainingLimitBytes));
+			}
+		}
+		wait( waitForAll(records) );
+
+		if( req.debugID.present() )
+			g_traceBatch.addEvent("TransactionDebug", req.debugID.get().first(), "storageserver.getMappedKeyValues.AfterRecords");
+
+		// The byte limit covers the records too, so the reply may stop short of the index entries that were read, and
+		// always stops before an entry whose records were cut short
+		GetMappedKeyValuesReply reply;
+		reply.arena.dependsOn(index.arena);
+		reply.more = index.more;
+		for (int i = 0; i < index.data.size(); i++) {
+			MappedKeyValueRef entry;
+			entry.key = index.data[i].key;
+			entry.value = index.data[i].value;
+			entry.records = records[i].get();
+			if (i > 0 && (records[i].get().more || resultSize + entry.expectedSize() > req.limitBytes)) {
+				reply.more = true;
+				break;
+			}
+			resultSize += entry.expectedSize();
+			data->counters.rowsQueried += 1 + entry.records.size();
+			reply.arena.dependsOn(records[i].get().arena());
+			reply.data.push_back(reply.arena, entry);
+		}
+		data->counters.bytesQueried += resultSize;
+		if (reply.data.empty()) {
+			++data->counters.emptyQueries;
+		}
+
+		if (resultSize > 0 && SERVER_KNOBS->READ_SAMPLING_ENABLED) {
+			// As in getKeyValues, the index read is billed to its first and last keys; the records were sampled
+			// by whichever server read them
+			int64_t bytesReadPerKSecond = std::max(resultSize, SERVER_KNOBS->EMPTY_READ_PENALTY) / 2;
+			data->metrics.notifyBytesReadPerKSecond(reply.data[0].key, bytesReadPerKSecond);
+			data->metrics.notifyBytesReadPerKSecond(reply.data[reply.data.size() - 1].key, bytesReadPerKSecond);
+		}
+
+		reply.version = version;
+		reply.cached = index.cached;
+		reply.penalty = data->getPenalty();
+		req.reply.send(reply);
+	} catch (Error& e) {
+		if (!canReplyWith(e) && !isMappedRecordsError(e) && e.code() != error_code_mapper_bad_index &&
+		    e.code() != error_code_mapper_bad_range_descriptor && e.code() != error_code_mapper_not_tuple)
+			throw;
+		data->sendErrorWithPenalty(req.reply, e, data->getPenalty());
+	}
+
+	++data->counters.finishedQueries;
+	--data->readQueueSizeMetric;
+
+	if(data->latencyBandConfig.present()) {
+		int maxReadBytes = data->latencyBandConfig.get().readConfig.maxReadBytes.orDefault(std::numeric_limits<int>::max());
+		data->counters.readLatencyBands.addMeasurement(timer() - req.requestTime(), resultSize > maxReadBytes);
+	}
+
+	return Void();
+}
+
 ACTOR Future<Void> getKey( StorageServer* data, GetKeyRequest req ) {
 	state int64_t resultSize = 0;
 
@@ -1480,7 +2643,9 @@ ACTOR Future<Void> getKey( StorageServer* data, GetKeyRequest req ) {
 	wait( delay(0, TaskPriority::DefaultEndpoint) );
 
 	try {
-		state Version version = wait( waitForVersion( data, req.version ) );
+		state Version version = wait( waitForVersionOrHistory( data, req.version ) );
+		wait( data->takeReadSlot( req.reply, req.priority, 1 ) );
+		state StorageReadQueue::Releaser readSlot( data->readQueue );
 		state uint64_t changeCounter = data->shardChangeCounter;
 		state KeyRange shard = getShardKeyRange( data, req.sel );
 
@@ -1559,11 +2724,8 @@ ACTOR Future<Void> doEagerReads( StorageServer* data, UpdateEagerReadInfo* eager
 
 	state Future<vector<Key>> futureKeyEnds = getAll(keyEnd);
 
-	vector<Future<Optional<Value>>> value( eager->keys.size() );
-	for(int i=0; i<value.size(); i++)
-		value[i] = data->storage.readValuePrefix( eager->keys[i].first, eager->keys[i].second );
-
-	state Future<vector<Optional<Value>>> futureValues = getAll(value);
+	// eager->keys is sorted and unique, so the engine can read all of the atomic op operands in one pass
+	state Future<vector<Optional<Value>>> futureValues = data->storage.readValuePrefixes( eager->keys );
 	state vector<Key> keyEndVal = wait( futureKeyEnds );
 	vector<Optional<Value>> optionalValues = wait ( futureValues);
 
@@ -1597,7 +2759,7 @@ bool changeDurableVersion( StorageServer* data, Version desiredDurableVersion )
 
 		int64_t bytesDurable = VERSION_OVERHEAD;
 		for(auto m = v.mutations.begin(); m; ++m) {
-			bytesDurable += mvccStorageBytes(*m);
+			bytesDurable += mvccStorageBytes(verData, *m);
 			auto i = verData.atLatest().find(m->param1);
 			if (i) {
 				ASSERT( i.key() == m->param1 );
@@ -1667,7 +2829,7 @@ bool expandMutation( MutationRef& m, StorageServer::VersionedData const& data, U
 		i = d.lastLessOrEqual(m.param2);
 		if (i && i->isClearTo() && i->getEndKey() >= m.param2) {
 			m.param2 = i->getEndKey();
-		} else {
+		} else if (SERVER_KNOBS->CLEAR_RANGE_EAGER_READS) {
 			// Expand to the next set or clear (from storage or latestVersion), and if it
 			// is a clear, engulf it as well
 			i = d.lower_bound(m.param2);
@@ -1747,7 +2909,7 @@ void applyMutation( StorageServer *self, MutationRef const& m, Arena& arena, Sto
 	// m is expected to be in arena already
 	// Clear split keys are added to arena
 	StorageMetrics metrics;
-	metrics.bytesPerKSecond = mvccStorageBytes( m ) / 2;
+	metrics.bytesPerKSecond = mvccStorageBytes( data, m ) / 2;
 	metrics.iosPerKSecond = 1;
 	self->metrics.notify(m.param1, metrics);
 
@@ -1951,6 +3113,65 @@ ACTOR Future<Void> logFetchKeysWarning(AddingShard* shard) {
 	}
 }
 
+ACTOR Future<Void> fetchChangeFeeds( StorageServer* data, KeyRange keys );
+
+static const int FETCH_WRITE_BATCH_ROWS = 1000;
+
+// Writes a block of the shard being fetched to storage
+ACTOR Future<Void> writeFetchedBlock( StorageServer* data, Standalone<RangeResultRef> block, KeyRange keys, Version fetchVersion, UID fetchID ) {
+	state int expectedSize = (int)block.expectedSize() + (8-(int)sizeof(KeyValueRef))*block.size();
+
+	TraceEvent(SevDebug, "FetchKeysBlock", data->thisServerID).detail("FKID", fetchID)
+		.detail("BlockRows", block.size()).detail("BlockBytes", expectedSize)
+		.detail("KeyBegin", keys.begin).detail("KeyEnd", keys.end)
+		.detail("Last", block.size() ? block.end()[-1].key : std::string())
+		.detail("Version", fetchVersion).detail("More", block.more);
+	debugKeyRange("fetchRange", fetchVersion, keys);
+	for(auto k = block.begin(); k != block.end(); ++k) debugMutation("fetch", fetchVersion, MutationRef(MutationRef::SetValue, k->key, k->value));
+
+	data->counters.bytesFetched += expectedSize;
+
+	// The shard holds no keys until it is fetched, so the block can go to the storage engine as a sorted run
+	state int begin = 0;
+	for(; begin < block.size(); begin += FETCH_WRITE_BATCH_ROWS) {
+		data->storage.writeSortedKeyValues( VectorRef<KeyValueRef>( block.begin() + begin, std::min<int>(FETCH_WRITE_BATCH_ROWS, block.size() - begin) ) );
+		wait(yield());
+	}
+
+	state KeyValueRef *kvItr = block.begin();
+	for(; kvItr != block.end(); ++kvItr) {
+		data->byteSampleApplySet( *kvItr, invalidVersion );
+		wait(yield());
+	}
+
+	return Void();
+}
+
+// Leaves shard (and keys) fetching only [keys.begin, nfk), which has been fetched, and adds a new AddingShard with its
+// own fetchKeys for the rest
+void splitFetchingShard( StorageServer* data, AddingShard*& shard, KeyRange& keys, Key nfk ) {
+	std::deque< Standalone<VerUpdateRef> > updatesToSplit = std::move( shard->updates );
+
+	// This actor finishes committing the keys [keys.begin,nfk) that we already fetched.
+	// The remaining unfetched keys [nfk,keys.end) will become a separate AddingShard with its own fetchKeys.
+	shard->server->addShard( ShardInfo::addingSplitLeft( KeyRangeRef(keys.begin, nfk), shard ) );
+	shard->server->addShard( ShardInfo::newAdding( data, KeyRangeRef(nfk, keys.end) ) );
+	shard = data->shards.rangeContaining( keys.begin ).value()->adding;
+	AddingShard* otherShard = data->shards.rangeContaining( nfk ).value()->adding;
+	keys = shard->keys;
+
+	// Split our prior updates.  The ones that apply to our new, restricted key range will go back into shard->updates,
+	// and the ones delivered to the new shard will be discarded because it is in WaitPrevious phase (hasn't chosen a fetchVersion yet).
+	// What we are doing here is expensive and could get more expensive if we started having many more blocks per shard. May need optimization in the future.
+	for(auto u = updatesToSplit.begin(); u != updatesToSplit.end(); ++u) {
+		splitMutations(data, data->shards, *u);
+	}
+
+	TEST( true );
+	TEST( shard->updates.size() );
+	ASSERT( otherShard->updates.empty() );
+}
+
 ACTOR Future<Void> fetchKeys( StorageServer *data, AddingShard* shard ) {
 	state TraceInterval interval("FetchKeys");
 	state KeyRange keys = shard->keys;
@@ -2007,6 +3228,7 @@ ACTOR Future<Void> fetchKeys( StorageServer *data, AddingShard* shard ) {
 		data->durableVersionLock.release();
 
 		wait(delay(0));
+		wait( fetchChangeFeeds( data, keys ) );
 
 		TraceEvent(SevDebug, "FetchKeysUnblocked", data->thisServerID).detail("FKID", interval.pairID).detail("Version", fetchVersion);
 
@@ -2014,6 +3236,7 @@ ACTOR Future<Void> fetchKeys( StorageServer *data, AddingShard* shard ) {
 		state int debug_getRangeRetries = 0;
 		state int debug_nextRetryToLog = 1;
 		state bool isTooOld = false;
+		state bool streamUnsupported = false;
 
 		//FIXME: The client cache does not notice when servers are added to a team. To read from a local storage server we must refresh the cache manually.
 		data->cx->invalidateCache(keys);
@@ -2022,69 +3245,78 @@ ACTOR Future<Void> fetchKeys( StorageServer *data, AddingShard* shard ) {
 			try {
 				TEST(true);		// Fetching keys for transferred shard
 
-				state Standalone<RangeResultRef> this_block = wait( tryGetRange( data->cx, fetchVersion, keys, GetRangeLimits( CLIENT_KNOBS->ROW_LIMIT_UNLIMITED, fetchBlockBytes ), &isTooOld ) );
-
-				int expectedSize = (int)this_block.expectedSize() + (8-(int)sizeof(KeyValueRef))*this_block.size();
-
-				TraceEvent(SevDebug, "FetchKeysBlock", data->thisServerID).detail("FKID", interval.pairID)
-					.detail("BlockRows", this_block.size()).detail("BlockBytes", expectedSize)
-					.detail("KeyBegin", keys.begin).detail("KeyEnd", keys.end)
-					.detail("Last", this_block.size() ? this_block.end()[-1].key : std::string())
-					.detail("Version", fetchVersion).detail("More", this_block.more);
-				debugKeyRange("fetchRange", fetchVersion, keys);
-				for(auto k = this_block.begin(); k != this_block.end(); ++k) debugMutation("fetch", fetchVersion, MutationRef(MutationRef::SetValue, k->key, k->value));
-
-				data->counters.bytesFetched += expectedSize;
-				if( fetchBlockBytes > expectedSize ) {
-					holdingFKPL.release( fetchBlockBytes - expectedSize );
-				}
+				if (SERVER_KNOBS->FETCH_KEYS_STREAMING && !streamUnsupported) {
+					// Stream the whole shard at fetchVersion, writing each block as it arrives while the next one is
+					// read, and only as fast as the commit budget allows
+					state PromiseStream<Standalone<RangeResultRef>> blocks;
+					state Reference<FlowLock> readAhead( new FlowLock( 2 * fetchBlockBytes ) );
+					state Future<Void> streamer = getRangeStream( data->cx, blocks, keys, fetchVersion, readAhead );
+					state Key fetchedThrough = keys.begin;
+					state Optional<Error> streamError;
+					try {
+						loop {
+							state Standalone<RangeResultRef> block = waitNext( blocks.getFuture() );
+							state int64_t blockSize = block.expectedSize();
+							while( data->fetchKeysBytesBudget <= 0 ) {
+								TEST(true); // fetchKeys waits for the storage engine to commit
+								wait( data->durableVersion.whenAtLeast( data->storageVersion()+1 ) );
+							}
+							data->fetchKeysBytesBudget -= blockSize;
+							wait( writeFetchedBlock( data, block, keys, fetchVersion, interval.pairID ) );
+							readAhead->release( blockSize );
+							fetchedThrough = block.readThrough.get();
+							block = Standalone<RangeResultRef>();
+						}
+					} catch( Error& e ) {
+						if( e.code() == error_code_actor_cancelled ) throw;
+						if( e.code() == error_code_end_of_stream ) {
+							fetchedThrough = keys.end;
+						} else {
+							streamError = e;
+						}
+					}
+					streamer = Future<Void>();
 
-				// Wait for permission to proceed
-				//wait( data->fetchKeysStorageWriteLock.take() );
-				//state FlowLock::Releaser holdingFKSWL( data->fetchKeysStorageWriteLock );
+					if( streamError.present() ) {
+						if( streamError.get().code() == error_code_unsupported_operation ) {
+							TEST(true); // fetchKeys source servers cannot stream
+							streamUnsupported = true;
+						}
+						// With nothing written, retry the whole shard (handling transaction_too_old and the like below)
+						if( fetchedThrough == keys.begin ) {
+							if( streamUnsupported ) continue;
+							throw streamError.get();
+						}
+						TEST(true); // fetchKeys stream failed after writing part of the shard
+					}
+					if( fetchedThrough != keys.end ) {
+						splitFetchingShard( data, shard, keys, fetchedThrough );
+						warningLogger = logFetchKeysWarning(shard);
+					}
+				} else {
+					state Standalone<RangeResultRef> this_block = wait( tryGetRange( data->cx, fetchVersion, keys, GetRangeLimits( CLIENT_KNOBS->ROW_LIMIT_UNLIMITED, fetchBlockBytes ), &isTooOld ) );
 
-				// Write this_block to storage
-				state KeyValueRef *kvItr = this_block.begin();
-				for(; kvItr != this_block.end(); ++kvItr) {
-					data->storage.writeKeyValue( *kvItr );
-					wait(yield());
-				}
+					int expectedSize = (int)this_block.expectedSize() + (8-(int)sizeof(KeyValueRef))*this_block.size();
+					if( fetchBlockBytes > expectedSize ) {
+						holdingFKPL.release( fetchBlockBytes - expectedSize );
+					}
 
-				kvItr = this_block.begin();
-				for(; kvItr != this_block.end(); ++kvItr) {
-					data->byteSampleApplySet( *kvItr, invalidVersion );
-					wait(yield());
-				}
+					// Wait for permission to proceed
+					//wait( data->fetchKeysStorageWriteLock.take() );
+					//state FlowLock::Releaser holdingFKSWL( data->fetchKeysStorageWriteLock );
 
-				if (this_block.more) {
-					Key nfk = this_block.readThrough.present() ? this_block.readThrough.get() : keyAfter( this_block.end()[-1].key );
-					if (nfk != keys.end) {
-						std::deque< Standalone<VerUpdateRef> > updatesToSplit = std::move( shard->updates );
+					wait( writeFetchedBlock( data, this_block, keys, fetchVersion, interval.pairID ) );
 
-						// This actor finishes committing the keys [keys.begin,nfk) that we already fetched.
-						// The remaining unfetched keys [nfk,keys.end) will become a separate AddingShard with its own fetchKeys.
-						shard->server->addShard( ShardInfo::addingSplitLeft( KeyRangeRef(keys.begin, nfk), shard ) );
-						shard->server->addShard( ShardInfo::newAdding( data, KeyRangeRef(nfk, keys.end) ) );
-						shard = data->shards.rangeContaining( keys.begin ).value()->adding;
-						warningLogger = logFetchKeysWarning(shard);
-						AddingShard* otherShard = data->shards.rangeContaining( nfk ).value()->adding;
-						keys = shard->keys;
-
-						// Split our prior updates.  The ones that apply to our new, restricted key range will go back into shard->updates,
-						// and the ones delivered to the new shard will be discarded because it is in WaitPrevious phase (hasn't chosen a fetchVersion yet).
-						// What we are doing here is expensive and could get more expensive if we started having many more blocks per shard. May need optimization in the future.
-						std::deque< Standalone<VerUpdateRef> >::iterator u = updatesToSplit.begin();
-						for(; u != updatesToSplit.end(); ++u) {
-							splitMutations(data, data->shards, *u);
+					if (this_block.more) {
+						Key nfk = this_block.readThrough.present() ? this_block.readThrough.get() : keyAfter( this_block.end()[-1].key );
+						if (nfk != keys.end) {
+							splitFetchingShard( data, shard, keys, nfk );
+							warningLogger = logFetchKeysWarning(shard);
 						}
-
-						TEST( true );
-						TEST( shard->updates.size() );
-						ASSERT( otherShard->updates.empty() );
 					}
-				}
 
-				this_block = Standalone<RangeResultRef>();
+					this_block = Standalone<RangeResultRef>();
+				}
 
 				if (BUGGIFY) wait( delay( 1 ) );
 
@@ -2191,6 +3423,7 @@ ACTOR Future<Void> fetchKeys( StorageServer *data, AddingShard* shard ) {
 
 		ASSERT( data->shards[shard->keys.begin]->assigned() && data->shards[shard->keys.begin]->keys == shard->keys );  // We aren't changing whether the shard is assigned
 		data->newestAvailableVersion.insert(shard->keys, latestVersion);
+		data->engineHistory.forget(shard->keys); // Earlier commits hold none of the fetched data
 		shard->readWrite.send(Void());
 		data->addShard( ShardInfo::newReadWrite(shard->keys, data) );   // invalidates shard!
 		coalesceShards(data, keys);
@@ -2452,10 +3685,351 @@ static const KeyRangeRef persistShardAssignedKeys = KeyRangeRef( LiteralStringRe
 static const KeyRangeRef persistShardAvailableKeys = KeyRangeRef( LiteralStringRef( PERSIST_PREFIX "ShardAvailable/" ), LiteralStringRef( PERSIST_PREFIX "ShardAvailable0" ) );
 static const KeyRangeRef persistByteSampleKeys = KeyRangeRef( LiteralStringRef( PERSIST_PREFIX "BS/" ), LiteralStringRef( PERSIST_PREFIX "BS0" ) );
 static const KeyRangeRef persistByteSampleSampleKeys = KeyRangeRef( LiteralStringRef( PERSIST_PREFIX "BS/" PERSIST_PREFIX "BS/" ), LiteralStringRef( PERSIST_PREFIX "BS/" PERSIST_PREFIX "BS0" ) );
+// The byte sample is also kept as a snapshot, in two generations of keys that each hold many sample entries, and a
+// log of the byte sample mutations made since the latest complete snapshot was started.  The snapshot is fuzzy: each
+// of its keys is consistent at the version it was written, and replaying the log over it makes it exact.
+static const KeyRef persistByteSampleSnapshot = LiteralStringRef( PERSIST_PREFIX "BSSnapshot" );
+static const KeyRangeRef persistByteSampleSnapshotKeys = KeyRangeRef( LiteralStringRef( PERSIST_PREFIX "BSS/" ), LiteralStringRef( PERSIST_PREFIX "BSS0" ) );
+static const KeyRangeRef persistByteSampleDeltaKeys = KeyRangeRef( LiteralStringRef( PERSIST_PREFIX "BSD/" ), LiteralStringRef( PERSIST_PREFIX "BSD0" ) );
+// The keys most read recently, in order, so that after a restart the storage engine's cache can be warmed around them
+static const KeyRef persistWarmUpKeys = LiteralStringRef( PERSIST_PREFIX "WarmUpKeys" );
 static const KeyRef persistLogProtocol = LiteralStringRef(PERSIST_PREFIX "LogProtocol");
 static const KeyRef persistPrimaryLocality = LiteralStringRef( PERSIST_PREFIX "PrimaryLocality" );
+static const KeyRangeRef persistChangeFeedKeys = KeyRangeRef( LiteralStringRef( PERSIST_PREFIX "CF/" ), LiteralStringRef( PERSIST_PREFIX "CF0" ) );
+static const KeyRangeRef persistChangeFeedDataKeys = KeyRangeRef( LiteralStringRef( PERSIST_PREFIX "CFD/" ), LiteralStringRef( PERSIST_PREFIX "CFD0" ) );
 // data keys are unmangled (but never start with PERSIST_PREFIX because they are always in allKeys)
 
+// A key of the byte sample snapshot is its generation and then the number of the key within the generation
+static Key byteSampleSnapshotKey( int generation, int32_t chunk ) {
+	BinaryWriter wr(Unversioned());
+	wr.serializeBytes( persistByteSampleSnapshotKeys.begin );
+	uint8_t g = generation;
+	wr << g;
+	chunk = bigEndian32(chunk);
+	wr.serializeBytes( &chunk, sizeof(chunk) );
+	return wr.toValue();
+}
+
+static KeyRange byteSampleSnapshotGenerationKeys( int generation ) {
+	return KeyRangeRef( byteSampleSnapshotKey(generation, 0), byteSampleSnapshotKey(generation + 1, 0) );
+}
+
+static Value byteSampleSnapshotValue( int generation, uint64_t startSequence, int32_t chunks ) {
+	BinaryWriter wr(IncludeVersion());
+	wr << generation << startSequence << chunks;
+	return wr.toValue();
+}
+
+static Key byteSampleDeltaKey( uint64_t sequence ) {
+	sequence = bigEndian64(sequence);
+	return StringRef( (const uint8_t*)&sequence, sizeof(sequence) ).withPrefix( persistByteSampleDeltaKeys.begin );
+}
+
+static uint64_t decodeByteSampleDeltaKey( KeyRef const& key ) {
+	uint64_t sequence;
+	memcpy(&sequence, key.end() - sizeof(sequence), sizeof(sequence));
+	return bigEndian64(sequence);
+}
+
+// The mutations a change feed recorded at a version are stored at a key that sorts by feed and then by version
+static Key changeFeedDurableKey( Key const& feed, Version version ) {
+	BinaryWriter wr(Unversioned());
+	wr.serializeBytes( persistChangeFeedDataKeys.begin );
+	wr << feed;
+	version = bigEndian64(version);
+	wr.serializeBytes( &version, sizeof(Version) );
+	return wr.toValue();
+}
+
+static Version decodeChangeFeedDurableKey( KeyRef const& key ) {
+	Version version;
+	memcpy(&version, key.end() - sizeof(Version), sizeof(Version));
+	return bigEndian64(version);
+}
+
+static Value changeFeedSSValue( KeyRangeRef const& range, Version emptyVersion, std::vector<std::pair<KeyRange, Version>> const& movedIn ) {
+	BinaryWriter wr(IncludeVersion());
+	wr << range << emptyVersion << movedIn;
+	return wr.toValue();
+}
+
+static std::pair<KeyRange, Version> decodeChangeFeedSSValue( ValueRef const& value, std::vector<std::pair<KeyRange, Version>>* movedIn ) {
+	KeyRange range;
+	Version emptyVersion;
+	BinaryReader rd( value, IncludeVersion() );
+	rd >> range >> emptyVersion >> *movedIn;
+	return std::make_pair(range, emptyVersion);
+}
+
+// Writes the feed's range and empty versions to the mutation log at the latest version
+static void persistChangeFeed( StorageServer* data, ChangeFeedInfo const& feed ) {
+	auto& mLV = data->addVersionToMutationLog( data->data().getLatestVersion() );
+	data->addMutationToMutationLog( mLV, MutationRef( MutationRef::SetValue, feed.id.withPrefix(persistChangeFeedKeys.begin), changeFeedSSValue(feed.range, feed.emptyVersion, feed.movedIn) ) );
+}
+
+static int64_t changeFeedMutationBytes( MutationsAndVersionRef const& mv ) {
+	int64_t bytes = 0;
+	for (auto& m : mv.mutations) bytes += m.totalSize();
+	return bytes;
+}
+
+// Starts recording the mutations to range in a new feed, from emptyVersion on
+static Reference<ChangeFeedInfo> addChangeFeed( StorageServer* data, Key const& id, KeyRange const& range, Version emptyVersion ) {
+	Reference<ChangeFeedInfo> feed( new ChangeFeedInfo() );
+	feed->id = id;
+	feed->range = range;
+	feed->emptyVersion = emptyVersion;
+	feed->durableVersion = std::max( emptyVersion - 1, data->storageVersion() );
+	data->uidChangeFeed[id] = feed;
+	auto ranges = data->keyChangeFeed.modify(range);
+	for (auto r = ranges.begin(); r != ranges.end(); ++r) {
+		r->value().push_back(feed);
+	}
+	data->keyChangeFeed.coalesce( KeyRangeRef(range) );
+	return feed;
+}
+
+static void removeChangeFeed( StorageServer* data, Reference<ChangeFeedInfo> feed ) {
+	TraceEvent("ChangeFeedRemoved", data->thisServerID).detail("RangeID", feed->id).detail("Range", feed->range);
+	feed->removing = true;
+	feed->newMutations.trigger();
+	for (auto& mv : feed->mutations) data->counters.bytesDurable += changeFeedMutationBytes(mv);
+	feed->mutations.clear();
+
+	auto ranges = data->keyChangeFeed.modify(feed->range);
+	for (auto r = ranges.begin(); r != ranges.end(); ++r) {
+		auto& feeds = r->value();
+		feeds.erase(std::remove(feeds.begin(), feeds.end(), feed), feeds.end());
+	}
+	data->keyChangeFeed.coalesce( KeyRangeRef(feed->range) );
+	data->uidChangeFeed.erase(feed->id);
+
+	auto& mLV = data->addVersionToMutationLog( data->data().getLatestVersion() );
+	data->addMutationToMutationLog( mLV, MutationRef( MutationRef::ClearRange, feed->id.withPrefix(persistChangeFeedKeys.begin), keyAfter(feed->id).withPrefix(persistChangeFeedKeys.begin) ) );
+	data->addMutationToMutationLog( mLV, MutationRef( MutationRef::ClearRange, changeFeedDurableKey(feed->id, 0), changeFeedDurableKey(feed->id, latestVersion) ) );
+}
+
+// Discards the mutations the feed recorded before version
+static void popChangeFeed( StorageServer* data, Reference<ChangeFeedInfo> feed, Version version ) {
+	if (version <= feed->emptyVersion) return;
+	feed->emptyVersion = version;
+	feed->movedIn.erase( std::remove_if( feed->movedIn.begin(), feed->movedIn.end(), [version](std::pair<KeyRange, Version> const& m) { return m.second <= version; } ), feed->movedIn.end() );
+	while (!feed->mutations.empty() && feed->mutations.front().version < version) {
+		data->counters.bytesDurable += changeFeedMutationBytes(feed->mutations.front());
+		feed->mutations.pop_front();
+	}
+	persistChangeFeed( data, *feed );
+	auto& mLV = data->addVersionToMutationLog( data->data().getLatestVersion() );
+	data->addMutationToMutationLog( mLV, MutationRef( MutationRef::ClearRange, changeFeedDurableKey(feed->id, 0), changeFeedDurableKey(feed->id, version) ) );
+}
+
+static void addChangeFeedMutation( StorageServer* data, ChangeFeedInfo* feed, MutationRef const& m, Version version ) {
+	if (version < feed->emptyVersion) return;
+	if (feed->mutations.empty() || feed->mutations.back().version != version) {
+		feed->mutations.emplace_back();
+		feed->mutations.back().version = version;
+		data->changeFeedsUpdated.push_back(Reference<ChangeFeedInfo>::addRef(feed));
+	}
+	auto& mv = feed->mutations.back();
+	mv.mutations.push_back_deep( mv.arena(), m );
+	data->counters.bytesInput += m.totalSize();
+}
+
+// Records a mutation from the log in every change feed whose range it touches
+void applyChangeFeedMutation( StorageServer* data, MutationRef const& m, Version version ) {
+	if (m.type == MutationRef::ClearRange) {
+		KeyRangeRef clearRange( m.param1, m.param2 );
+		std::vector<ChangeFeedInfo*> recorded;
+		for (auto r : data->keyChangeFeed.intersectingRanges(clearRange)) {
+			for (auto& feed : r.value()) {
+				// A feed spans consecutive ranges of the map but records the clear only once
+				if (std::find(recorded.begin(), recorded.end(), feed.getPtr()) != recorded.end()) continue;
+				recorded.push_back(feed.getPtr());
+				KeyRangeRef feedClear = clearRange & feed->range;
+				addChangeFeedMutation( data, feed.getPtr(), MutationRef( MutationRef::ClearRange, feedClear.begin, feedClear.end ), version );
+			}
+		}
+	} else {
+		for (auto& feed : data->keyChangeFeed[m.param1]) {
+			addChangeFeedMutation( data, feed.getPtr(), m, version );
+		}
+	}
+}
+
+// Appends the part of mutations that falls in range to reply, and returns its size
+static int addChangeFeedReplyEntry( ChangeFeedStreamReply& reply, VectorRef<MutationRef> mutations, Version version, KeyRangeRef range ) {
+	MutationsAndVersionRef entry( VectorRef<MutationRef>(), version );
+	for (auto& m : mutations) {
+		if (m.type == MutationRef::ClearRange) {
+			KeyRangeRef clearRange( m.param1, m.param2 );
+			if (range.intersects(clearRange)) {
+				KeyRangeRef r = clearRange & range;
+				entry.mutations.push_back_deep( reply.arena, MutationRef( MutationRef::ClearRange, r.begin, r.end ) );
+			}
+		} else if (range.contains(m.param1)) {
+			entry.mutations.push_back_deep( reply.arena, m );
+		}
+	}
+	if (entry.mutations.empty()) return 0;
+	reply.mutations.push_back( reply.arena, entry );
+	return entry.expectedSize();
+}
+
+// Reads what the feed recorded in range at versions [begin, end), from storage if begin is durable and otherwise from
+// memory up to the committed version.  The last entry of the reply is at the version through which it is complete.
+ACTOR Future<ChangeFeedStreamReply> getChangeFeedMutations( StorageServer* data, Reference<ChangeFeedInfo> feed, KeyRange range, Version begin, Version end ) {
+	state ChangeFeedStreamReply reply;
+	state int remainingBytes = SERVER_KNOBS->CHANGEFEEDSTREAM_FRAGMENT_BYTES;
+	state Version readThrough;
+
+	if (begin <= feed->durableVersion) {
+		readThrough = std::min( feed->durableVersion, end - 1 );
+		Standalone<RangeResultRef> res = wait( data->storage.readRange( KeyRangeRef( changeFeedDurableKey(feed->id, begin), changeFeedDurableKey(feed->id, readThrough + 1) ), 1 << 30, remainingBytes ) );
+		if (feed->removing) throw change_feed_not_registered();
+		if (begin < feed->emptyVersionOf(range)) throw change_feed_popped();
+		for (auto& kv : res) {
+			Version version = decodeChangeFeedDurableKey(kv.key);
+			remainingBytes -= addChangeFeedReplyEntry( reply, BinaryReader::fromStringRef<Standalone<VectorRef<MutationRef>>>(kv.value, IncludeVersion()), version, range );
+		}
+		if (res.more) readThrough = decodeChangeFeedDurableKey(res.back().key);
+	} else {
+		readThrough = std::min( data->knownCommittedVersion.get(), end - 1 );
+		auto mv = std::lower_bound( feed->mutations.begin(), feed->mutations.end(), begin, [](Standalone<MutationsAndVersionRef> const& mv, Version v) { return mv.version < v; } );
+		for (; mv != feed->mutations.end() && mv->version <= readThrough; ++mv) {
+			remainingBytes -= addChangeFeedReplyEntry( reply, mv->mutations, mv->version, range );
+			if (remainingBytes <= 0) {
+				readThrough = mv->version;
+				break;
+			}
+		}
+	}
+
+	if (reply.mutations.empty() || reply.mutations.back().version != readThrough) {
+		reply.mutations.push_back( reply.arena, MutationsAndVersionRef( VectorRef<MutationRef>(), readThrough ) );
+	}
+	return reply;
+}
+
+ACTOR Future<Void> changeFeedStreamQ( StorageServer* data, ChangeFeedStreamRequest req )
+// Sends the feed's mutations to req.range as a sequence of replies and then waits for new versions until req.end.  Each
+// reply ends with an entry at the version it is complete through, so a reply may report progress without mutations.
+{
+	state Version begin = req.begin;
+	state double lastReply = 0;
+	state Future<Void> disconnected = IFailureMonitor::failureMonitor().onDisconnectOrFailure( req.reply.getEndpoint() );
+
+	req.reply.setByteLimit(SERVER_KNOBS->CHANGEFEEDSTREAM_LIMIT_BYTES);
+	++data->counters.changeFeedStreamQueries;
+
+	// Active load balancing runs at a very high priority (to obtain accurate queue lengths)
+	// so we need to downgrade here
+	wait( delay(0, TaskPriority::DefaultEndpoint) );
+
+	try {
+		loop {
+			choose {
+				when( wait( req.reply.onReady() ) ) {}
+				when( wait( disconnected ) ) { throw operation_obsolete(); }
+			}
+			if (begin >= req.end) break;
+
+			choose {
+				when( wait( data->knownCommittedVersion.whenAtLeast(begin) ) ) {}
+				when( wait( disconnected ) ) { throw operation_obsolete(); }
+			}
+
+			auto f = data->uidChangeFeed.find(req.rangeID);
+			if (f == data->uidChangeFeed.end()) throw change_feed_not_registered();
+			state Reference<ChangeFeedInfo> feed = f->second;
+			if (begin < feed->emptyVersionOf(req.range)) throw change_feed_popped();
+
+			ChangeFeedStreamReply _reply = wait( getChangeFeedMutations( data, feed, req.range, begin, req.end ) );
+			state ChangeFeedStreamReply reply = _reply;
+			// This server has every mutation to the range up to the reply's version only if it still serves the range
+			if (!data->isReadable(req.range)) throw wrong_shard_server();
+
+			state Version readThrough = reply.mutations.back().version;
+			if (reply.mutations.size() == 1 && reply.mutations[0].mutations.empty() && readThrough + 1 < req.end &&
+			    now() < lastReply + SERVER_KNOBS->CHANGEFEEDSTREAM_IDLE_INTERVAL) {
+				// Only report progress every so often while nothing is being recorded
+				choose {
+					when( wait( feed->newMutations.onTrigger() ) ) {}
+					when( wait( delayUntil( lastReply + SERVER_KNOBS->CHANGEFEEDSTREAM_IDLE_INTERVAL ) ) ) {}
+					when( wait( disconnected ) ) { throw operation_obsolete(); }
+				}
+				continue;
+			}
+
+			data->counters.bytesQueried += reply.expectedSize();
+			begin = readThrough + 1;
+			lastReply = now();
+			req.reply.send( reply );
+		}
+		req.reply.sendError( end_of_stream() );
+	} catch (Error& e) {
+		if (!canReplyWith(e) && e.code() != error_code_operation_obsolete && e.code() != error_code_change_feed_not_registered && e.code() != error_code_change_feed_popped)
+			throw;
+		req.reply.sendError(e);
+	}
+
+	return Void();
+}
+
+ACTOR Future<Void> changeFeedPopQ( StorageServer* data, ChangeFeedPopRequest req ) {
+	wait( delay(0, TaskPriority::DefaultEndpoint) );
+
+	auto feed = data->uidChangeFeed.find(req.rangeID);
+	if (feed == data->uidChangeFeed.end()) {
+		req.reply.sendError( change_feed_not_registered() );
+	} else {
+		popChangeFeed( data, feed->second, req.version );
+		req.reply.send( Void() );
+	}
+	return Void();
+}
+
+// Feeds that already covered other keys when a shard with keys moved here are missing the moved mutations, so reads
+// of keys from before the current version are refused; feeds this server did not know are registered from the
+// current version on.
+ACTOR Future<Void> fetchChangeFeeds( StorageServer* data, KeyRange keys ) {
+	state Transaction tr( data->cx );
+	state std::vector<std::pair<Key, KeyRange>> fetched;
+	loop {
+		try {
+			tr.setOption( FDBTransactionOptions::ACCESS_SYSTEM_KEYS );
+			tr.setOption( FDBTransactionOptions::LOCK_AWARE );
+			state KeyRange remaining = changeFeedKeys;
+			fetched.clear();
+			loop {
+				Standalone<RangeResultRef> feeds = wait( tr.getRange( remaining, CLIENT_KNOBS->TOO_MANY ) );
+				for (auto& kv : feeds) {
+					KeyRange range = decodeChangeFeedValue(kv.value);
+					if (range.intersects(keys)) fetched.emplace_back(kv.key.removePrefix(changeFeedPrefix), range);
+				}
+				if (!feeds.more) break;
+				remaining = KeyRangeRef( keyAfter(feeds.back().key), remaining.end );
+			}
+			break;
+		} catch (Error& e) {
+			wait( tr.onError(e) );
+		}
+	}
+
+	Version version = data->data().getLatestVersion() + 1;
+	for (auto& f : fetched) {
+		auto feed = data->uidChangeFeed.find(f.first);
+		if (feed == data->uidChangeFeed.end()) {
+			TraceEvent("ChangeFeedFetched", data->thisServerID).detail("RangeID", f.first).detail("Range", f.second).detail("Version", version);
+			persistChangeFeed( data, *addChangeFeed( data, f.first, f.second, version ) );
+		} else {
+			TEST(true); // Change feed popped where a shard moved to the server
+			feed->second->movedIn.emplace_back( f.second & keys, version );
+			persistChangeFeed( data, *feed->second );
+		}
+	}
+	return Void();
+}
+
 class StorageUpdater {
 public:
 	StorageUpdater() : fromVersion(invalidVersion), currentVersion(invalidVersion), restoredVersion(invalidVersion), processedStartKey(false), processedCacheStartKey(false) {}
@@ -2557,6 +4131,23 @@ private:
 			data->primaryLocality = BinaryReader::fromStringRef<int8_t>(m.param2, Unversioned());
 			auto& mLV = data->addVersionToMutationLog( data->data().getLatestVersion() );
 			data->addMutationToMutationLog( mLV, MutationRef(MutationRef::SetValue, persistPrimaryLocality, m.param2) );
+		} else if (m.type == MutationRef::SetValue && m.param1.startsWith(changeFeedPrivatePrefix)) {
+			Key id = m.param1.removePrefix(changeFeedPrivatePrefix);
+			KeyRange range = decodeChangeFeedValue(m.param2);
+			auto feed = data->uidChangeFeed.find(id);
+			if (feed == data->uidChangeFeed.end() || feed->second->range != range) {
+				// Registering an existing feed with a different range starts it over
+				if (feed != data->uidChangeFeed.end()) removeChangeFeed( data, feed->second );
+				TraceEvent("ChangeFeedRegistered", data->thisServerID).detail("RangeID", id).detail("Range", range).detail("Version", currentVersion);
+				persistChangeFeed( data, *addChangeFeed( data, id, range, currentVersion + 1 ) );
+			}
+		} else if (m.type == MutationRef::ClearRange && m.param1.startsWith(changeFeedPrivatePrefix)) {
+			KeyRangeRef cleared( m.param1, m.param2 );
+			std::vector<Reference<ChangeFeedInfo>> removed;
+			for (auto& it : data->uidChangeFeed) {
+				if (cleared.contains(it.first.withPrefix(changeFeedPrivatePrefix))) removed.push_back(it.second);
+			}
+			for (auto& feed : removed) removeChangeFeed( data, feed );
 		} else {
 			ASSERT(false);  // Unknown private mutation
 		}
@@ -2772,6 +4363,7 @@ ACTOR Future<Void> update( StorageServer* data, bool* pReceivedUpdate )
 						//TraceEvent("SSPeekMutation", data->thisServerID).detail("Mutation", msg.toString()).detail("Version", cloneCursor2->version().toString());
 					}
 
+					if (!msg.param1.startsWith( systemKeys.end )) applyChangeFeedMutation(data, msg, ver);
 					updater.applyMutation(data, msg, ver);
 					mutationBytes += msg.totalSize();
 					data->counters.mutationBytes += msg.totalSize();
@@ -2830,7 +4422,8 @@ ACTOR Future<Void> update( StorageServer* data, bool* pReceivedUpdate )
 			setDataVersion(data->thisServerID, data->version.get());
 			if (data->otherError.getFuture().isReady()) data->otherError.getFuture().get();
 
-			Version maxVersionsInMemory = SERVER_KNOBS->MAX_READ_TRANSACTION_LIFE_VERSIONS;
+			// Older versions are read from the storage engine's commits when it keeps them
+			Version maxVersionsInMemory = data->engineHistory.enabled ? std::min(SERVER_KNOBS->STORAGE_VERSIONED_MEMORY_VERSIONS, SERVER_KNOBS->MAX_READ_TRANSACTION_LIFE_VERSIONS) : SERVER_KNOBS->MAX_READ_TRANSACTION_LIFE_VERSIONS;
 			for(int i = 0; i < data->recoveryVersionSkips.size(); i++) {
 				maxVersionsInMemory += data->recoveryVersionSkips[i].second;
 			}
@@ -2855,6 +4448,20 @@ ACTOR Future<Void> update( StorageServer* data, bool* pReceivedUpdate )
 
 		}
 
+		// Change feeds are only read up to versions that can no longer be rolled back
+		Version committedVersion = std::min(data->version.get(), cursor->getMinKnownCommittedVersion());
+		if (committedVersion > data->knownCommittedVersion.get()) {
+			data->knownCommittedVersion.set(committedVersion);
+			std::vector<Reference<ChangeFeedInfo>> uncommitted;
+			for (auto& feed : data->changeFeedsUpdated) {
+				if (!feed->mutations.empty() && feed->mutations.back().version > committedVersion) {
+					uncommitted.push_back(feed);
+				}
+				feed->newMutations.trigger();
+			}
+			data->changeFeedsUpdated = std::move(uncommitted);
+		}
+
 		validate(data);
 
 		data->logCursor->advanceTo( cloneCursor2->version() );
@@ -2909,10 +4516,26 @@ ACTOR Future<Void> updateStorage(StorageServer* data) {
 			if (done) break;
 		}
 
+		// Change feed mutations through the new durable version are committed along with the data
+		for (auto& it : data->uidChangeFeed) {
+			for (auto& mv : it.second->mutations) {
+				if (mv.version > newOldestVersion) break;
+				data->storage.writeKeyValue( KeyValueRef( changeFeedDurableKey(it.first, mv.version), BinaryWriter::toValue(mv.mutations, IncludeVersion()) ) );
+			}
+		}
+
 		// Set the new durable version as part of the outstanding change set, before commit
 		if (startOldestVersion != newOldestVersion)
 			data->storage.makeVersionDurable( newOldestVersion );
 
+		// Label the commit with its version and keep the commits that reads in the last MAX_READ_TRANSACTION_LIFE_VERSIONS
+		// may be served from
+		if (data->engineHistory.enabled && startOldestVersion != newOldestVersion) {
+			data->engineHistory.expire( data->version.get() - SERVER_KNOBS->MAX_READ_TRANSACTION_LIFE_VERSIONS );
+			Version oldestReadable = data->engineHistory.oldestVersion();
+			data->storage.setCommitVersion( newOldestVersion, oldestReadable != invalidVersion ? oldestReadable : startOldestVersion );
+		}
+
 		debug_advanceMaxCommittedVersion( data->thisServerID, newOldestVersion );
 		state Future<Void> durable = data->storage.commit();
 		state Future<Void> durableDelay = Void();
@@ -2922,6 +4545,9 @@ ACTOR Future<Void> updateStorage(StorageServer* data) {
 		}
 
 		wait( durable );
+		data->fetchKeysBytesBudget = SERVER_KNOBS->FETCH_KEYS_COMMIT_BYTES;
+		if (data->engineHistory.enabled && startOldestVersion != newOldestVersion)
+			data->engineHistory.committed( startOldestVersion, newOldestVersion );
 
 		debug_advanceMinCommittedVersion( data->thisServerID, newOldestVersion );
 
@@ -2956,6 +4582,15 @@ ACTOR Future<Void> updateStorage(StorageServer* data) {
 
 		data->durableVersionLock.release();
 
+		for (auto& it : data->uidChangeFeed) {
+			auto& feed = it.second;
+			while (!feed->mutations.empty() && feed->mutations.front().version <= newOldestVersion) {
+				data->counters.bytesDurable += changeFeedMutationBytes(feed->mutations.front());
+				feed->mutations.pop_front();
+			}
+			feed->durableVersion = std::max(feed->durableVersion, newOldestVersion);
+		}
+
 		//TraceEvent("StorageServerDurable", data->thisServerID).detail("Version", newOldestVersion);
 
 		wait( durableDelay );
@@ -3015,18 +4650,28 @@ void setAssignedStatus( StorageServer* self, KeyRangeRef keys, bool nowAssigned
 
 void StorageServerDisk::clearRange( KeyRangeRef keys ) {
 	storage->clear(keys);
+	rowCache.written(keys);
 }
 
 void StorageServerDisk::writeKeyValue( KeyValueRef kv ) {
 	storage->set( kv );
+	rowCache.written(singleKeyRange(kv.key));
+}
+
+void StorageServerDisk::writeSortedKeyValues( VectorRef<KeyValueRef> kvs ) {
+	if (kvs.empty()) return;
+	storage->setSorted( kvs );
+	rowCache.written(KeyRangeRef(kvs.front().key, keyAfter(kvs.back().key)));
 }
 
 void StorageServerDisk::writeMutation( MutationRef mutation ) {
 	// FIXME: debugMutation(debugContext, debugVersion, *m);
 	if (mutation.type == MutationRef::SetValue) {
 		storage->set( KeyValueRef(mutation.param1, mutation.param2) );
+		rowCache.written(singleKeyRange(mutation.param1));
 	} else if (mutation.type == MutationRef::ClearRange) {
 		storage->clear( KeyRangeRef(mutation.param1, mutation.param2) );
+		rowCache.written(KeyRangeRef(mutation.param1, mutation.param2));
 	} else
 		ASSERT(false);
 }
@@ -3036,10 +4681,60 @@ void StorageServerDisk::writeMutations( MutationListRef mutations, Version debug
 		debugMutation(debugContext, debugVersion, *m);
 		if (m->type == MutationRef::SetValue) {
 			storage->set( KeyValueRef(m->param1, m->param2) );
+			rowCache.written(singleKeyRange(m->param1));
 		} else if (m->type == MutationRef::ClearRange) {
 			storage->clear( KeyRangeRef(m->param1, m->param2) );
+			rowCache.written(KeyRangeRef(m->param1, m->param2));
+		}
+	}
+}
+
+Future<Optional<Value>> StorageServerDisk::readValue( KeyRef key, Optional<UID> debugID ) {
+	if (!rowCache.enabled()) return storage->readValue(key, debugID);
+
+	Optional<Value>* cached = rowCache.get(key);
+	if (cached) {
+		++data->counters.rowCacheHits;
+		return *cached;
+	}
+	++data->counters.rowCacheMisses;
+	if (!rowCache.admit(key)) return storage->readValue(key, debugID);
+	return readValueAndCache(this, key, debugID);
+}
+
+Future<Optional<Value>> StorageServerDisk::readValuePrefix( KeyRef key, int maxLength, Optional<UID> debugID ) {
+	if (!rowCache.enabled()) return storage->readValuePrefix(key, maxLength, debugID);
+
+	Optional<Value>* cached = rowCache.get(key);
+	if (cached) {
+		++data->counters.rowCacheHits;
+		return StorageRowCache::prefix(*cached, maxLength);
+	}
+	++data->counters.rowCacheMisses;
+	if (!rowCache.admit(key)) return storage->readValuePrefix(key, maxLength, debugID);
+	return readValuePrefixAndCache(this, key, maxLength, debugID);
+}
+
+Future<std::vector<Optional<Value>>> StorageServerDisk::readValuePrefixes( std::vector<std::pair<KeyRef, int>> const& keys, Optional<UID> debugID ) {
+	if (!rowCache.enabled()) return storage->readValuePrefixes(keys, debugID);
+
+	// Cached keys are answered here and the rest are still read from storage as one sorted batch
+	std::vector<Optional<Value>> values(keys.size());
+	std::vector<int> missIndexes;
+	std::vector<std::pair<KeyRef, int>> misses;
+	for (int i = 0; i < keys.size(); i++) {
+		Optional<Value>* cached = rowCache.get(keys[i].first);
+		if (cached) {
+			++data->counters.rowCacheHits;
+			values[i] = StorageRowCache::prefix(*cached, keys[i].second);
+		} else {
+			++data->counters.rowCacheMisses;
+			missIndexes.push_back(i);
+			misses.push_back(keys[i]);
 		}
 	}
+	if (misses.empty()) return values;
+	return readValuePrefixesAndCache(this, std::move(values), std::move(missIndexes), std::move(misses), debugID);
 }
 
 bool StorageServerDisk::makeVersionMutationsDurable( Version& prevStorageVersion, Version newStorageVersion, int64_t& bytesLeft ) {
@@ -3052,8 +4747,15 @@ bool StorageServerDisk::makeVersionMutationsDurable( Version& prevStorageVersion
 		ASSERT( v.version > prevStorageVersion && v.version <= newStorageVersion );
 		debugKeyRange("makeVersionMutationsDurable", v.version, allKeys);
 		writeMutations(v.mutations, v.version, "makeVersionDurable");
-		for(auto m=v.mutations.begin(); m; ++m)
-			bytesLeft -= mvccStorageBytes(*m);
+		for(auto m=v.mutations.begin(); m; ++m) {
+			bytesLeft -= mvccStorageBytes(data->data(), *m);
+			if (data->engineHistory.enabled) {
+				if (m->type == MutationRef::SetValue)
+					data->engineHistory.changed( singleKeyRange(m->param1), v.version );
+				else if (m->type == MutationRef::ClearRange)
+					data->engineHistory.changed( KeyRangeRef(m->param1, m->param2), v.version );
+			}
+		}
 		prevStorageVersion = v.version;
 		return false;
 	} else {
@@ -3112,7 +4814,88 @@ ACTOR Future<Void> applyByteSampleResult( StorageServer* data, IKeyValueStore* s
 	return Void();
 }
 
+// Loads the byte sample from its snapshot and then replays the changes logged since the snapshot was started.  Returns
+// false, having loaded nothing, if there is no snapshot.
+ACTOR Future<bool> restoreByteSampleSnapshot( StorageServer* data, IKeyValueStore* storage ) {
+	state Future<Optional<Value>> fSnapshot = storage->readValue(persistByteSampleSnapshot);
+	state Future<Standalone<RangeResultRef>> fLastDelta = storage->readRange(persistByteSampleDeltaKeys, -1);
+	wait( success(fSnapshot) && success(fLastDelta) );
+
+	if (fLastDelta.get().size())
+		data->byteSampleDeltaSequence = decodeByteSampleDeltaKey(fLastDelta.get()[0].key) + 1;
+	if (!fSnapshot.get().present())
+		return false;
+	if (SERVER_KNOBS->BYTE_SAMPLE_SNAPSHOT_INTERVAL <= 0) {
+		// Changes are no longer logged, so the snapshot would fall behind the byte sample
+		storage->clear( singleKeyRange(persistByteSampleSnapshot) );
+		storage->clear( persistByteSampleSnapshotKeys );
+		storage->clear( persistByteSampleDeltaKeys );
+		return false;
+	}
+
+	state int generation;
+	state uint64_t startSequence;
+	state int32_t chunks;
+	{
+		BinaryReader rd( fSnapshot.get().get(), IncludeVersion() );
+		rd >> generation >> startSequence >> chunks;
+	}
+
+	state KeyRange keys = byteSampleSnapshotGenerationKeys(generation);
+	state int32_t chunksRead = 0;
+	state int64_t entries = 0;
+	loop {
+		Standalone<RangeResultRef> snapshot = wait( storage->readRange( keys, 1<<30, SERVER_KNOBS->STORAGE_LIMIT_BYTES ) );
+		for (auto& kv : snapshot) {
+			ArenaReader reader( snapshot.arena(), kv.value, IncludeVersion() );
+			int32_t count;
+			reader >> count;
+			for (int i = 0; i < count; i++) {
+				KeyRef key;
+				int64_t size;
+				reader >> key >> size;
+				data->metrics.byteSample.sample.insert( Key(key), size );
+			}
+			entries += count;
+		}
+		chunksRead += snapshot.size();
+		if (!snapshot.more) break;
+		keys = KeyRangeRef( keyAfter(snapshot.back().key), keys.end );
+	}
+	ASSERT( chunksRead == chunks );
+
+	state KeyRange log = KeyRangeRef( byteSampleDeltaKey(startSequence), persistByteSampleDeltaKeys.end );
+	state int64_t deltas = 0;
+	loop {
+		Standalone<RangeResultRef> changes = wait( storage->readRange( log, 1<<30, SERVER_KNOBS->STORAGE_LIMIT_BYTES ) );
+		for (auto& kv : changes) {
+			ArenaReader reader( changes.arena(), kv.value, IncludeVersion() );
+			MutationRef m;
+			reader >> m;
+			if (m.type == MutationRef::SetValue)
+				data->metrics.byteSample.sample.insert( Key(m.param1.removePrefix(persistByteSampleKeys.begin)), BinaryReader::fromStringRef<int64_t>(m.param2, Unversioned()) );
+			else
+				data->metrics.byteSample.sample.erase( m.param1.removePrefix(persistByteSampleKeys.begin), m.param2.removePrefix(persistByteSampleKeys.begin) );
+		}
+		deltas += changes.size();
+		if (!changes.more) break;
+		log = KeyRangeRef( keyAfter(changes.back().key), log.end );
+	}
+
+	data->byteSampleDeltaSequence = std::max( data->byteSampleDeltaSequence, startSequence );
+	data->byteSampleSnapshotGeneration = generation;
+	TraceEvent("RecoveredByteSampleSnapshot", data->thisServerID).detail("Generation", generation).detail("Chunks", chunks)
+		.detail("Entries", entries).detail("Deltas", deltas);
+	return true;
+}
+
 ACTOR Future<Void> restoreByteSample(StorageServer* data, IKeyValueStore* storage, Promise<Void> byteSampleSampleRecovered, Future<Void> startRestore) {
+	bool fromSnapshot = wait( restoreByteSampleSnapshot(data, storage) );
+	if (fromSnapshot) {
+		byteSampleSampleRecovered.send(Void());
+		return Void();
+	}
+
 	state std::vector<Standalone<VectorRef<KeyValueRef>>> byteSampleSample;
 	wait( applyByteSampleResult(data, storage, persistByteSampleSampleKeys.begin, persistByteSampleSampleKeys.end, &byteSampleSample) );
 	byteSampleSampleRecovered.send(Void());
@@ -3160,17 +4943,19 @@ ACTOR Future<bool> restoreDurableState( StorageServer* data, IKeyValueStore* sto
 	state Future<Optional<Value>> fVersion = storage->readValue(persistVersion);
 	state Future<Optional<Value>> fLogProtocol = storage->readValue(persistLogProtocol);
 	state Future<Optional<Value>> fPrimaryLocality = storage->readValue(persistPrimaryLocality);
+	state Future<Optional<Value>> fWarmUpKeys = storage->readValue(persistWarmUpKeys);
 	state Future<Standalone<RangeResultRef>> fShardAssigned = storage->readRange(persistShardAssignedKeys);
 	state Future<Standalone<RangeResultRef>> fShardAvailable = storage->readRange(persistShardAvailableKeys);
+	state Future<Standalone<RangeResultRef>> fChangeFeeds = storage->readRange(persistChangeFeedKeys);
 
 	state Promise<Void> byteSampleSampleRecovered;
 	state Promise<Void> startByteSampleRestore;
 	data->byteSampleRecovery = restoreByteSample(data, storage, byteSampleSampleRecovered, startByteSampleRestore.getFuture());
 
+	// The shard metadata is restored while the byte sample is still loading; only unassigning shards needs the sample
 	TraceEvent("ReadingDurableState", data->thisServerID);
-	wait( waitForAll( std::vector{ fFormat, fID, fVersion, fLogProtocol, fPrimaryLocality } ) );
-	wait( waitForAll( std::vector{ fShardAssigned, fShardAvailable } ) );
-	wait( byteSampleSampleRecovered.getFuture() );
+	wait( waitForAll( std::vector{ fFormat, fID, fVersion, fLogProtocol, fPrimaryLocality, fWarmUpKeys } ) &&
+	      waitForAll( std::vector{ fShardAssigned, fShardAvailable, fChangeFeeds } ) );
 	TraceEvent("RestoringDurableState", data->thisServerID);
 
 	if (!fFormat.get().present()) {
@@ -3194,6 +4979,9 @@ ACTOR Future<bool> restoreDurableState( StorageServer* data, IKeyValueStore* sto
 	if (fPrimaryLocality.get().present())
 		data->primaryLocality = BinaryReader::fromStringRef<int8_t>(fPrimaryLocality.get().get(), Unversioned());
 
+	if (fWarmUpKeys.get().present())
+		data->warmUpKeys = BinaryReader::fromStringRef<std::vector<Key>>(fWarmUpKeys.get().get(), IncludeVersion());
+
 	state Version version = BinaryReader::fromStringRef<Version>( fVersion.get().get(), Unversioned() );
 	debug_checkRestoredVersion( data->thisServerID, version, "StorageServer" );
 	data->setInitialVersion( version );
@@ -3212,6 +5000,9 @@ ACTOR Future<bool> restoreDurableState( StorageServer* data, IKeyValueStore* sto
 		wait(yield());
 	}
 
+	// Unassigning a shard clears its data, and with it the data's byte sample, which must therefore be loaded
+	wait( byteSampleSampleRecovered.getFuture() );
+
 	state Standalone<RangeResultRef> assigned = fShardAssigned.get();
 	state int assignedLoc;
 	for(assignedLoc=0; assignedLoc<assigned.size(); assignedLoc++) {
@@ -3228,6 +5019,16 @@ ACTOR Future<bool> restoreDurableState( StorageServer* data, IKeyValueStore* sto
 		wait(yield());
 	}
 
+	for (auto& kv : fChangeFeeds.get()) {
+		Key id = kv.key.removePrefix(persistChangeFeedKeys.begin);
+		std::vector<std::pair<KeyRange, Version>> movedIn;
+		auto feedInfo = decodeChangeFeedSSValue(kv.value, &movedIn);
+		auto feed = addChangeFeed( data, id, feedInfo.first, feedInfo.second );
+		feed->movedIn = movedIn;
+		feed->durableVersion = std::max( feed->durableVersion, version );
+		TraceEvent("RestoringChangeFeed", data->thisServerID).detail("RangeID", id).detail("Range", feedInfo.first).detail("EmptyVersion", feedInfo.second);
+	}
+
 	wait( delay( 0.0001 ) );
 
 	{
@@ -3281,6 +5082,22 @@ void StorageServer::addMutationToMutationLogOrStorage( Version ver, MutationRef
 	}
 }
 
+void StorageServer::byteSamplePersist( MutationRef const& m, Version ver ) {
+	if (SERVER_KNOBS->BYTE_SAMPLE_SNAPSHOT_INTERVAL <= 0) {
+		addMutationToMutationLogOrStorage( ver, m );
+		return;
+	}
+
+	// Numbered before m is applied, which can sample m itself and log that change too
+	Key deltaKey = byteSampleDeltaKey( byteSampleDeltaSequence++ );
+	Value delta = BinaryWriter::toValue( m, IncludeVersion() );
+	addMutationToMutationLogOrStorage( ver, m );
+	if (ver != invalidVersion)
+		addUnsampledMutationToMutationLog( addVersionToMutationLog(ver), MutationRef(MutationRef::SetValue, deltaKey, delta) );
+	else
+		storage.writeKeyValue( KeyValueRef(deltaKey, delta) );
+}
+
 void StorageServer::byteSampleApplySet( KeyValueRef kv, Version ver ) {
 	// Update byteSample in memory and (eventually) on disk and notify waiting metrics
 
@@ -3295,7 +5112,7 @@ void StorageServer::byteSampleApplySet( KeyValueRef kv, Version ver ) {
 	if (sampleInfo.inSample) {
 		delta += sampleInfo.sampledSize;
 		byteSample.insert( key, sampleInfo.sampledSize );
-		addMutationToMutationLogOrStorage( ver, MutationRef(MutationRef::SetValue, key.withPrefix(persistByteSampleKeys.begin), BinaryWriter::toValue( sampleInfo.sampledSize, Unversioned() )) );
+		byteSamplePersist( MutationRef(MutationRef::SetValue, key.withPrefix(persistByteSampleKeys.begin), BinaryWriter::toValue( sampleInfo.sampledSize, Unversioned() )), ver );
 	} else {
 		bool any = old != byteSample.end();
 		if(!byteSampleRecovery.isReady() ) {
@@ -3308,7 +5125,7 @@ void StorageServer::byteSampleApplySet( KeyValueRef kv, Version ver ) {
 		if (any) {
 			byteSample.erase(old);
 			auto diskRange = singleKeyRange(key.withPrefix(persistByteSampleKeys.begin));
-			addMutationToMutationLogOrStorage( ver, MutationRef(MutationRef::ClearRange, diskRange.begin, diskRange.end) );
+			byteSamplePersist( MutationRef(MutationRef::ClearRange, diskRange.begin, diskRange.end), ver );
 		}
 	}
 
@@ -3353,7 +5170,7 @@ void StorageServer::byteSampleApplyClear( KeyRangeRef range, Version ver ) {
 	if (any) {
 		byteSample.eraseAsync( range.begin, range.end );
 		auto diskRange = range.withPrefix( persistByteSampleKeys.begin );
-		addMutationToMutationLogOrStorage( ver, MutationRef(MutationRef::ClearRange, diskRange.begin, diskRange.end) );
+		byteSamplePersist( MutationRef(MutationRef::ClearRange, diskRange.begin, diskRange.end), ver );
 	}
 }
 
@@ -3482,6 +5299,14 @@ ACTOR Future<Void> metricsCore( StorageServer* self, StorageServerInterface ssi
 					self->metrics.splitMetrics( req );
 				}
 			}
+			when (SplitRangeRequest req = waitNext(ssi.getRangeSplitPoints.getFuture())) {
+				if (!self->isReadable( req.keys )) {
+					TEST( true );	// getSplitPoints immediate wrong_shard_server()
+					self->sendErrorWithPenalty(req.reply, wrong_shard_server(), self->getPenalty());
+				} else {
+					self->metrics.getSplitPoints( req );
+				}
+			}
 			when (GetStorageMetricsRequest req = waitNext(ssi.getStorageMetrics.getFuture())) {
 				StorageBytes sb = self->storage.getStorageBytes();
 				self->metrics.getStorageMetrics( req, sb, self->counters.bytesInput.getRate() );
@@ -3506,6 +5331,135 @@ ACTOR Future<Void> logLongByteSampleRecovery(Future<Void> recovery) {
 	return Void();
 }
 
+// Periodically writes a snapshot of the byte sample over the older of its two generations, a chunk of entries at a
+// time, so that a restart can load the sample from the snapshot and the changes logged since instead of reading every
+// sampled key.  The snapshot replaces the previous one, and the log before it is discarded, only once it is complete.
+ACTOR Future<Void> snapshotByteSample( StorageServer* self ) {
+	if (SERVER_KNOBS->BYTE_SAMPLE_SNAPSHOT_INTERVAL <= 0)
+		return Void();
+	wait( self->byteSampleRecovery );
+
+	loop {
+		wait( delay(SERVER_KNOBS->BYTE_SAMPLE_SNAPSHOT_INTERVAL) );
+
+		state int generation = 1 - self->byteSampleSnapshotGeneration;
+		state uint64_t startSequence = self->byteSampleDeltaSequence;
+		state int32_t chunks = 0;
+		state int64_t entries = 0;
+		state Key begin;
+		state double startTime = now();
+		{
+			KeyRange keys = byteSampleSnapshotGenerationKeys(generation);
+			self->addUnsampledMutationToMutationLog( self->addVersionToMutationLog(self->data().getLatestVersion()), MutationRef(MutationRef::ClearRange, keys.begin, keys.end) );
+		}
+
+		loop {
+			bool done;
+			{
+				// Each chunk is consistent at the version it is written at; replaying the log from startSequence fixes up
+				// the changes made between chunks
+				auto& sample = self->metrics.byteSample.sample;
+				std::vector<std::pair<KeyRef, int64_t>> chunk;
+				auto it = sample.lower_bound(begin);
+				for(; it != sample.end() && chunk.size() < SERVER_KNOBS->BYTE_SAMPLE_SNAPSHOT_CHUNK_ENTRIES; ++it)
+					chunk.emplace_back( *it, sample.getMetric(it) );
+
+				BinaryWriter wr(IncludeVersion());
+				wr << int32_t(chunk.size());
+				for(auto& e : chunk) wr << e.first << e.second;
+				self->addUnsampledMutationToMutationLog( self->addVersionToMutationLog(self->data().getLatestVersion()),
+					MutationRef(MutationRef::SetValue, byteSampleSnapshotKey(generation, chunks), wr.toValue()) );
+				++chunks;
+				entries += chunk.size();
+
+				done = it == sample.end();
+				if (!done) begin = *it;
+			}
+			if (done) break;
+			wait( delay(SERVER_KNOBS->BYTE_SAMPLE_SNAPSHOT_CHUNK_DELAY) );
+		}
+
+		auto& mLV = self->addVersionToMutationLog( self->data().getLatestVersion() );
+		self->addUnsampledMutationToMutationLog( mLV, MutationRef(MutationRef::SetValue, persistByteSampleSnapshot, byteSampleSnapshotValue(generation, startSequence, chunks)) );
+		self->addUnsampledMutationToMutationLog( mLV, MutationRef(MutationRef::ClearRange, persistByteSampleDeltaKeys.begin, byteSampleDeltaKey(startSequence)) );
+		self->byteSampleSnapshotGeneration = generation;
+
+		TraceEvent("ByteSampleSnapshot", self->thisServerID).detail("Generation", generation).detail("Chunks", chunks)
+			.detail("Entries", entries).detail("Duration", now() - startTime);
+	}
+}
+
+// Periodically records the keys read most recently, so that the next run can warm the storage engine's cache around them
+ACTOR Future<Void> captureWarmUpKeys( StorageServer* self ) {
+	if (SERVER_KNOBS->STORAGE_WARM_UP_CAPTURE_INTERVAL <= 0)
+		return Void();
+
+	loop {
+		wait( delay(SERVER_KNOBS->STORAGE_WARM_UP_CAPTURE_INTERVAL) );
+
+		auto& sample = self->metrics.bytesReadSample.sample;
+		std::vector<std::pair<int64_t, KeyRef>> read;
+		for(auto it = sample.begin(); it != sample.end(); ++it)
+			read.emplace_back( sample.getMetric(it), *it );
+		// With nothing read lately the keys already recorded are as good a guess as any
+		if (read.empty()) continue;
+
+		int count = std::min<int>( read.size(), SERVER_KNOBS->STORAGE_WARM_UP_KEYS );
+		std::partial_sort( read.begin(), read.begin() + count, read.end(),
+			[](std::pair<int64_t, KeyRef> const& a, std::pair<int64_t, KeyRef> const& b) { return a.first > b.first; } );
+		std::vector<Key> keys;
+		for(int i = 0; i < count; i++)
+			keys.push_back( read[i].second );
+		std::sort( keys.begin(), keys.end() );
+
+		self->addUnsampledMutationToMutationLog( self->addVersionToMutationLog(self->data().getLatestVersion()),
+			MutationRef(MutationRef::SetValue, persistWarmUpKeys, BinaryWriter::toValue(keys, IncludeVersion())) );
+	}
+}
+
+// Reads onward from each of the keys most read before the last restart, so that the first reads after it mostly hit the
+// storage engine's cache rather than the disk.  Warm-up reads queue behind client reads at batch priority and are
+// limited in total bytes and in rate.
+ACTOR Future<Void> warmUpStorage( StorageServer* self ) {
+	state std::vector<Key> keys = std::move(self->warmUpKeys);
+	state int64_t bytesRead = 0;
+	state int keysRead = 0;
+	state double startTime = now();
+	state int i = 0;
+
+	self->warmUpKeys.clear();
+	if (keys.empty())
+		return Void();
+
+	for(; i < keys.size() && bytesRead < SERVER_KNOBS->STORAGE_WARM_UP_MAX_BYTES; i++) {
+		state int64_t bytes = 0;
+		try {
+			wait( self->readQueue.take(READ_PRIORITY_BATCH, NetworkAddress(), SERVER_KNOBS->STORAGE_WARM_UP_BYTES_PER_KEY) );
+			state StorageReadQueue::Releaser releaser(self->readQueue);
+			// Shards can have moved away since the keys were recorded
+			state KeyRange range = KeyRangeRef( keys[i], self->shards[keys[i]]->keys.end );
+			if (self->shards[keys[i]]->isReadable()) {
+				Standalone<RangeResultRef> result = wait( self->storage.readRange( range, 1<<30, SERVER_KNOBS->STORAGE_WARM_UP_BYTES_PER_KEY ) );
+				bytes = result.expectedSize();
+				++keysRead;
+			}
+			// The slot must not be held while waiting for the next one
+			releaser.release();
+		} catch (Error& e) {
+			if (e.code() != error_code_server_overloaded) throw;
+			// The server is busy enough that there is no time to warm up
+			TEST(true); // Storage warm-up shed
+			break;
+		}
+		bytesRead += bytes;
+		wait( delay( (double)bytes / SERVER_KNOBS->STORAGE_WARM_UP_BYTES_PER_SECOND, TaskPriority::Low ) );
+	}
+
+	TraceEvent("StorageWarmUpDone", self->thisServerID).detail("Keys", keysRead).detail("Recorded", keys.size())
+		.detail("Bytes", bytesRead).detail("Duration", now() - startTime);
+	return Void();
+}
+
 ACTOR Future<Void> checkBehind( StorageServer* self ) {
 	state int behindCount = 0;
 	loop {
@@ -3543,6 +5497,9 @@ ACTOR Future<Void> storageServerCore( StorageServer* self, StorageServerInterfac
 	actors.add(self->otherError.getFuture());
 	actors.add(metricsCore(self, ssi));
 	actors.add(logLongByteSampleRecovery(self->byteSampleRecovery));
+	actors.add(snapshotByteSample(self));
+	actors.add(captureWarmUpKeys(self));
+	actors.add(warmUpStorage(self));
 	actors.add(checkBehind(self));
 
 	self->coreStarted.send( Void() );
@@ -3610,11 +5567,27 @@ ACTOR Future<Void> storageServerCore( StorageServer* self, StorageServerInterfac
 				else
 					actors.add(self->readGuard(req , getValueQ));
 			}
+			when( GetValuesRequest req = waitNext(ssi.getValues.getFuture()) ) {
+				// Warning: This code is executed at extremely high priority (TaskPriority::LoadBalancedEndpoint), so downgrade before doing real work
+				actors.add(self->readGuard(req , getValuesQ));
+			}
+			when( GetMappedKeyValuesRequest req = waitNext(ssi.getMappedKeyValues.getFuture()) ) {
+				// Warning: This code is executed at extremely high priority (TaskPriority::LoadBalancedEndpoint), so downgrade before doing real work
+				actors.add(self->readGuard(req , getMappedKeyValuesQ));
+			}
+			when( ChangeFeedStreamRequest req = waitNext(ssi.changeFeedStream.getFuture()) ) {
+				actors.add(changeFeedStreamQ(self, req));
+			}
+			when( ChangeFeedPopRequest req = waitNext(ssi.changeFeedPop.getFuture()) ) {
+				actors.add(changeFeedPopQ(self, req));
+			}
 			when( WatchValueRequest req = waitNext(ssi.watchValue.getFuture()) ) {
 				// TODO: fast load balancing?
-				// SOMEDAY: combine watches for the same key/value into a single watch
 				actors.add(self->readGuard(req, watchValueQ));
 			}
+			when( WatchValuesRequest req = waitNext(ssi.watchValues.getFuture()) ) {
+				actors.add(self->readGuard(req, watchValuesQ));
+			}
 			when (GetKeyRequest req = waitNext(ssi.getKey.getFuture())) {
 				// Warning: This code is executed at extremely high priority (TaskPriority::LoadBalancedEndpoint), so downgrade before doing real work
 				actors.add(self->readGuard(req , getKey));
@@ -3623,6 +5596,10 @@ ACTOR Future<Void> storageServerCore( StorageServer* self, StorageServerInterfac
 				// Warning: This code is executed at extremely high priority (TaskPriority::LoadBalancedEndpoint), so downgrade before doing real work
 				actors.add(self->readGuard(req , getKeyValues));
 			}
+			when (GetKeyValuesStreamRequest req = waitNext(ssi.getKeyValuesStream.getFuture()) ) {
+				// Warning: This code is executed at extremely high priority (TaskPriority::LoadBalancedEndpoint), so downgrade before doing real work
+				actors.add(self->readGuard(req , getKeyValuesStreamQ));
+			}
 			when (GetShardStateRequest req = waitNext(ssi.getShardState.getFuture()) ) {
 				if (req.mode == GetShardStateRequest::NO_WAIT ) {
 					if( self->isReadable( req.keys ) )
@@ -3925,36 +5902,166 @@ Possibilities:
   -4 Modular lastUpdateVersion (make sure no node survives 4 billion updates)
 */
 
-void versionedMapTest() {
-	VersionedMap<int,int> vm;
-
-	printf("SS Ptree node is %zu bytes\n", sizeof( StorageServer::VersionedData::PTreeT ) );
-
-	const int NSIZE = sizeof(VersionedMap<int,int>::PTreeT);
-	const int ASIZE = NSIZE <= 64 ? 64 : nextFastAllocatedSize(NSIZE);
-
-	auto before = FastAllocator< ASIZE >::getTotalMemory();
+static int64_t fastAllocatedMemory() {
+	return FastAllocator<64>::getTotalMemory() + FastAllocator<96>::getTotalMemory() + FastAllocator<128>::getTotalMemory() +
+	       FastAllocator<256>::getTotalMemory() + FastAllocator<512>::getTotalMemory() + FastAllocator<1024>::getTotalMemory() +
+	       FastAllocator<2048>::getTotalMemory();
+}
 
-	for(int v=1; v<=1000; ++v) {
+// Runs the same workload against a VersionedMap<int,int> of the given kind: 1000000 sets and small clears, in versions of
+// writesPerVersion each, keeping the last 100000 of them in memory like the storage server does, followed by point reads
+// and scans at random versions.  A PBTree copies the most per write when there are few writes per version.
+static void versionedMapBenchmark(bool useBTree, int writesPerVersion) {
+	VersionedMap<int,int> vm(useBTree);
+	DeterministicRandom random(1);
+	int versions = 1000000 / writesPerVersion;
+	int window = 100000 / writesPerVersion;
+
+	auto before = fastAllocatedMemory();
+	double start = timer();
+	for(int v=1; v<=versions; ++v) {
 		vm.createNewVersion(v);
-		for(int i=0; i<1000; i++) {
-			int k = deterministicRandom()->randomInt(0, 2000000);
-			/*for(int k2=k-5; k2<k+5; k2++)
-				if (vm.atLatest().find(k2) != vm.atLatest().end())
-					vm.erase(k2);*/
+		for(int i=0; i<writesPerVersion; i++) {
+			int k = random.randomInt(0, 2000000);
 			vm.erase( k-5, k+5 );
 			vm.insert( k, v );
 		}
+		if (v > window) vm.forgetVersionsBefore(v - window);
 	}
+	double writeTime = timer() - start;
+	auto after = fastAllocatedMemory();
+
+	start = timer();
+	int found = 0;
+	for(int i=0; i<1000000; i++) {
+		auto view = vm.at( random.randomInt(vm.getOldestVersion(), vm.getLatestVersion()+1) );
+		if (view.find( random.randomInt(0, 2000000) ) != view.end())
+			++found;
+	}
+	double readTime = timer() - start;
 
-	auto after = FastAllocator< ASIZE >::getTotalMemory();
-
+	start = timer();
 	int count = 0;
-	for(auto i = vm.atLatest().begin(); i != vm.atLatest().end(); ++i)
-		++count;
+	for(int i=0; i<100; i++) {
+		auto view = vm.at( random.randomInt(vm.getOldestVersion(), vm.getLatestVersion()+1) );
+		for(auto it = view.begin(); it != view.end(); ++it)
+			++count;
+	}
+	double scanTime = timer() - start;
+
+	printf("%s, %d writes per version: %.3fs for 1000000 sets and clears, %.3fs for 1000000 point reads (%d found), %.3fs to scan %d items, %f MB allocated\n",
+		 useBTree ? "PBTree" : "PTree", writesPerVersion, writeTime, readTime, found, scanTime, count, (after - before) / 1e6);
+}
+
+void versionedMapTest() {
+	printf("SS Ptree node is %zu bytes\n", sizeof( StorageServer::VersionedData::PTreeT ) );
+	printf("SS PBTree leaf is %zu bytes, internal node is %zu bytes\n",
+		 sizeof( PBTreeImpl::PBTreeLeaf<KeyRef, std::pair<ValueOrClearToRef, Version>> ),
+		 sizeof( PBTreeImpl::PBTreeInternal<KeyRef, std::pair<ValueOrClearToRef, Version>> ) );
+	printf("SS charges %d bytes per PTree item and %d bytes per PBTree item\n",
+		 StorageServer::VersionedData::ptreeOverheadPerItem, StorageServer::VersionedData::pbtreeOverheadPerItem );
+
+	for(int writesPerVersion : { 1000, 10 }) {
+		versionedMapBenchmark(false, writesPerVersion);
+		versionedMapBenchmark(true, writesPerVersion);
+	}
+}
+
+TEST_CASE("/fdbserver/storageserver/StorageHistory") {
+	// Commits at versions 10 and 20, with "b" changed at version 15 by the commit at 20 and nothing changed by the
+	// commit at 30
+	StorageHistory history(true);
+	KeyRef a = LiteralStringRef("a"), b = LiteralStringRef("b"), d = LiteralStringRef("d");
+	ASSERT( history.oldestVersion() == invalidVersion && !history.canRead(5, singleKeyRange(a)) );
+
+	history.changed( singleKeyRange(b), 15 );
+	history.committed( 10, 20 );
+	history.committed( 20, 30 );
+	ASSERT( history.oldestVersion() == 10 );
+	ASSERT( !history.canRead(9, singleKeyRange(a)) );
+	ASSERT( history.canRead(12, KeyRangeRef(a, d)) ); // Before the first change
+	ASSERT( history.canRead(16, singleKeyRange(a)) && history.canRead(16, singleKeyRange(d)) );
+	ASSERT( !history.canRead(16, singleKeyRange(b)) && !history.canRead(16, KeyRangeRef(a, d)) );
+	ASSERT( history.canRead(25, singleKeyRange(b)) );
+	ASSERT( !history.canRead(30, singleKeyRange(a)) ); // Not yet committed
+
+	// Too many changes to track refuses every read after the first of them
+	for(int i = 0; i <= SERVER_KNOBS->STORAGE_VERSIONED_READ_MAX_RANGES; i++)
+		history.changed( singleKeyRange(StringRef(format("k%08d", i))), 35 );
+	history.committed( 30, 40 );
+	ASSERT( history.canRead(32, singleKeyRange(a)) && !history.canRead(35, singleKeyRange(a)) );
+
+	history.forget( KeyRangeRef(a, LiteralStringRef("c")) );
+	ASSERT( !history.canRead(12, singleKeyRange(a)) && !history.canRead(25, singleKeyRange(b)) );
+	ASSERT( history.canRead(25, singleKeyRange(d)) && !history.canRead(32, singleKeyRange(d)) );
+
+	history.expire( 20 );
+	ASSERT( history.oldestVersion() == 20 && !history.canRead(15, singleKeyRange(d)) );
+	history.expire( 40 );
+	ASSERT( history.oldestVersion() == invalidVersion );
+	return Void();
+}
+
+TEST_CASE("/fdbserver/storageserver/RowCache") {
+	StorageRowCache cache(1e6);
+	KeyRef a = LiteralStringRef("a"), b = LiteralStringRef("b"), c = LiteralStringRef("c");
+	Optional<Value> value = Value(LiteralStringRef("value"));
+
+	// A key is admitted on its second miss, and a missing key is cached as missing
+	ASSERT( !cache.get(a) && !cache.admit(a) && cache.admit(a) );
+	cache.insert( a, value, cache.getCommits() );
+	cache.insert( b, Optional<Value>(), cache.getCommits() );
+	ASSERT( cache.get(a) && *cache.get(a) == value );
+	ASSERT( cache.get(b) && !cache.get(b)->present() );
+	ASSERT( StorageRowCache::prefix(*cache.get(a), 3) == Optional<Value>(Value(LiteralStringRef("val"))) );
+	ASSERT( StorageRowCache::prefix(*cache.get(a), 100) == value );
+
+	// Writes invalidate the keys they touch when their commit completes, and a value read from storage while a
+	// commit completed is not cached
+	uint64_t readCommits = cache.getCommits();
+	cache.written( KeyRangeRef(b, c) );
+	Standalone<VectorRef<KeyRangeRef>> writes = cache.startCommit();
+	ASSERT( cache.get(b) );
+	cache.invalidate( writes );
+	ASSERT( !cache.get(b) && cache.get(a) );
+	cache.insert( c, value, readCommits );
+	ASSERT( !cache.get(c) );
+
+	// The least recently used keys are evicted to stay within capacity
+	StorageRowCache small(200);
+	small.insert( a, value, small.getCommits() );
+	small.insert( b, value, small.getCommits() );
+	ASSERT( !small.get(a) && small.get(b) && small.getBytes() <= 200 );
+	return Void();
+}
 
-	printf("PTree node is %d bytes, allocated as %d bytes\n", NSIZE, ASIZE);
-	printf("%d distinct after %d insertions\n", count, 1000*1000);
-	printf("Memory used: %f MB\n",
-		 (after - before)/ 1e6);
+ACTOR static Future<Void> takeAndRecordReadSlot( StorageReadQueue* queue, int priority, NetworkAddress client, int64_t cost, int id, std::vector<int>* order ) {
+	wait( queue->take(priority, client, cost) );
+	order->push_back(id);
+	queue->release();
+	return Void();
+}
+
+TEST_CASE("/fdbserver/storageserver/ReadQueue") {
+	// With the only slot taken, queues reads and checks that they are admitted by priority and then by fair share:
+	// one point read from client b goes ahead of client a's range reads that were queued before it
+	state StorageReadQueue queue(1);
+	state std::vector<int> order;
+	state std::vector<Future<Void>> reads;
+	state NetworkAddress a(1, 1);
+	state NetworkAddress b(2, 1);
+
+	wait( queue.take(READ_PRIORITY_DEFAULT, a, 1) );
+	reads.push_back( takeAndRecordReadSlot(&queue, READ_PRIORITY_DEFAULT, a, 10, 1, &order) );
+	reads.push_back( takeAndRecordReadSlot(&queue, READ_PRIORITY_DEFAULT, a, 10, 2, &order) );
+	reads.push_back( takeAndRecordReadSlot(&queue, READ_PRIORITY_BATCH, b, 1, 3, &order) );
+	reads.push_back( takeAndRecordReadSlot(&queue, READ_PRIORITY_DEFAULT, b, 1, 4, &order) );
+	reads.push_back( takeAndRecordReadSlot(&queue, READ_PRIORITY_IMMEDIATE, a, 100, 5, &order) );
+	ASSERT( queue.getWaiting() == 5 );
+
+	queue.release();
+	wait( waitForAll(reads) );
+	ASSERT( order == std::vector<int>({ 5, 4, 1, 2, 3 }) );
+	ASSERT( queue.getActive() == 0 && queue.getWaiting() == 0 && queue.getShed() == 0 );
+	return Void();
 }
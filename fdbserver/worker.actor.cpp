@@ -437,6 +437,7 @@ ACTOR Future<Void> registrationClient(
 					StorageServerInterface recruited;
 					recruited.locality = locality;
 					recruited.initEndpoints();
+					recruited.features = StorageServerInterface::STORAGE_CACHE_FEATURES;
 
 					std::map<std::string, std::string> details;
 					startRole( Role::STORAGE_CACHE, recruited.id(), interf.id(), details );
@@ -453,6 +454,13 @@ ACTOR Future<Void> registrationClient(
 					DUMPTOKEN(recruited.getQueuingMetrics);
 					DUMPTOKEN(recruited.getKeyValueStoreType);
 					DUMPTOKEN(recruited.watchValue);
+					DUMPTOKEN(recruited.watchValues);
+					DUMPTOKEN(recruited.getKeyValuesStream);
+					DUMPTOKEN(recruited.getValues);
+					DUMPTOKEN(recruited.getMappedKeyValues);
+					DUMPTOKEN(recruited.changeFeedStream);
+					DUMPTOKEN(recruited.changeFeedPop);
+					DUMPTOKEN(recruited.getRangeSplitPoints);
 
 					cacheProcessFuture = storageCache( recruited, reply.storageCache.get(), dbInfo );
 					cacheErrorsFuture = forwardError(errors, Role::STORAGE_CACHE, recruited.id(), setWhenDoneOrError(cacheProcessFuture, scInterf, Optional<std::pair<uint16_t,StorageServerInterface>>()));
@@ -628,6 +636,7 @@ ACTOR Future<Void> storageServerRollbackRebooter( Future<Void> prevStorageServer
 		recruited.uniqueID = id;
 		recruited.locality = locality;
 		recruited.initEndpoints();
+		recruited.features = StorageServerInterface::STORAGE_SERVER_FEATURES;
 
 		DUMPTOKEN(recruited.getValue);
 		DUMPTOKEN(recruited.getKey);
@@ -640,6 +649,13 @@ ACTOR Future<Void> storageServerRollbackRebooter( Future<Void> prevStorageServer
 		DUMPTOKEN(recruited.getQueuingMetrics);
 		DUMPTOKEN(recruited.getKeyValueStoreType);
 		DUMPTOKEN(recruited.watchValue);
+		DUMPTOKEN(recruited.watchValues);
+		DUMPTOKEN(recruited.getKeyValuesStream);
+		DUMPTOKEN(recruited.getValues);
+		DUMPTOKEN(recruited.getMappedKeyValues);
+		DUMPTOKEN(recruited.changeFeedStream);
+		DUMPTOKEN(recruited.changeFeedPop);
+		DUMPTOKEN(recruited.getRangeSplitPoints);
 
 		prevStorageServer = storageServer( store, recruited, db, folder, Promise<Void>(), Reference<ClusterConnectionFile> (nullptr) );
 		prevStorageServer = handleIOErrors(prevStorageServer, store, id, store->onClosed());
@@ -977,6 +993,7 @@ ACTOR Future<Void> workerServer(
 				recruited.uniqueID = s.storeID;
 				recruited.locality = locality;
 				recruited.initEndpoints();
+				recruited.features = StorageServerInterface::STORAGE_SERVER_FEATURES;
 
 				std::map<std::string, std::string> details;
 				details["StorageEngine"] = s.storeType.toString();
@@ -993,6 +1010,13 @@ ACTOR Future<Void> workerServer(
 				DUMPTOKEN(recruited.getQueuingMetrics);
 				DUMPTOKEN(recruited.getKeyValueStoreType);
 				DUMPTOKEN(recruited.watchValue);
+				DUMPTOKEN(recruited.watchValues);
+				DUMPTOKEN(recruited.getKeyValuesStream);
+				DUMPTOKEN(recruited.getValues);
+				DUMPTOKEN(recruited.getMappedKeyValues);
+				DUMPTOKEN(recruited.changeFeedStream);
+				DUMPTOKEN(recruited.changeFeedPop);
+				DUMPTOKEN(recruited.getRangeSplitPoints);
 
 				Promise<Void> recovery;
 				Future<Void> f = storageServer( kv, recruited, dbInfo, folder, recovery, connFile);
@@ -1230,6 +1254,7 @@ ACTOR Future<Void> workerServer(
 					StorageServerInterface recruited(req.interfaceId);
 					recruited.locality = locality;
 					recruited.initEndpoints();
+					recruited.features = StorageServerInterface::STORAGE_SERVER_FEATURES;
 
 					std::map<std::string, std::string> details;
 					details["StorageEngine"] = req.storeType.toString();
@@ -1246,6 +1271,13 @@ ACTOR Future<Void> workerServer(
 					DUMPTOKEN(recruited.getQueuingMetrics);
 					DUMPTOKEN(recruited.getKeyValueStoreType);
 					DUMPTOKEN(recruited.watchValue);
+					DUMPTOKEN(recruited.watchValues);
+					DUMPTOKEN(recruited.getKeyValuesStream);
+					DUMPTOKEN(recruited.getValues);
+					DUMPTOKEN(recruited.getMappedKeyValues);
+					DUMPTOKEN(recruited.changeFeedStream);
+					DUMPTOKEN(recruited.changeFeedPop);
+					DUMPTOKEN(recruited.getRangeSplitPoints);
 					//printf("Recruited as storageServer\n");
 
 					std::string filename = filenameFromId( req.storeType, folder, fileStoragePrefix.toString(), recruited.id() );
@@ -427,9 +427,13 @@ public:
 		state Version readVersion;
 
 		state Reference<TransactionWrapper> transaction = self->createTransaction();
+		state int parallelShards = deterministicRandom()->coinflip() ? deterministicRandom()->randomInt(1, 5) : 0;
 
 		loop {
 			try {
+				if(parallelShards) {
+					transaction->setOption(FDBTransactionOptions::PARALLEL_RANGE_READS, BinaryWriter::toValue<int64_t>(parallelShards, Unversioned()));
+				}
 				Version version = wait(transaction->getReadVersion());
 				readVersion = version;
 
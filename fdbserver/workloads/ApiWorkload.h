@@ -79,6 +79,8 @@ struct TransactionWrapper : public ReferenceCounted<TransactionWrapper> {
 	virtual void debugTransaction(UID debugId) {}
 
 	virtual void addReadConflictRange( KeyRangeRef const& keys ) = 0;
+
+	virtual void setOption( FDBTransactionOptions::Option option, Optional<StringRef> value = Optional<StringRef>() ) = 0;
 };
 
 //A wrapper class for flow based transactions (NativeAPI, ReadYourWrites)
@@ -164,6 +166,10 @@ struct FlowTransactionWrapper : public TransactionWrapper {
 	void addReadConflictRange( KeyRangeRef const& keys ) {
 		transaction.addReadConflictRange(keys);
 	}
+
+	void setOption( FDBTransactionOptions::Option option, Optional<StringRef> value ) {
+		transaction.setOption(option, value);
+	}
 };
 
 //A wrapper class for ThreadSafeTransactions.  Converts ThreadFutures into Futures for interchangeability with flow transactions
@@ -232,6 +238,10 @@ struct ThreadTransactionWrapper : public TransactionWrapper {
 	void addReadConflictRange( KeyRangeRef const& keys ) {
 		transaction->addReadConflictRange(keys);
 	}
+
+	void setOption( FDBTransactionOptions::Option option, Optional<StringRef> value ) {
+		transaction->setOption(option, value);
+	}
 };
 
 //A factory interface for creating different kinds of TransactionWrappers
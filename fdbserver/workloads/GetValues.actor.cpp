@@ -0,0 +1,126 @@
+/*
+ * GetValues.actor.cpp
+ *
+ * This source file is part of the FoundationDB open source project
+ *
+ * Copyright 2013-2018 Apple Inc. and the FoundationDB project authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "fdbclient/NativeAPI.actor.h"
+#include "fdbserver/TesterInterface.actor.h"
+#include "fdbserver/workloads/workloads.actor.h"
+#include "flow/actorcompiler.h"  // This must be the last #include.
+
+// Issues many concurrent point reads in each transaction, so that the client batches them into GetValuesRequests,
+// and checks every value.  Only the even keys exist, and some keys are read more than once.
+struct GetValuesWorkload : TestWorkload {
+	int nodeCount, maxReads;
+	double testDuration;
+	PerfIntCounter transactions, reads, retries;
+	bool ok;
+
+	GetValuesWorkload(WorkloadContext const& wcx)
+		: TestWorkload(wcx), transactions("Transactions"), reads("Reads"), retries("Retries"), ok(true)
+	{
+		nodeCount = getOption( options, LiteralStringRef("nodeCount"), 2000 );
+		maxReads = getOption( options, LiteralStringRef("maxReads"), 200 );
+		testDuration = getOption( options, LiteralStringRef("testDuration"), 10.0 );
+	}
+
+	virtual std::string description() { return "GetValues"; }
+
+	Key keyForIndex( int n ) { return StringRef(format("getvalues%08d", n)); }
+	Value valueForIndex( int n ) { return StringRef(format("value%d", n * 7)); }
+
+	virtual Future<Void> setup( Database const& cx ) {
+		if( clientId == 0 )
+			return _setup( cx, this );
+		return Void();
+	}
+
+	virtual Future<Void> start( Database const& cx ) {
+		return _start( cx, this );
+	}
+
+	virtual Future<bool> check( Database const& cx ) {
+		return ok;
+	}
+
+	virtual void getMetrics( vector<PerfMetric>& m ) {
+		m.push_back( transactions.getMetric() );
+		m.push_back( reads.getMetric() );
+		m.push_back( retries.getMetric() );
+	}
+
+	ACTOR static Future<Void> _setup( Database cx, GetValuesWorkload* self ) {
+		state int i = 0;
+		for(; i < self->nodeCount; i += 200) {
+			state Transaction tr( cx );
+			loop {
+				try {
+					for(int j = i; j < std::min(i + 200, self->nodeCount); j += 2) {
+						tr.set( self->keyForIndex(j), self->valueForIndex(j) );
+					}
+					wait( tr.commit() );
+					break;
+				} catch( Error &e ) {
+					wait( tr.onError(e) );
+				}
+			}
+		}
+		return Void();
+	}
+
+	ACTOR static Future<Void> _start( Database cx, GetValuesWorkload* self ) {
+		state double testStart = now();
+		while( now() - testStart < self->testDuration ) {
+			state std::vector<int> indexes;
+			for(int i = deterministicRandom()->randomInt(1, self->maxReads + 1); i > 0; i--) {
+				indexes.push_back( deterministicRandom()->randomInt(0, self->nodeCount) );
+			}
+			state Transaction tr( cx );
+			loop {
+				try {
+					state std::vector<Future<Optional<Value>>> values;
+					for(int n : indexes) {
+						values.push_back( tr.get(self->keyForIndex(n)) );
+					}
+					wait( waitForAll(values) );
+
+					for(int i = 0; i < indexes.size(); i++) {
+						Optional<Value> expected;
+						if( indexes[i] % 2 == 0 )
+							expected = self->valueForIndex(indexes[i]);
+						if( values[i].get() != expected ) {
+							TraceEvent(SevError, "GetValuesMismatch").detail("Key", self->keyForIndex(indexes[i]))
+								.detail("Expected", expected.present() ? expected.get() : LiteralStringRef("<null>"))
+								.detail("Read", values[i].get().present() ? values[i].get().get() : LiteralStringRef("<null>"));
+							self->ok = false;
+						}
+					}
+					++self->transactions;
+					self->reads += indexes.size();
+					break;
+				} catch( Error &e ) {
+					wait( tr.onError(e) );
+					++self->retries;
+				}
+			}
+		}
+		return Void();
+	}
+};
+
+WorkloadFactory<GetValuesWorkload> GetValuesWorkloadFactory("GetValues");
@@ -0,0 +1,428 @@
+/*
+ * KVStoreBench.actor.cpp
+ *
+ * This source file is part of the FoundationDB open source project
+ *
+ * Copyright 2013-2018 Apple Inc. and the FoundationDB project authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cinttypes>
+#include "fdbserver/workloads/workloads.actor.h"
+#include "fdbserver/IKeyValueStore.h"
+#include "fdbclient/zipf.h"
+#include "fdbrpc/ContinuousSample.h"
+#include "flow/ActorCollection.h"
+#include "flow/actorcompiler.h"  // This must be the last #include.
+
+// KVStoreBench runs the YCSB core workloads against a single IKeyValueStore, without a cluster, so that storage
+// engines can be compared with each other and with earlier builds of themselves.  It loads nodeCount records (or as
+// many as fit in datasetBytes) into a new store and then runs one of the mixes A-F against them for testDuration,
+// reporting the throughput and latency of each kind of operation, the write amplification (bytes written to the
+// device / bytes set) and the space amplification (bytes used by the store / logical bytes of the live records).
+//
+// Run it with 'fdbserver -r test -f tests/KVStoreBenchYCSB.txt'.  Write amplification is measured on the device
+// holding the store, so anything else writing to that device while the benchmark runs is counted too, and it is
+// reported as 0 on platforms which do not count the sectors written to a device.
+
+// Latencies of one kind of operation, kept as a sample for percentiles and as counts in power-of-two microsecond
+// buckets for the shape of the tail.
+struct KVBenchOpStats {
+	std::string name;
+	PerfIntCounter count;
+	ContinuousSample<double> latency;
+	std::vector<int64_t> buckets;
+
+	explicit KVBenchOpStats(std::string const& name) : name(name), count(name), latency(10000), buckets(32) {}
+
+	void add(double seconds) {
+		++count;
+		latency.addSample(seconds);
+		int b = 0;
+		for (int64_t us = seconds * 1e6; us > 1 && b + 1 < buckets.size(); us >>= 1) ++b;
+		++buckets[b];
+	}
+
+	void getMetrics(vector<PerfMetric>& m, double elapsed) {
+		m.push_back(count.getMetric());
+		m.push_back(PerfMetric(name + "/sec", elapsed ? count.getValue() / elapsed : 0, false));
+		if (!count.getValue()) return;
+		m.push_back(PerfMetric("Median " + name + " Latency (ms)", 1000.0 * latency.median(), true));
+		m.push_back(PerfMetric("95% " + name + " Latency (ms)", 1000.0 * latency.percentile(0.95), true));
+		m.push_back(PerfMetric("99% " + name + " Latency (ms)", 1000.0 * latency.percentile(0.99), true));
+		m.push_back(PerfMetric("99.9% " + name + " Latency (ms)", 1000.0 * latency.percentile(0.999), true));
+		m.push_back(PerfMetric("Max " + name + " Latency (ms)", 1000.0 * latency.max(), true));
+	}
+
+	void logHistogram() {
+		TraceEvent e("KVStoreBenchLatencyHistogram");
+		e.detail("Operation", name);
+		for (int b = 0; b < buckets.size(); ++b) {
+			if (buckets[b]) e.detail(format("UnderMicroseconds%" PRId64, int64_t(2) << b).c_str(), buckets[b]);
+		}
+	}
+};
+
+Future<Void> benchKVStore( struct KVStoreBenchWorkload *const& );
+
+struct KVStoreBenchWorkload : TestWorkload {
+	bool enabled, saturation;
+	std::string profile, storeType, filename, requestDistribution, valueSizeDistribution;
+	double testDuration, operationsPerSecond, commitInterval, zipfConstant;
+	double readFraction, updateFraction, insertFraction, scanFraction, readModifyWriteFraction, totalFraction;
+	int nodeCount, keyBytes, valueBytesMin, valueBytesMax, maxScanLength, actorCount;
+
+	IKeyValueStore* store;
+	std::string dataFolder;
+	IPAddress localIP;
+	SystemStatisticsState* diskStats;
+	std::vector<int> valueSizes; // Current value size of each record; record i has key makeKey(i)
+	std::vector<int> valueSizePool; // Value sizes drawn from a zipfian distribution, if valueSizeDistribution is zipfian
+	Standalone<StringRef> valueSource; // Random bytes that values are cut from
+	int64_t liveBytes; // Logical size of the live records
+	int64_t bytesSet; // Logical size of the sets made since the run began
+	bool uncommitted;
+
+	PerfIntCounter updates, inserts;
+	KVBenchOpStats reads, scans, readModifyWrites, commits;
+	double loadTook, runTook, loadWriteAmplification, writeAmplification, spaceAmplification;
+
+	KVStoreBenchWorkload(WorkloadContext const& wcx)
+	  : TestWorkload(wcx), store(NULL), diskStats(NULL), liveBytes(0), bytesSet(0), uncommitted(false),
+	    updates("Updates"), inserts("Inserts"), reads("Reads"), scans("Scans"), readModifyWrites("ReadModifyWrites"),
+	    commits("Commits"), loadTook(0), runTook(0), loadWriteAmplification(0), writeAmplification(0),
+	    spaceAmplification(0) {
+		enabled = !clientId; // only do this on the "first" client
+		profile = getOption(options, LiteralStringRef("workload"), LiteralStringRef("A")).toString();
+
+		// The operation mix of each YCSB core workload: A is update heavy, B is read mostly, C is read only, D reads
+		// the latest records, E scans short ranges and F reads records and writes them back.  Each fraction can also
+		// be given directly.
+		double read = 0, update = 0, insert = 0, scan = 0, readModifyWrite = 0;
+		std::string distribution = "zipfian";
+		if (profile == "A") {
+			read = 0.5; update = 0.5;
+		} else if (profile == "B") {
+			read = 0.95; update = 0.05;
+		} else if (profile == "C") {
+			read = 1.0;
+		} else if (profile == "D") {
+			read = 0.95; insert = 0.05; distribution = "latest";
+		} else if (profile == "E") {
+			scan = 0.95; insert = 0.05;
+		} else if (profile == "F") {
+			read = 0.5; readModifyWrite = 0.5;
+		} else {
+			ASSERT(false);
+		}
+		readFraction = getOption(options, LiteralStringRef("readFraction"), read);
+		updateFraction = getOption(options, LiteralStringRef("updateFraction"), update);
+		insertFraction = getOption(options, LiteralStringRef("insertFraction"), insert);
+		scanFraction = getOption(options, LiteralStringRef("scanFraction"), scan);
+		readModifyWriteFraction = getOption(options, LiteralStringRef("readModifyWriteFraction"), readModifyWrite);
+		totalFraction = readFraction + updateFraction + insertFraction + scanFraction + readModifyWriteFraction;
+		ASSERT(totalFraction > 0);
+
+		requestDistribution = getOption(options, LiteralStringRef("requestDistribution"), StringRef(distribution)).toString();
+		valueSizeDistribution = getOption(options, LiteralStringRef("valueSizeDistribution"), LiteralStringRef("uniform")).toString();
+		ASSERT(requestDistribution == "zipfian" || requestDistribution == "uniform" || requestDistribution == "latest");
+		ASSERT(valueSizeDistribution == "zipfian" || valueSizeDistribution == "uniform");
+		zipfConstant = getOption(options, LiteralStringRef("zipfConstant"), ZIPFIAN_CONSTANT);
+
+		testDuration = getOption(options, LiteralStringRef("testDuration"), 10.0);
+		operationsPerSecond = getOption(options, LiteralStringRef("operationsPerSecond"), 10e3);
+		saturation = getOption(options, LiteralStringRef("saturation"), false);
+		actorCount = getOption(options, LiteralStringRef("actorCount"), 100);
+		commitInterval = getOption(options, LiteralStringRef("commitInterval"), 0.1);
+		keyBytes = getOption(options, LiteralStringRef("keyBytes"), 16);
+		valueBytesMin = getOption(options, LiteralStringRef("valueBytesMin"), 1000);
+		valueBytesMax = getOption(options, LiteralStringRef("valueBytesMax"), valueBytesMin);
+		maxScanLength = getOption(options, LiteralStringRef("maxScanLength"), 100);
+		filename = getOption(options, LiteralStringRef("filename"), Value()).toString();
+		storeType = getOption(options, LiteralStringRef("storeType"), LiteralStringRef("ssd-redwood-experimental")).toString();
+		ASSERT(keyBytes >= sizeof(int64_t) && valueBytesMin >= 0 && valueBytesMin <= valueBytesMax);
+
+		// Zipfian value sizes favor the short end of the range, as YCSB's zipfian field lengths do.  They are drawn
+		// up front because the zipfian generator is shared with the request distribution.
+		if (valueSizeDistribution == "zipfian" && valueBytesMin < valueBytesMax) {
+			zipfian_generator3(valueBytesMin, valueBytesMax, zipfConstant);
+			for (int i = 0; i < 10000; ++i) valueSizePool.push_back(zipfian_next());
+		}
+
+		double datasetBytes = getOption(options, LiteralStringRef("datasetBytes"), 0.0);
+		if (datasetBytes > 0) {
+			double meanValueBytes = (valueBytesMin + valueBytesMax) / 2.0;
+			if (valueSizePool.size()) {
+				meanValueBytes = 0;
+				for (int size : valueSizePool) meanValueBytes += size;
+				meanValueBytes /= valueSizePool.size();
+			}
+			nodeCount = datasetBytes / (keyBytes + meanValueBytes);
+		} else {
+			nodeCount = getOption(options, LiteralStringRef("nodeCount"), 100000);
+		}
+		ASSERT(nodeCount > 0);
+	}
+
+	virtual std::string description() { return "KVStoreBench"; }
+	virtual Future<Void> setup(Database const& cx) { return Void(); }
+	virtual Future<Void> start(Database const& cx) {
+		if (enabled) return benchKVStore(this);
+		return Void();
+	}
+	virtual Future<bool> check(Database const& cx) { return true; }
+
+	virtual void getMetrics(vector<PerfMetric>& m) {
+		if (!enabled) return;
+		m.push_back(PerfMetric("Records", valueSizes.size(), false));
+		m.push_back(PerfMetric("Load Took (s)", loadTook, false));
+		m.push_back(PerfMetric("Load Write Amplification", loadWriteAmplification, false));
+		int64_t operations = reads.count.getValue() + updates.getValue() + inserts.getValue() +
+		                     scans.count.getValue() + readModifyWrites.count.getValue();
+		m.push_back(PerfMetric("Operations/sec", runTook ? operations / runTook : 0, false));
+		m.push_back(updates.getMetric());
+		m.push_back(inserts.getMetric());
+		reads.getMetrics(m, runTook);
+		scans.getMetrics(m, runTook);
+		readModifyWrites.getMetrics(m, runTook);
+		commits.getMetrics(m, runTook);
+		m.push_back(PerfMetric("Write Amplification", writeAmplification, false));
+		m.push_back(PerfMetric("Space Amplification", spaceAmplification, false));
+	}
+
+	Key makeKey(int64_t record) {
+		Key k = makeString(keyBytes);
+		uint8_t* s = mutateString(k);
+		*(uint64_t*)s = bigEndian64(record);
+		memset(s + sizeof(uint64_t), '.', keyBytes - sizeof(uint64_t));
+		return k;
+	}
+
+	// Returns an existing record chosen by requestDistribution.  Zipfian ranks are scattered over the records, as
+	// YCSB's scrambled zipfian does, so that the popular records are not neighbors; latest favors the most recently
+	// inserted records.
+	int64_t chooseRecord() {
+		int64_t records = valueSizes.size();
+		if (requestDistribution == "uniform") return deterministicRandom()->randomInt64(0, records);
+		int64_t rank = zipfian_next();
+		if (requestDistribution == "latest") return records - 1 - rank % records;
+		return rank * 2654435761LL % records;
+	}
+
+	int randomValueSize() {
+		if (valueSizePool.size()) return deterministicRandom()->randomChoice(valueSizePool);
+		return deterministicRandom()->randomInt(valueBytesMin, valueBytesMax + 1);
+	}
+
+	// Sets record, which is either existing or the next one to insert, to a new value of a random size
+	void set(int64_t record) {
+		int size = randomValueSize();
+		ValueRef value(valueSource.begin() + deterministicRandom()->randomInt(0, valueSource.size() - size + 1), size);
+		store->set(KeyValueRef(makeKey(record), value));
+		if (record == valueSizes.size()) {
+			valueSizes.push_back(0);
+			liveBytes += keyBytes;
+		}
+		liveBytes += size - valueSizes[record];
+		valueSizes[record] = size;
+		bytesSet += keyBytes + size;
+		uncommitted = true;
+	}
+
+	// Returns the bytes written to the device holding the store since the last call
+	double diskBytesWritten() {
+		return getSystemStatistics(dataFolder, &localIP, &diskStats, false).processDiskWriteSectors * 512;
+	}
+
+	ACTOR static Future<Void> operation(KVStoreBenchWorkload* self) {
+		state double begin = timer();
+		state double op = deterministicRandom()->random01() * self->totalFraction;
+		state Key key;
+		if ((op -= self->readFraction) < 0) {
+			key = self->makeKey(self->chooseRecord());
+			Optional<Value> val = wait(self->store->readValue(key));
+			self->reads.add(timer() - begin);
+		} else if ((op -= self->updateFraction) < 0) {
+			self->set(self->chooseRecord());
+			++self->updates;
+		} else if ((op -= self->insertFraction) < 0) {
+			self->set(self->valueSizes.size());
+			++self->inserts;
+		} else if ((op -= self->scanFraction) < 0) {
+			key = self->makeKey(self->chooseRecord());
+			Standalone<RangeResultRef> kvs = wait(self->store->readRange(
+			    KeyRangeRef(key, normalKeys.end), deterministicRandom()->randomInt(1, self->maxScanLength + 1)));
+			self->scans.add(timer() - begin);
+		} else {
+			state int64_t record = self->chooseRecord();
+			key = self->makeKey(record);
+			Optional<Value> val = wait(self->store->readValue(key));
+			self->set(record);
+			self->readModifyWrites.add(timer() - begin);
+		}
+		return Void();
+	}
+
+	ACTOR static Future<Void> client(KVStoreBenchWorkload* self) {
+		loop {
+			wait(operation(self));
+			wait(yield());
+		}
+	}
+
+	// Commits whatever has been set every commitInterval, as a storage server does, so that the commit latency
+	// depends on the write rate as it does in a cluster.
+	ACTOR static Future<Void> committer(KVStoreBenchWorkload* self) {
+		state double begin;
+		loop {
+			wait(delay(self->commitInterval));
+			if (self->uncommitted) {
+				self->uncommitted = false;
+				begin = timer();
+				wait(self->store->commit());
+				self->commits.add(timer() - begin);
+			}
+		}
+	}
+
+	ACTOR static Future<Void> load(KVStoreBenchWorkload* self) {
+		state double begin = timer();
+		state Future<Void> lastCommit = Void();
+		state int i;
+		printf("Loading %d records\n", self->nodeCount);
+		for (i = 0; i < self->nodeCount; i++) {
+			self->set(i);
+			if (!((i + 1) % 10000) || i + 1 == self->nodeCount) {
+				wait(lastCommit);
+				lastCommit = self->store->commit();
+			}
+		}
+		wait(lastCommit);
+		self->uncommitted = false;
+		self->loadTook = timer() - begin;
+		self->loadWriteAmplification = self->diskBytesWritten() / self->bytesSet;
+		self->bytesSet = 0;
+		TraceEvent("KVStoreBenchLoaded")
+		    .detail("Records", self->nodeCount)
+		    .detail("LogicalBytes", self->liveBytes)
+		    .detail("Took", self->loadTook)
+		    .detail("WriteAmplification", self->loadWriteAmplification);
+		return Void();
+	}
+
+	ACTOR static Future<Void> run(KVStoreBenchWorkload* self) {
+		state ActorCollectionNoErrors ac;
+		state std::vector<Future<Void>> clients;
+		state Future<Void> commits = committer(self);
+		state double begin = now();
+		state double t = begin;
+		state double stopAt = begin + self->testDuration;
+
+		if (self->requestDistribution != "uniform") {
+			zipfian_generator3(0, self->nodeCount - 1, self->zipfConstant);
+		}
+		if (self->saturation) {
+			for (int c = 0; c < self->actorCount; c++) clients.push_back(client(self));
+			wait(delay(self->testDuration));
+		} else {
+			while (t < stopAt) {
+				double end = now();
+				loop {
+					t += 1.0 / self->operationsPerSecond;
+					ac.add(operation(self));
+					if (t >= end) break;
+				}
+				wait(delayUntil(t));
+			}
+		}
+		self->runTook = now() - begin;
+		clients.clear();
+		ac.clear();
+		commits.cancel();
+
+		wait(self->store->commit());
+		self->writeAmplification = self->bytesSet ? self->diskBytesWritten() / self->bytesSet : 0;
+		self->spaceAmplification = double(self->store->getStorageBytes().used) / self->liveBytes;
+		TraceEvent("KVStoreBenchFinished")
+		    .detail("Workload", self->profile)
+		    .detail("StoreType", self->storeType)
+		    .detail("Records", self->valueSizes.size())
+		    .detail("LogicalBytes", self->liveBytes)
+		    .detail("WriteAmplification", self->writeAmplification)
+		    .detail("SpaceAmplification", self->spaceAmplification);
+		self->reads.logHistogram();
+		self->scans.logHistogram();
+		self->readModifyWrites.logHistogram();
+		self->commits.logHistogram();
+		return Void();
+	}
+};
+
+WorkloadFactory<KVStoreBenchWorkload> KVStoreBenchWorkloadFactory("KVStoreBench");
+
+ACTOR Future<Void> benchKVStoreMain(KVStoreBenchWorkload* self) {
+	self->valueSource = StringRef(deterministicRandom()->randomAlphaNumeric(self->valueBytesMax * 2 + 1));
+	self->valueSizes.reserve(self->nodeCount);
+	self->diskBytesWritten();
+
+	wait(KVStoreBenchWorkload::load(self));
+	wait(KVStoreBenchWorkload::run(self));
+	return Void();
+}
+
+ACTOR Future<Void> benchKVStore(KVStoreBenchWorkload* self) {
+	state Error err;
+
+	UID id = deterministicRandom()->randomUniqueID();
+	state bool dispose = !self->filename.size();
+	std::string fn = self->filename.size() ? self->filename : id.toString();
+	if (self->storeType == "ssd")
+		self->store = keyValueStoreSQLite(fn, id, KeyValueStoreType::SSD_BTREE_V2);
+	else if (self->storeType == "ssd-1")
+		self->store = keyValueStoreSQLite(fn, id, KeyValueStoreType::SSD_BTREE_V1);
+	else if (self->storeType == "ssd-2")
+		self->store = keyValueStoreSQLite(fn, id, KeyValueStoreType::SSD_REDWOOD_V1);
+	else if (self->storeType == "ssd-redwood-experimental")
+		self->store = keyValueStoreRedwoodV1(fn, id);
+	else if (self->storeType == "memory")
+		self->store = keyValueStoreMemory(fn, id, 500e6);
+	else if (self->storeType == "memory-radixtree-beta")
+		self->store = keyValueStoreMemory(fn, id, 500e6, "fdr", KeyValueStoreType::MEMORY_RADIXTREE);
+	else
+		ASSERT(false);
+	self->dataFolder = parentDirectory(abspath(fn));
+
+	wait(self->store->init());
+
+	state Future<Void> main = benchKVStoreMain(self);
+	try {
+		choose {
+			when(wait(main)) {}
+			when(wait(self->store->getError())) { ASSERT(false); }
+		}
+	} catch (Error& e) {
+		err = e;
+	}
+	main.cancel();
+
+	Future<Void> c = self->store->onClosed();
+	if (dispose)
+		self->store->dispose();
+	else
+		self->store->close();
+	self->store = NULL;
+	wait(c);
+	if (err.code() != invalid_error_code) throw err;
+	return Void();
+}
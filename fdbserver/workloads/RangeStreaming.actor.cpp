@@ -0,0 +1,149 @@
+/*
+ * RangeStreaming.actor.cpp
+ *
+ * This source file is part of the FoundationDB open source project
+ *
+ * Copyright 2013-2018 Apple Inc. and the FoundationDB project authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "fdbclient/NativeAPI.actor.h"
+#include "fdbclient/Knobs.h"
+#include "fdbserver/TesterInterface.actor.h"
+#include "fdbserver/workloads/workloads.actor.h"
+#include "flow/actorcompiler.h"  // This must be the last #include.
+
+// Checks reads that are streamed from the storage servers (no byte limit) against the same ranges read one byte
+// limited batch at a time, at the same read version.
+struct RangeStreamingWorkload : TestWorkload {
+	int nodeCount, maxValueBytes, pageBytes;
+	double testDuration;
+	PerfIntCounter reads, rowsRead, retries;
+	bool ok;
+
+	RangeStreamingWorkload(WorkloadContext const& wcx)
+		: TestWorkload(wcx), reads("Reads"), rowsRead("RowsRead"), retries("Retries"), ok(true)
+	{
+		nodeCount = getOption( options, LiteralStringRef("nodeCount"), 3000 );
+		maxValueBytes = getOption( options, LiteralStringRef("maxValueBytes"), 2000 );
+		pageBytes = getOption( options, LiteralStringRef("pageBytes"), 10000 );
+		testDuration = getOption( options, LiteralStringRef("testDuration"), 10.0 );
+	}
+
+	virtual std::string description() { return "RangeStreaming"; }
+
+	Key keyForIndex( int n ) { return StringRef(format("rangestream%08d", n)); }
+
+	virtual Future<Void> setup( Database const& cx ) {
+		if( clientId == 0 )
+			return _setup( cx, this );
+		return Void();
+	}
+
+	virtual Future<Void> start( Database const& cx ) {
+		return _start( cx, this );
+	}
+
+	virtual Future<bool> check( Database const& cx ) {
+		return ok;
+	}
+
+	virtual void getMetrics( vector<PerfMetric>& m ) {
+		m.push_back( reads.getMetric() );
+		m.push_back( rowsRead.getMetric() );
+		m.push_back( retries.getMetric() );
+	}
+
+	ACTOR static Future<Void> _setup( Database cx, RangeStreamingWorkload* self ) {
+		state int i = 0;
+		for(; i < self->nodeCount; i += 100) {
+			state Transaction tr( cx );
+			loop {
+				try {
+					for(int j = i; j < std::min(i + 100, self->nodeCount); j++) {
+						tr.set( self->keyForIndex(j), std::string(deterministicRandom()->randomInt(0, self->maxValueBytes + 1), 'x') );
+					}
+					wait( tr.commit() );
+					break;
+				} catch( Error &e ) {
+					wait( tr.onError(e) );
+				}
+			}
+		}
+		return Void();
+	}
+
+	// Reads [begin, end) in batches of at most pageBytes, so that none of the reads are streamed
+	ACTOR static Future<Standalone<RangeResultRef>> readPaged( Transaction* tr, KeyRange keys, int rowLimit, bool reverse, int pageBytes ) {
+		state Standalone<RangeResultRef> output;
+		state KeySelector begin = firstGreaterOrEqual(keys.begin);
+		state KeySelector end = firstGreaterOrEqual(keys.end);
+		loop {
+			state GetRangeLimits limits( rowLimit == GetRangeLimits::ROW_LIMIT_UNLIMITED ? rowLimit : rowLimit - output.size(), pageBytes );
+			Standalone<RangeResultRef> page = wait( tr->getRange(begin, end, limits, false, reverse) );
+			output.arena().dependsOn(page.arena());
+			output.append(output.arena(), page.begin(), page.size());
+			if( !page.more || page.empty() || output.size() == rowLimit )
+				return output;
+			if( reverse )
+				end = KeySelector(firstGreaterOrEqual(output.back().key), output.arena());
+			else
+				begin = KeySelector(firstGreaterThan(output.back().key), output.arena());
+		}
+	}
+
+	ACTOR static Future<Void> _start( Database cx, RangeStreamingWorkload* self ) {
+		state double testStart = now();
+		while( now() - testStart < self->testDuration ) {
+			state int beginIndex = deterministicRandom()->randomInt(0, self->nodeCount);
+			state int endIndex = deterministicRandom()->randomInt(beginIndex, self->nodeCount + 1);
+			state KeyRange keys = KeyRangeRef(self->keyForIndex(beginIndex), self->keyForIndex(endIndex));
+			state int rowLimit = deterministicRandom()->coinflip() ? GetRangeLimits::ROW_LIMIT_UNLIMITED : deterministicRandom()->randomInt(1, self->nodeCount + 1);
+			state bool reverse = deterministicRandom()->coinflip();
+			state Transaction tr( cx );
+			loop {
+				try {
+					state Standalone<RangeResultRef> streamed = wait( tr.getRange(keys, GetRangeLimits(rowLimit), false, reverse) );
+					Standalone<RangeResultRef> paged = wait( readPaged(&tr, keys, rowLimit, reverse, self->pageBytes) );
+
+					int expected = endIndex - beginIndex;
+					if( rowLimit != GetRangeLimits::ROW_LIMIT_UNLIMITED )
+						expected = std::min(expected, rowLimit);
+					bool matches = streamed.size() == expected && paged.size() == expected;
+					for(int i = 0; matches && i < expected; i++) {
+						matches = streamed[i] == paged[i] &&
+							streamed[i].key == self->keyForIndex(reverse ? endIndex - 1 - i : beginIndex + i);
+					}
+					if( !matches ) {
+						TraceEvent(SevError, "RangeStreamingMismatch")
+							.detail("Begin", keys.begin).detail("End", keys.end)
+							.detail("RowLimit", rowLimit).detail("Reverse", reverse)
+							.detail("Expected", expected).detail("Streamed", streamed.size()).detail("Paged", paged.size())
+							.detail("RangeStreaming", CLIENT_KNOBS->ENABLE_RANGE_STREAMING);
+						self->ok = false;
+					}
+					++self->reads;
+					self->rowsRead += streamed.size();
+					break;
+				} catch( Error &e ) {
+					wait( tr.onError(e) );
+					++self->retries;
+				}
+			}
+		}
+		return Void();
+	}
+};
+
+WorkloadFactory<RangeStreamingWorkload> RangeStreamingWorkloadFactory("RangeStreaming");
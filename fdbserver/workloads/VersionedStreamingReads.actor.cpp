@@ -0,0 +1,181 @@
+/*
+ * VersionedStreamingReads.actor.cpp
+ *
+ * This source file is part of the FoundationDB open source project
+ *
+ * Copyright 2013-2018 Apple Inc. and the FoundationDB project authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "fdbclient/NativeAPI.actor.h"
+#include "fdbserver/Knobs.h"
+#include "fdbserver/TesterInterface.actor.h"
+#include "fdbserver/workloads/workloads.actor.h"
+#include "flow/actorcompiler.h"  // This must be the last #include.
+
+// Streams a range at a read version that has aged out of the storage servers' versioned map, as fetchKeys does when a
+// fetch is slow.  With STORAGE_VERSIONED_READS, storage servers keep only STORAGE_VERSIONED_MEMORY_VERSIONS in memory
+// and serve older reads from the storage engine's commits, so the stream must still return what the range held at
+// that version.  Other keys are written while the read version ages, so that the storage engine commits in between.
+struct VersionedStreamingReadsWorkload : TestWorkload {
+	int nodeCount, valueBytes;
+	double testDuration, readAge;
+	PerfIntCounter reads, tooOld, retries;
+	bool ok;
+
+	VersionedStreamingReadsWorkload(WorkloadContext const& wcx)
+		: TestWorkload(wcx), reads("Reads"), tooOld("TooOld"), retries("Retries"), ok(true)
+	{
+		nodeCount = getOption( options, LiteralStringRef("nodeCount"), 1000 );
+		valueBytes = getOption( options, LiteralStringRef("valueBytes"), 100 );
+		testDuration = getOption( options, LiteralStringRef("testDuration"), 30.0 );
+
+		// Halfway between leaving memory and leaving the storage engine's commits, or within the life of a read
+		// transaction when versions are not kept any shorter in memory
+		double memorySeconds = SERVER_KNOBS->STORAGE_VERSIONED_MEMORY_VERSIONS / (double)SERVER_KNOBS->VERSIONS_PER_SECOND;
+		double lifeSeconds = SERVER_KNOBS->MAX_READ_TRANSACTION_LIFE_VERSIONS / (double)SERVER_KNOBS->VERSIONS_PER_SECOND;
+		readAge = getOption( options, LiteralStringRef("readAge"), memorySeconds < lifeSeconds ? (memorySeconds + lifeSeconds) / 2 : lifeSeconds / 2 );
+	}
+
+	virtual std::string description() { return "VersionedStreamingReads"; }
+
+	Key keyForIndex( int n ) { return StringRef(format("versionedstreaming%02d%08d", clientId, n)); }
+	KeyRange readKeys() { return KeyRangeRef( keyForIndex(0), keyForIndex(nodeCount) ); }
+	Key churnKey() { return StringRef(format("versionedstreamingchurn%02d", clientId)); }
+
+	virtual Future<Void> setup( Database const& cx ) {
+		return _setup( cx, this );
+	}
+
+	virtual Future<Void> start( Database const& cx ) {
+		return _start( cx, this );
+	}
+
+	virtual Future<bool> check( Database const& cx ) {
+		if( reads.getValue() == 0 ) {
+			TraceEvent(SevError, "VersionedStreamingReadsNoneSucceeded").detail("TooOld", tooOld.getValue());
+			return false;
+		}
+		return ok;
+	}
+
+	virtual void getMetrics( vector<PerfMetric>& m ) {
+		m.push_back( reads.getMetric() );
+		m.push_back( tooOld.getMetric() );
+		m.push_back( retries.getMetric() );
+	}
+
+	ACTOR static Future<Void> _setup( Database cx, VersionedStreamingReadsWorkload* self ) {
+		state int begin = 0;
+		while( begin < self->nodeCount ) {
+			state Transaction tr( cx );
+			state int end = std::min( begin + 100, self->nodeCount );
+			loop {
+				try {
+					for(int i = begin; i < end; i++) {
+						tr.set( self->keyForIndex(i), StringRef(std::string(self->valueBytes, 'a' + i % 26)) );
+					}
+					wait( tr.commit() );
+					break;
+				} catch( Error &e ) {
+					wait( tr.onError(e) );
+				}
+			}
+			begin = end;
+		}
+		return Void();
+	}
+
+	// Keeps committing a key outside of the range that is read, so that versions advance and storage commits
+	ACTOR static Future<Void> churn( Database cx, VersionedStreamingReadsWorkload* self ) {
+		state int n = 0;
+		loop {
+			state Transaction tr( cx );
+			loop {
+				try {
+					tr.set( self->churnKey(), StringRef(format("%d", n++)) );
+					wait( tr.commit() );
+					break;
+				} catch( Error &e ) {
+					wait( tr.onError(e) );
+				}
+			}
+			wait( delay( 0.05 ) );
+		}
+	}
+
+	ACTOR static Future<Standalone<RangeResultRef>> streamRange( Database cx, KeyRange keys, Version version ) {
+		state PromiseStream<Standalone<RangeResultRef>> results;
+		state Reference<FlowLock> readAhead( new FlowLock( CLIENT_KNOBS->REPLY_BYTE_LIMIT ) );
+		state Future<Void> streamer = getRangeStream( cx, results, keys, version, readAhead );
+		state Standalone<RangeResultRef> all;
+		try {
+			loop {
+				Standalone<RangeResultRef> block = waitNext( results.getFuture() );
+				all.arena().dependsOn( block.arena() );
+				all.append( all.arena(), block.begin(), block.size() );
+				readAhead->release( block.expectedSize() );
+			}
+		} catch( Error &e ) {
+			if( e.code() != error_code_end_of_stream ) throw;
+		}
+		return all;
+	}
+
+	ACTOR static Future<Void> readAtAge( Database cx, VersionedStreamingReadsWorkload* self ) {
+		state Transaction tr( cx );
+		state Version version;
+		state Standalone<RangeResultRef> expected;
+		loop {
+			try {
+				Version v = wait( tr.getReadVersion() );
+				version = v;
+				Standalone<RangeResultRef> r = wait( tr.getRange( self->readKeys(), CLIENT_KNOBS->TOO_MANY ) );
+				ASSERT( !r.more );
+				expected = r;
+
+				wait( delay( self->readAge ) );
+
+				Standalone<RangeResultRef> streamed = wait( streamRange( cx, self->readKeys(), version ) );
+				if( streamed.size() != expected.size() || !std::equal( streamed.begin(), streamed.end(), expected.begin() ) ) {
+					TraceEvent(SevError, "VersionedStreamingReadsMismatch").detail("Version", version)
+						.detail("Expected", expected.size()).detail("Streamed", streamed.size());
+					self->ok = false;
+				}
+				++self->reads;
+				return Void();
+			} catch( Error &e ) {
+				// The storage engine's commits may not hold the range at the read version, for instance after a
+				// storage server restarts or the range moves
+				if( e.code() == error_code_transaction_too_old ) {
+					++self->tooOld;
+					return Void();
+				}
+				wait( tr.onError(e) );
+				++self->retries;
+			}
+		}
+	}
+
+	ACTOR static Future<Void> _start( Database cx, VersionedStreamingReadsWorkload* self ) {
+		state Future<Void> churner = churn( cx, self );
+		state double testStart = now();
+		while( now() - testStart < self->testDuration ) {
+			wait( readAtAge( cx, self ) );
+		}
+		return Void();
+	}
+};
+
+WorkloadFactory<VersionedStreamingReadsWorkload> VersionedStreamingReadsWorkloadFactory("VersionedStreamingReads");
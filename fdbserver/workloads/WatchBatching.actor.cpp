@@ -0,0 +1,169 @@
+/*
+ * WatchBatching.actor.cpp
+ *
+ * This source file is part of the FoundationDB open source project
+ *
+ * Copyright 2013-2018 Apple Inc. and the FoundationDB project authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "fdbclient/NativeAPI.actor.h"
+#include "fdbserver/TesterInterface.actor.h"
+#include "fdbserver/workloads/workloads.actor.h"
+#include "flow/actorcompiler.h"  // This must be the last #include.
+
+// Sets several concurrent watches on each of a run of adjacent keys, so that the client batches them into
+// WatchValuesRequests and the storage server shares one KeyWatch among the watchers of a key.  Half of the keys are
+// then changed, and every watch on them must fire; then the rest are changed, and the remaining watches must fire
+// too.  Some watchers read the key before it changes and set their watch after, so their watch must fire at once.
+struct WatchBatchingWorkload : TestWorkload {
+	int keysPerRound, watchersPerKey;
+	double testDuration, fireTimeout;
+	PerfIntCounter rounds, watches, fired, retries;
+	bool ok;
+
+	WatchBatchingWorkload(WorkloadContext const& wcx)
+		: TestWorkload(wcx), rounds("Rounds"), watches("Watches"), fired("Fired"), retries("Retries"), ok(true)
+	{
+		keysPerRound = getOption( options, LiteralStringRef("keysPerRound"), 20 );
+		watchersPerKey = getOption( options, LiteralStringRef("watchersPerKey"), 3 );
+		testDuration = getOption( options, LiteralStringRef("testDuration"), 30.0 );
+		fireTimeout = getOption( options, LiteralStringRef("fireTimeout"), 300.0 );
+	}
+
+	virtual std::string description() { return "WatchBatching"; }
+
+	Key keyForIndex( int n ) { return StringRef(format("watchbatching%02d%06d", clientId, n)); }
+	Value valueForRound( int round, int changes ) { return StringRef(format("round%d.%d", round, changes)); }
+
+	virtual Future<Void> setup( Database const& cx ) {
+		return Void();
+	}
+
+	virtual Future<Void> start( Database const& cx ) {
+		return _start( cx, this );
+	}
+
+	virtual Future<bool> check( Database const& cx ) {
+		return ok;
+	}
+
+	virtual void getMetrics( vector<PerfMetric>& m ) {
+		m.push_back( rounds.getMetric() );
+		m.push_back( watches.getMetric() );
+		m.push_back( fired.getMetric() );
+		m.push_back( retries.getMetric() );
+	}
+
+	ACTOR static Future<Void> setValues( Database cx, WatchBatchingWorkload* self, int begin, int end, Value value ) {
+		state Transaction tr( cx );
+		loop {
+			try {
+				for(int i = begin; i < end; i++) {
+					tr.set( self->keyForIndex(i), value );
+				}
+				wait( tr.commit() );
+				return Void();
+			} catch( Error &e ) {
+				wait( tr.onError(e) );
+			}
+		}
+	}
+
+	// Returns once key no longer holds original.  A stale watcher sets its watch only after the key has changed,
+	// on the value it read before.
+	ACTOR static Future<Void> watcher( Database cx, WatchBatchingWorkload* self, Key key, Value original,
+	                                   Future<Void> changed, bool stale ) {
+		state Transaction tr( cx );
+		loop {
+			try {
+				Optional<Value> value = wait( tr.get(key) );
+				if( !value.present() || value.get() != original ) {
+					break;
+				}
+				if( stale ) {
+					wait( changed );
+				}
+				state Future<Void> watch = tr.watch( key );
+				wait( tr.commit() );
+				++self->watches;
+				wait( watch );
+				break;
+			} catch( Error &e ) {
+				wait( tr.onError(e) );
+				++self->retries;
+				stale = false;
+			}
+		}
+		++self->fired;
+		return Void();
+	}
+
+	ACTOR static Future<Void> waitForFired( WatchBatchingWorkload* self, std::vector<Future<Void>> watchers,
+	                                        int round, const char* which ) {
+		try {
+			wait( timeoutError( waitForAll(watchers), self->fireTimeout ) );
+		} catch( Error &e ) {
+			if( e.code() != error_code_timed_out ) throw;
+			int pending = 0;
+			for(auto& w : watchers) {
+				if( !w.isReady() ) pending++;
+			}
+			TraceEvent(SevError, "WatchBatchingWatchesDidNotFire").detail("Round", round).detail("Keys", which)
+				.detail("Pending", pending);
+			self->ok = false;
+		}
+		return Void();
+	}
+
+	ACTOR static Future<Void> _start( Database cx, WatchBatchingWorkload* self ) {
+		state double testStart = now();
+		state int round = 0;
+		for(; now() - testStart < self->testDuration; round++) {
+			state Value original = self->valueForRound(round, 0);
+			wait( setValues(cx, self, 0, self->keysPerRound, original) );
+
+			state Promise<Void> firstChanged;
+			state Promise<Void> restChanged;
+			state std::vector<Future<Void>> firstWatchers;
+			state std::vector<Future<Void>> restWatchers;
+			state int half = self->keysPerRound / 2;
+			for(int i = 0; i < self->keysPerRound; i++) {
+				for(int w = 0; w < self->watchersPerKey; w++) {
+					bool stale = w == 0 && deterministicRandom()->random01() < 0.5;
+					if( i < half )
+						firstWatchers.push_back( watcher(cx, self, self->keyForIndex(i), original, firstChanged.getFuture(), stale) );
+					else
+						restWatchers.push_back( watcher(cx, self, self->keyForIndex(i), original, restChanged.getFuture(), stale) );
+				}
+			}
+
+			// Let the watches reach the storage servers before changing anything
+			wait( delay( deterministicRandom()->random01() ) );
+
+			wait( setValues(cx, self, 0, half, self->valueForRound(round, 1)) );
+			firstChanged.send(Void());
+			wait( waitForFired(self, firstWatchers, round, "First") );
+
+			wait( setValues(cx, self, half, self->keysPerRound, self->valueForRound(round, 1)) );
+			restChanged.send(Void());
+			wait( waitForFired(self, restWatchers, round, "Rest") );
+
+			++self->rounds;
+		}
+		return Void();
+	}
+};
+
+WorkloadFactory<WatchBatchingWorkload> WatchBatchingWorkloadFactory("WatchBatching");
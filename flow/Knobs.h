@@ -126,6 +126,10 @@ public:
 	int PAGE_WRITE_CHECKSUM_HISTORY;
 	int DISABLE_POSIX_KERNEL_AIO;
 
+	//AsyncFileIOUring
+	int USE_IO_URING; // Use io_uring instead of kernel AIO for uncached files, buffered as well as unbuffered, if the kernel supports it and DISABLE_POSIX_KERNEL_AIO is not set
+	int IO_URING_QUEUE_DEPTH; // Submission ring entries, and so the most requests in flight at once
+
 	//AsyncFileNonDurable
 	double MAX_PRIOR_MODIFICATION_DELAY;
 
@@ -91,6 +91,13 @@ public: // introduced features
 	PROTOCOL_VERSION_FEATURE(0x0FDB00B063000000LL, UnifiedTLogSpilling);
 	PROTOCOL_VERSION_FEATURE(0x0FDB00B063010000LL, BackupWorker);
 	PROTOCOL_VERSION_FEATURE(0x0FDB00B063010000LL, ReportConflictingKeys);
+	PROTOCOL_VERSION_FEATURE(0x0FDB00B063010002LL, StreamingRangeReads);
+	PROTOCOL_VERSION_FEATURE(0x0FDB00B063010003LL, GetValues);
+	PROTOCOL_VERSION_FEATURE(0x0FDB00B063010004LL, MappedRangeReads);
+	PROTOCOL_VERSION_FEATURE(0x0FDB00B063010005LL, ChangeFeeds);
+	PROTOCOL_VERSION_FEATURE(0x0FDB00B063010006LL, RangeSplitPoints);
+	PROTOCOL_VERSION_FEATURE(0x0FDB00B063010007LL, WatchValues);
+	PROTOCOL_VERSION_FEATURE(0x0FDB00B063010008LL, StorageServerFeatures);
 };
 
 // These impact both communications and the deserialization of certain database and IKeyValueStore keys.
@@ -100,7 +107,7 @@ public: // introduced features
 //
 //                                                         xyzdev
 //                                                         vvvv
-constexpr ProtocolVersion currentProtocolVersion(0x0FDB00B063010001LL);
+constexpr ProtocolVersion currentProtocolVersion(0x0FDB00B063010009LL);
 // This assert is intended to help prevent incrementing the leftmost digits accidentally. It will probably need to
 // change when we reach version 10.
 static_assert(currentProtocolVersion.version() < 0x0FDB00B100000000LL, "Unexpected protocol version");
@@ -138,6 +138,12 @@ ERROR( no_commit_version, 2021, "Transaction is read-only and therefore does not
 ERROR( environment_variable_network_option_failed, 2022, "Environment variable network option could not be set" )
 ERROR( transaction_read_only, 2023, "Attempted to commit a transaction specified as read-only" )
 ERROR( invalid_cache_eviction_policy, 2024, "Invalid cache eviction policy, only random and lru are supported" )
+ERROR( mapper_bad_index, 2025, "Mapper refers to an element of the index key or value that is not valid" )
+ERROR( mapper_bad_range_descriptor, 2026, "Mapper range descriptor {...} must be its last element" )
+ERROR( mapper_not_tuple, 2027, "Mapper, index key or index value is not a valid tuple" )
+ERROR( mapped_range_reads_your_writes, 2028, "Mapped range read depends on keys written in the transaction" )
+ERROR( change_feed_not_registered, 2029, "Change feed not registered" )
+ERROR( change_feed_popped, 2030, "Change feed mutations before the requested version are no longer available" )
 
 ERROR( incompatible_protocol_version, 2100, "Incompatible protocol version" )
 ERROR( transaction_too_large, 2101, "Transaction exceeds byte limit" )
@@ -581,7 +581,12 @@ struct NotifiedQueue : private SingleCallback<T>, FastAllocated<NotifiedQueue<T>
 	bool isError() const { return queue.empty() && error.isValid(); }  // the *next* thing queued is an error
 	uint32_t size() const { return queue.size(); }
 
-	T pop() {
+	// True if a value sent now would be handed directly to a waiting callback rather than queued
+	bool shouldFireImmediately() const { return SingleCallback<T>::next != this; }
+
+	virtual T pop() { return popImpl(); }
+
+	T popImpl() {
 		if (queue.empty()) {
 			if (error.isValid()) throw error;
 			throw internal_error();